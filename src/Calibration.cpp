@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "Calibration.hpp"
+#include "Defines.hpp"
+#include "LodEval.hpp"
+#include "Renderer.hpp"
+#include "TessLod.hpp"
+
+static bool parse_profile(const std::string &line, TessProfile &profile)
+{
+    std::istringstream ss{line};
+    std::string maxTess, scale, gpuMs, error;
+    if (!std::getline(ss, profile.renderer, '\t') || !std::getline(ss, profile.version, '\t') ||
+        !std::getline(ss, maxTess, '\t') || !std::getline(ss, scale, '\t') || !std::getline(ss, gpuMs, '\t') || !std::getline(ss, error))
+        return false;
+
+    try
+    {
+        profile.maxTessLevel = std::stoi(maxTess);
+        profile.rangeScale = std::stof(scale);
+        profile.gpuMs = std::stof(gpuMs);
+        profile.heightError = std::stof(error);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+    return profile.maxTessLevel > 0 && profile.rangeScale > 0.0f;
+}
+
+bool loadTessProfile(const std::string &filepath, const std::string &renderer, const std::string &version, TessProfile &profile)
+{
+    std::ifstream ifs{filepath, std::ios::in};
+    if (!ifs.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        TessProfile entry;
+        if (line.empty() || line[0] == '#' || !parse_profile(line, entry))
+            continue;
+        if (entry.renderer == renderer && entry.version == version)
+        {
+            profile = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+void saveTessProfile(const std::string &filepath, const TessProfile &profile)
+{
+    std::vector<std::string> kept;
+    {
+        std::ifstream ifs{filepath, std::ios::in};
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            TessProfile entry;
+            if (!line.empty() && line[0] != '#' && parse_profile(line, entry) &&
+                !(entry.renderer == profile.renderer && entry.version == profile.version))
+                kept.push_back(line);
+        }
+    }
+
+    std::ofstream ofs{filepath, std::ios::out | std::ios::trunc};
+    if (!ofs.is_open())
+        EXIT("Failed to write tess profiles " + filepath);
+
+    ofs << "# renderer\tversion\tmax_tess\trange_scale\tgpu_ms\theight_p95\n";
+    for (const std::string &line : kept)
+        ofs << line << '\n';
+    ofs << profile.renderer << '\t' << profile.version << '\t' << profile.maxTessLevel << '\t' << profile.rangeScale << '\t'
+        << profile.gpuMs << '\t' << profile.heightError << '\n';
+}
+
+TessProfile calibrateTessProfile(const CameraPath &path, const CalibrationSettings &settings)
+{
+    std::vector<LodView> views = sampleLodViews(path, settings.views);
+
+    LodEvaluator evaluator;
+    evaluator.init(g_app.viewerWidth, g_app.viewerHeight);
+    evaluator.captureReference(views);
+
+    std::vector<LodResult> results;
+    for (const int maxTess : settings.maxTessLevels)
+    {
+        for (const float scale : settings.rangeScales)
+        {
+            const LodResult &result = results.emplace_back(evaluator.measure(views, maxTess, scale, settings.repeats));
+            LOG("  max tess %2d, range scale %.2f: %.3f ms, height p95 %.3f\n", maxTess, scale, result.gpuMs, result.height.p95);
+        }
+    }
+    evaluator.release();
+
+    // triangles break ties when the timer resolution cannot tell configurations apart
+    const auto cheaper = [](const LodResult &a, const LodResult &b) {
+        return a.gpuMs != b.gpuMs ? a.gpuMs < b.gpuMs : a.triangles < b.triangles;
+    };
+
+    const LodResult *best = nullptr;
+    for (const LodResult &result : results)
+        if (result.height.p95 <= settings.errorBudget && (best == nullptr || cheaper(result, *best)))
+            best = &result;
+    if (best == nullptr)
+        best = &*std::min_element(results.begin(), results.end(),
+                                  [](const LodResult &a, const LodResult &b) { return a.height.p95 < b.height.p95; });
+
+    TessProfile profile;
+    profile.renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    profile.version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    profile.maxTessLevel = best->maxTessLevel;
+    profile.rangeScale = best->rangeScale;
+    profile.gpuMs = static_cast<float>(best->gpuMs);
+    profile.heightError = static_cast<float>(best->height.p95);
+    return profile;
+}
+
+void applyTessProfile(const TessProfile &profile)
+{
+    g_app.maxTessLevel = profile.maxTessLevel;
+    g_app.lodRanges = scaled_lod_ranges(profile.rangeScale);
+}
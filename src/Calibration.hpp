@@ -0,0 +1,53 @@
+#ifndef CALIBRATION_HPP
+#define CALIBRATION_HPP
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "CameraPath.hpp"
+
+/**
+ * @brief Tessellation settings calibrated for one GPU / driver. Stored one
+ * profile per line, tab separated, in the file g_app.calibrationPath names:
+ *
+ *     # renderer  version  max_tess  range_scale  gpu_ms  height_p95
+ *
+ * A new GL_VERSION string (driver update) counts as a new device.
+ */
+struct TessProfile
+{
+    std::string renderer; // GL_RENDERER
+    std::string version;  // GL_VERSION
+    int maxTessLevel = 64;
+    float rangeScale = 1.0f; // of DEFAULT_LOD_RANGES
+    float gpuMs = 0.0f;      // measured on the calibration path
+    float heightError = 0.0f; // p95 world units against the max tess reference
+};
+
+struct CalibrationSettings
+{
+    std::vector<int> maxTessLevels = {16, 24, 32, 48, 64};
+    std::vector<float> rangeScales = {0.5f, 0.75f, 1.0f, 1.5f, 2.0f};
+    uint32_t views = 6;
+    uint32_t repeats = 3;
+    float errorBudget = 0.5f; // height p95 the chosen profile may not exceed
+};
+
+// false when the file or the current device's entry does not exist
+bool loadTessProfile(const std::string &filepath, const std::string &renderer, const std::string &version, TessProfile &profile);
+// replaces the entry of the same device, keeps the others
+void saveTessProfile(const std::string &filepath, const TessProfile &profile);
+
+/**
+ * @brief Sweeps g_app's max tess level and LOD band scale over the camera
+ * path, keeps the cheapest GPU time within the error budget (or the smallest
+ * error when nothing fits). Blocks for the whole sweep; needs init() and
+ * setupFrameGraph(), the gui pass disabled.
+ */
+TessProfile calibrateTessProfile(const CameraPath &path, const CalibrationSettings &settings);
+
+void applyTessProfile(const TessProfile &profile);
+
+#endif // CALIBRATION_HPP
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "CameraPath.hpp"
+#include "Defines.hpp"
+
+void CameraPath::sample(float time, glm::vec3 &pos, float &yaw, float &pitch) const
+{
+    if (keys.size() == 1 || time <= keys.front().time)
+    {
+        pos = keys.front().pos;
+        yaw = keys.front().yaw;
+        pitch = keys.front().pitch;
+        return;
+    }
+
+    if (time >= keys.back().time)
+    {
+        pos = keys.back().pos;
+        yaw = keys.back().yaw;
+        pitch = keys.back().pitch;
+        return;
+    }
+
+    const auto next = std::upper_bound(keys.begin(), keys.end(), time, [](float t, const Key &key) { return t < key.time; });
+    const Key &b = *next;
+    const Key &a = *(next - 1);
+
+    const float span = b.time - a.time;
+    const float w = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+    pos = glm::mix(a.pos, b.pos, w);
+    yaw = glm::mix(a.yaw, b.yaw, w);
+    pitch = glm::mix(a.pitch, b.pitch, w);
+}
+
+CameraPath loadCameraPath(const std::string &filepath)
+{
+    std::ifstream ifs{filepath, std::ios::in};
+    if (!ifs.is_open())
+        EXIT("Failed to open camera path " + filepath);
+
+    CameraPath path;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(ifs, line))
+    {
+        ++lineNumber;
+
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.resize(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::istringstream ss{line};
+        CameraPath::Key key;
+        if (!(ss >> key.time >> key.pos.x >> key.pos.y >> key.pos.z >> key.yaw >> key.pitch))
+            EXIT("Malformed camera key in " + filepath + ":" + std::to_string(lineNumber));
+
+        if (!path.keys.empty() && key.time < path.keys.back().time)
+            EXIT("Camera keys must be sorted by time in " + filepath + ":" + std::to_string(lineNumber));
+
+        path.keys.push_back(key);
+    }
+
+    if (path.keys.empty())
+        EXIT("Camera path " + filepath + " has no keys");
+
+    return path;
+}
@@ -0,0 +1,37 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Keyframed camera path, one key per line:
+ *
+ *     # time(s)  pos.x  pos.y  pos.z  yaw(deg)  pitch(deg)
+ *     0.0        -900   120    500    45        -15
+ *
+ * Positions and angles are interpolated linearly between keys, the angle
+ * convention matches setCameraOrientation().
+ */
+struct CameraPath
+{
+    struct Key
+    {
+        float time;
+        glm::vec3 pos;
+        float yaw;
+        float pitch;
+    };
+
+    std::vector<Key> keys;
+
+    float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    void sample(float time, glm::vec3 &pos, float &yaw, float &pitch) const;
+};
+
+CameraPath loadCameraPath(const std::string &filepath);
+
+#endif // CAMERA_PATH_HPP
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "CollisionMesh.hpp"
+#include "Defines.hpp"
+#include "Profiler.hpp"
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+namespace
+{
+// the aligned quadtree of one lod, in global cell coordinates (cell i spans texel centers i and i + 1)
+struct BlockTree
+{
+    const HeightField &field;
+    int32_t lastX, lastY; // last texel, cells end there
+    uint8_t threshold;    // largest texel range a block may keep
+
+    // the pyramid block that holds the texels of block (x, y, size), exact for sizes the pyramid has
+    void range(int32_t x, int32_t y, int32_t size, uint8_t &lo, uint8_t &hi) const
+    {
+        size_t level = 0;
+        while ((2 << level) < size)
+            ++level;
+        level = std::min(level, field.bounds.size() - 1);
+
+        const MinMaxLevel &l = field.bounds[level];
+        const uint32_t bx = static_cast<uint32_t>(x >> (level + 1)), by = static_cast<uint32_t>(y >> (level + 1));
+        lo = l.min.at(bx, by);
+        hi = l.max.at(bx, by);
+    }
+
+    bool empty(int32_t x, int32_t y) const { return x >= lastX || y >= lastY; }
+
+    // blocks over the field's last texel split until they fit, so every leaf is a whole square
+    bool leaf(int32_t x, int32_t y, int32_t size) const
+    {
+        if (size == 1)
+            return true;
+        if (x + size > lastX || y + size > lastY)
+            return false;
+        uint8_t lo, hi;
+        range(x, y, size, lo, hi);
+        return hi - lo <= threshold;
+    }
+
+    template <typename Fn>
+    void leaves(int32_t x, int32_t y, int32_t size, Fn &&fn) const
+    {
+        if (empty(x, y))
+            return;
+        if (leaf(x, y, size))
+        {
+            fn(x, y, size);
+            return;
+        }
+        const int32_t half = size / 2;
+        leaves(x, y, half, fn);
+        leaves(x + half, y, half, fn);
+        leaves(x, y + half, half, fn);
+        leaves(x + half, y + half, half, fn);
+    }
+
+    // leaves of the block that touch the line x = edge (vertical) or y = edge, reports their corners on it
+    template <typename Fn>
+    void edgeCorners(int32_t x, int32_t y, int32_t size, bool vertical, int32_t edge, Fn &&fn) const
+    {
+        if (empty(x, y))
+            return;
+        const int32_t lo = vertical ? x : y;
+        if (edge < lo || edge > lo + size)
+            return;
+        if (leaf(x, y, size))
+        {
+            if (vertical)
+            {
+                fn(edge, y);
+                fn(edge, y + size);
+            }
+            else
+            {
+                fn(x, edge);
+                fn(x + size, edge);
+            }
+            return;
+        }
+        const int32_t half = size / 2;
+        edgeCorners(x, y, half, vertical, edge, fn);
+        edgeCorners(x + half, y, half, vertical, edge, fn);
+        edgeCorners(x, y + half, half, vertical, edge, fn);
+        edgeCorners(x + half, y + half, half, vertical, edge, fn);
+    }
+};
+} // namespace
+
+void CollisionMesh::decode(std::vector<glm::vec3> &out) const
+{
+    out.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+        out[i] = position(i);
+}
+
+glm::uvec2 collisionTileCount(const HeightField &field, uint32_t tileSize)
+{
+    // cells lie between texel centers, one fewer than texels
+    return {(field.width - 1 + tileSize - 1) / tileSize, (field.height - 1 + tileSize - 1) / tileSize};
+}
+
+CollisionMesh buildCollisionMesh(const HeightField &field, CollisionTileKey key, const CollisionMeshSettings &settings)
+{
+    const int32_t tile = static_cast<int32_t>(settings.tileSize);
+    if (tile < 1 || tile > static_cast<int32_t>(CollisionMesh::MAX_TILE_SIZE) || (tile & (tile - 1)) != 0)
+        EXIT("Collision tile size must be a power of two up to " + std::to_string(CollisionMesh::MAX_TILE_SIZE));
+
+    constexpr float STEP = HEIGHT_SCALE / 255.0f;
+    const float bound = settings.baseError * std::ldexp(1.0f, static_cast<int>(key.lod));
+    const BlockTree tree{field, static_cast<int32_t>(field.width) - 1, static_cast<int32_t>(field.height) - 1,
+                         static_cast<uint8_t>(std::clamp(std::floor(bound / STEP), 0.0f, 255.0f))};
+
+    CollisionMesh mesh;
+    mesh.key = key;
+    const float texelX = field.extent.x / static_cast<float>(field.width);
+    const float texelZ = field.extent.y / static_cast<float>(field.height);
+    const int32_t x0 = static_cast<int32_t>(key.x) * tile, y0 = static_cast<int32_t>(key.y) * tile;
+    mesh.origin = {field.origin.x + (static_cast<float>(x0) + 0.5f) * texelX, HEIGHT_OFFSET,
+                   field.origin.y + (static_cast<float>(y0) + 0.5f) * texelZ};
+    mesh.scale = {texelX, STEP, texelZ};
+
+    if (tree.empty(x0, y0))
+        return mesh;
+
+    // grid points some leaf has a corner on, this tile's and the neighbours' along the shared edges
+    const int32_t side = tile + 1;
+    std::vector<uint8_t> used(static_cast<size_t>(side) * side, 0u);
+    const auto mark = [&](int32_t x, int32_t y) { used[static_cast<size_t>(y - y0) * side + static_cast<size_t>(x - x0)] = 1u; };
+
+    struct Leaf
+    {
+        int32_t x, y, size;
+    };
+    std::vector<Leaf> leaves;
+    tree.leaves(x0, y0, tile, [&](int32_t x, int32_t y, int32_t size) {
+        leaves.push_back({x, y, size});
+        mark(x, y);
+        mark(x + size, y);
+        mark(x, y + size);
+        mark(x + size, y + size);
+    });
+
+    // the neighbours' leaves along the shared edges, their corners are on the same lines as ours
+    if (x0 > 0)
+        tree.edgeCorners(x0 - tile, y0, tile, true, x0, mark);
+    tree.edgeCorners(x0 + tile, y0, tile, true, x0 + tile, mark);
+    if (y0 > 0)
+        tree.edgeCorners(x0, y0 - tile, tile, false, y0, mark);
+    tree.edgeCorners(x0, y0 + tile, tile, false, y0 + tile, mark);
+
+    // packed vertices, created on first use
+    std::vector<uint16_t> remap(used.size(), UINT16_MAX);
+    const auto vertex = [&](int32_t x, int32_t y) {
+        uint16_t &index = remap[static_cast<size_t>(y - y0) * side + static_cast<size_t>(x - x0)];
+        if (index == UINT16_MAX)
+        {
+            index = static_cast<uint16_t>(mesh.vertices.size());
+            const uint8_t texel = field.texels.at(static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+            mesh.vertices.push_back(static_cast<uint32_t>(x - x0) | static_cast<uint32_t>(y - y0) << 8 | static_cast<uint32_t>(texel) << 16);
+        }
+        return index;
+    };
+    // the rings below run counter-clockwise in the (x, z) plane, which faces down with y up; swap so triangles face up
+    const auto triangle = [&](uint16_t a, uint16_t b, uint16_t c) { mesh.indices.insert(mesh.indices.end(), {a, c, b}); };
+
+    float maxError = 0.0f;
+    std::vector<uint16_t> ring;
+    for (const Leaf &leaf : leaves)
+    {
+        const int32_t x = leaf.x, y = leaf.y, s = leaf.size;
+        const auto height = [&](int32_t px, int32_t py) { return field.texels.at(static_cast<uint32_t>(px), static_cast<uint32_t>(py)); };
+
+        // boundary counter-clockwise in the plane, with the grid points finer neighbours put on it
+        ring.clear();
+        const auto walk = [&](int32_t ax, int32_t ay, int32_t dx, int32_t dy) {
+            ring.push_back(vertex(ax, ay));
+            for (int32_t k = 1; k < s; ++k)
+            {
+                const int32_t px = ax + dx * k, py = ay + dy * k;
+                if (used[static_cast<size_t>(py - y0) * side + static_cast<size_t>(px - x0)])
+                    ring.push_back(vertex(px, py));
+            }
+        };
+        walk(x, y, 1, 0);
+        walk(x + s, y, 0, 1);
+        walk(x + s, y + s, -1, 0);
+        walk(x, y + s, 0, -1);
+
+        if (s == 1)
+        {
+            // a cell: the two triangles leave the bilinear patch by a quarter of its twist
+            const int twist = height(x, y) - height(x + 1, y) - height(x, y + 1) + height(x + 1, y + 1);
+            maxError = std::max(maxError, 0.25f * STEP * static_cast<float>(std::abs(twist)));
+        }
+        else
+        {
+            uint8_t lo, hi;
+            tree.range(x, y, s, lo, hi);
+            maxError = std::max(maxError, STEP * static_cast<float>(hi - lo));
+        }
+
+        if (ring.size() == 4)
+        {
+            triangle(ring[0], ring[1], ring[2]);
+            triangle(ring[0], ring[2], ring[3]);
+            continue;
+        }
+
+        // fan from the center texel, inside the block so it stays within the block's range
+        const uint16_t center = vertex(x + s / 2, y + s / 2);
+        for (size_t i = 0; i < ring.size(); ++i)
+            triangle(center, ring[i], ring[(i + 1) % ring.size()]);
+    }
+    mesh.maxError = maxError;
+    return mesh;
+}
+
+void CollisionMeshService::init(const CollisionMeshSettings &config)
+{
+    if (!builders.empty())
+        release();
+
+    settings = config;
+    quit = false;
+    counters = {};
+    for (size_t i = 0; i < std::max<size_t>(settings.threads, 1u); ++i)
+        builders.emplace_back(&CollisionMeshService::builderLoop, this, i);
+}
+
+void CollisionMeshService::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread &builder : builders)
+        builder.join();
+    builders.clear();
+
+    cache.clear();
+    lru.clear();
+    queue.clear();
+    pending.clear();
+    field.reset();
+}
+
+void CollisionMeshService::syncField()
+{
+    std::shared_ptr<const HeightField> current = currentHeightField();
+    if (current == field)
+        return;
+
+    // meshes of the old field stay valid for whoever holds them, they just leave the cache
+    changed.clear();
+    if (field && current && heightFieldChanges(*current, *field, changed))
+    {
+        for (auto it = cache.begin(); it != cache.end();)
+            if (touched(it->first, changed))
+            {
+                counters.cachedBytes -= it->second.mesh->bytes();
+                lru.erase(it->second.lru);
+                it = cache.erase(it);
+                ++counters.evicted;
+            }
+            else
+                ++it;
+    }
+    else
+    {
+        counters.evicted += cache.size();
+        cache.clear();
+        lru.clear();
+        counters.cachedBytes = 0;
+    }
+    field = std::move(current);
+}
+
+bool CollisionMeshService::touched(CollisionTileKey key, const std::vector<TexelRect> &rects) const
+{
+    // a tile reads texels tileSize * key .. tileSize * (key + 1), one more each side covers the bound blocks
+    const int64_t x0 = static_cast<int64_t>(key.x) * settings.tileSize - 1, x1 = x0 + settings.tileSize + 2;
+    const int64_t y0 = static_cast<int64_t>(key.y) * settings.tileSize - 1, y1 = y0 + settings.tileSize + 2;
+    for (const TexelRect &rect : rects)
+        if (rect.x0 <= x1 && rect.x1 >= x0 && rect.y0 <= y1 && rect.y1 >= y0)
+            return true;
+    return false;
+}
+
+std::shared_ptr<const CollisionMesh> CollisionMeshService::request(CollisionTileKey key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    syncField();
+    if (!field)
+        return nullptr;
+
+    const auto it = cache.find(key);
+    if (it != cache.end())
+    {
+        ++counters.hits;
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return it->second.mesh;
+    }
+
+    ++counters.misses;
+    const glm::uvec2 tiles = collisionTileCount(*field, settings.tileSize);
+    if (key.x < tiles.x && key.y < tiles.y && pending.insert(key).second)
+    {
+        queue.push_back(key);
+        wake.notify_one();
+    }
+    return nullptr;
+}
+
+void CollisionMeshService::requestAround(glm::vec2 position, float radius, uint32_t lod, std::vector<std::shared_ptr<const CollisionMesh>> &out)
+{
+    std::shared_ptr<const HeightField> snapshot = currentHeightField();
+    if (!snapshot)
+        return;
+
+    // tile range in cells, cell i starts at texel center i
+    const float kx = static_cast<float>(snapshot->width) / snapshot->extent.x;
+    const float kz = static_cast<float>(snapshot->height) / snapshot->extent.y;
+    const glm::uvec2 tiles = collisionTileCount(*snapshot, settings.tileSize);
+    const auto tileOf = [&](float cell, uint32_t count) {
+        return static_cast<uint32_t>(std::clamp(std::floor(cell / static_cast<float>(settings.tileSize)), 0.0f, static_cast<float>(count - 1)));
+    };
+    const uint32_t tx0 = tileOf((position.x - radius - snapshot->origin.x) * kx - 0.5f, tiles.x);
+    const uint32_t tx1 = tileOf((position.x + radius - snapshot->origin.x) * kx - 0.5f, tiles.x);
+    const uint32_t ty0 = tileOf((position.y - radius - snapshot->origin.y) * kz - 0.5f, tiles.y);
+    const uint32_t ty1 = tileOf((position.y + radius - snapshot->origin.y) * kz - 0.5f, tiles.y);
+
+    for (uint32_t ty = ty0; ty <= ty1; ++ty)
+        for (uint32_t tx = tx0; tx <= tx1; ++tx)
+            if (std::shared_ptr<const CollisionMesh> mesh = request({tx, ty, lod}))
+                out.push_back(std::move(mesh));
+}
+
+void CollisionMeshService::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return queue.empty() && building == 0; });
+}
+
+CollisionMeshService::Stats CollisionMeshService::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = counters;
+    result.cachedMeshes = cache.size();
+    result.queued = queue.size();
+    return result;
+}
+
+void CollisionMeshService::insert(std::shared_ptr<const CollisionMesh> mesh)
+{
+    const CollisionTileKey key = mesh->key;
+    counters.cachedBytes += mesh->bytes();
+    lru.push_front(key);
+    cache[key] = {std::move(mesh), lru.begin()};
+
+    while (counters.cachedBytes > settings.cacheBytes && cache.size() > 1)
+    {
+        const auto victim = cache.find(lru.back());
+        counters.cachedBytes -= victim->second.mesh->bytes();
+        cache.erase(victim);
+        lru.pop_back();
+        ++counters.evicted;
+    }
+}
+
+void CollisionMeshService::builderLoop(size_t builder)
+{
+    g_profiler.setThreadName("collision " + std::to_string(builder));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [&] { return quit || !queue.empty(); });
+        if (quit)
+            return;
+
+        // newest first, requests from where bodies are now
+        const CollisionTileKey key = queue.back();
+        queue.pop_back();
+        std::shared_ptr<const HeightField> source = field;
+        ++building;
+
+        lock.unlock();
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const CollisionMesh> mesh;
+        {
+            PROFILE_CPU("collision_mesh");
+            mesh = std::make_shared<const CollisionMesh>(buildCollisionMesh(*source, key, settings));
+        }
+        const uint64_t nanos = elapsed_ns(start);
+        lock.lock();
+
+        ++counters.built;
+        counters.buildNanos += nanos;
+        counters.triangles += mesh->triangleCount();
+        pending.erase(key);
+        // a field published meanwhile keeps the mesh only if it changed nothing under the tile
+        if (source != field)
+        {
+            changed.clear();
+            if (!field || !heightFieldChanges(*field, *source, changed) || touched(key, changed))
+                mesh.reset();
+        }
+        if (mesh)
+            insert(std::move(mesh));
+
+        if (--building == 0 && queue.empty())
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef COLLISION_MESH_HPP
+#define COLLISION_MESH_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+
+struct CollisionTileKey
+{
+    uint32_t x = 0, y = 0; // tile, tileSize texels per side
+    uint32_t lod = 0;      // error bound baseError * 2^lod
+
+    bool operator==(const CollisionTileKey &other) const { return x == other.x && y == other.y && lod == other.lod; }
+};
+
+struct CollisionTileKeyHash
+{
+    size_t operator()(const CollisionTileKey &key) const
+    {
+        return (static_cast<size_t>(key.y) * 0x9e3779b97f4a7c15ull ^ key.x) * 31u + key.lod;
+    }
+};
+
+struct CollisionMeshSettings
+{
+    uint32_t tileSize = 64;  // cells per tile side, power of two up to MAX_TILE_SIZE
+    float baseError = 0.25f; // world units at lod 0, one 8 bit height step
+    size_t cacheBytes = 32u << 20;
+    size_t threads = 1; // builder threads, kept off the render loop's WorkerPool
+};
+
+/**
+ * @brief Triangle mesh of one tile between texel centers. Vertices are
+ * packed grid coordinates: x and z in tile cells, the 8 bit texel as
+ * height, so a vertex is 4 bytes and world space is the affine map
+ * origin + scale * (x, texel, z). Indices are 16 bit, counter-clockwise
+ * seen from above.
+ */
+struct CollisionMesh
+{
+    static constexpr uint32_t MAX_TILE_SIZE = 128; // keeps vertex x and z in 8 bits
+
+    CollisionTileKey key;
+    std::vector<uint32_t> vertices; // x | z << 8 | texel << 16
+    std::vector<uint16_t> indices;  // 3 per triangle
+    glm::vec3 origin{0.0f};         // world position of (0, 0, 0)
+    glm::vec3 scale{1.0f};
+    float maxError = 0.0f; // world units, bound on |mesh - terrain| over the tile
+
+    size_t triangleCount() const { return indices.size() / 3; }
+    size_t bytes() const { return vertices.size() * sizeof(uint32_t) + indices.size() * sizeof(uint16_t) + sizeof(*this); }
+
+    glm::vec3 position(size_t vertex) const
+    {
+        const uint32_t v = vertices[vertex];
+        return origin + scale * glm::vec3{static_cast<float>(v & 255u), static_cast<float>(v >> 16), static_cast<float>((v >> 8) & 255u)};
+    }
+
+    // unpacked positions for engines that want float3 vertices
+    void decode(std::vector<glm::vec3> &out) const;
+};
+
+// tiles covering the field, the last row and column may be partial
+glm::uvec2 collisionTileCount(const HeightField &field, uint32_t tileSize);
+
+/**
+ * @brief Error-bounded decimation of one tile from the field's min/max
+ * pyramid. An aligned block becomes one quad when its height range is
+ * within the bound (every point of a quad over its own corners lies in that
+ * range, so the range bounds the error), otherwise it splits in four. Quads
+ * whose edges carry finer neighbours' corners are fanned from their center
+ * so the mesh has no T-junctions; along the tile border the neighbouring
+ * tile's quadtree at the same lod is walked too, which keeps tiles of one
+ * lod watertight. Across lods the seams stay within the coarser bound.
+ */
+CollisionMesh buildCollisionMesh(const HeightField &field, CollisionTileKey key, const CollisionMeshSettings &settings);
+
+/**
+ * @brief Builds collision meshes on its own threads and keeps them in an LRU
+ * keyed by tile and lod. request() never blocks: it returns the cached mesh
+ * or queues the build and returns null, newest requests first so moving
+ * bodies get their current surroundings before stale ones. Meshes are
+ * shared, eviction does not invalidate one a body still holds.
+ *
+ * Builds read the published HeightField snapshot, not the render thread or
+ * the image. A newly published field evicts only the tiles its changed
+ * rects touch, or everything when its parent chain does not reach the old one.
+ */
+struct CollisionMeshService
+{
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t built = 0;
+        uint64_t evicted = 0;
+        uint64_t buildNanos = 0;
+        uint64_t triangles = 0; // of every build
+        size_t cachedBytes = 0;
+        size_t cachedMeshes = 0;
+        size_t queued = 0;
+    };
+
+    void init(const CollisionMeshSettings &settings);
+    void release();
+
+    std::shared_ptr<const CollisionMesh> request(CollisionTileKey key);
+
+    // every tile overlapping the square of half size radius around world xz, appends the cached ones
+    void requestAround(glm::vec2 position, float radius, uint32_t lod, std::vector<std::shared_ptr<const CollisionMesh>> &out);
+
+    // blocks until the queue is empty and no build is running, for tools
+    void flush();
+
+    Stats stats();
+
+    const CollisionMeshSettings &config() const { return settings; }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const CollisionMesh> mesh;
+        std::list<CollisionTileKey>::iterator lru;
+    };
+
+    void builderLoop(size_t builder);
+    void syncField(); // evicts the tiles a newly published field changed, needs mutex
+    bool touched(CollisionTileKey key, const std::vector<TexelRect> &rects) const;
+    void insert(std::shared_ptr<const CollisionMesh> mesh);
+
+    CollisionMeshSettings settings;
+    std::vector<std::thread> builders;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::shared_ptr<const HeightField> field;
+    std::vector<TexelRect> changed; // scratch for heightFieldChanges
+    std::unordered_map<CollisionTileKey, Entry, CollisionTileKeyHash> cache;
+    std::list<CollisionTileKey> lru; // most recently used first
+    std::vector<CollisionTileKey> queue; // pending, newest at the back
+    std::unordered_set<CollisionTileKey, CollisionTileKeyHash> pending; // queued or building
+    size_t building = 0;
+    bool quit = false;
+    Stats counters;
+};
+
+#endif // COLLISION_MESH_HPP
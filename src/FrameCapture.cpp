@@ -0,0 +1,231 @@
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+#include "FrameCapture.hpp"
+#include "Defines.hpp"
+
+FrameCapture g_frameCapture;
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void FrameCapture::start(Output outputKind, const std::string &outputPath, uint32_t frameWidth, uint32_t frameHeight, uint32_t frameLimit)
+{
+    if (active())
+        stop();
+
+    output = outputKind;
+    path = outputPath;
+    width = frameWidth;
+    height = frameHeight;
+    maxFrames = frameLimit;
+    head = 0;
+    oldest = 0;
+    quit = false;
+
+    stats.captured = 0;
+    stats.dropped = 0;
+    stats.issueNanos = 0;
+    stats.written = 0;
+    stats.writeNanos = 0;
+
+    if (output == Output::Images)
+        std::filesystem::create_directories(path);
+    else
+    {
+        pipe = !path.empty() && path[0] == '|';
+        stream = pipe ? popen(path.c_str() + 1, "w") : fopen(path.c_str(), "wb");
+        if (!stream)
+            EXIT("Failed to open capture output " + path);
+    }
+
+    // read back into client memory the writer can scan quickly, mapped once for the whole capture
+    const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (Slot &slot : slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        slot.mapped = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags));
+        if (!slot.mapped)
+            EXIT("Failed to map capture buffer");
+        slot.fence = nullptr;
+        slot.state = SLOT_FREE;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+
+    writer = std::thread(&FrameCapture::writerLoop, this);
+    LOG("Capturing %ux%u frames to %s\n", width, height, path.c_str());
+}
+
+void FrameCapture::stop()
+{
+    if (!active())
+        return;
+
+    poll(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    for (Slot &slot : slots)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+        glDeleteBuffers(1, &slot.pbo);
+        slot.pbo = 0;
+        slot.mapped = nullptr;
+    }
+
+    if (stream)
+        pipe ? pclose(stream) : fclose(stream);
+    stream = nullptr;
+
+    const uint64_t written = stats.written;
+    LOG("Captured %llu frames to %s (%llu dropped), %.3f ms per frame on the render thread, %.3f ms per frame written\n",
+        static_cast<unsigned long long>(written), path.c_str(), static_cast<unsigned long long>(stats.dropped),
+        stats.captured ? stats.issueNanos * 1e-6 / stats.captured : 0.0, written ? stats.writeNanos * 1e-6 / written : 0.0);
+}
+
+bool FrameCapture::done() const
+{
+    if (maxFrames == 0 || stats.captured < maxFrames)
+        return false;
+    for (const Slot &slot : slots)
+        if (slot.state.load(std::memory_order_acquire) != SLOT_FREE)
+            return false;
+    return true;
+}
+
+void FrameCapture::capture(GLuint framebuffer)
+{
+    if (!active())
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+    poll(false);
+
+    if (maxFrames > 0 && stats.captured >= maxFrames)
+        return;
+
+    Slot &slot = slots[head];
+    if (slot.state.load(std::memory_order_acquire) != SLOT_FREE)
+    {
+        ++stats.dropped;
+        return;
+    }
+
+    GLint readFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = stats.captured++;
+    slot.state.store(SLOT_PENDING, std::memory_order_relaxed);
+    head = (head + 1) % RING_SIZE;
+
+    stats.issueNanos += elapsed_ns(start);
+}
+
+/**
+ * @brief Hands signaled readbacks to the writer, oldest first so frames stay
+ * in order. Without wait it only consumes fences that already signaled.
+ */
+void FrameCapture::poll(bool wait)
+{
+    for (size_t i = 0; i < RING_SIZE; ++i)
+    {
+        Slot &slot = slots[oldest];
+        if (slot.state.load(std::memory_order_relaxed) != SLOT_PENDING)
+            return;
+
+        GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000u);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        if (status == GL_WAIT_FAILED)
+            EXIT("glClientWaitSync failed on capture fence");
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        slot.state.store(SLOT_WRITING, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(oldest);
+        }
+        wake.notify_one();
+        oldest = (oldest + 1) % RING_SIZE;
+    }
+}
+
+void FrameCapture::writerLoop()
+{
+    while (true)
+    {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || !queue.empty(); });
+            if (queue.empty())
+                return;
+            index = queue.front();
+            queue.pop_front();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        write(slots[index]);
+        stats.writeNanos += elapsed_ns(start);
+        ++stats.written;
+        slots[index].state.store(SLOT_FREE, std::memory_order_release);
+    }
+}
+
+// GL rows are bottom-up, both outputs are written top-down
+void FrameCapture::write(const Slot &slot)
+{
+    const size_t stride = static_cast<size_t>(width) * 4;
+
+    if (output == Output::Raw)
+    {
+        for (uint32_t y = height; y-- > 0;)
+            if (fwrite(slot.mapped + y * stride, 1, stride, stream) != stride)
+                EXIT("Failed to write capture stream " + path);
+        return;
+    }
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "frame_%06llu.ppm", static_cast<unsigned long long>(slot.frame));
+    const std::string filepath = (std::filesystem::path(path) / filename).string();
+
+    FILE *file = fopen(filepath.c_str(), "wb");
+    if (!file)
+        EXIT("Failed to open " + filepath);
+
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = height; y-- > 0;)
+    {
+        const uint8_t *src = slot.mapped + y * stride;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    fclose(file);
+}
@@ -0,0 +1,104 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <glad/glad.h>
+
+/**
+ * @brief Screenshots and flythrough recordings without stalling the render
+ * loop. capture() only queues a glReadPixels into the next pixel pack buffer
+ * of a small ring and fences it; once the fence signaled (a few frames later)
+ * the slot goes to a writer thread that reads the persistently mapped buffer
+ * and writes it out. When the writer falls behind and the ring is full the
+ * frame is dropped, the render thread never waits.
+ *
+ * Output is either numbered binary PPMs in a directory, or a raw top-down
+ * RGBA stream to a file or, with a leading '|', to the stdin of a command,
+ * e.g. "|ffmpeg -f rawvideo -pix_fmt rgba -s 900x700 -r 60 -i - out.mp4".
+ */
+struct FrameCapture
+{
+    static constexpr size_t RING_SIZE = 4;
+
+    enum class Output
+    {
+        Images,
+        Raw,
+    };
+
+    struct Stats
+    {
+        uint64_t captured = 0; // readbacks issued
+        uint64_t dropped = 0;  // frames skipped because every slot was busy
+        uint64_t issueNanos = 0; // render thread time in capture(), total
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> writeNanos{0};
+    };
+
+    Stats stats;
+
+    // needs a current context, maxFrames 0 = until stop()
+    void start(Output output, const std::string &path, uint32_t width, uint32_t height, uint32_t maxFrames = 0);
+
+    // waits for outstanding readbacks and the writer
+    void stop();
+
+    bool active() const { return slots[0].pbo != 0; }
+
+    // maxFrames reached and everything written, stop() will not block
+    bool done() const;
+
+    // reads the color buffer of framebuffer (0 = back buffer), call after the frame was drawn
+    void capture(GLuint framebuffer);
+
+private:
+    enum SlotState : int
+    {
+        SLOT_FREE = 0,
+        SLOT_PENDING, // readback queued on the GPU
+        SLOT_WRITING, // owned by the writer thread
+    };
+
+    struct Slot
+    {
+        GLuint pbo = 0;
+        const uint8_t *mapped = nullptr;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+        std::atomic<int> state{SLOT_FREE};
+    };
+
+    void poll(bool wait);
+    void writerLoop();
+    void write(const Slot &slot);
+
+    Slot slots[RING_SIZE];
+    size_t head = 0;   // next slot to capture into
+    size_t oldest = 0; // next slot handed to the writer, keeps frames in order
+
+    Output output = Output::Images;
+    std::string path;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t maxFrames = 0;
+    FILE *stream = nullptr; // Raw output
+    bool pipe = false;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<size_t> queue; // slots ready to write, guarded by mutex
+    bool quit = false;
+};
+
+extern FrameCapture g_frameCapture;
+
+#endif // FRAME_CAPTURE_HPP
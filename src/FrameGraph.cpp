@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <chrono>
+
+#include "FrameGraph.hpp"
+#include "Defines.hpp"
+#include "Profiler.hpp"
+
+constexpr uint32_t INCOHERENT_WRITES = ACCESS_IMAGE | ACCESS_STORAGE | ACCESS_ATOMIC_COUNTER;
+
+// barrier bit a consumer needs after an incoherent shader write
+static GLbitfield barrier_bits(uint32_t access)
+{
+    GLbitfield bits = 0;
+    if (access & ACCESS_HOST_WRITE)         bits |= GL_BUFFER_UPDATE_BARRIER_BIT;
+    if (access & ACCESS_COLOR_ATTACHMENT)   bits |= GL_FRAMEBUFFER_BARRIER_BIT;
+    if (access & ACCESS_DEPTH_ATTACHMENT)   bits |= GL_FRAMEBUFFER_BARRIER_BIT;
+    if (access & ACCESS_TRANSFORM_FEEDBACK) bits |= GL_TRANSFORM_FEEDBACK_BARRIER_BIT;
+    if (access & ACCESS_SAMPLED)            bits |= GL_TEXTURE_FETCH_BARRIER_BIT;
+    if (access & ACCESS_VERTEX)             bits |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+    if (access & ACCESS_UNIFORM)            bits |= GL_UNIFORM_BARRIER_BIT;
+    if (access & ACCESS_INDIRECT)           bits |= GL_COMMAND_BARRIER_BIT;
+    if (access & ACCESS_PIXEL_PACK)         bits |= GL_PIXEL_BUFFER_BARRIER_BIT;
+    if (access & ACCESS_IMAGE)              bits |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    if (access & ACCESS_STORAGE)            bits |= GL_SHADER_STORAGE_BARRIER_BIT;
+    if (access & ACCESS_ATOMIC_COUNTER)     bits |= GL_ATOMIC_COUNTER_BARRIER_BIT;
+    return bits;
+}
+
+static size_t texel_bytes(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:                 return 1;
+    case GL_RG8:
+    case GL_R16:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:  return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_RGBA16:             return 8;
+    case GL_RGBA32F:            return 16;
+    default:                    return 4;
+    }
+}
+
+static size_t texture_bytes(const FrameGraph::TextureDesc &desc)
+{
+    size_t bytes = 0;
+    size_t w = static_cast<size_t>(desc.width);
+    size_t h = static_cast<size_t>(desc.height);
+    for (GLsizei level = 0; level < desc.levels; ++level)
+    {
+        bytes += w * h * texel_bytes(desc.internalFormat);
+        w = std::max<size_t>(w / 2, 1u);
+        h = std::max<size_t>(h / 2, 1u);
+    }
+    return bytes;
+}
+
+void FrameGraph::init()
+{
+    for (size_t f = 0; f < QUERY_FRAMES; ++f)
+        glGenQueries(2 * MAX_PASSES, queries[f]);
+}
+
+void FrameGraph::release()
+{
+    for (size_t f = 0; f < QUERY_FRAMES; ++f)
+        glDeleteQueries(2 * MAX_PASSES, queries[f]);
+
+    for (Physical &physical : physicals)
+        glDeleteTextures(1, &physical.texture);
+    physicals.clear();
+
+    resources.clear();
+    passes.clear();
+    order.clear();
+    compiled = false;
+}
+
+FrameGraph::Handle FrameGraph::importTexture(const std::string &name, GLuint texture, bool output)
+{
+    Resource resource;
+    resource.name = name;
+    resource.handle = texture;
+    resource.output = output;
+    resources.push_back(resource);
+    compiled = false;
+    return static_cast<Handle>(resources.size() - 1);
+}
+
+FrameGraph::Handle FrameGraph::importBuffer(const std::string &name, GLuint buffer, bool output)
+{
+    return importTexture(name, buffer, output);
+}
+
+FrameGraph::Handle FrameGraph::createTexture(const std::string &name, const TextureDesc &desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.transient = true;
+    resource.desc = desc;
+    resources.push_back(resource);
+    compiled = false;
+    return static_cast<Handle>(resources.size() - 1);
+}
+
+size_t FrameGraph::addPass(const std::string &name, std::function<void()> execute, bool sideEffects)
+{
+    if (passes.size() == MAX_PASSES)
+        EXIT("Frame graph supports at most " + std::to_string(MAX_PASSES) + " passes");
+
+    Pass pass;
+    pass.name = name;
+    pass.profileName = g_profiler.intern(name);
+    pass.execute = std::move(execute);
+    pass.sideEffects = sideEffects;
+    passes.push_back(std::move(pass));
+    compiled = false;
+    return passes.size() - 1;
+}
+
+void FrameGraph::read(size_t pass, Handle resource, uint32_t access)
+{
+    passes[pass].accesses.push_back({resource, access, false});
+    compiled = false;
+}
+
+void FrameGraph::write(size_t pass, Handle resource, uint32_t access)
+{
+    passes[pass].accesses.push_back({resource, access, true});
+    compiled = false;
+}
+
+void FrameGraph::setEnabled(size_t pass, bool enabled)
+{
+    if (passes[pass].enabled != enabled)
+        compiled = false;
+    passes[pass].enabled = enabled;
+}
+
+void FrameGraph::compile()
+{
+    stats = {};
+
+    // -- dependencies: a read sees the last write declared before it, or the frame's final write when every writer
+    //    comes later; writers of a resource keep their declared order and wait for the readers of the version they replace --
+    const size_t count = passes.size();
+    std::vector<std::vector<size_t>> inputs(count);   // passes whose results p consumes, culling follows these
+    std::vector<std::vector<size_t>> hazards(count);  // passes that must merely finish first (write after read)
+    std::vector<size_t> lastWriter(resources.size(), SIZE_MAX);
+    std::vector<size_t> finalWriter(resources.size(), SIZE_MAX);
+    std::vector<std::vector<size_t>> readers(resources.size()); // of the version lastWriter produced
+    for (size_t p = 0; p < count; ++p)
+        if (passes[p].enabled)
+            for (const Access &access : passes[p].accesses)
+                if (access.write)
+                    finalWriter[access.resource] = p;
+
+    const auto writes = [&](size_t p, Handle resource) {
+        return std::any_of(passes[p].accesses.begin(), passes[p].accesses.end(), [&](const Access &a) { return a.write && a.resource == resource; });
+    };
+    for (size_t p = 0; p < count; ++p)
+    {
+        if (!passes[p].enabled)
+            continue;
+
+        for (const Access &access : passes[p].accesses)
+        {
+            if (access.write)
+                continue;
+            const Handle r = access.resource;
+            if (lastWriter[r] != SIZE_MAX)
+            {
+                inputs[p].push_back(lastWriter[r]);
+                readers[r].push_back(p);
+            }
+            else if (finalWriter[r] != SIZE_MAX && !writes(p, r))
+                inputs[p].push_back(finalWriter[r]);
+            else
+                readers[r].push_back(p); // the imported contents, later writers wait for this pass
+        }
+
+        for (const Access &access : passes[p].accesses)
+        {
+            if (!access.write)
+                continue;
+            const Handle r = access.resource;
+            if (lastWriter[r] != SIZE_MAX && lastWriter[r] != p)
+                inputs[p].push_back(lastWriter[r]);
+            for (const size_t reader : readers[r])
+                if (reader != p)
+                    hazards[p].push_back(reader);
+            readers[r].clear();
+            lastWriter[r] = p;
+        }
+    }
+
+    // -- cull passes that do not contribute to an output or side effect --
+    std::vector<bool> needed(count, false);
+    std::vector<size_t> pending;
+    for (size_t p = 0; p < count; ++p)
+    {
+        const Pass &pass = passes[p];
+        if (!pass.enabled)
+            continue;
+        bool output = pass.sideEffects;
+        for (const Access &access : pass.accesses)
+            output = output || (access.write && resources[access.resource].output);
+        if (output)
+        {
+            needed[p] = true;
+            pending.push_back(p);
+        }
+    }
+    while (!pending.empty())
+    {
+        const size_t p = pending.back();
+        pending.pop_back();
+        for (const size_t input : inputs[p])
+        {
+            if (needed[input])
+                continue;
+            needed[input] = true;
+            pending.push_back(input);
+        }
+    }
+    for (size_t p = 0; p < count; ++p)
+    {
+        passes[p].culled = !needed[p];
+        if (passes[p].culled)
+            ++stats.culledPasses;
+    }
+
+    // -- topological order of what is left, the earliest declared ready pass first so valid declarations keep their order --
+    std::vector<size_t> waiting(count, 0);
+    std::vector<std::vector<size_t>> consumers(count);
+    for (size_t p = 0; p < count; ++p)
+    {
+        if (!needed[p])
+            continue;
+        for (const std::vector<size_t> *edges : {&inputs[p], &hazards[p]})
+        {
+            for (const size_t q : *edges)
+            {
+                if (!needed[q])
+                    continue;
+                consumers[q].push_back(p);
+                ++waiting[p];
+            }
+        }
+    }
+
+    order.clear();
+    std::vector<bool> scheduled(count, false);
+    for (;;)
+    {
+        size_t next = SIZE_MAX;
+        for (size_t p = 0; p < count && next == SIZE_MAX; ++p)
+            if (needed[p] && !scheduled[p] && waiting[p] == 0)
+                next = p;
+        if (next == SIZE_MAX)
+            break;
+
+        scheduled[next] = true;
+        order.push_back(next);
+        for (const size_t consumer : consumers[next])
+            --waiting[consumer];
+    }
+
+    if (order.size() != count - stats.culledPasses)
+    {
+        std::string cycle;
+        for (size_t p = 0; p < count; ++p)
+            if (needed[p] && !scheduled[p])
+                cycle += (cycle.empty() ? "" : ", ") + passes[p].name;
+        EXIT("Frame graph dependency cycle between passes " + cycle);
+    }
+
+    // -- minimal barriers: only consumers of incoherent writes that were not yet flushed for their access --
+    std::vector<bool> dirty(resources.size(), false);
+    std::vector<GLbitfield> flushed(resources.size(), 0);
+    for (const size_t p : order)
+    {
+        Pass &pass = passes[p];
+        pass.barriers = 0;
+
+        for (const Access &access : pass.accesses)
+        {
+            if (!dirty[access.resource])
+                continue;
+            const GLbitfield bits = barrier_bits(access.access);
+            pass.barriers |= bits & ~flushed[access.resource];
+        }
+
+        // a barrier is global, it flushes every pending write for those bits
+        if (pass.barriers)
+        {
+            ++stats.barriers;
+            for (size_t r = 0; r < resources.size(); ++r)
+                if (dirty[r])
+                    flushed[r] |= pass.barriers;
+        }
+
+        for (const Access &access : pass.accesses)
+        {
+            if (!access.write)
+                continue;
+            dirty[access.resource] = (access.access & INCOHERENT_WRITES) != 0;
+            flushed[access.resource] = 0;
+        }
+    }
+
+    // -- alias transient textures with matching descriptions and disjoint lifetimes --
+    struct Lifetime
+    {
+        Handle resource;
+        size_t first;
+        size_t last;
+    };
+    std::vector<Lifetime> lifetimes;
+    for (size_t o = 0; o < order.size(); ++o)
+    {
+        for (const Access &access : passes[order[o]].accesses)
+        {
+            if (!resources[access.resource].transient)
+                continue;
+
+            auto it = std::find_if(lifetimes.begin(), lifetimes.end(), [&](const Lifetime &l) { return l.resource == access.resource; });
+            if (it == lifetimes.end())
+                lifetimes.push_back({access.resource, o, o});
+            else
+                it->last = o;
+        }
+    }
+
+    for (Resource &resource : resources)
+    {
+        if (!resource.transient)
+            continue;
+        resource.physical = SIZE_MAX;
+        resource.handle = 0;
+    }
+
+    std::vector<bool> assigned(physicals.size(), false);
+    std::vector<size_t> busyUntil(physicals.size(), 0);
+    for (const Lifetime &lifetime : lifetimes) // already sorted by first use
+    {
+        Resource &resource = resources[lifetime.resource];
+        stats.transientBytesRequested += texture_bytes(resource.desc);
+
+        size_t chosen = SIZE_MAX;
+        for (size_t i = 0; i < physicals.size(); ++i)
+        {
+            if (!(physicals[i].desc == resource.desc))
+                continue;
+            if (assigned[i] && busyUntil[i] >= lifetime.first)
+                continue;
+            chosen = i;
+            break;
+        }
+
+        if (chosen == SIZE_MAX)
+        {
+            Physical physical;
+            physical.desc = resource.desc;
+            glGenTextures(1, &physical.texture);
+            glBindTexture(GL_TEXTURE_2D, physical.texture);
+            glTexStorage2D(GL_TEXTURE_2D, resource.desc.levels, resource.desc.internalFormat, resource.desc.width, resource.desc.height);
+            glBindTexture(GL_TEXTURE_2D, 0u);
+
+            physicals.push_back(physical);
+            assigned.push_back(false);
+            busyUntil.push_back(0);
+            chosen = physicals.size() - 1;
+        }
+
+        assigned[chosen] = true;
+        busyUntil[chosen] = lifetime.last;
+        resource.physical = chosen;
+        resource.handle = physicals[chosen].texture;
+    }
+
+    // drop physical textures nothing maps to anymore
+    for (size_t i = physicals.size(); i-- > 0;)
+    {
+        if (assigned[i])
+            continue;
+
+        glDeleteTextures(1, &physicals[i].texture);
+        physicals.erase(physicals.begin() + static_cast<std::ptrdiff_t>(i));
+        for (Resource &resource : resources)
+            if (resource.transient && resource.physical != SIZE_MAX && resource.physical > i)
+                --resource.physical;
+    }
+
+    for (const Physical &physical : physicals)
+        stats.transientBytesAllocated += texture_bytes(physical.desc);
+
+    compiled = true;
+}
+
+void FrameGraph::execute()
+{
+    if (!compiled)
+        compile();
+
+    const size_t slot = frame % QUERY_FRAMES;
+
+    // results of the frame that used this slot QUERY_FRAMES ago, skipped rather than waited on
+    for (size_t p = 0; p < passes.size(); ++p)
+    {
+        if (!queryIssued[slot][p])
+            continue;
+        queryIssued[slot][p] = false;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][2 * p + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(queries[slot][2 * p], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[slot][2 * p + 1], GL_QUERY_RESULT, &end);
+        passes[p].gpuMs = static_cast<float>(end - begin) * 1e-6f;
+    }
+
+    for (const size_t p : order)
+    {
+        Pass &pass = passes[p];
+
+        if (pass.barriers)
+            glMemoryBarrier(pass.barriers);
+
+        const auto start = std::chrono::steady_clock::now();
+        glQueryCounter(queries[slot][2 * p], GL_TIMESTAMP);
+
+        {
+            PROFILE_ZONE(pass.profileName);
+            pass.execute();
+        }
+
+        glQueryCounter(queries[slot][2 * p + 1], GL_TIMESTAMP);
+        queryIssued[slot][p] = true;
+        pass.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    ++frame;
+}
+
+FrameGraph::Handle FrameGraph::findResource(const std::string &name) const
+{
+    for (size_t r = 0; r < resources.size(); ++r)
+        if (resources[r].name == name)
+            return static_cast<Handle>(r);
+
+    EXIT("Unknown frame graph resource " + name);
+}
+
+const FrameGraph::Pass *FrameGraph::findPass(const std::string &name) const
+{
+    for (const Pass &pass : passes)
+        if (pass.name == name)
+            return &pass;
+    return nullptr;
+}
@@ -0,0 +1,141 @@
+#ifndef FRAME_GRAPH_HPP
+#define FRAME_GRAPH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum ResourceAccess : uint32_t
+{
+    ACCESS_NONE = 0,
+    // coherent accesses, ordered by GL without barriers
+    ACCESS_HOST_WRITE = 1u << 0,
+    ACCESS_COLOR_ATTACHMENT = 1u << 1,
+    ACCESS_DEPTH_ATTACHMENT = 1u << 2,
+    ACCESS_TRANSFORM_FEEDBACK = 1u << 3,
+    ACCESS_SAMPLED = 1u << 4,
+    ACCESS_VERTEX = 1u << 5,
+    ACCESS_UNIFORM = 1u << 6,
+    ACCESS_INDIRECT = 1u << 7,
+    ACCESS_PIXEL_PACK = 1u << 8,
+    // incoherent shader writes, later consumers need glMemoryBarrier
+    ACCESS_IMAGE = 1u << 9,
+    ACCESS_STORAGE = 1u << 10,
+    ACCESS_ATOMIC_COUNTER = 1u << 11,
+};
+
+/**
+ * @brief Declarative pass list. Passes state which resources they read and
+ * write, compile() culls passes that do not reach an output, sorts the
+ * rest topologically by those accesses (a cycle is fatal), works out the
+ * minimal glMemoryBarrier bits before each pass and aliases transient
+ * textures whose lifetimes do not overlap. execute() runs the
+ * passes and records per-pass CPU time and GPU time (timestamp queries read
+ * back a few frames late so they never stall).
+ */
+struct FrameGraph
+{
+    using Handle = uint32_t;
+
+    static constexpr size_t QUERY_FRAMES = 4;
+    static constexpr size_t MAX_PASSES = 32;
+
+    struct TextureDesc
+    {
+        GLsizei width = 0;
+        GLsizei height = 0;
+        GLenum internalFormat = GL_RGBA8;
+        GLsizei levels = 1;
+
+        bool operator==(const TextureDesc &o) const
+        {
+            return width == o.width && height == o.height && internalFormat == o.internalFormat && levels == o.levels;
+        }
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool transient = false;
+        bool output = false; // imported resources that must be produced every frame (backbuffer, readbacks)
+        TextureDesc desc;
+        GLuint handle = 0; // GL name, physical texture for transients once compiled
+        size_t physical = SIZE_MAX;
+    };
+
+    struct Access
+    {
+        Handle resource;
+        uint32_t access;
+        bool write;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        const char *profileName = nullptr; // interned, stable for trace zones
+        std::function<void()> execute;
+        std::vector<Access> accesses;
+        bool sideEffects = false; // never culled, e.g. readbacks to the CPU
+        bool enabled = true;
+
+        // filled by compile()
+        bool culled = false;
+        GLbitfield barriers = 0;
+
+        // timing in ms, GPU lags QUERY_FRAMES - 1 frames behind
+        float cpuMs = 0.0f;
+        float gpuMs = 0.0f;
+    };
+
+    struct Physical
+    {
+        TextureDesc desc;
+        GLuint texture = 0;
+    };
+
+    struct Stats
+    {
+        size_t transientBytesRequested = 0;
+        size_t transientBytesAllocated = 0;
+        size_t barriers = 0;
+        size_t culledPasses = 0;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<size_t> order; // compiled execution order
+    std::vector<Physical> physicals;
+    Stats stats;
+
+    GLuint queries[QUERY_FRAMES][2 * MAX_PASSES] = {};
+    bool queryIssued[QUERY_FRAMES][MAX_PASSES] = {};
+    size_t frame = 0;
+    bool compiled = false;
+
+    void init();
+    void release();
+
+    Handle importTexture(const std::string &name, GLuint texture, bool output = false);
+    Handle importBuffer(const std::string &name, GLuint buffer, bool output = false);
+    Handle createTexture(const std::string &name, const TextureDesc &desc);
+
+    size_t addPass(const std::string &name, std::function<void()> execute, bool sideEffects = false);
+    void read(size_t pass, Handle resource, uint32_t access);
+    void write(size_t pass, Handle resource, uint32_t access);
+    void setEnabled(size_t pass, bool enabled);
+
+    // GL name of a resource, valid for transients after compile()
+    GLuint texture(Handle resource) const { return resources[resource].handle; }
+
+    void compile();
+    void execute();
+
+    const Pass *findPass(const std::string &name) const;
+    Handle findResource(const std::string &name) const;
+};
+
+#endif // FRAME_GRAPH_HPP
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <thread>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "FramePacer.hpp"
+#include "Defines.hpp"
+
+constexpr float SMOOTHING = 0.1f;
+
+static void smooth(float &value, float sample)
+{
+    value += (sample - value) * SMOOTHING;
+}
+
+static float elapsed_ms(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<float, std::milli>(to - from).count();
+}
+
+void FramePacer::init()
+{
+    for (Slot &slot : slots)
+        glGenQueries(3, slot.queries);
+
+    adaptiveSupported = glfwExtensionSupported("GLX_EXT_swap_control_tear") || glfwExtensionSupported("WGL_EXT_swap_control_tear");
+    setSwapMode(swapMode);
+
+    frameStart = lastPresent = std::chrono::steady_clock::now();
+}
+
+void FramePacer::release()
+{
+    for (Slot &slot : slots)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteQueries(3, slot.queries);
+        slot = {};
+    }
+}
+
+void FramePacer::setSwapMode(SwapMode mode)
+{
+    if (mode == SWAP_ADAPTIVE && !adaptiveSupported)
+        mode = SWAP_VSYNC;
+
+    swapMode = mode;
+    glfwSwapInterval(mode == SWAP_ADAPTIVE ? -1 : static_cast<int>(mode));
+}
+
+void FramePacer::beginFrame()
+{
+    framesInFlight = std::clamp(framesInFlight, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT));
+
+    const auto waitStart = std::chrono::steady_clock::now();
+
+    // opportunistically collect finished frames, block only on the one that bounds the queue depth
+    for (Slot &slot : slots)
+    {
+        if (!slot.pending)
+            continue;
+        const bool mustFinish = slot.frame + static_cast<uint64_t>(framesInFlight) <= frame;
+        retire(slot, mustFinish);
+    }
+
+    frameStart = std::chrono::steady_clock::now();
+    smooth(stats.waitMs, elapsed_ms(waitStart, frameStart));
+
+    Slot &slot = slots[frame % SLOT_COUNT];
+    glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+}
+
+void FramePacer::endFrame()
+{
+    Slot &slot = slots[frame % SLOT_COUNT];
+    glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    slot.frame = frame;
+    slot.submitGpuNs = gpuNow;
+
+    lastCpuMs = elapsed_ms(frameStart, std::chrono::steady_clock::now());
+    smooth(stats.cpuMs, lastCpuMs);
+}
+
+void FramePacer::present(GLFWwindow *window)
+{
+    const auto swapStart = std::chrono::steady_clock::now();
+    glfwSwapBuffers(window);
+    auto now = std::chrono::steady_clock::now();
+    smooth(stats.swapMs, elapsed_ms(swapStart, now));
+
+    // behind the swap, so latency and retirement both include it
+    Slot &slot = slots[frame % SLOT_COUNT];
+    glQueryCounter(slot.queries[2], GL_TIMESTAMP);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.pending = true;
+
+    if (targetFrameMs > 0.0f)
+    {
+        const auto deadline = lastPresent + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                std::chrono::duration<float, std::milli>(targetFrameMs));
+        if (now < deadline)
+        {
+            std::this_thread::sleep_until(deadline);
+            now = std::chrono::steady_clock::now();
+        }
+    }
+
+    smooth(stats.frameMs, elapsed_ms(lastPresent, now));
+    lastPresent = now;
+    ++frame;
+}
+
+void FramePacer::retire(Slot &slot, bool wait)
+{
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000u);
+
+    if (status == GL_TIMEOUT_EXPIRED)
+        return;
+    if (status == GL_WAIT_FAILED)
+        EXIT("glClientWaitSync failed on frame fence");
+
+    // the fence signaled, so every timestamp is available without stalling
+    GLuint64 begin = 0, end = 0, presented = 0;
+    glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end);
+    glGetQueryObjectui64v(slot.queries[2], GL_QUERY_RESULT, &presented);
+
+    lastGpuMs = static_cast<float>(end - begin) * 1e-6f;
+    smooth(stats.gpuMs, lastGpuMs);
+    smooth(stats.latencyMs, static_cast<float>(static_cast<int64_t>(presented) - slot.submitGpuNs) * 1e-6f);
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.pending = false;
+}
@@ -0,0 +1,84 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+/**
+ * @brief Bounds how many frames the CPU may run ahead of the GPU with one
+ * fence per frame, controls the swap interval and reports where frame time
+ * goes: CPU recording, GPU execution, time blocked in swap and the latency
+ * from submission until the GPU reached the frame's swap. The fence goes in
+ * after the swap, so a frame only retires once its present was processed.
+ */
+struct FramePacer
+{
+    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 3;
+    static constexpr size_t SLOT_COUNT = MAX_FRAMES_IN_FLIGHT + 1;
+
+    enum SwapMode
+    {
+        SWAP_IMMEDIATE = 0,
+        SWAP_VSYNC = 1,
+        SWAP_ADAPTIVE = 2, // late frames tear instead of waiting a full interval
+    };
+
+    struct Slot
+    {
+        GLsync fence = nullptr;
+        GLuint queries[3] = {}; // GPU timestamps at frame begin / end / after the swap
+        uint64_t frame = 0;
+        int64_t submitGpuNs = 0; // GPU clock when the frame was handed off
+        bool pending = false;
+    };
+
+    // exponentially smoothed, in ms
+    struct Stats
+    {
+        float cpuMs = 0.0f;
+        float gpuMs = 0.0f;
+        float swapMs = 0.0f;
+        float waitMs = 0.0f;    // blocked on the frames-in-flight fence
+        float latencyMs = 0.0f; // submission -> GPU past the swap
+        float frameMs = 0.0f;
+    };
+
+    int framesInFlight = 2;
+    SwapMode swapMode = SWAP_VSYNC;
+    float targetFrameMs = 0.0f; // 0 = uncapped
+    bool adaptiveSupported = false;
+
+    Slot slots[SLOT_COUNT];
+    uint64_t frame = 0;
+    Stats stats;
+
+    // latest unsmoothed samples, the GPU one belongs to the most recently retired frame
+    float lastCpuMs = 0.0f;
+    float lastGpuMs = 0.0f;
+
+    void init();
+    void release();
+
+    void setSwapMode(SwapMode mode);
+
+    // waits until at most framesInFlight - 1 frames are queued
+    void beginFrame();
+
+    // ends the frame's GPU timing, call after the last GL command of the frame
+    void endFrame();
+
+    // swaps, fences the frame behind the swap and applies the frame-time cap
+    void present(GLFWwindow *window);
+
+private:
+    void retire(Slot &slot, bool wait);
+
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point lastPresent;
+};
+
+#endif // FRAME_PACER_HPP
@@ -0,0 +1,1213 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "GlCapture.hpp"
+#include "Defines.hpp"
+
+GlCapture g_glCapture;
+
+const char *glCallName(GlCall call)
+{
+    static const char *const names[] = {
+#define GL_CAPTURE_NAME(name) "gl" #name,
+        GL_CAPTURE_CALLS(GL_CAPTURE_NAME)
+#undef GL_CAPTURE_NAME
+        "MappedWrite", "EndFrame"};
+    static_assert(std::size(names) == static_cast<size_t>(GlCall::Count));
+    return names[static_cast<size_t>(call)];
+}
+
+// size of the header up to and including the frame count patched in by stop()
+constexpr long FRAME_COUNT_END = 6 * sizeof(uint32_t);
+
+// -- recorder --
+
+#define GL_CAPTURE_REAL(name) static decltype(glad_gl##name) real_##name = nullptr;
+GL_CAPTURE_CALLS(GL_CAPTURE_REAL)
+#undef GL_CAPTURE_REAL
+
+namespace
+{
+struct MappedRange
+{
+    const uint8_t *ptr;
+    GLintptr offset;
+    GLsizeiptr length;
+    GLbitfield access;
+};
+
+// what the hooks need to size payloads
+struct RecorderState
+{
+    std::unordered_map<GLenum, GLuint> boundBuffers;
+    std::unordered_map<GLuint, MappedRange> mappings;
+    GLint unpackAlignment = 4;
+    GLint packAlignment = 4;
+};
+
+RecorderState s_state;
+}
+
+static size_t pixel_bytes(GLenum format, GLenum type)
+{
+    size_t components = 4;
+    switch (format)
+    {
+    case GL_RED: case GL_RED_INTEGER: case GL_GREEN: case GL_BLUE: case GL_ALPHA:
+    case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+        components = 2;
+        break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    }
+
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE: case GL_BYTE:
+        return components;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+        return 2 * components;
+    case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+        return 4 * components;
+    default:
+        return 4; // packed formats, one 32 bit word per pixel
+    }
+}
+
+static size_t image_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment)
+{
+    const size_t row = static_cast<size_t>(width) * pixel_bytes(format, type);
+    const size_t a = static_cast<size_t>(alignment);
+    return (row + a - 1) / a * a * static_cast<size_t>(height);
+}
+
+// the GPU reads mapped memory without a GL call, store what it will see
+static void record_mapped(GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    const auto it = s_state.mappings.find(buffer);
+    if (it == s_state.mappings.end() || !(it->second.access & GL_MAP_WRITE_BIT))
+        return;
+
+    const MappedRange &range = it->second;
+    if (offset < range.offset || offset + size > range.offset + range.length)
+        return;
+
+    g_glCapture.record(GlCall::MappedWrite, buffer, offset);
+    g_glCapture.blob(range.ptr + (offset - range.offset), static_cast<size_t>(size));
+}
+
+// arguments are all plain values, recorded as is
+#define GL_CAPTURE_HOOK(name, params, ...)                   \
+    static void APIENTRY hook_##name params                  \
+    {                                                        \
+        g_glCapture.record(GlCall::name, __VA_ARGS__);       \
+        real_##name(__VA_ARGS__);                            \
+    }
+
+GL_CAPTURE_HOOK(ActiveTexture, (GLenum texture), texture)
+GL_CAPTURE_HOOK(AttachShader, (GLuint program, GLuint shader), program, shader)
+GL_CAPTURE_HOOK(BeginQuery, (GLenum target, GLuint id), target, id)
+GL_CAPTURE_HOOK(BeginTransformFeedback, (GLenum primitiveMode), primitiveMode)
+GL_CAPTURE_HOOK(BindFramebuffer, (GLenum target, GLuint framebuffer), target, framebuffer)
+GL_CAPTURE_HOOK(BindRenderbuffer, (GLenum target, GLuint renderbuffer), target, renderbuffer)
+GL_CAPTURE_HOOK(BindTexture, (GLenum target, GLuint texture), target, texture)
+GL_CAPTURE_HOOK(BindTransformFeedback, (GLenum target, GLuint id), target, id)
+GL_CAPTURE_HOOK(BindVertexArray, (GLuint array), array)
+GL_CAPTURE_HOOK(BindVertexBuffer, (GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride), bindingindex, buffer, offset, stride)
+GL_CAPTURE_HOOK(Clear, (GLbitfield mask), mask)
+GL_CAPTURE_HOOK(ClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), red, green, blue, alpha)
+GL_CAPTURE_HOOK(CompileShader, (GLuint shader), shader)
+GL_CAPTURE_HOOK(DeleteProgram, (GLuint program), program)
+GL_CAPTURE_HOOK(DeleteShader, (GLuint shader), shader)
+GL_CAPTURE_HOOK(Disable, (GLenum cap), cap)
+GL_CAPTURE_HOOK(DrawArrays, (GLenum mode, GLint first, GLsizei count), mode, first, count)
+GL_CAPTURE_HOOK(DrawTransformFeedback, (GLenum mode, GLuint id), mode, id)
+GL_CAPTURE_HOOK(Enable, (GLenum cap), cap)
+GL_CAPTURE_HOOK(EnableVertexAttribArray, (GLuint index), index)
+GL_CAPTURE_HOOK(EndQuery, (GLenum target), target)
+GL_CAPTURE_HOOK(FramebufferRenderbuffer, (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer), target, attachment, renderbuffertarget, renderbuffer)
+GL_CAPTURE_HOOK(LinkProgram, (GLuint program), program)
+GL_CAPTURE_HOOK(MemoryBarrier, (GLbitfield barriers), barriers)
+GL_CAPTURE_HOOK(PatchParameteri, (GLenum pname, GLint value), pname, value)
+GL_CAPTURE_HOOK(PolygonMode, (GLenum face, GLenum mode), face, mode)
+GL_CAPTURE_HOOK(QueryCounter, (GLuint id, GLenum target), id, target)
+GL_CAPTURE_HOOK(RenderbufferStorage, (GLenum target, GLenum internalformat, GLsizei width, GLsizei height), target, internalformat, width, height)
+GL_CAPTURE_HOOK(TexParameteri, (GLenum target, GLenum pname, GLint param), target, pname, param)
+GL_CAPTURE_HOOK(TexStorage2D, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height), target, levels, internalformat, width, height)
+GL_CAPTURE_HOOK(Uniform1f, (GLint location, GLfloat v0), location, v0)
+GL_CAPTURE_HOOK(Uniform1i, (GLint location, GLint v0), location, v0)
+GL_CAPTURE_HOOK(UniformBlockBinding, (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding), program, uniformBlockIndex, uniformBlockBinding)
+GL_CAPTURE_HOOK(UseProgram, (GLuint program), program)
+GL_CAPTURE_HOOK(VertexAttribBinding, (GLuint attribindex, GLuint bindingindex), attribindex, bindingindex)
+GL_CAPTURE_HOOK(VertexAttribFormat, (GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset), attribindex, size, type, normalized, relativeoffset)
+GL_CAPTURE_HOOK(Viewport, (GLint x, GLint y, GLsizei width, GLsizei height), x, y, width, height)
+
+#undef GL_CAPTURE_HOOK
+
+// getters, only the inputs are recorded, the replay reads into scratch memory
+#define GL_CAPTURE_GETTER(name, params, call, ...)           \
+    static void APIENTRY hook_##name params                  \
+    {                                                        \
+        g_glCapture.record(GlCall::name, __VA_ARGS__);       \
+        real_##name call;                                    \
+    }
+
+GL_CAPTURE_GETTER(GetInteger64v, (GLenum pname, GLint64 *data), (pname, data), pname)
+GL_CAPTURE_GETTER(GetIntegerv, (GLenum pname, GLint *data), (pname, data), pname)
+GL_CAPTURE_GETTER(GetNamedBufferParameteri64v, (GLuint buffer, GLenum pname, GLint64 *params), (buffer, pname, params), buffer, pname)
+GL_CAPTURE_GETTER(GetProgramInfoLog, (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog), (program, bufSize, length, infoLog), program, bufSize)
+GL_CAPTURE_GETTER(GetProgramiv, (GLuint program, GLenum pname, GLint *params), (program, pname, params), program, pname)
+GL_CAPTURE_GETTER(GetQueryObjectiv, (GLuint id, GLenum pname, GLint *params), (id, pname, params), id, pname)
+GL_CAPTURE_GETTER(GetQueryObjectui64v, (GLuint id, GLenum pname, GLuint64 *params), (id, pname, params), id, pname)
+GL_CAPTURE_GETTER(GetShaderInfoLog, (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog), (shader, bufSize, length, infoLog), shader, bufSize)
+GL_CAPTURE_GETTER(GetShaderiv, (GLuint shader, GLenum pname, GLint *params), (shader, pname, params), shader, pname)
+GL_CAPTURE_GETTER(GetTextureLevelParameteriv, (GLuint texture, GLint level, GLenum pname, GLint *params), (texture, level, pname, params), texture, level, pname)
+GL_CAPTURE_GETTER(GetTextureParameteriv, (GLuint texture, GLenum pname, GLint *params), (texture, pname, params), texture, pname)
+
+#undef GL_CAPTURE_GETTER
+
+// glGen* / glDelete*, the names are recorded so the replay can map them
+#define GL_CAPTURE_NAMES(name)                                                \
+    static void APIENTRY hook_Gen##name(GLsizei n, GLuint *names)                   \
+    {                                                                               \
+        real_Gen##name(n, names);                                                   \
+        g_glCapture.record(GlCall::Gen##name, n);                                   \
+        g_glCapture.blob(names, sizeof(GLuint) * static_cast<size_t>(n));           \
+    }                                                                               \
+    static void APIENTRY hook_Delete##name(GLsizei n, const GLuint *names)          \
+    {                                                                               \
+        g_glCapture.record(GlCall::Delete##name, n);                                \
+        g_glCapture.blob(names, sizeof(GLuint) * static_cast<size_t>(n));           \
+        real_Delete##name(n, names);                                                \
+    }
+
+GL_CAPTURE_NAMES(Buffers)
+GL_CAPTURE_NAMES(Framebuffers)
+GL_CAPTURE_NAMES(Queries)
+GL_CAPTURE_NAMES(Renderbuffers)
+GL_CAPTURE_NAMES(Textures)
+GL_CAPTURE_NAMES(TransformFeedbacks)
+GL_CAPTURE_NAMES(VertexArrays)
+
+#undef GL_CAPTURE_NAMES
+
+static void APIENTRY hook_EndTransformFeedback()
+{
+    g_glCapture.record(GlCall::EndTransformFeedback);
+    real_EndTransformFeedback();
+}
+
+static void APIENTRY hook_Finish()
+{
+    g_glCapture.record(GlCall::Finish);
+    real_Finish();
+}
+
+static void APIENTRY hook_Flush()
+{
+    g_glCapture.record(GlCall::Flush);
+    real_Flush();
+}
+
+static void APIENTRY hook_BindBuffer(GLenum target, GLuint buffer)
+{
+    s_state.boundBuffers[target] = buffer;
+    g_glCapture.record(GlCall::BindBuffer, target, buffer);
+    real_BindBuffer(target, buffer);
+}
+
+static void APIENTRY hook_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    record_mapped(buffer, offset, size);
+    s_state.boundBuffers[target] = buffer;
+    g_glCapture.record(GlCall::BindBufferRange, target, index, buffer, offset, size);
+    real_BindBufferRange(target, index, buffer, offset, size);
+}
+
+static void APIENTRY hook_BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    g_glCapture.record(GlCall::BufferData, target, size, usage, static_cast<uint8_t>(data != nullptr));
+    if (data)
+        g_glCapture.blob(data, static_cast<size_t>(size));
+    real_BufferData(target, size, data, usage);
+}
+
+static void APIENTRY hook_BufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+    g_glCapture.record(GlCall::BufferStorage, target, size, flags, static_cast<uint8_t>(data != nullptr));
+    if (data)
+        g_glCapture.blob(data, static_cast<size_t>(size));
+    real_BufferStorage(target, size, data, flags);
+}
+
+static GLenum APIENTRY hook_CheckFramebufferStatus(GLenum target)
+{
+    g_glCapture.record(GlCall::CheckFramebufferStatus, target);
+    return real_CheckFramebufferStatus(target);
+}
+
+static GLenum APIENTRY hook_ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    g_glCapture.record(GlCall::ClientWaitSync, reinterpret_cast<uint64_t>(sync), flags, timeout);
+    return real_ClientWaitSync(sync, flags, timeout);
+}
+
+static GLuint APIENTRY hook_CreateProgram()
+{
+    const GLuint program = real_CreateProgram();
+    g_glCapture.record(GlCall::CreateProgram, program);
+    return program;
+}
+
+static GLuint APIENTRY hook_CreateShader(GLenum type)
+{
+    const GLuint shader = real_CreateShader(type);
+    g_glCapture.record(GlCall::CreateShader, type, shader);
+    return shader;
+}
+
+static void APIENTRY hook_DeleteSync(GLsync sync)
+{
+    g_glCapture.record(GlCall::DeleteSync, reinterpret_cast<uint64_t>(sync));
+    real_DeleteSync(sync);
+}
+
+static GLsync APIENTRY hook_FenceSync(GLenum condition, GLbitfield flags)
+{
+    const GLsync sync = real_FenceSync(condition, flags);
+    g_glCapture.record(GlCall::FenceSync, condition, flags, reinterpret_cast<uint64_t>(sync));
+    return sync;
+}
+
+static const GLubyte *APIENTRY hook_GetString(GLenum name)
+{
+    g_glCapture.record(GlCall::GetString, name);
+    return real_GetString(name);
+}
+
+static const GLubyte *APIENTRY hook_GetStringi(GLenum name, GLuint index)
+{
+    g_glCapture.record(GlCall::GetStringi, name, index);
+    return real_GetStringi(name, index);
+}
+
+static GLuint APIENTRY hook_GetUniformBlockIndex(GLuint program, const GLchar *uniformBlockName)
+{
+    const GLuint index = real_GetUniformBlockIndex(program, uniformBlockName);
+    g_glCapture.record(GlCall::GetUniformBlockIndex, program, index);
+    g_glCapture.string(uniformBlockName, std::strlen(uniformBlockName));
+    return index;
+}
+
+static GLint APIENTRY hook_GetUniformLocation(GLuint program, const GLchar *name)
+{
+    const GLint location = real_GetUniformLocation(program, name);
+    g_glCapture.record(GlCall::GetUniformLocation, program, location);
+    g_glCapture.string(name, std::strlen(name));
+    return location;
+}
+
+static void *APIENTRY hook_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    void *ptr = real_MapBufferRange(target, offset, length, access);
+    g_glCapture.record(GlCall::MapBufferRange, target, offset, length, access);
+    if (ptr)
+        s_state.mappings[s_state.boundBuffers[target]] = {static_cast<const uint8_t *>(ptr), offset, length, access};
+    return ptr;
+}
+
+static GLboolean APIENTRY hook_UnmapBuffer(GLenum target)
+{
+    // persistent mappings are recorded where the GPU reads them, transient ones once here
+    const GLuint buffer = s_state.boundBuffers[target];
+    const auto it = s_state.mappings.find(buffer);
+    if (it != s_state.mappings.end())
+    {
+        if (!(it->second.access & GL_MAP_PERSISTENT_BIT))
+            record_mapped(buffer, it->second.offset, it->second.length);
+        s_state.mappings.erase(it);
+    }
+
+    g_glCapture.record(GlCall::UnmapBuffer, target);
+    return real_UnmapBuffer(target);
+}
+
+static void APIENTRY hook_MultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount)
+{
+    g_glCapture.record(GlCall::MultiDrawArrays, mode, drawcount);
+    g_glCapture.blob(first, sizeof(GLint) * static_cast<size_t>(drawcount));
+    g_glCapture.blob(count, sizeof(GLsizei) * static_cast<size_t>(drawcount));
+    real_MultiDrawArrays(mode, first, count, drawcount);
+}
+
+static void APIENTRY hook_PixelStorei(GLenum pname, GLint param)
+{
+    if (pname == GL_UNPACK_ALIGNMENT)
+        s_state.unpackAlignment = param;
+    else if (pname == GL_PACK_ALIGNMENT)
+        s_state.packAlignment = param;
+    g_glCapture.record(GlCall::PixelStorei, pname, param);
+    real_PixelStorei(pname, param);
+}
+
+// with a pixel buffer bound the pointer is an offset into it, otherwise the byte count is stored
+static void APIENTRY hook_ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels)
+{
+    const bool packBuffer = s_state.boundBuffers[GL_PIXEL_PACK_BUFFER] != 0;
+    const uint64_t value = packBuffer ? reinterpret_cast<uint64_t>(pixels) : image_bytes(width, height, format, type, s_state.packAlignment);
+    g_glCapture.record(GlCall::ReadPixels, x, y, width, height, format, type, static_cast<uint8_t>(packBuffer), value);
+    real_ReadPixels(x, y, width, height, format, type, pixels);
+}
+
+static void APIENTRY hook_ShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+    g_glCapture.record(GlCall::ShaderSource, shader, count);
+    for (GLsizei i = 0; i < count; ++i)
+        g_glCapture.string(string[i], length && length[i] >= 0 ? static_cast<size_t>(length[i]) : std::strlen(string[i]));
+    real_ShaderSource(shader, count, string, length);
+}
+
+enum : uint8_t
+{
+    PIXELS_NONE = 0,
+    PIXELS_INLINE = 1,
+    PIXELS_UNPACK_BUFFER = 2, // pointer is an offset into the bound GL_PIXEL_UNPACK_BUFFER
+};
+
+static void APIENTRY hook_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+                                     GLenum format, GLenum type, const void *pixels)
+{
+    const uint8_t source = s_state.boundBuffers[GL_PIXEL_UNPACK_BUFFER] ? PIXELS_UNPACK_BUFFER : pixels ? PIXELS_INLINE : PIXELS_NONE;
+    g_glCapture.record(GlCall::TexImage2D, target, level, internalformat, width, height, border, format, type, source);
+    if (source == PIXELS_UNPACK_BUFFER)
+        g_glCapture.values(reinterpret_cast<uint64_t>(pixels));
+    else if (source == PIXELS_INLINE)
+        g_glCapture.blob(pixels, image_bytes(width, height, format, type, s_state.unpackAlignment));
+    real_TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY hook_TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                        GLenum format, GLenum type, const void *pixels)
+{
+    const GLuint unpackBuffer = s_state.boundBuffers[GL_PIXEL_UNPACK_BUFFER];
+    const size_t size = image_bytes(width, height, format, type, s_state.unpackAlignment);
+    if (unpackBuffer)
+        record_mapped(unpackBuffer, reinterpret_cast<GLintptr>(pixels), static_cast<GLsizeiptr>(size));
+
+    const uint8_t source = unpackBuffer ? PIXELS_UNPACK_BUFFER : pixels ? PIXELS_INLINE : PIXELS_NONE;
+    g_glCapture.record(GlCall::TexSubImage2D, target, level, xoffset, yoffset, width, height, format, type, source);
+    if (source == PIXELS_UNPACK_BUFFER)
+        g_glCapture.values(reinterpret_cast<uint64_t>(pixels));
+    else if (source == PIXELS_INLINE)
+        g_glCapture.blob(pixels, size);
+    real_TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+static void APIENTRY hook_TransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode)
+{
+    g_glCapture.record(GlCall::TransformFeedbackVaryings, program, count, bufferMode);
+    for (GLsizei i = 0; i < count; ++i)
+        g_glCapture.string(varyings[i], std::strlen(varyings[i]));
+    real_TransformFeedbackVaryings(program, count, varyings, bufferMode);
+}
+
+#define GL_CAPTURE_UNIFORM(name, components)                                                       \
+    static void APIENTRY hook_##name(GLint location, GLsizei count, const GLfloat *value)          \
+    {                                                                                              \
+        g_glCapture.record(GlCall::name, location, count);                                         \
+        g_glCapture.blob(value, sizeof(GLfloat) * (components) * static_cast<size_t>(count));      \
+        real_##name(location, count, value);                                                       \
+    }
+
+GL_CAPTURE_UNIFORM(Uniform2fv, 2)
+GL_CAPTURE_UNIFORM(Uniform3fv, 3)
+GL_CAPTURE_UNIFORM(Uniform4fv, 4)
+
+#undef GL_CAPTURE_UNIFORM
+
+static void APIENTRY hook_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+    g_glCapture.record(GlCall::UniformMatrix4fv, location, count, transpose);
+    g_glCapture.blob(value, sizeof(GLfloat) * 16 * static_cast<size_t>(count));
+    real_UniformMatrix4fv(location, count, transpose, value);
+}
+
+// core profile, the pointer is an offset into GL_ARRAY_BUFFER
+static void APIENTRY hook_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+    g_glCapture.record(GlCall::VertexAttribPointer, index, size, type, normalized, stride, reinterpret_cast<uint64_t>(pointer));
+    real_VertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void GlCapture::blob(const void *data, size_t size)
+{
+    put(static_cast<uint32_t>(size));
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+    stats.payloadBytes += size;
+    if (buffer.size() >= FLUSH_BYTES)
+        flush();
+}
+
+// NUL terminated in the file so the replay can hand the bytes straight to GL
+void GlCapture::string(const char *s, size_t length)
+{
+    put(static_cast<uint32_t>(length + 1));
+    buffer.insert(buffer.end(), s, s + length);
+    buffer.push_back(0);
+    stats.payloadBytes += length + 1;
+}
+
+void GlCapture::flush()
+{
+    if (!file || buffer.empty())
+        return;
+    if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        EXIT("Failed to write GL capture " + path);
+    stats.fileBytes += buffer.size();
+    buffer.clear();
+}
+
+void GlCapture::start(const std::string &filepath, uint32_t first, uint32_t frameCount)
+{
+    if (file)
+        stop();
+
+    file = fopen(filepath.c_str(), "wb");
+    if (!file)
+        EXIT("Failed to open GL capture " + filepath);
+
+    path = filepath;
+    firstFrame = first;
+    lastFrame = first + frameCount;
+    stats = {};
+    s_state = {};
+
+    GLint viewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const std::string renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    const std::string version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+
+    put(MAGIC);
+    put(VERSION);
+    put(static_cast<uint32_t>(viewport[2]));
+    put(static_cast<uint32_t>(viewport[3]));
+    put(firstFrame);
+    put(uint32_t{0}); // frame count, patched by stop()
+    put(static_cast<uint32_t>(renderer.size()));
+    buffer.insert(buffer.end(), renderer.begin(), renderer.end());
+    put(static_cast<uint32_t>(version.size()));
+    buffer.insert(buffer.end(), version.begin(), version.end());
+
+#define GL_CAPTURE_INSTALL(name) real_##name = glad_gl##name; glad_gl##name = hook_##name;
+    GL_CAPTURE_CALLS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+
+    LOG("GL capture to %s, frames %u..%u\n", path.c_str(), firstFrame, lastFrame);
+}
+
+void GlCapture::stop()
+{
+    if (!file)
+        return;
+
+#define GL_CAPTURE_RESTORE(name) glad_gl##name = real_##name;
+    GL_CAPTURE_CALLS(GL_CAPTURE_RESTORE)
+#undef GL_CAPTURE_RESTORE
+
+    flush();
+    fseek(file, FRAME_COUNT_END - static_cast<long>(sizeof(uint32_t)), SEEK_SET);
+    fwrite(&stats.frames, sizeof(uint32_t), 1, file);
+    fclose(file);
+    file = nullptr;
+
+    LOG("Wrote GL capture %s (%u frames, %llu calls, %.2f MB payload, %.2f MB total)\n", path.c_str(), stats.frames,
+        static_cast<unsigned long long>(stats.calls), stats.payloadBytes / (1024.0 * 1024.0), stats.fileBytes / (1024.0 * 1024.0));
+}
+
+void GlCapture::endFrame()
+{
+    if (!file)
+        return;
+
+    record(GlCall::EndFrame);
+    if (++stats.frames >= lastFrame)
+        stop();
+}
+
+// -- replay --
+
+GlCaptureFile loadGlCapture(const std::string &filepath)
+{
+    std::ifstream ifs{filepath, std::ios::binary};
+    if (!ifs.is_open())
+        EXIT("Failed to open GL capture " + filepath);
+
+    const std::vector<uint8_t> data{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    size_t pos = 0;
+    const auto read = [&](void *out, size_t size) {
+        if (pos + size > data.size())
+            EXIT("Truncated GL capture " + filepath);
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+    };
+    const auto read_u32 = [&]() {
+        uint32_t value;
+        read(&value, sizeof(value));
+        return value;
+    };
+    const auto read_string = [&]() {
+        std::string s(read_u32(), '\0');
+        read(s.data(), s.size());
+        return s;
+    };
+
+    if (read_u32() != GlCapture::MAGIC)
+        EXIT(filepath + " is not a GL capture");
+    if (const uint32_t version = read_u32(); version != GlCapture::VERSION)
+        EXIT("Unsupported GL capture version " + std::to_string(version));
+
+    GlCaptureFile file;
+    file.width = read_u32();
+    file.height = read_u32();
+    file.firstFrame = read_u32();
+    file.frames = read_u32();
+    file.renderer = read_string();
+    file.version = read_string();
+    file.records.assign(data.begin() + static_cast<std::ptrdiff_t>(pos), data.end());
+    return file;
+}
+
+enum
+{
+    NAMES_BUFFER = 0,
+    NAMES_TEXTURE,
+    NAMES_VERTEX_ARRAY,
+    NAMES_FRAMEBUFFER,
+    NAMES_RENDERBUFFER,
+    NAMES_QUERY,
+    NAMES_PROGRAM, // programs and shaders share one namespace
+    NAMES_TRANSFORM_FEEDBACK,
+    NAMES_COUNT
+};
+
+void GlReplayer::begin(const GlCaptureFile &file, GLuint framebuffer)
+{
+    static_assert(NAMES_COUNT == NAME_SPACES);
+
+    capture = &file;
+    defaultFramebuffer = framebuffer;
+    cursor = 0;
+    for (auto &space : names)
+        space.clear();
+    syncs.clear();
+    locations.clear();
+    blockIndices.clear();
+    mappings.clear();
+    boundBuffers.clear();
+    currentProgram = 0;
+    for (CallStats &stats : calls)
+        stats = {};
+}
+
+void GlReplayer::read(void *out, size_t size)
+{
+    if (cursor + size > capture->records.size())
+        EXIT("Truncated GL capture");
+    std::memcpy(out, capture->records.data() + cursor, size);
+    cursor += size;
+}
+
+const uint8_t *GlReplayer::blob(uint32_t &size)
+{
+    size = get<uint32_t>();
+    if (cursor + size > capture->records.size())
+        EXIT("Truncated GL capture");
+    const uint8_t *data = capture->records.data() + cursor;
+    cursor += size;
+    return data;
+}
+
+GLuint GlReplayer::name(int space, GLuint recorded) const
+{
+    if (recorded == 0)
+        return space == NAMES_FRAMEBUFFER ? defaultFramebuffer : 0u;
+    const auto it = names[space].find(recorded);
+    return it != names[space].end() ? it->second : recorded;
+}
+
+GLint GlReplayer::location(GLint recorded) const
+{
+    if (recorded < 0)
+        return recorded;
+    const auto it = locations.find(static_cast<uint64_t>(currentProgram) << 32 | static_cast<uint32_t>(recorded));
+    return it != locations.end() ? it->second : recorded;
+}
+
+void GlReplayer::genNames(int space, void(APIENTRYP gen)(GLsizei, GLuint *))
+{
+    const GLsizei n = get<GLsizei>();
+    uint32_t size;
+    const uint8_t *recorded = blob(size);
+
+    std::vector<GLuint> created(static_cast<size_t>(n));
+    gen(n, created.data());
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        GLuint original;
+        std::memcpy(&original, recorded + i * sizeof(GLuint), sizeof(GLuint));
+        names[space][original] = created[static_cast<size_t>(i)];
+    }
+}
+
+void GlReplayer::deleteNames(int space, void(APIENTRYP del)(GLsizei, const GLuint *))
+{
+    const GLsizei n = get<GLsizei>();
+    uint32_t size;
+    const uint8_t *recorded = blob(size);
+
+    std::vector<GLuint> mapped(static_cast<size_t>(n));
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        GLuint original;
+        std::memcpy(&original, recorded + i * sizeof(GLuint), sizeof(GLuint));
+        mapped[static_cast<size_t>(i)] = name(space, original);
+        names[space].erase(original);
+        if (space == NAMES_BUFFER)
+            mappings.erase(mapped[static_cast<size_t>(i)]);
+    }
+    del(n, mapped.data());
+}
+
+bool GlReplayer::replayFrame()
+{
+    while (cursor < capture->records.size())
+    {
+        const auto start = timeCalls ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        const GlCall call = step();
+
+        CallStats &stats = calls[static_cast<size_t>(call)];
+        ++stats.count;
+        if (timeCalls)
+            stats.nanos += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+        if (call == GlCall::EndFrame)
+            return true;
+    }
+    return false;
+}
+
+GlCall GlReplayer::step()
+{
+    const GlCall call = static_cast<GlCall>(get<uint16_t>());
+    uint32_t size;
+
+    switch (call)
+    {
+    case GlCall::ActiveTexture: glActiveTexture(get<GLenum>()); break;
+    case GlCall::AttachShader:
+    {
+        const GLuint program = get<GLuint>(), shader = get<GLuint>();
+        glAttachShader(name(NAMES_PROGRAM, program), name(NAMES_PROGRAM, shader));
+        break;
+    }
+    case GlCall::BeginQuery:
+    {
+        const GLenum target = get<GLenum>();
+        glBeginQuery(target, name(NAMES_QUERY, get<GLuint>()));
+        break;
+    }
+    case GlCall::BeginTransformFeedback: glBeginTransformFeedback(get<GLenum>()); break;
+    case GlCall::BindBuffer:
+    {
+        const GLenum target = get<GLenum>();
+        const GLuint buffer = name(NAMES_BUFFER, get<GLuint>());
+        boundBuffers[target] = buffer;
+        glBindBuffer(target, buffer);
+        break;
+    }
+    case GlCall::BindBufferRange:
+    {
+        const GLenum target = get<GLenum>();
+        const GLuint index = get<GLuint>();
+        const GLuint buffer = name(NAMES_BUFFER, get<GLuint>());
+        const GLintptr offset = get<GLintptr>();
+        const GLsizeiptr length = get<GLsizeiptr>();
+        boundBuffers[target] = buffer;
+        glBindBufferRange(target, index, buffer, offset, length);
+        break;
+    }
+    case GlCall::BindFramebuffer:
+    {
+        const GLenum target = get<GLenum>();
+        glBindFramebuffer(target, name(NAMES_FRAMEBUFFER, get<GLuint>()));
+        break;
+    }
+    case GlCall::BindRenderbuffer:
+    {
+        const GLenum target = get<GLenum>();
+        glBindRenderbuffer(target, name(NAMES_RENDERBUFFER, get<GLuint>()));
+        break;
+    }
+    case GlCall::BindTexture:
+    {
+        const GLenum target = get<GLenum>();
+        glBindTexture(target, name(NAMES_TEXTURE, get<GLuint>()));
+        break;
+    }
+    case GlCall::BindTransformFeedback:
+    {
+        const GLenum target = get<GLenum>();
+        glBindTransformFeedback(target, name(NAMES_TRANSFORM_FEEDBACK, get<GLuint>()));
+        break;
+    }
+    case GlCall::BindVertexArray: glBindVertexArray(name(NAMES_VERTEX_ARRAY, get<GLuint>())); break;
+    case GlCall::BindVertexBuffer:
+    {
+        const GLuint binding = get<GLuint>();
+        const GLuint buffer = name(NAMES_BUFFER, get<GLuint>());
+        const GLintptr offset = get<GLintptr>();
+        glBindVertexBuffer(binding, buffer, offset, get<GLsizei>());
+        break;
+    }
+    case GlCall::BufferData:
+    case GlCall::BufferStorage:
+    {
+        const GLenum target = get<GLenum>();
+        const GLsizeiptr length = get<GLsizeiptr>();
+        const GLenum usage = get<GLenum>(); // usage or storage flags
+        const void *data = get<uint8_t>() ? blob(size) : nullptr;
+        if (call == GlCall::BufferData)
+            glBufferData(target, length, data, usage);
+        else
+            glBufferStorage(target, length, data, usage);
+        break;
+    }
+    case GlCall::CheckFramebufferStatus: glCheckFramebufferStatus(get<GLenum>()); break;
+    case GlCall::Clear: glClear(get<GLbitfield>()); break;
+    case GlCall::ClearColor:
+    {
+        const GLfloat r = get<GLfloat>(), g = get<GLfloat>(), b = get<GLfloat>(), a = get<GLfloat>();
+        glClearColor(r, g, b, a);
+        break;
+    }
+    case GlCall::ClientWaitSync:
+    {
+        const uint64_t sync = get<uint64_t>();
+        const GLbitfield flags = get<GLbitfield>();
+        const GLuint64 timeout = get<GLuint64>();
+        if (const auto it = syncs.find(sync); it != syncs.end())
+            glClientWaitSync(it->second, flags, timeout);
+        break;
+    }
+    case GlCall::CompileShader: glCompileShader(name(NAMES_PROGRAM, get<GLuint>())); break;
+    case GlCall::CreateProgram: names[NAMES_PROGRAM][get<GLuint>()] = glCreateProgram(); break;
+    case GlCall::CreateShader:
+    {
+        const GLenum type = get<GLenum>();
+        names[NAMES_PROGRAM][get<GLuint>()] = glCreateShader(type);
+        break;
+    }
+    case GlCall::DeleteBuffers: deleteNames(NAMES_BUFFER, glDeleteBuffers); break;
+    case GlCall::DeleteFramebuffers: deleteNames(NAMES_FRAMEBUFFER, glDeleteFramebuffers); break;
+    case GlCall::DeleteQueries: deleteNames(NAMES_QUERY, glDeleteQueries); break;
+    case GlCall::DeleteRenderbuffers: deleteNames(NAMES_RENDERBUFFER, glDeleteRenderbuffers); break;
+    case GlCall::DeleteTextures: deleteNames(NAMES_TEXTURE, glDeleteTextures); break;
+    case GlCall::DeleteTransformFeedbacks: deleteNames(NAMES_TRANSFORM_FEEDBACK, glDeleteTransformFeedbacks); break;
+    case GlCall::DeleteVertexArrays: deleteNames(NAMES_VERTEX_ARRAY, glDeleteVertexArrays); break;
+    case GlCall::DeleteProgram:
+    case GlCall::DeleteShader:
+    {
+        const GLuint recorded = get<GLuint>();
+        const GLuint object = name(NAMES_PROGRAM, recorded);
+        names[NAMES_PROGRAM].erase(recorded);
+        if (call == GlCall::DeleteProgram)
+            glDeleteProgram(object);
+        else
+            glDeleteShader(object);
+        break;
+    }
+    case GlCall::DeleteSync:
+        if (const auto it = syncs.find(get<uint64_t>()); it != syncs.end())
+        {
+            glDeleteSync(it->second);
+            syncs.erase(it);
+        }
+        break;
+    case GlCall::Disable: glDisable(get<GLenum>()); break;
+    case GlCall::DrawArrays:
+    {
+        const GLenum mode = get<GLenum>();
+        const GLint first = get<GLint>();
+        glDrawArrays(mode, first, get<GLsizei>());
+        break;
+    }
+    case GlCall::DrawTransformFeedback:
+    {
+        const GLenum mode = get<GLenum>();
+        glDrawTransformFeedback(mode, name(NAMES_TRANSFORM_FEEDBACK, get<GLuint>()));
+        break;
+    }
+    case GlCall::Enable: glEnable(get<GLenum>()); break;
+    case GlCall::EnableVertexAttribArray: glEnableVertexAttribArray(get<GLuint>()); break;
+    case GlCall::EndQuery: glEndQuery(get<GLenum>()); break;
+    case GlCall::EndTransformFeedback: glEndTransformFeedback(); break;
+    case GlCall::FenceSync:
+    {
+        const GLenum condition = get<GLenum>();
+        const GLbitfield flags = get<GLbitfield>();
+        syncs[get<uint64_t>()] = glFenceSync(condition, flags);
+        break;
+    }
+    case GlCall::Finish: glFinish(); break;
+    case GlCall::Flush: glFlush(); break;
+    case GlCall::FramebufferRenderbuffer:
+    {
+        const GLenum target = get<GLenum>(), attachment = get<GLenum>(), renderbufferTarget = get<GLenum>();
+        glFramebufferRenderbuffer(target, attachment, renderbufferTarget, name(NAMES_RENDERBUFFER, get<GLuint>()));
+        break;
+    }
+    case GlCall::GenBuffers: genNames(NAMES_BUFFER, glGenBuffers); break;
+    case GlCall::GenFramebuffers: genNames(NAMES_FRAMEBUFFER, glGenFramebuffers); break;
+    case GlCall::GenQueries: genNames(NAMES_QUERY, glGenQueries); break;
+    case GlCall::GenRenderbuffers: genNames(NAMES_RENDERBUFFER, glGenRenderbuffers); break;
+    case GlCall::GenTextures: genNames(NAMES_TEXTURE, glGenTextures); break;
+    case GlCall::GenTransformFeedbacks: genNames(NAMES_TRANSFORM_FEEDBACK, glGenTransformFeedbacks); break;
+    case GlCall::GenVertexArrays: genNames(NAMES_VERTEX_ARRAY, glGenVertexArrays); break;
+    case GlCall::GetInteger64v:
+    {
+        GLint64 values[16];
+        glGetInteger64v(get<GLenum>(), values);
+        break;
+    }
+    case GlCall::GetIntegerv:
+    {
+        GLint values[16];
+        glGetIntegerv(get<GLenum>(), values);
+        break;
+    }
+    case GlCall::GetNamedBufferParameteri64v:
+    {
+        const GLuint buffer = name(NAMES_BUFFER, get<GLuint>());
+        GLint64 value;
+        glGetNamedBufferParameteri64v(buffer, get<GLenum>(), &value);
+        break;
+    }
+    case GlCall::GetProgramInfoLog:
+    case GlCall::GetShaderInfoLog:
+    {
+        const GLuint object = name(NAMES_PROGRAM, get<GLuint>());
+        const GLsizei bufSize = get<GLsizei>();
+        scratch.resize(static_cast<size_t>(std::max(bufSize, 1)));
+        if (call == GlCall::GetProgramInfoLog)
+            glGetProgramInfoLog(object, bufSize, nullptr, reinterpret_cast<GLchar *>(scratch.data()));
+        else
+            glGetShaderInfoLog(object, bufSize, nullptr, reinterpret_cast<GLchar *>(scratch.data()));
+        break;
+    }
+    case GlCall::GetProgramiv:
+    case GlCall::GetShaderiv:
+    {
+        const GLuint object = name(NAMES_PROGRAM, get<GLuint>());
+        GLint values[4];
+        if (call == GlCall::GetProgramiv)
+            glGetProgramiv(object, get<GLenum>(), values);
+        else
+            glGetShaderiv(object, get<GLenum>(), values);
+        break;
+    }
+    case GlCall::GetQueryObjectiv:
+    {
+        const GLuint query = name(NAMES_QUERY, get<GLuint>());
+        GLint value;
+        glGetQueryObjectiv(query, get<GLenum>(), &value);
+        break;
+    }
+    case GlCall::GetQueryObjectui64v:
+    {
+        const GLuint query = name(NAMES_QUERY, get<GLuint>());
+        GLuint64 value;
+        glGetQueryObjectui64v(query, get<GLenum>(), &value);
+        break;
+    }
+    case GlCall::GetString: glGetString(get<GLenum>()); break;
+    case GlCall::GetStringi:
+    {
+        const GLenum pname = get<GLenum>();
+        glGetStringi(pname, get<GLuint>());
+        break;
+    }
+    case GlCall::GetTextureLevelParameteriv:
+    {
+        const GLuint texture = name(NAMES_TEXTURE, get<GLuint>());
+        const GLint level = get<GLint>();
+        GLint value;
+        glGetTextureLevelParameteriv(texture, level, get<GLenum>(), &value);
+        break;
+    }
+    case GlCall::GetTextureParameteriv:
+    {
+        const GLuint texture = name(NAMES_TEXTURE, get<GLuint>());
+        GLint values[4];
+        glGetTextureParameteriv(texture, get<GLenum>(), values);
+        break;
+    }
+    case GlCall::GetUniformBlockIndex:
+    {
+        const GLuint program = get<GLuint>();
+        const GLuint recorded = get<GLuint>();
+        const char *blockName = reinterpret_cast<const char *>(blob(size));
+        blockIndices[static_cast<uint64_t>(program) << 32 | recorded] = glGetUniformBlockIndex(name(NAMES_PROGRAM, program), blockName);
+        break;
+    }
+    case GlCall::GetUniformLocation:
+    {
+        const GLuint program = get<GLuint>();
+        const GLint recorded = get<GLint>();
+        const char *uniformName = reinterpret_cast<const char *>(blob(size));
+        locations[static_cast<uint64_t>(program) << 32 | static_cast<uint32_t>(recorded)] = glGetUniformLocation(name(NAMES_PROGRAM, program), uniformName);
+        break;
+    }
+    case GlCall::LinkProgram: glLinkProgram(name(NAMES_PROGRAM, get<GLuint>())); break;
+    case GlCall::MapBufferRange:
+    {
+        const GLenum target = get<GLenum>();
+        const GLintptr offset = get<GLintptr>();
+        const GLsizeiptr length = get<GLsizeiptr>();
+        void *ptr = glMapBufferRange(target, offset, length, get<GLbitfield>());
+        if (!ptr)
+            EXIT("glMapBufferRange failed during replay");
+        mappings[boundBuffers[target]] = {static_cast<uint8_t *>(ptr), offset};
+        break;
+    }
+    case GlCall::MappedWrite:
+    {
+        const GLuint buffer = name(NAMES_BUFFER, get<GLuint>());
+        const GLintptr offset = get<GLintptr>();
+        const uint8_t *data = blob(size);
+        if (const auto it = mappings.find(buffer); it != mappings.end())
+            std::memcpy(it->second.ptr + (offset - it->second.offset), data, size);
+        break;
+    }
+    case GlCall::MemoryBarrier: glMemoryBarrier(get<GLbitfield>()); break;
+    case GlCall::MultiDrawArrays:
+    {
+        const GLenum mode = get<GLenum>();
+        const GLsizei drawcount = get<GLsizei>();
+        const GLint *first = reinterpret_cast<const GLint *>(blob(size));
+        glMultiDrawArrays(mode, first, reinterpret_cast<const GLsizei *>(blob(size)), drawcount);
+        break;
+    }
+    case GlCall::PatchParameteri:
+    {
+        const GLenum pname = get<GLenum>();
+        glPatchParameteri(pname, get<GLint>());
+        break;
+    }
+    case GlCall::PixelStorei:
+    {
+        const GLenum pname = get<GLenum>();
+        glPixelStorei(pname, get<GLint>());
+        break;
+    }
+    case GlCall::PolygonMode:
+    {
+        const GLenum face = get<GLenum>();
+        glPolygonMode(face, get<GLenum>());
+        break;
+    }
+    case GlCall::QueryCounter:
+    {
+        const GLuint query = name(NAMES_QUERY, get<GLuint>());
+        glQueryCounter(query, get<GLenum>());
+        break;
+    }
+    case GlCall::ReadPixels:
+    {
+        const GLint x = get<GLint>(), y = get<GLint>();
+        const GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+        const GLenum format = get<GLenum>(), type = get<GLenum>();
+        const bool packBuffer = get<uint8_t>() != 0;
+        const uint64_t value = get<uint64_t>();
+        if (!packBuffer)
+            scratch.resize(static_cast<size_t>(value));
+        glReadPixels(x, y, width, height, format, type, packBuffer ? reinterpret_cast<void *>(value) : scratch.data());
+        break;
+    }
+    case GlCall::RenderbufferStorage:
+    {
+        const GLenum target = get<GLenum>(), format = get<GLenum>();
+        const GLsizei width = get<GLsizei>();
+        glRenderbufferStorage(target, format, width, get<GLsizei>());
+        break;
+    }
+    case GlCall::ShaderSource:
+    {
+        const GLuint shader = name(NAMES_PROGRAM, get<GLuint>());
+        const GLsizei count = get<GLsizei>();
+        strings.resize(static_cast<size_t>(count));
+        lengths.resize(static_cast<size_t>(count));
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            strings[static_cast<size_t>(i)] = reinterpret_cast<const char *>(blob(size));
+            lengths[static_cast<size_t>(i)] = static_cast<GLint>(size - 1);
+        }
+        glShaderSource(shader, count, strings.data(), lengths.data());
+        break;
+    }
+    case GlCall::TexImage2D:
+    {
+        const GLenum target = get<GLenum>();
+        const GLint level = get<GLint>(), internalFormat = get<GLint>();
+        const GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+        const GLint border = get<GLint>();
+        const GLenum format = get<GLenum>(), type = get<GLenum>();
+        const uint8_t source = get<uint8_t>();
+        const void *pixels = nullptr;
+        if (source == PIXELS_UNPACK_BUFFER)
+            pixels = reinterpret_cast<const void *>(get<uint64_t>());
+        else if (source == PIXELS_INLINE)
+            pixels = blob(size);
+        glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+        break;
+    }
+    case GlCall::TexParameteri:
+    {
+        const GLenum target = get<GLenum>(), pname = get<GLenum>();
+        glTexParameteri(target, pname, get<GLint>());
+        break;
+    }
+    case GlCall::TexStorage2D:
+    {
+        const GLenum target = get<GLenum>();
+        const GLsizei levels = get<GLsizei>();
+        const GLenum format = get<GLenum>();
+        const GLsizei width = get<GLsizei>();
+        glTexStorage2D(target, levels, format, width, get<GLsizei>());
+        break;
+    }
+    case GlCall::TexSubImage2D:
+    {
+        const GLenum target = get<GLenum>();
+        const GLint level = get<GLint>(), xoffset = get<GLint>(), yoffset = get<GLint>();
+        const GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+        const GLenum format = get<GLenum>(), type = get<GLenum>();
+        const uint8_t source = get<uint8_t>();
+        const void *pixels = nullptr;
+        if (source == PIXELS_UNPACK_BUFFER)
+            pixels = reinterpret_cast<const void *>(get<uint64_t>());
+        else if (source == PIXELS_INLINE)
+            pixels = blob(size);
+        glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+        break;
+    }
+    case GlCall::TransformFeedbackVaryings:
+    {
+        const GLuint program = name(NAMES_PROGRAM, get<GLuint>());
+        const GLsizei count = get<GLsizei>();
+        const GLenum bufferMode = get<GLenum>();
+        strings.resize(static_cast<size_t>(count));
+        for (GLsizei i = 0; i < count; ++i)
+            strings[static_cast<size_t>(i)] = reinterpret_cast<const char *>(blob(size));
+        glTransformFeedbackVaryings(program, count, strings.data(), bufferMode);
+        break;
+    }
+    case GlCall::Uniform1f:
+    {
+        const GLint loc = location(get<GLint>());
+        glUniform1f(loc, get<GLfloat>());
+        break;
+    }
+    case GlCall::Uniform1i:
+    {
+        const GLint loc = location(get<GLint>());
+        glUniform1i(loc, get<GLint>());
+        break;
+    }
+    case GlCall::Uniform2fv:
+    case GlCall::Uniform3fv:
+    case GlCall::Uniform4fv:
+    {
+        const GLint loc = location(get<GLint>());
+        const GLsizei count = get<GLsizei>();
+        const GLfloat *value = reinterpret_cast<const GLfloat *>(blob(size));
+        if (call == GlCall::Uniform2fv)
+            glUniform2fv(loc, count, value);
+        else if (call == GlCall::Uniform3fv)
+            glUniform3fv(loc, count, value);
+        else
+            glUniform4fv(loc, count, value);
+        break;
+    }
+    case GlCall::UniformBlockBinding:
+    {
+        const GLuint program = get<GLuint>();
+        const GLuint recorded = get<GLuint>();
+        const auto it = blockIndices.find(static_cast<uint64_t>(program) << 32 | recorded);
+        glUniformBlockBinding(name(NAMES_PROGRAM, program), it != blockIndices.end() ? it->second : recorded, get<GLuint>());
+        break;
+    }
+    case GlCall::UniformMatrix4fv:
+    {
+        const GLint loc = location(get<GLint>());
+        const GLsizei count = get<GLsizei>();
+        const GLboolean transpose = get<GLboolean>();
+        glUniformMatrix4fv(loc, count, transpose, reinterpret_cast<const GLfloat *>(blob(size)));
+        break;
+    }
+    case GlCall::UnmapBuffer:
+    {
+        const GLenum target = get<GLenum>();
+        mappings.erase(boundBuffers[target]);
+        glUnmapBuffer(target);
+        break;
+    }
+    case GlCall::UseProgram:
+        currentProgram = get<GLuint>();
+        glUseProgram(name(NAMES_PROGRAM, currentProgram));
+        break;
+    case GlCall::VertexAttribBinding:
+    {
+        const GLuint attrib = get<GLuint>();
+        glVertexAttribBinding(attrib, get<GLuint>());
+        break;
+    }
+    case GlCall::VertexAttribFormat:
+    {
+        const GLuint attrib = get<GLuint>();
+        const GLint components = get<GLint>();
+        const GLenum type = get<GLenum>();
+        const GLboolean normalized = get<GLboolean>();
+        glVertexAttribFormat(attrib, components, type, normalized, get<GLuint>());
+        break;
+    }
+    case GlCall::VertexAttribPointer:
+    {
+        const GLuint index = get<GLuint>();
+        const GLint components = get<GLint>();
+        const GLenum type = get<GLenum>();
+        const GLboolean normalized = get<GLboolean>();
+        const GLsizei stride = get<GLsizei>();
+        glVertexAttribPointer(index, components, type, normalized, stride, reinterpret_cast<const void *>(get<uint64_t>()));
+        break;
+    }
+    case GlCall::Viewport:
+    {
+        const GLint x = get<GLint>(), y = get<GLint>();
+        const GLsizei width = get<GLsizei>();
+        glViewport(x, y, width, get<GLsizei>());
+        break;
+    }
+    case GlCall::EndFrame: break;
+    default: EXIT("Corrupt GL capture, unknown call " + std::to_string(static_cast<uint32_t>(call)));
+    }
+
+    return call;
+}
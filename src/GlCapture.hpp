@@ -0,0 +1,200 @@
+#ifndef GL_CAPTURE_HPP
+#define GL_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+// every entry point the renderer issues, new GL calls in src/ must be added here and in GlCapture.cpp
+#define GL_CAPTURE_CALLS(X)                                                                                            \
+    X(ActiveTexture) X(AttachShader) X(BeginQuery) X(BeginTransformFeedback) X(BindBuffer) X(BindBufferRange)          \
+    X(BindFramebuffer) X(BindRenderbuffer) X(BindTexture) X(BindTransformFeedback) X(BindVertexArray)                  \
+    X(BindVertexBuffer) X(BufferData) X(BufferStorage) X(CheckFramebufferStatus) X(Clear) X(ClearColor)                \
+    X(ClientWaitSync) X(CompileShader) X(CreateProgram) X(CreateShader) X(DeleteBuffers) X(DeleteFramebuffers)         \
+    X(DeleteProgram) X(DeleteQueries) X(DeleteRenderbuffers) X(DeleteShader) X(DeleteSync) X(DeleteTextures)           \
+    X(DeleteTransformFeedbacks) X(DeleteVertexArrays) X(Disable) X(DrawArrays) X(DrawTransformFeedback) X(Enable)      \
+    X(EnableVertexAttribArray) X(EndQuery) X(EndTransformFeedback) X(FenceSync) X(Finish) X(Flush)                     \
+    X(FramebufferRenderbuffer) X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenRenderbuffers) X(GenTextures)       \
+    X(GenTransformFeedbacks) X(GenVertexArrays) X(GetInteger64v) X(GetIntegerv) X(GetNamedBufferParameteri64v)         \
+    X(GetProgramInfoLog) X(GetProgramiv) X(GetQueryObjectiv) X(GetQueryObjectui64v) X(GetShaderInfoLog) X(GetShaderiv) \
+    X(GetString) X(GetStringi) X(GetTextureLevelParameteriv) X(GetTextureParameteriv) X(GetUniformBlockIndex)          \
+    X(GetUniformLocation) X(LinkProgram) X(MapBufferRange) X(MemoryBarrier) X(MultiDrawArrays) X(PatchParameteri)      \
+    X(PixelStorei) X(PolygonMode) X(QueryCounter) X(ReadPixels) X(RenderbufferStorage) X(ShaderSource) X(TexImage2D)   \
+    X(TexParameteri) X(TexStorage2D) X(TexSubImage2D) X(TransformFeedbackVaryings) X(Uniform1f) X(Uniform1i)           \
+    X(Uniform2fv) X(Uniform3fv) X(Uniform4fv) X(UniformBlockBinding) X(UniformMatrix4fv) X(UnmapBuffer) X(UseProgram)  \
+    X(VertexAttribBinding) X(VertexAttribFormat) X(VertexAttribPointer) X(Viewport)
+
+enum class GlCall : uint16_t
+{
+#define GL_CAPTURE_ENUM(name) name,
+    GL_CAPTURE_CALLS(GL_CAPTURE_ENUM)
+#undef GL_CAPTURE_ENUM
+    MappedWrite, // contents of a mapped range the GPU is about to read, written through the pointer not a GL call
+    EndFrame,
+    Count
+};
+
+const char *glCallName(GlCall call);
+
+/**
+ * @brief Opt-in recorder of the GL call stream. start() swaps the glad
+ * function pointers for recording wrappers, so every call made through glad
+ * is appended with its arguments and payloads (buffer / texture uploads,
+ * shader sources, uniform arrays, CPU writes into persistently mapped
+ * buffers) to a binary capture. Off, it costs nothing.
+ *
+ * Everything from start() on is recorded, frames before firstFrame set up
+ * the state the measured range depends on. GL thread only; calls that bypass
+ * glad (the imgui backend has its own loader) are not captured.
+ */
+struct GlCapture
+{
+    static constexpr uint32_t MAGIC = 0x43474c54; // "TGLC"
+    static constexpr uint32_t VERSION = 2;
+
+    struct Stats
+    {
+        uint64_t calls = 0;
+        uint64_t payloadBytes = 0;
+        uint64_t fileBytes = 0;
+        uint32_t frames = 0;
+    };
+
+    Stats stats;
+
+    // needs a current context with glad loaded, captures until firstFrame + frameCount frames ended
+    void start(const std::string &filepath, uint32_t firstFrame, uint32_t frameCount);
+    void stop();
+
+    bool active() const { return file != nullptr; }
+
+    // frame boundary, call once after the frame's GL commands were issued
+    void endFrame();
+
+    // hook side, GlCapture.cpp only
+    template <typename... Args>
+    void record(GlCall call, const Args &...args)
+    {
+        ++stats.calls;
+        put(static_cast<uint16_t>(call));
+        values(args...);
+    }
+    template <typename... Args>
+    void values(const Args &...args)
+    {
+        (put(args), ...);
+    }
+    void blob(const void *data, size_t size);
+    void string(const char *s, size_t length);
+
+private:
+    template <typename T>
+    void put(const T &value)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        if (buffer.size() >= FLUSH_BYTES)
+            flush();
+    }
+    void flush();
+
+    static constexpr size_t FLUSH_BYTES = 4u << 20;
+
+    FILE *file = nullptr;
+    std::string path;
+    std::vector<uint8_t> buffer;
+    uint32_t firstFrame = 0;
+    uint32_t lastFrame = 0;
+};
+
+extern GlCapture g_glCapture;
+
+// header and record stream of a capture file
+struct GlCaptureFile
+{
+    std::string renderer; // where it was recorded
+    std::string version;
+    uint32_t width = 0;   // viewport at start(), size of the replay's stand-in default framebuffer
+    uint32_t height = 0;
+    uint32_t firstFrame = 0; // frames before are setup
+    uint32_t frames = 0;     // total EndFrame records
+    std::vector<uint8_t> records;
+};
+
+GlCaptureFile loadGlCapture(const std::string &filepath);
+
+/**
+ * @brief Re-issues a capture against the current context. Object names,
+ * uniform locations, block indices and syncs are remapped to the ones the
+ * replay context hands out; getters and query reads go to scratch memory.
+ * Framebuffer 0 is replaced by an offscreen target of the captured size
+ * owned by the caller.
+ */
+struct GlReplayer
+{
+    struct CallStats
+    {
+        uint64_t count = 0;
+        uint64_t nanos = 0; // only with timeCalls
+    };
+
+    const GlCaptureFile *capture = nullptr;
+    GLuint defaultFramebuffer = 0;
+    bool timeCalls = false; // per call CPU time, adds a clock read around every call
+    CallStats calls[static_cast<size_t>(GlCall::Count)];
+
+    void begin(const GlCaptureFile &file, GLuint framebuffer);
+
+    // issues records up to and including the next EndFrame, false at the end of the capture
+    bool replayFrame();
+
+    // cursor of the first record of frame, for replaying a range again
+    size_t position() const { return cursor; }
+    void seek(size_t position) { cursor = position; }
+
+private:
+    GlCall step();
+
+    template <typename T>
+    T get()
+    {
+        T value;
+        read(&value, sizeof(T));
+        return value;
+    }
+    void read(void *out, size_t size);
+    const uint8_t *blob(uint32_t &size);
+
+    GLuint name(int space, GLuint recorded) const;
+    // glGen* / glDelete* of any object type, they share one signature
+    void genNames(int space, void(APIENTRYP gen)(GLsizei, GLuint *));
+    void deleteNames(int space, void(APIENTRYP del)(GLsizei, const GLuint *));
+    GLint location(GLint recorded) const;
+
+    static constexpr int NAME_SPACES = 8; // buffers, textures, vertex arrays, ... see GlCapture.cpp
+
+    struct Mapping
+    {
+        uint8_t *ptr = nullptr;
+        GLintptr offset = 0;
+    };
+
+    size_t cursor = 0;
+    std::unordered_map<GLuint, GLuint> names[NAME_SPACES];
+    std::unordered_map<uint64_t, GLsync> syncs;
+    std::unordered_map<uint64_t, GLint> locations;      // recorded program << 32 | recorded location
+    std::unordered_map<uint64_t, GLuint> blockIndices;  // recorded program << 32 | recorded index
+    std::unordered_map<GLuint, Mapping> mappings;       // replay buffer name
+    std::unordered_map<GLenum, GLuint> boundBuffers;    // replay names per target
+    GLuint currentProgram = 0;                          // recorded name
+    std::vector<uint8_t> scratch;
+    std::vector<const char *> strings;
+    std::vector<GLint> lengths;
+};
+
+#endif // GL_CAPTURE_HPP
@@ -0,0 +1,88 @@
+#include "Defines.hpp"
+#include "HeadlessContext.hpp"
+
+#ifdef TERRAIN_HEADLESS_EGL
+
+#include <EGL/eglext.h>
+
+// surfaceless Mesa context, needs neither a display server nor a GPU (llvmpipe)
+HeadlessContext createHeadlessContext(const char *)
+{
+    HeadlessContext ctx;
+
+    const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    ctx.display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+                                     : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, &major, &minor))
+        EXIT("Failed to initialize EGL");
+
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(ctx.display, configAttribs, &config, 1, &configCount);
+
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    ctx.context = eglCreateContext(ctx.display, configCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx.context == EGL_NO_CONTEXT || !eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx.context))
+        EXIT("Failed to create a surfaceless OpenGL 4.5 core context");
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+        EXIT("gladLoadGLLoader failed");
+
+    return ctx;
+}
+
+void destroyHeadlessContext(HeadlessContext &ctx)
+{
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+    ctx = {};
+}
+
+#else
+
+#include <GLFW/glfw3.h>
+
+// hidden window, rendering still goes to the offscreen framebuffer
+HeadlessContext createHeadlessContext(const char *name)
+{
+    HeadlessContext ctx;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    ctx.window = glfwCreateWindow(64, 64, name, nullptr, nullptr);
+    if (ctx.window == nullptr)
+    {
+        glfwTerminate();
+        EXIT("Failed to create a hidden OpenGL 4.5 core window");
+    }
+    glfwMakeContextCurrent(ctx.window);
+    glfwSwapInterval(0);
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+        EXIT("gladLoadGLLoader failed");
+
+    return ctx;
+}
+
+void destroyHeadlessContext(HeadlessContext &ctx)
+{
+    glfwDestroyWindow(ctx.window);
+    glfwTerminate();
+    ctx = {};
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef HEADLESS_CONTEXT_HPP
+#define HEADLESS_CONTEXT_HPP
+
+#include <glad/glad.h>
+
+#ifdef TERRAIN_HEADLESS_EGL
+#include <EGL/egl.h>
+#else
+struct GLFWwindow;
+#endif
+
+/**
+ * @brief OpenGL 4.5 core context for the headless tools. Surfaceless EGL when
+ * built with TERRAIN_HEADLESS_EGL (runs without a display, e.g. llvmpipe in
+ * CI), a hidden GLFW window otherwise. Rendering goes to an offscreen target
+ * (createOffscreenTarget() in Helpers.hpp) either way.
+ */
+struct HeadlessContext
+{
+#ifdef TERRAIN_HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#else
+    GLFWwindow *window = nullptr;
+#endif
+};
+
+// makes the context current and loads GL through glad, EXITs on failure
+HeadlessContext createHeadlessContext(const char *name);
+void destroyHeadlessContext(HeadlessContext &ctx);
+
+#endif // HEADLESS_CONTEXT_HPP
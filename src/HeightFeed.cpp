@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Defines.hpp"
+#include "HeightFeed.hpp"
+#include "Profiler.hpp"
+#include "WorkerPool.hpp"
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int64_t steady_nanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string shm_name(const std::string &name)
+{
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+void HeightFeedWriter::create(const std::string &feedName, uint32_t width, uint32_t height, uint32_t slotCount)
+{
+    if (width < 2 || height < 2 || slotCount < 2)
+        EXIT("A height feed needs at least 2x2 texels and 2 slots");
+
+    name = shm_name(feedName);
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+        EXIT("Failed to create height feed " + name);
+
+    // slots start on a cache line, the seqlock never shares one with texels of another slot
+    const uint64_t slotBytes = (sizeof(HeightFeedSlot) + static_cast<uint64_t>(width) * height + 63u) & ~uint64_t{63u};
+    size = sizeof(HeightFeedHeader) + slotCount * slotBytes;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        EXIT("Failed to size height feed " + name);
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        EXIT("Failed to map height feed " + name);
+
+    header = new (base) HeightFeedHeader;
+    header->width = width;
+    header->height = height;
+    header->slotCount = slotCount;
+    header->slotBytes = slotBytes;
+    for (uint32_t i = 0; i < slotCount; ++i)
+        new (static_cast<uint8_t *>(base) + sizeof(HeightFeedHeader) + i * slotBytes) HeightFeedSlot;
+    next = 1;
+}
+
+void HeightFeedWriter::release()
+{
+    if (!header)
+        return;
+    munmap(header, size);
+    shm_unlink(name.c_str());
+    header = nullptr;
+}
+
+static HeightFeedSlot *feed_slot(HeightFeedHeader *header, uint64_t frame)
+{
+    return reinterpret_cast<HeightFeedSlot *>(reinterpret_cast<uint8_t *>(header) + sizeof(HeightFeedHeader) +
+                                              (frame % header->slotCount) * header->slotBytes);
+}
+
+uint8_t *HeightFeedWriter::beginFrame()
+{
+    HeightFeedSlot *slot = feed_slot(header, next);
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<uint8_t *>(slot + 1);
+}
+
+void HeightFeedWriter::publish()
+{
+    HeightFeedSlot *slot = feed_slot(header, next);
+    slot->frame = next;
+    slot->writeNanos = steady_nanos();
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1u, std::memory_order_release);
+    header->published.store(next, std::memory_order_release);
+    ++next;
+}
+
+bool HeightFeed::attach(const std::string &feedName, int timeoutMs)
+{
+    release();
+    const std::string name = shm_name(feedName);
+    const auto start = std::chrono::steady_clock::now();
+
+    // the producer may still be starting: wait for the object, then for its first frame
+    int fd = -1;
+    struct stat st = {};
+    while ((fd = shm_open(name.c_str(), O_RDONLY, 0)) < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(HeightFeedHeader))
+    {
+        if (fd >= 0)
+            close(fd);
+        if (elapsed_ms(start) > timeoutMs)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        EXIT("Failed to map height feed " + name);
+    header = static_cast<const HeightFeedHeader *>(base);
+
+    while (header->published.load(std::memory_order_acquire) == 0)
+    {
+        if (elapsed_ms(start) > timeoutMs)
+        {
+            release();
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (header->magic != HeightFeedHeader::MAGIC || header->width < 2 || header->height < 2 || header->slotCount < 2 ||
+        size < sizeof(HeightFeedHeader) + header->slotCount * header->slotBytes ||
+        header->slotBytes < sizeof(HeightFeedSlot) + static_cast<uint64_t>(header->width) * header->height)
+        EXIT("Malformed height feed " + name);
+
+    stats = {};
+    seen = 0;
+    return true;
+}
+
+void HeightFeed::release()
+{
+    if (header)
+        munmap(const_cast<HeightFeedHeader *>(header), size);
+    header = nullptr;
+    shown.reset();
+}
+
+const HeightFeedSlot *HeightFeed::slot(uint64_t frame) const
+{
+    return reinterpret_cast<const HeightFeedSlot *>(reinterpret_cast<const uint8_t *>(header) + sizeof(HeightFeedHeader) +
+                                                    (frame % header->slotCount) * header->slotBytes);
+}
+
+Heightmap HeightFeed::snapshot()
+{
+    Heightmap heightmap;
+    heightmap.width = header->width;
+    heightmap.height = header->height;
+    heightmap.texels.resize(static_cast<size_t>(heightmap.width) * heightmap.height);
+
+    // a producer lapping the ring tears at most the copy it overlaps, the next try gets a newer slot
+    for (;;)
+    {
+        const uint64_t frame = header->published.load(std::memory_order_acquire);
+        const HeightFeedSlot *s = slot(frame);
+        const uint32_t before = s->sequence.load(std::memory_order_acquire);
+        if ((before & 1u) == 0 && s->frame == frame)
+        {
+            memcpy(heightmap.texels.data(), s + 1, heightmap.texels.size());
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s->sequence.load(std::memory_order_relaxed) == before)
+            {
+                seen = frame;
+                return heightmap;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void HeightFeed::track(std::shared_ptr<HeightField> field, WorkerPool *workers)
+{
+    if (field->width != width() || field->height != height())
+        EXIT("Height feed and field sizes differ");
+    shown = std::move(field);
+    pool = workers;
+}
+
+// marks the blocks of rows [by0, by1) where frame and field differ; whole rows are compared first, most of a live frame is unchanged
+static void diff_blocks(const uint8_t *frame, const HeightField &field, uint32_t by0, uint32_t by1, uint32_t blocksX, uint8_t *changed)
+{
+    const uint32_t width = field.width;
+    for (uint32_t by = by0; by < by1; ++by)
+    {
+        uint8_t *flags = changed + static_cast<size_t>(by) * blocksX;
+        const uint32_t y1 = std::min((by + 1) * HeightFeed::BLOCK, field.height);
+        for (uint32_t y = by * HeightFeed::BLOCK; y < y1; ++y)
+        {
+            const uint8_t *a = frame + static_cast<size_t>(y) * width;
+            const uint8_t *b = field.texels.row(y);
+            if (memcmp(a, b, width) == 0)
+                continue;
+            for (uint32_t bx = 0; bx < blocksX; ++bx)
+            {
+                const uint32_t x0 = bx * HeightFeed::BLOCK;
+                if (!flags[bx] && memcmp(a + x0, b + x0, std::min(HeightFeed::BLOCK, width - x0)) != 0)
+                    flags[bx] = 1u;
+            }
+        }
+    }
+}
+
+// runs of changed blocks per block row, stacked while consecutive rows repeat the run
+static void block_rects(const uint8_t *changed, uint32_t blocksX, uint32_t blocksY, uint32_t width, uint32_t height, std::vector<TexelRect> &rects)
+{
+    rects.clear();
+    std::vector<size_t> open, next; // rects that reached the previous block row
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        next.clear();
+        const uint8_t *flags = changed + static_cast<size_t>(by) * blocksX;
+        for (uint32_t bx = 0; bx < blocksX;)
+        {
+            if (!flags[bx])
+            {
+                ++bx;
+                continue;
+            }
+            uint32_t end = bx;
+            while (end + 1 < blocksX && flags[end + 1])
+                ++end;
+
+            const TexelRect rect{bx * HeightFeed::BLOCK, by * HeightFeed::BLOCK, std::min((end + 1) * HeightFeed::BLOCK, width) - 1,
+                                 std::min((by + 1) * HeightFeed::BLOCK, height) - 1};
+            const auto above = std::find_if(open.begin(), open.end(), [&](size_t i) { return rects[i].x0 == rect.x0 && rects[i].x1 == rect.x1; });
+            if (above != open.end())
+            {
+                rects[*above].y1 = rect.y1;
+                next.push_back(*above);
+            }
+            else
+            {
+                next.push_back(rects.size());
+                rects.push_back(rect);
+            }
+            bx = end + 1;
+        }
+        open.swap(next);
+    }
+}
+
+static void copy_rect(const uint8_t *frame, HeightField &field, const TexelRect &rect)
+{
+    for (uint32_t y = rect.y0; y <= rect.y1; ++y)
+    {
+        memcpy(field.texels.writableRow(y) + rect.x0, frame + static_cast<size_t>(y) * field.width + rect.x0, rect.x1 - rect.x0 + 1);
+    }
+}
+
+std::shared_ptr<const HeightField> HeightFeed::update(std::vector<TexelRect> &rects, int64_t &writeNanos)
+{
+    rects.clear();
+    if (!header || !shown)
+        return nullptr;
+
+    const uint64_t frame = header->published.load(std::memory_order_acquire);
+    if (frame == seen)
+        return nullptr;
+
+    // the producer is already refilling the slot for a newer frame, which the next poll finds
+    const HeightFeedSlot *s = slot(frame);
+    const uint32_t before = s->sequence.load(std::memory_order_acquire);
+    if ((before & 1u) != 0 || s->frame != frame)
+        return nullptr;
+    PROFILE_CPU("height_feed/update");
+
+    writeNanos = s->writeNanos;
+    const uint8_t *texels = reinterpret_cast<const uint8_t *>(s + 1);
+    if (seen && frame > seen + 1)
+        stats.skipped += frame - seen - 1;
+    seen = frame;
+
+    const auto diffStart = std::chrono::steady_clock::now();
+    const uint32_t w = shown->width, h = shown->height;
+    const uint32_t blocksX = (w + BLOCK - 1) / BLOCK, blocksY = (h + BLOCK - 1) / BLOCK;
+    changed.assign(static_cast<size_t>(blocksX) * blocksY, 0u);
+    const auto diff = [&](size_t begin, size_t end, size_t) {
+        diff_blocks(texels, *shown, static_cast<uint32_t>(begin), static_cast<uint32_t>(end), blocksX, changed.data());
+    };
+    if (pool)
+        pool->parallelFor(blocksY, 4u, diff);
+    else
+        diff(0u, blocksY, 0u);
+    block_rects(changed.data(), blocksX, blocksY, w, h, rects);
+    stats.diffMs = elapsed_ms(diffStart);
+
+    const auto applyStart = std::chrono::steady_clock::now();
+    std::shared_ptr<HeightField> next;
+    if (!rects.empty())
+    {
+        // the copy shares every band with the field on screen until a rect writes it
+        next = std::make_shared<HeightField>(*shown);
+        for (const TexelRect &rect : rects)
+        {
+            stats.bandsCopied += next->texels.unshare(rect.y0, rect.y1);
+            copy_rect(texels, *next, rect);
+        }
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->sequence.load(std::memory_order_relaxed) != before)
+    {
+        // the copy took part of a newer frame, drop it, the next diff finds these blocks again
+        rects.clear();
+        ++stats.torn;
+        return nullptr;
+    }
+
+    for (const TexelRect &rect : rects)
+        updateMinMaxPyramid(next->bounds, next->texels, rect.x0, rect.y0, rect.x1, rect.y1);
+    stats.applyMs = elapsed_ms(applyStart);
+
+    ++stats.frames;
+    stats.changedRects = rects.size();
+    stats.changedTexels = 0;
+    for (const TexelRect &rect : rects)
+        stats.changedTexels += rect.area();
+    if (rects.empty())
+        return nullptr;
+
+    next->parent = shown;
+    next->changed = rects;
+    shown = std::move(next);
+    return shown;
+}
+
+bool parseFeedSource(const std::string &path, std::string &name)
+{
+    const std::string prefix = "feed:";
+    if (path.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    name = path.substr(prefix.size());
+    if (name.empty())
+        EXIT("Height feed path without a name: " + path);
+    return true;
+}
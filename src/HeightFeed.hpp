@@ -0,0 +1,135 @@
+#ifndef HEIGHT_FEED_HPP
+#define HEIGHT_FEED_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HeightField.hpp"
+
+struct WorkerPool;
+
+/**
+ * @brief Shared memory layout of a live height feed: this header, then
+ * slotCount slots of slotBytes each, a HeightFeedSlot followed by
+ * width * height texels, bottom row first. The producer fills slot
+ * frame % slotCount and bumps published; readers never write.
+ */
+struct HeightFeedHeader
+{
+    static constexpr uint32_t MAGIC = 0x31464854; // "THF1"
+
+    uint32_t magic = MAGIC;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t slotCount = 0;
+    uint64_t slotBytes = 0;
+    std::atomic<uint64_t> published{0}; // newest complete frame, 0 = none yet
+    uint8_t pad[32];
+};
+
+/**
+ * @brief Seqlock of one slot: sequence is odd while the producer writes the
+ * texels. A reader that sees the same even sequence before and after
+ * reading got a whole frame.
+ */
+struct HeightFeedSlot
+{
+    std::atomic<uint32_t> sequence{0};
+    uint32_t reserved = 0;
+    uint64_t frame = 0;
+    int64_t writeNanos = 0; // steady_clock (CLOCK_MONOTONIC) when the frame was published, for latency
+    uint8_t pad[40];
+};
+
+static_assert(sizeof(HeightFeedHeader) == 64 && sizeof(HeightFeedSlot) == 64, "feed layout is shared between processes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "feed atomics live in shared memory");
+
+// producer side, one writer per feed
+struct HeightFeedWriter
+{
+    // creates or replaces the shared memory object name ("/terrain_feed")
+    void create(const std::string &name, uint32_t width, uint32_t height, uint32_t slotCount = 3);
+    void release(); // unmaps and unlinks
+
+    // texels of the next frame's slot, write all of them before publish()
+    uint8_t *beginFrame();
+    void publish();
+
+    uint64_t frame() const { return next - 1; } // last published
+
+private:
+    std::string name;
+    HeightFeedHeader *header = nullptr;
+    size_t size = 0;
+    uint64_t next = 1;
+};
+
+/**
+ * @brief Consumer side. Frames are read where the producer wrote them: a
+ * new frame is compared block by block with the field on screen, only the
+ * blocks that differ are copied into a copy of that field, which shares
+ * every band the blocks miss, and the copy is published and uploaded by
+ * rect. Nothing else of the frame is copied.
+ *
+ * Changes are always found against the field, not the previous frame, so a
+ * torn read (the producer lapped the ring mid-copy) is simply dropped along
+ * with its copy and the next frame brings those blocks.
+ */
+struct HeightFeed
+{
+    struct Stats
+    {
+        uint64_t frames = 0;  // applied
+        uint64_t skipped = 0; // published but superseded before a poll saw them
+        uint64_t torn = 0;    // overwritten while read, dropped
+        uint64_t bandsCopied = 0; // texel bands unshared from the field on screen, summed
+        size_t changedTexels = 0;  // last applied frame
+        size_t changedRects = 0;
+        double diffMs = 0.0;  // last applied frame
+        double applyMs = 0.0; // copy and bounds
+    };
+
+    static constexpr uint32_t BLOCK = 32; // texels per side of the change detection grid
+
+    // maps the shared memory object read only, waits up to timeoutMs for its first frame
+    bool attach(const std::string &name, int timeoutMs = 5000);
+    void release();
+    bool attached() const { return header != nullptr; }
+
+    uint32_t width() const { return header ? header->width : 0u; }
+    uint32_t height() const { return header ? header->height : 0u; }
+
+    // the newest frame, copied whole, for the first texture
+    Heightmap snapshot();
+
+    // the field on screen now, made from snapshot(); updates start from it
+    void track(std::shared_ptr<HeightField> field, WorkerPool *pool = nullptr);
+
+    /**
+     * @brief Brings the field up to the newest frame. Returns the snapshot
+     * to publish and the rects of it to upload, null when there is no new
+     * frame or its read was torn. writeNanos receives the frame's stamp.
+     */
+    std::shared_ptr<const HeightField> update(std::vector<TexelRect> &rects, int64_t &writeNanos);
+
+    Stats stats;
+
+private:
+    const HeightFeedSlot *slot(uint64_t frame) const;
+
+    const HeightFeedHeader *header = nullptr;
+    size_t size = 0;
+    uint64_t seen = 0; // last frame applied or dropped
+    WorkerPool *pool = nullptr;
+    std::shared_ptr<const HeightField> shown; // published
+    std::vector<uint8_t> changed; // per block, scratch
+};
+
+// a heightmap path "feed:/name" attaches to that feed, false for any other path
+bool parseFeedSource(const std::string &path, std::string &name);
+
+#endif // HEIGHT_FEED_HPP
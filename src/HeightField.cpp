@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEIGHT_FIELD_X86 1
+#endif
+
+#include "HeightField.hpp"
+#include "Defines.hpp"
+#include "Helpers.hpp"
+
+// 8 bit texels to the decoded height, (t / 255) * 64 - 16 in exactly this order, like the shader
+constexpr float INV_255 = 1.0f / 255.0f;
+
+static std::atomic<std::shared_ptr<const HeightField>> s_current;
+
+const char *heightFilterName(HeightFilter filter)
+{
+    switch (filter)
+    {
+    case HeightFilter::Fixed8: return "fixed8";
+    case HeightFilter::Float:  return "float";
+    default:                   return "unknown";
+    }
+}
+
+/*
+ * Both filters read the two texel columns px, px + 1 with px clamped to
+ * [0, width - 2]. Where clamp to edge would read the same texel twice the
+ * weight is pinned to 0 or 1 instead, which picks that texel exactly, so
+ * every lookup is one aligned pair per row. The AVX2 kernels below repeat
+ * these steps operation for operation.
+ */
+
+static float sample_fixed8(const HeightField &f, float u, float v)
+{
+    // 8.8 fixed point texel coordinates, far out of range values clamped before the conversion
+    float xs = u * static_cast<float>(f.width) * 256.0f;
+    float ys = v * static_cast<float>(f.height) * 256.0f;
+    xs = xs > -512.0f ? xs : -512.0f;
+    ys = ys > -512.0f ? ys : -512.0f;
+    xs = xs < static_cast<float>(f.width + 1) * 256.0f ? xs : static_cast<float>(f.width + 1) * 256.0f;
+    ys = ys < static_cast<float>(f.height + 1) * 256.0f ? ys : static_cast<float>(f.height + 1) * 256.0f;
+    const int32_t sx = static_cast<int32_t>(std::lrint(xs)) - 128;
+    const int32_t sy = static_cast<int32_t>(std::lrint(ys)) - 128;
+
+    const int32_t ix = sx >> 8;
+    const int32_t iy = sy >> 8;
+    const int32_t lastX = static_cast<int32_t>(f.width) - 2;
+    const int32_t lastY = static_cast<int32_t>(f.height) - 2;
+    const int32_t wx = ix < 0 ? 0 : ix > lastX ? 256 : sx & 255;
+    const int32_t wy = iy < 0 ? 0 : iy > lastY ? 256 : sy & 255;
+    const size_t px = static_cast<size_t>(std::clamp(ix, 0, lastX));
+    const size_t py = static_cast<size_t>(std::clamp(iy, 0, lastY));
+
+    const uint8_t *row0 = f.texels.row(static_cast<uint32_t>(py)) + px;
+    const uint8_t *row1 = f.texels.row(static_cast<uint32_t>(py) + 1u) + px;
+    const int32_t t00 = row0[0], t10 = row0[1];
+    const int32_t t01 = row1[0], t11 = row1[1];
+
+    // every lerp rounds back to 8 bits
+    const int32_t h0 = t00 + (((t10 - t00) * wx + 128) >> 8);
+    const int32_t h1 = t01 + (((t11 - t01) * wx + 128) >> 8);
+    const int32_t r = h0 + (((h1 - h0) * wy + 128) >> 8);
+
+    return static_cast<float>(r) * INV_255 * HEIGHT_SCALE + HEIGHT_OFFSET;
+}
+
+static float sample_float(const HeightField &f, float u, float v)
+{
+    float x = u * static_cast<float>(f.width) - 0.5f;
+    float y = v * static_cast<float>(f.height) - 0.5f;
+    x = x > -2.0f ? x : -2.0f;
+    y = y > -2.0f ? y : -2.0f;
+    x = x < static_cast<float>(f.width + 1) ? x : static_cast<float>(f.width + 1);
+    y = y < static_cast<float>(f.height + 1) ? y : static_cast<float>(f.height + 1);
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+
+    const int32_t ix = static_cast<int32_t>(fx);
+    const int32_t iy = static_cast<int32_t>(fy);
+    const int32_t lastX = static_cast<int32_t>(f.width) - 2;
+    const int32_t lastY = static_cast<int32_t>(f.height) - 2;
+    const float ax = ix < 0 ? 0.0f : ix > lastX ? 1.0f : x - fx;
+    const float ay = iy < 0 ? 0.0f : iy > lastY ? 1.0f : y - fy;
+    const size_t px = static_cast<size_t>(std::clamp(ix, 0, lastX));
+    const size_t py = static_cast<size_t>(std::clamp(iy, 0, lastY));
+
+    const uint8_t *row0 = f.texels.row(static_cast<uint32_t>(py)) + px;
+    const uint8_t *row1 = f.texels.row(static_cast<uint32_t>(py) + 1u) + px;
+    const float t00 = static_cast<float>(row0[0]) * INV_255, t10 = static_cast<float>(row0[1]) * INV_255;
+    const float t01 = static_cast<float>(row1[0]) * INV_255, t11 = static_cast<float>(row1[1]) * INV_255;
+
+    const float h0 = t00 * (1.0f - ax) + t10 * ax;
+    const float h1 = t01 * (1.0f - ax) + t11 * ax;
+    const float r = h0 * (1.0f - ay) + h1 * ay;
+
+    return r * HEIGHT_SCALE + HEIGHT_OFFSET;
+}
+
+float HeightField::sample(float u, float v) const
+{
+    return filter == HeightFilter::Fixed8 ? sample_fixed8(*this, u, v) : sample_float(*this, u, v);
+}
+
+void sampleHeightsScalar(const HeightField &field, const float *u, const float *v, float *out, size_t count)
+{
+    if (field.filter == HeightFilter::Fixed8)
+        for (size_t i = 0; i < count; ++i)
+            out[i] = sample_fixed8(field, u[i], v[i]);
+    else
+        for (size_t i = 0; i < count; ++i)
+            out[i] = sample_float(field, u[i], v[i]);
+}
+
+#ifdef HEIGHT_FIELD_X86
+
+// no FMA in the target, contracted multiply-adds would round differently from the scalar path
+#define AVX2_KERNEL __attribute__((target("avx2")))
+
+// low and second byte of each 32 bit gather, the texel pair at px and px + 1 of row py; rows live in
+// separate bands, so every lane gathers its band pointer first and the pairs come from 64 bit addresses
+AVX2_KERNEL static inline void gather_pairs(const RowBands &texels, __m256i px, __m256i py, __m256i &t0, __m256i &t1)
+{
+    const long long *bands = reinterpret_cast<const long long *>(texels.bandPointers());
+    const __m256i band = _mm256_srli_epi32(py, RowBands::BAND_SHIFT);
+    const __m256i rowInBand = _mm256_and_si256(py, _mm256_set1_epi32(RowBands::BAND_ROWS - 1));
+    const __m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(rowInBand, _mm256_set1_epi32(static_cast<int32_t>(texels.width))), px);
+
+    const __m256i lowAddress = _mm256_add_epi64(_mm256_i32gather_epi64(bands, _mm256_castsi256_si128(band), 8),
+                                                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(offset)));
+    const __m256i highAddress = _mm256_add_epi64(_mm256_i32gather_epi64(bands, _mm256_extracti128_si256(band, 1), 8),
+                                                 _mm256_cvtepi32_epi64(_mm256_extracti128_si256(offset, 1)));
+    const __m128i low = _mm256_i64gather_epi32(static_cast<const int *>(nullptr), lowAddress, 1);
+    const __m128i high = _mm256_i64gather_epi32(static_cast<const int *>(nullptr), highAddress, 1);
+    const __m256i pair = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+    const __m256i bytes = _mm256_set1_epi32(0xff);
+    t0 = _mm256_and_si256(pair, bytes);
+    t1 = _mm256_and_si256(_mm256_srli_epi32(pair, 8), bytes);
+}
+
+AVX2_KERNEL static void sample_fixed8_avx2(const HeightField &f, const float *u, const float *v, float *out, size_t count)
+{
+    const __m256 scaleX = _mm256_set1_ps(static_cast<float>(f.width));
+    const __m256 scaleY = _mm256_set1_ps(static_cast<float>(f.height));
+    const __m256 subtexels = _mm256_set1_ps(256.0f);
+    const __m256 low = _mm256_set1_ps(-512.0f);
+    const __m256 highX = _mm256_set1_ps(static_cast<float>(f.width + 1) * 256.0f);
+    const __m256 highY = _mm256_set1_ps(static_cast<float>(f.height + 1) * 256.0f);
+    const __m256i half = _mm256_set1_epi32(128);
+    const __m256i fraction = _mm256_set1_epi32(255);
+    const __m256i one = _mm256_set1_epi32(256);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lastX = _mm256_set1_epi32(static_cast<int32_t>(f.width) - 2);
+    const __m256i lastY = _mm256_set1_epi32(static_cast<int32_t>(f.height) - 2);
+    const __m256i rowStep = _mm256_set1_epi32(1);
+    const __m256 inv255 = _mm256_set1_ps(INV_255);
+    const __m256 scale = _mm256_set1_ps(HEIGHT_SCALE);
+    const __m256 offset = _mm256_set1_ps(HEIGHT_OFFSET);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 xs = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(u + i), scaleX), subtexels);
+        __m256 ys = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), scaleY), subtexels);
+        xs = _mm256_min_ps(_mm256_max_ps(xs, low), highX);
+        ys = _mm256_min_ps(_mm256_max_ps(ys, low), highY);
+        const __m256i sx = _mm256_sub_epi32(_mm256_cvtps_epi32(xs), half);
+        const __m256i sy = _mm256_sub_epi32(_mm256_cvtps_epi32(ys), half);
+
+        const __m256i ix = _mm256_srai_epi32(sx, 8);
+        const __m256i iy = _mm256_srai_epi32(sy, 8);
+        __m256i wx = _mm256_and_si256(sx, fraction);
+        __m256i wy = _mm256_and_si256(sy, fraction);
+        wx = _mm256_blendv_epi8(wx, zero, _mm256_cmpgt_epi32(zero, ix));
+        wy = _mm256_blendv_epi8(wy, zero, _mm256_cmpgt_epi32(zero, iy));
+        wx = _mm256_blendv_epi8(wx, one, _mm256_cmpgt_epi32(ix, lastX));
+        wy = _mm256_blendv_epi8(wy, one, _mm256_cmpgt_epi32(iy, lastY));
+        const __m256i px = _mm256_min_epi32(_mm256_max_epi32(ix, zero), lastX);
+        const __m256i py = _mm256_min_epi32(_mm256_max_epi32(iy, zero), lastY);
+
+        __m256i t00, t10, t01, t11;
+        gather_pairs(f.texels, px, py, t00, t10);
+        gather_pairs(f.texels, px, _mm256_add_epi32(py, rowStep), t01, t11);
+
+        const __m256i h0 = _mm256_add_epi32(t00, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(t10, t00), wx), half), 8));
+        const __m256i h1 = _mm256_add_epi32(t01, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(t11, t01), wx), half), 8));
+        const __m256i r = _mm256_add_epi32(h0, _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(h1, h0), wy), half), 8));
+
+        const __m256 h = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(r), inv255), scale), offset);
+        _mm256_storeu_ps(out + i, h);
+    }
+
+    for (; i < count; ++i)
+        out[i] = sample_fixed8(f, u[i], v[i]);
+}
+
+AVX2_KERNEL static void sample_float_avx2(const HeightField &f, const float *u, const float *v, float *out, size_t count)
+{
+    const __m256 scaleX = _mm256_set1_ps(static_cast<float>(f.width));
+    const __m256 scaleY = _mm256_set1_ps(static_cast<float>(f.height));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 low = _mm256_set1_ps(-2.0f);
+    const __m256 highX = _mm256_set1_ps(static_cast<float>(f.width + 1));
+    const __m256 highY = _mm256_set1_ps(static_cast<float>(f.height + 1));
+    const __m256 zerof = _mm256_setzero_ps();
+    const __m256 onef = _mm256_set1_ps(1.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lastX = _mm256_set1_epi32(static_cast<int32_t>(f.width) - 2);
+    const __m256i lastY = _mm256_set1_epi32(static_cast<int32_t>(f.height) - 2);
+    const __m256i rowStep = _mm256_set1_epi32(1);
+    const __m256 inv255 = _mm256_set1_ps(INV_255);
+    const __m256 scale = _mm256_set1_ps(HEIGHT_SCALE);
+    const __m256 offset = _mm256_set1_ps(HEIGHT_OFFSET);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(u + i), scaleX), half);
+        __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), scaleY), half);
+        x = _mm256_min_ps(_mm256_max_ps(x, low), highX);
+        y = _mm256_min_ps(_mm256_max_ps(y, low), highY);
+        const __m256 fx = _mm256_floor_ps(x);
+        const __m256 fy = _mm256_floor_ps(y);
+
+        const __m256i ix = _mm256_cvttps_epi32(fx);
+        const __m256i iy = _mm256_cvttps_epi32(fy);
+        __m256 ax = _mm256_sub_ps(x, fx);
+        __m256 ay = _mm256_sub_ps(y, fy);
+        ax = _mm256_blendv_ps(ax, zerof, _mm256_castsi256_ps(_mm256_cmpgt_epi32(zero, ix)));
+        ay = _mm256_blendv_ps(ay, zerof, _mm256_castsi256_ps(_mm256_cmpgt_epi32(zero, iy)));
+        ax = _mm256_blendv_ps(ax, onef, _mm256_castsi256_ps(_mm256_cmpgt_epi32(ix, lastX)));
+        ay = _mm256_blendv_ps(ay, onef, _mm256_castsi256_ps(_mm256_cmpgt_epi32(iy, lastY)));
+        const __m256i px = _mm256_min_epi32(_mm256_max_epi32(ix, zero), lastX);
+        const __m256i py = _mm256_min_epi32(_mm256_max_epi32(iy, zero), lastY);
+
+        __m256i i00, i10, i01, i11;
+        gather_pairs(f.texels, px, py, i00, i10);
+        gather_pairs(f.texels, px, _mm256_add_epi32(py, rowStep), i01, i11);
+        const __m256 t00 = _mm256_mul_ps(_mm256_cvtepi32_ps(i00), inv255);
+        const __m256 t10 = _mm256_mul_ps(_mm256_cvtepi32_ps(i10), inv255);
+        const __m256 t01 = _mm256_mul_ps(_mm256_cvtepi32_ps(i01), inv255);
+        const __m256 t11 = _mm256_mul_ps(_mm256_cvtepi32_ps(i11), inv255);
+
+        const __m256 bx = _mm256_sub_ps(onef, ax);
+        const __m256 by = _mm256_sub_ps(onef, ay);
+        const __m256 h0 = _mm256_add_ps(_mm256_mul_ps(t00, bx), _mm256_mul_ps(t10, ax));
+        const __m256 h1 = _mm256_add_ps(_mm256_mul_ps(t01, bx), _mm256_mul_ps(t11, ax));
+        const __m256 r = _mm256_add_ps(_mm256_mul_ps(h0, by), _mm256_mul_ps(h1, ay));
+
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(r, scale), offset));
+    }
+
+    for (; i < count; ++i)
+        out[i] = sample_float(f, u[i], v[i]);
+}
+
+bool cpuHasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+void sampleHeightsAvx2(const HeightField &field, const float *u, const float *v, float *out, size_t count)
+{
+    if (field.filter == HeightFilter::Fixed8)
+        sample_fixed8_avx2(field, u, v, out, count);
+    else
+        sample_float_avx2(field, u, v, out, count);
+}
+
+#else
+
+bool cpuHasAvx2()
+{
+    return false;
+}
+
+void sampleHeightsAvx2(const HeightField &field, const float *u, const float *v, float *out, size_t count)
+{
+    sampleHeightsScalar(field, u, v, out, count);
+}
+
+#endif // HEIGHT_FIELD_X86
+
+void HeightField::sample(const float *u, const float *v, float *out, size_t count) const
+{
+    if (cpuHasAvx2())
+        sampleHeightsAvx2(*this, u, v, out, count);
+    else
+        sampleHeightsScalar(*this, u, v, out, count);
+}
+
+void HeightField::query(const float *x, const float *z, float *out, size_t count) const
+{
+    // converted in blocks so the uv scratch stays on the stack
+    constexpr size_t BLOCK = 256;
+    float u[BLOCK], v[BLOCK];
+    const glm::vec2 scale{1.0f / extent.x, 1.0f / extent.y};
+
+    for (size_t begin = 0; begin < count; begin += BLOCK)
+    {
+        const size_t n = std::min(BLOCK, count - begin);
+        for (size_t i = 0; i < n; ++i)
+        {
+            u[i] = (x[begin + i] - origin.x) * scale.x;
+            v[i] = (z[begin + i] - origin.y) * scale.y;
+        }
+        sample(u, v, out + begin, n);
+    }
+}
+
+HeightField makeHeightField(Heightmap &&heightmap, glm::vec2 origin, glm::vec2 extent, WorkerPool *pool)
+{
+    if (heightmap.width < 2 || heightmap.height < 2)
+        EXIT("Height field needs at least 2x2 texels");
+
+    HeightField field;
+    field.width = heightmap.width;
+    field.height = heightmap.height;
+    field.texels.assign(field.width, field.height, heightmap.texels.data());
+    field.bounds = buildMinMaxPyramid(heightmap.texels.data(), field.width, field.height, pool);
+    heightmap.texels = {};
+    field.origin = origin;
+    field.extent = extent;
+    return field;
+}
+
+std::shared_ptr<const HeightField> currentHeightField()
+{
+    return s_current.load(std::memory_order_acquire);
+}
+
+void publishHeightField(std::shared_ptr<const HeightField> field)
+{
+    s_current.store(std::move(field), std::memory_order_release);
+}
+
+bool heightFieldChanges(const HeightField &to, const HeightField &from, std::vector<TexelRect> &rects)
+{
+    // parents are weak, a snapshot nobody holds any more ends the chain
+    std::shared_ptr<const HeightField> hold;
+    for (const HeightField *node = &to; node != &from; node = hold.get())
+    {
+        rects.insert(rects.end(), node->changed.begin(), node->changed.end());
+        hold = node->parent.lock();
+        if (!hold)
+            return false;
+    }
+    return true;
+}
+
+HeightFilter HeightFilterCheck::best() const
+{
+    size_t best = 0;
+    for (size_t i = 1; i < static_cast<size_t>(HeightFilter::Count); ++i)
+        if (mismatches[i] < mismatches[best])
+            best = i;
+    return static_cast<HeightFilter>(best);
+}
+
+HeightFilterCheck checkHeightFilters(GLuint texture, const HeightField &field, const std::string &shaderDir, size_t samples, uint32_t seed)
+{
+    HeightFilterCheck check;
+    check.samples = samples;
+
+    // mostly inside, a tenth past the edges to cover clamping
+    std::mt19937 rng{seed};
+    std::uniform_real_distribution<float> inside{0.0f, 1.0f};
+    std::uniform_real_distribution<float> outside{-0.1f, 1.1f};
+    std::vector<glm::vec2> uvs(samples);
+    for (size_t i = 0; i < samples; ++i)
+        uvs[i] = i % 10 == 0 ? glm::vec2{outside(rng), outside(rng)} : glm::vec2{inside(rng), inside(rng)};
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    const GLuint program = createCaptureProgram(shaderDir + "height_probe_vert.glsl", {"Height"}, "HEIGHT_PROBE");
+
+    // draws need a complete framebuffer even with rasterization off
+    OffscreenTarget target = createOffscreenTarget(1u, 1u);
+
+    GLuint vao = 0, vbo = 0, feedback = 0;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(samples * sizeof(glm::vec2)), uvs.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), nullptr);
+    glEnableVertexAttribArray(0);
+
+    const GLsizeiptr feedbackBytes = static_cast<GLsizeiptr>(samples * sizeof(float));
+    glGenBuffers(1, &feedback);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, feedbackBytes, nullptr, GL_STREAM_READ);
+
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    set_uni_int(program, "heightMap", 0);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+    glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback, 0, feedbackBytes);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(samples));
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    const float *gpu = static_cast<const float *>(glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBytes, GL_MAP_READ_BIT));
+    if (!gpu)
+        EXIT("Failed to map height probe results");
+
+    HeightField candidate = field;
+    for (size_t f = 0; f < static_cast<size_t>(HeightFilter::Count); ++f)
+    {
+        candidate.filter = static_cast<HeightFilter>(f);
+        for (size_t i = 0; i < samples; ++i)
+        {
+            const float cpu = candidate.sample(uvs[i].x, uvs[i].y);
+            if (cpu != gpu[i])
+            {
+                ++check.mismatches[f];
+                check.maxError[f] = std::max(check.maxError[f], std::abs(cpu - gpu[i]));
+            }
+        }
+    }
+
+    glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0u);
+    glBindBuffer(GL_ARRAY_BUFFER, 0u);
+    glBindVertexArray(0u);
+    glUseProgram(0u);
+    glDeleteBuffers(1, &feedback);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    destroyOffscreenTarget(target);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    return check;
+}
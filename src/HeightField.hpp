@@ -0,0 +1,94 @@
+#ifndef HEIGHT_FIELD_HPP
+#define HEIGHT_FIELD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Heightmap.hpp"
+
+/**
+ * @brief How texture(heightMap, uv) filters UNORM8 texels. Subtexel
+ * precision is implementation defined, so the match is checked against the
+ * device (checkHeightFilters) rather than assumed.
+ */
+enum class HeightFilter : uint8_t
+{
+    Fixed8, // 8.8 fixed point coordinates, 8 bit weights, every lerp rounded to 8 bits (llvmpipe)
+    Float,  // float weights and lerps on the normalized texels
+    Count
+};
+
+const char *heightFilterName(HeightFilter filter);
+
+/**
+ * @brief Retained CPU copy of the heightmap channel the shaders read, with
+ * the world placement of the patch grid. Queries decode like test_tes.glsl
+ * (texture().y * 64 - 16) under GL_LINEAR + GL_CLAMP_TO_EDGE.
+ *
+ * Immutable once published, any number of threads may query one snapshot.
+ * Copies share texel and bound bands, so a snapshot of an edited copy costs
+ * only the bands the edit wrote.
+ */
+struct HeightField
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    RowBands texels;                 // bottom row first
+    std::vector<MinMaxLevel> bounds; // buildMinMaxPyramid of texels, for ray casts
+    glm::vec2 origin{0.0f};      // world xz of uv (0, 0)
+    glm::vec2 extent{1.0f};      // world size of uv [0, 1]
+    HeightFilter filter = HeightFilter::Fixed8;
+
+    // the snapshot this one was made from and where they differ, for caches that outlive a publish
+    std::weak_ptr<const HeightField> parent;
+    std::vector<TexelRect> changed;
+
+    // scalar reference, the batched paths return the same bits
+    float sample(float u, float v) const;
+
+    // count lookups in uv space, AVX2 when the CPU has it
+    void sample(const float *u, const float *v, float *out, size_t count) const;
+
+    // count lookups at world xz
+    void query(const float *x, const float *z, float *out, size_t count) const;
+};
+
+// takes the texels of heightmap, width and height must be at least 2
+HeightField makeHeightField(Heightmap &&heightmap, glm::vec2 origin, glm::vec2 extent, WorkerPool *pool = nullptr);
+
+// explicit paths for benchmarks, sampleHeightsAvx2 needs cpuHasAvx2()
+bool cpuHasAvx2();
+void sampleHeightsScalar(const HeightField &field, const float *u, const float *v, float *out, size_t count);
+void sampleHeightsAvx2(const HeightField &field, const float *u, const float *v, float *out, size_t count);
+
+// the field gameplay and physics query; readers keep their snapshot alive, a new one is swapped in atomically
+std::shared_ptr<const HeightField> currentHeightField();
+void publishHeightField(std::shared_ptr<const HeightField> field);
+
+// appends the changed rects of to and its parents back to from, false when that chain is broken
+bool heightFieldChanges(const HeightField &to, const HeightField &from, std::vector<TexelRect> &rects);
+
+struct HeightFilterCheck
+{
+    size_t samples = 0;
+    size_t mismatches[static_cast<size_t>(HeightFilter::Count)] = {};
+    float maxError[static_cast<size_t>(HeightFilter::Count)] = {};
+
+    // exact filter if there is one, else the closest
+    HeightFilter best() const;
+};
+
+/**
+ * @brief Samples texture at random uvs (some outside [0, 1]) on the GPU
+ * through transform feedback and compares every filter against it. Needs a
+ * current context and height_probe_vert.glsl in shaderDir.
+ */
+HeightFilterCheck checkHeightFilters(GLuint texture, const HeightField &field, const std::string &shaderDir, size_t samples, uint32_t seed = 1);
+
+#endif // HEIGHT_FIELD_HPP
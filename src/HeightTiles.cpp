@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Defines.hpp"
+#include "HeightTiles.hpp"
+#include "Profiler.hpp"
+
+TexelRect HeightVersion::tileRect(uint32_t tx, uint32_t ty) const
+{
+    const uint32_t x0 = tx * HeightTile::SIZE, y0 = ty * HeightTile::SIZE;
+    return {x0, y0, std::min(x0 + HeightTile::SIZE, width) - 1u, std::min(y0 + HeightTile::SIZE, height) - 1u};
+}
+
+void HeightVersion::read(const TexelRect &rect, RowBands &rows) const
+{
+    for (uint32_t ty = rect.y0 / HeightTile::SIZE; ty <= rect.y1 / HeightTile::SIZE; ++ty)
+    {
+        for (uint32_t tx = rect.x0 / HeightTile::SIZE; tx <= rect.x1 / HeightTile::SIZE; ++tx)
+        {
+            const TexelRect bounds = tileRect(tx, ty);
+            const uint32_t x0 = std::max(rect.x0, bounds.x0), x1 = std::min(rect.x1, bounds.x1);
+            const uint32_t y0 = std::max(rect.y0, bounds.y0), y1 = std::min(rect.y1, bounds.y1);
+            const HeightTile &source = tile(tx, ty);
+            for (uint32_t y = y0; y <= y1; ++y)
+                memcpy(rows.writableRow(y) + x0, source.texels + (y - bounds.y0) * HeightTile::SIZE + (x0 - bounds.x0), x1 - x0 + 1);
+        }
+    }
+}
+
+void HeightTileStore::init(const RowBands &texels, size_t historyBytes)
+{
+    const uint32_t width = texels.width, height = texels.height;
+    if (width == 0 || height == 0)
+        EXIT("Height tiles need a non-empty map");
+
+    auto version = std::make_shared<HeightVersion>();
+    version->width = width;
+    version->height = height;
+    version->tilesX = (width + HeightTile::SIZE - 1) / HeightTile::SIZE;
+    version->tilesY = (height + HeightTile::SIZE - 1) / HeightTile::SIZE;
+    version->tiles.resize(static_cast<size_t>(version->tilesX) * version->tilesY);
+
+    for (uint32_t ty = 0; ty < version->tilesY; ++ty)
+    {
+        for (uint32_t tx = 0; tx < version->tilesX; ++tx)
+        {
+            const TexelRect bounds = version->tileRect(tx, ty);
+            auto tile = std::make_shared<HeightTile>();
+            memset(tile->texels, 0, sizeof(tile->texels));
+            for (uint32_t y = bounds.y0; y <= bounds.y1; ++y)
+                memcpy(tile->texels + (y - bounds.y0) * HeightTile::SIZE, texels.row(y) + bounds.x0, bounds.x1 - bounds.x0 + 1);
+            version->tiles[static_cast<size_t>(ty) * version->tilesX + tx] = std::move(tile);
+        }
+    }
+
+    undoStack.clear();
+    redoStack.clear();
+    this->historyBytes = 0;
+    historyLimit = historyBytes;
+    nextId = 1;
+    tilesCopied = 0;
+    published = 0;
+    root.store(std::move(version), std::memory_order_release);
+}
+
+void HeightTileStore::write(const RowBands &texels, const std::vector<TexelRect> &rects)
+{
+    if (rects.empty())
+        return;
+    PROFILE_CPU("height_tiles/write");
+
+    // the pointer array is all a new version copies up front, tiles follow on first touch
+    const std::shared_ptr<const HeightVersion> base = current();
+    auto next = std::make_shared<HeightVersion>(*base);
+    next->id = nextId++;
+
+    std::vector<HeightTile *> copies(next->tiles.size(), nullptr);
+    size_t copied = 0;
+    for (const TexelRect &rect : rects)
+    {
+        for (uint32_t ty = rect.y0 / HeightTile::SIZE; ty <= rect.y1 / HeightTile::SIZE; ++ty)
+        {
+            for (uint32_t tx = rect.x0 / HeightTile::SIZE; tx <= rect.x1 / HeightTile::SIZE; ++tx)
+            {
+                const size_t index = static_cast<size_t>(ty) * next->tilesX + tx;
+                if (!copies[index])
+                {
+                    auto tile = std::make_shared<HeightTile>(*base->tiles[index]);
+                    copies[index] = tile.get();
+                    next->tiles[index] = std::move(tile);
+                    ++copied;
+                }
+
+                const TexelRect bounds = next->tileRect(tx, ty);
+                const uint32_t x0 = std::max(rect.x0, bounds.x0), x1 = std::min(rect.x1, bounds.x1);
+                const uint32_t y0 = std::max(rect.y0, bounds.y0), y1 = std::min(rect.y1, bounds.y1);
+                for (uint32_t y = y0; y <= y1; ++y)
+                    memcpy(copies[index]->texels + (y - bounds.y0) * HeightTile::SIZE + (x0 - bounds.x0),
+                           texels.row(y) + x0, x1 - x0 + 1);
+            }
+        }
+    }
+
+    // a new edit forks the history, what was undone cannot come back
+    for (const Entry &entry : redoStack)
+        historyBytes -= entry.bytes;
+    redoStack.clear();
+
+    undoStack.push_back({base, copied * sizeof(HeightTile)});
+    historyBytes += copied * sizeof(HeightTile);
+    tilesCopied += copied;
+    ++published;
+    root.store(std::move(next), std::memory_order_release);
+
+    // the oldest version only keeps alive the tiles its successor replaced
+    size_t dropped = 0;
+    while (historyBytes > historyLimit && dropped < undoStack.size())
+        historyBytes -= undoStack[dropped++].bytes;
+    undoStack.erase(undoStack.begin(), undoStack.begin() + static_cast<std::ptrdiff_t>(dropped));
+}
+
+bool HeightTileStore::undo(std::vector<TexelRect> &changed)
+{
+    return step(undoStack, redoStack, changed);
+}
+
+bool HeightTileStore::redo(std::vector<TexelRect> &changed)
+{
+    return step(redoStack, undoStack, changed);
+}
+
+bool HeightTileStore::step(std::vector<Entry> &from, std::vector<Entry> &to, std::vector<TexelRect> &changed)
+{
+    changed.clear();
+    if (from.empty())
+        return false;
+
+    const std::shared_ptr<const HeightVersion> leaving = current();
+    Entry target = std::move(from.back());
+    from.pop_back();
+
+    // versions of one store differ exactly where their tile pointers do
+    for (uint32_t ty = 0; ty < leaving->tilesY; ++ty)
+        for (uint32_t tx = 0; tx < leaving->tilesX; ++tx)
+            if (leaving->tiles[static_cast<size_t>(ty) * leaving->tilesX + tx] != target.version->tiles[static_cast<size_t>(ty) * leaving->tilesX + tx])
+                changed.push_back(leaving->tileRect(tx, ty));
+
+    to.push_back({leaving, target.bytes});
+    ++published;
+    root.store(std::move(target.version), std::memory_order_release);
+    return true;
+}
+
+HeightTileStore::Stats HeightTileStore::stats() const
+{
+    Stats stats;
+    stats.undoVersions = undoStack.size();
+    stats.redoVersions = redoStack.size();
+    stats.historyBytes = historyBytes;
+    stats.tilesCopied = tilesCopied;
+    stats.published = published;
+    return stats;
+}
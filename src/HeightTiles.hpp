@@ -0,0 +1,103 @@
+#ifndef HEIGHT_TILES_HPP
+#define HEIGHT_TILES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Heightmap.hpp"
+
+struct HeightTile
+{
+    static constexpr uint32_t SIZE = 64; // texels per side, edge tiles use part of it
+
+    uint8_t texels[SIZE * SIZE]; // bottom row first
+};
+
+/**
+ * @brief One immutable version of the heightmap as a grid of shared tiles.
+ * A version made from another shares every tile it did not write, so a
+ * version costs a pointer per tile plus the tiles it changed.
+ */
+struct HeightVersion
+{
+    uint64_t id = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    std::vector<std::shared_ptr<const HeightTile>> tiles; // row-major
+
+    const HeightTile &tile(uint32_t tx, uint32_t ty) const { return *tiles[static_cast<size_t>(ty) * tilesX + tx]; }
+
+    uint8_t at(uint32_t x, uint32_t y) const
+    {
+        return tile(x / HeightTile::SIZE, y / HeightTile::SIZE).texels[(y % HeightTile::SIZE) * HeightTile::SIZE + x % HeightTile::SIZE];
+    }
+
+    // texels of tile (tx, ty) inside the map
+    TexelRect tileRect(uint32_t tx, uint32_t ty) const;
+
+    // copies the inclusive rect into rows of the same size
+    void read(const TexelRect &rect, RowBands &rows) const;
+};
+
+/**
+ * @brief Copy-on-write height tiles behind an atomically swapped version
+ * root, RCU style. Readers take current() and keep using that version for
+ * as long as they hold it, without locks and without seeing a half written
+ * edit. The single writer copies only the tiles it touches into a new
+ * version and publishes it in one store.
+ *
+ * Replaced versions stay on an undo stack. They share their untouched tiles
+ * with the current one, so the history costs memory in proportion to the
+ * edited area; the oldest versions are dropped past historyBytes.
+ */
+struct HeightTileStore
+{
+    struct Stats
+    {
+        size_t undoVersions = 0;
+        size_t redoVersions = 0;
+        size_t historyBytes = 0; // tiles only the undo and redo stacks keep alive
+        uint64_t tilesCopied = 0;
+        uint64_t published = 0;
+    };
+
+    void init(const RowBands &texels, size_t historyBytes = 64u << 20);
+
+    std::shared_ptr<const HeightVersion> current() const { return root.load(std::memory_order_acquire); }
+
+    // writer side, one thread: copies the rects of texels into the tiles of a new version and publishes it
+    void write(const RowBands &texels, const std::vector<TexelRect> &rects);
+
+    // step through the history, changed receives the rects of the tiles that differ; false when there is nothing to step to
+    bool undo(std::vector<TexelRect> &changed);
+    bool redo(std::vector<TexelRect> &changed);
+
+    // writer thread
+    Stats stats() const;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const HeightVersion> version;
+        size_t bytes = 0; // tiles it does not share with the next version towards the current one
+    };
+
+    // moves the current version onto to, from's top becomes current
+    bool step(std::vector<Entry> &from, std::vector<Entry> &to, std::vector<TexelRect> &changed);
+
+    std::atomic<std::shared_ptr<const HeightVersion>> root;
+    std::vector<Entry> undoStack; // oldest first
+    std::vector<Entry> redoStack;
+    size_t historyBytes = 0;
+    size_t historyLimit = 0;
+    uint64_t nextId = 0;
+    uint64_t tilesCopied = 0;
+    uint64_t published = 0;
+};
+
+#endif // HEIGHT_TILES_HPP
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stb/stb_image.h>
+
+#include "Heightmap.hpp"
+#include "Defines.hpp"
+#include "WorkerPool.hpp"
+
+constexpr char RAW_MAGIC[4] = {'T', 'H', 'M', '1'};
+constexpr size_t RAW_HEADER_BYTES = 16;
+
+// rows per parallelFor chunk, keeps chunks well above the scheduling cost
+constexpr size_t ROW_GRAIN = 16;
+
+template <typename Fn>
+static void for_rows(WorkerPool *pool, size_t rows, Fn &&fn)
+{
+    if (pool)
+        pool->parallelFor(rows, ROW_GRAIN, [&](size_t begin, size_t end, size_t) { fn(begin, end); });
+    else
+        fn(0u, rows);
+}
+
+float Heightmap::sample(float u, float v) const
+{
+    const float x = u * static_cast<float>(width) - 0.5f;
+    const float y = v * static_cast<float>(height) - 0.5f;
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+    const float ax = x - fx;
+    const float ay = y - fy;
+
+    const int maxX = static_cast<int>(width) - 1;
+    const int maxY = static_cast<int>(height) - 1;
+    const uint32_t x0 = static_cast<uint32_t>(std::clamp(static_cast<int>(fx), 0, maxX));
+    const uint32_t x1 = static_cast<uint32_t>(std::clamp(static_cast<int>(fx) + 1, 0, maxX));
+    const uint32_t y0 = static_cast<uint32_t>(std::clamp(static_cast<int>(fy), 0, maxY));
+    const uint32_t y1 = static_cast<uint32_t>(std::clamp(static_cast<int>(fy) + 1, 0, maxY));
+
+    const float h00 = texel_height(at(x0, y0));
+    const float h10 = texel_height(at(x1, y0));
+    const float h01 = texel_height(at(x0, y1));
+    const float h11 = texel_height(at(x1, y1));
+
+    const float h0 = h00 + (h10 - h00) * ax;
+    const float h1 = h01 + (h11 - h01) * ax;
+    return h0 + (h1 - h0) * ay;
+}
+
+Heightmap decodeHeightmap(const std::string &filepath)
+{
+    int width, height, channels;
+    if (!stbi_info(filepath.c_str(), &width, &height, &channels))
+        EXIT("Failed to load heightmap " + filepath);
+
+    // grey images expand to grey in every channel, no need to decode them to RGBA
+    const int decoded = channels <= 2 ? 1 : 4;
+
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *data = stbi_load(filepath.c_str(), &width, &height, &channels, decoded);
+    if (!data)
+        EXIT("Failed to load heightmap " + filepath);
+
+    Heightmap heightmap;
+    heightmap.width = static_cast<uint32_t>(width);
+    heightmap.height = static_cast<uint32_t>(height);
+    heightmap.texels.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+
+    // green channel, what texture().y returns
+    if (decoded == 1)
+        std::memcpy(heightmap.texels.data(), data, heightmap.texels.size());
+    else
+        for (size_t i = 0; i < heightmap.texels.size(); ++i)
+            heightmap.texels[i] = data[4 * i + 1];
+
+    stbi_image_free(data);
+    return heightmap;
+}
+
+void saveRawHeightmap(const std::string &filepath, const Heightmap &heightmap)
+{
+    FILE *file = fopen(filepath.c_str(), "wb");
+    if (!file)
+        EXIT("Failed to open " + filepath);
+
+    uint8_t header[RAW_HEADER_BYTES] = {};
+    std::memcpy(header, RAW_MAGIC, sizeof(RAW_MAGIC));
+    std::memcpy(header + 4, &heightmap.width, sizeof(uint32_t));
+    std::memcpy(header + 8, &heightmap.height, sizeof(uint32_t));
+
+    const bool ok = fwrite(header, 1, RAW_HEADER_BYTES, file) == RAW_HEADER_BYTES &&
+                    fwrite(heightmap.texels.data(), 1, heightmap.texels.size(), file) == heightmap.texels.size();
+    fclose(file);
+    if (!ok)
+        EXIT("Failed to write " + filepath);
+}
+
+static void parse_raw_header(const uint8_t *header, const std::string &filepath, uint32_t &width, uint32_t &height)
+{
+    if (std::memcmp(header, RAW_MAGIC, sizeof(RAW_MAGIC)) != 0)
+        EXIT(filepath + " is not a raw heightmap");
+    std::memcpy(&width, header + 4, sizeof(uint32_t));
+    std::memcpy(&height, header + 8, sizeof(uint32_t));
+}
+
+Heightmap readRawHeightmap(const std::string &filepath)
+{
+    FILE *file = fopen(filepath.c_str(), "rb");
+    if (!file)
+        EXIT("Failed to open " + filepath);
+
+    uint8_t header[RAW_HEADER_BYTES];
+    if (fread(header, 1, RAW_HEADER_BYTES, file) != RAW_HEADER_BYTES)
+        EXIT("Truncated raw heightmap " + filepath);
+
+    Heightmap heightmap;
+    parse_raw_header(header, filepath, heightmap.width, heightmap.height);
+    heightmap.texels.resize(static_cast<size_t>(heightmap.width) * heightmap.height);
+    const bool ok = fread(heightmap.texels.data(), 1, heightmap.texels.size(), file) == heightmap.texels.size();
+    fclose(file);
+    if (!ok)
+        EXIT("Truncated raw heightmap " + filepath);
+
+    return heightmap;
+}
+
+MappedHeightmap mapRawHeightmap(const std::string &filepath)
+{
+    const int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        EXIT("Failed to open " + filepath);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < RAW_HEADER_BYTES)
+        EXIT("Truncated raw heightmap " + filepath);
+
+    MappedHeightmap mapped;
+    mapped.size = static_cast<size_t>(st.st_size);
+    mapped.base = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped.base == MAP_FAILED)
+        EXIT("Failed to map " + filepath);
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(mapped.base);
+    parse_raw_header(bytes, filepath, mapped.width, mapped.height);
+    if (mapped.size < RAW_HEADER_BYTES + static_cast<size_t>(mapped.width) * mapped.height)
+        EXIT("Truncated raw heightmap " + filepath);
+
+    madvise(mapped.base, mapped.size, MADV_SEQUENTIAL);
+    mapped.texels = bytes + RAW_HEADER_BYTES;
+    return mapped;
+}
+
+void MappedHeightmap::release()
+{
+    if (base)
+        munmap(base, size);
+    base = nullptr;
+    texels = nullptr;
+    size = 0;
+}
+
+static uint32_t hash2(uint32_t x, uint32_t y, uint32_t seed)
+{
+    uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return h;
+}
+
+static float value_noise(float x, float y, uint32_t seed)
+{
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+    const uint32_t ix = static_cast<uint32_t>(static_cast<int32_t>(fx));
+    const uint32_t iy = static_cast<uint32_t>(static_cast<int32_t>(fy));
+
+    float tx = x - fx;
+    float ty = y - fy;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    ty = ty * ty * (3.0f - 2.0f * ty);
+
+    constexpr float INV = 1.0f / 4294967295.0f;
+    const float v00 = hash2(ix, iy, seed) * INV;
+    const float v10 = hash2(ix + 1, iy, seed) * INV;
+    const float v01 = hash2(ix, iy + 1, seed) * INV;
+    const float v11 = hash2(ix + 1, iy + 1, seed) * INV;
+
+    const float a = v00 + (v10 - v00) * tx;
+    const float b = v01 + (v11 - v01) * tx;
+    return a + (b - a) * ty;
+}
+
+Heightmap makeSyntheticHeightmap(uint32_t width, uint32_t height, uint32_t seed, WorkerPool *pool)
+{
+    constexpr int OCTAVES = 6;
+
+    Heightmap heightmap;
+    heightmap.width = width;
+    heightmap.height = height;
+    heightmap.texels.resize(static_cast<size_t>(width) * height);
+
+    // features scale with the map so every size has the same look
+    const float baseFrequency = 8.0f / static_cast<float>(std::max(width, height));
+
+    for_rows(pool, height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint8_t *row = &heightmap.texels[y * width];
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                float sum = 0.0f, amplitude = 0.5f, frequency = baseFrequency;
+                for (int octave = 0; octave < OCTAVES; ++octave)
+                {
+                    sum += amplitude * value_noise(x * frequency, y * frequency, seed + static_cast<uint32_t>(octave));
+                    amplitude *= 0.5f;
+                    frequency *= 2.0f;
+                }
+                row[x] = static_cast<uint8_t>(std::clamp(sum * 255.0f, 0.0f, 255.0f));
+            }
+        }
+    });
+
+    return heightmap;
+}
+
+// 2x2 box filter of src into the dst texels [x0, x1] x [y0, y1], odd source edges clamp
+static void downsample_rect(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, HeightLevel &dst, uint32_t x0, uint32_t y0,
+                            uint32_t x1, uint32_t y1)
+{
+    const uint32_t lastX = srcWidth - 1, lastY = srcHeight - 1;
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        const uint8_t *row0 = src + std::min<size_t>(2 * y, lastY) * srcWidth;
+        const uint8_t *row1 = src + std::min<size_t>(2 * y + 1, lastY) * srcWidth;
+        uint8_t *out = dst.texels.data() + static_cast<size_t>(y) * dst.width;
+        for (uint32_t x = x0; x <= x1; ++x)
+        {
+            const uint32_t c0 = std::min(2 * x, lastX), c1 = std::min(2 * x + 1, lastX);
+            const uint32_t sum = row0[c0] + row0[c1] + row1[c0] + row1[c1];
+            out[x] = static_cast<uint8_t>((sum + 2) >> 2);
+        }
+    }
+}
+
+std::vector<HeightLevel> buildMipChain(const uint8_t *texels, uint32_t width, uint32_t height, WorkerPool *pool)
+{
+    std::vector<HeightLevel> levels;
+
+    const uint8_t *src = texels;
+    uint32_t srcWidth = width, srcHeight = height;
+    while (srcWidth > 1 || srcHeight > 1)
+    {
+        HeightLevel level;
+        level.width = std::max(srcWidth / 2, 1u);
+        level.height = std::max(srcHeight / 2, 1u);
+        level.texels.resize(static_cast<size_t>(level.width) * level.height);
+
+        for_rows(pool, level.height, [&](size_t begin, size_t end) {
+            downsample_rect(src, srcWidth, srcHeight, level, 0u, static_cast<uint32_t>(begin), level.width - 1, static_cast<uint32_t>(end - 1));
+        });
+
+        levels.push_back(std::move(level));
+        src = levels.back().texels.data();
+        srcWidth = levels.back().width;
+        srcHeight = levels.back().height;
+    }
+
+    return levels;
+}
+
+void updateMipChain(std::vector<HeightLevel> &levels, const uint8_t *texels, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0,
+                    uint32_t x1, uint32_t y1)
+{
+    const uint8_t *src = texels;
+    uint32_t srcWidth = width, srcHeight = height;
+    for (HeightLevel &level : levels)
+    {
+        // texels of this level that read the changed ones, a change only in a dropped odd edge reaches none
+        x0 /= 2, y0 /= 2, x1 = std::min(x1 / 2, level.width - 1), y1 = std::min(y1 / 2, level.height - 1);
+        if (x0 > x1 || y0 > y1)
+            return;
+
+        downsample_rect(src, srcWidth, srcHeight, level, x0, y0, x1, y1);
+        src = level.texels.data();
+        srcWidth = level.width;
+        srcHeight = level.height;
+    }
+}
+
+void RowBands::assign(uint32_t w, uint32_t h, const uint8_t *data)
+{
+    width = w;
+    height = h;
+    const uint32_t count = (h + BAND_ROWS - 1) >> BAND_SHIFT;
+    bands.resize(count);
+    bandData.resize(count);
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        const size_t rows = std::min(BAND_ROWS, h - b * BAND_ROWS);
+        bands[b] = std::make_shared<uint8_t[]>(rows * w + PADDING);
+        bandData[b] = bands[b].get();
+        if (data)
+            memcpy(bandData[b], data + static_cast<size_t>(b) * BAND_ROWS * w, rows * w);
+    }
+}
+
+uint8_t *RowBands::writableRow(uint32_t y)
+{
+    unshare(y, y);
+    return bandData[y >> BAND_SHIFT] + static_cast<size_t>(y & (BAND_ROWS - 1)) * width;
+}
+
+size_t RowBands::unshare(uint32_t y0, uint32_t y1)
+{
+    size_t cloned = 0;
+    for (uint32_t b = y0 >> BAND_SHIFT; b <= y1 >> BAND_SHIFT; ++b)
+    {
+        // the only owner writes in place, nobody else can take a reference to the band meanwhile
+        if (bands[b].use_count() == 1)
+            continue;
+        const size_t bytes = std::min(BAND_ROWS, height - b * BAND_ROWS) * static_cast<size_t>(width) + PADDING;
+        std::shared_ptr<uint8_t[]> copy = std::make_shared_for_overwrite<uint8_t[]>(bytes);
+        memcpy(copy.get(), bandData[b], bytes);
+        bandData[b] = copy.get();
+        bands[b] = std::move(copy);
+        ++cloned;
+    }
+    // orders the writes after the reads of whoever dropped the last other reference
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return cloned;
+}
+
+// level 0 blocks [bx0, bx1] x [by0, by1]: 2x2 texels widened by the shared edge texel, 3x3 footprints
+template <typename Rows>
+static void minmax_base_rect(const Rows &texels, uint32_t width, uint32_t height, MinMaxLevel &level, uint32_t bx0, uint32_t by0,
+                             uint32_t bx1, uint32_t by1)
+{
+    const uint32_t lastX = width - 1, lastY = height - 1;
+    for (uint32_t by = by0; by <= by1; ++by)
+    {
+        const uint32_t y0 = 2 * by;
+        const uint32_t y1 = std::min(y0 + 2, lastY);
+        uint8_t *outMin = level.min.writableRow(by);
+        uint8_t *outMax = level.max.writableRow(by);
+        for (uint32_t bx = bx0; bx <= bx1; ++bx)
+        {
+            const uint32_t x0 = 2 * bx;
+            const uint32_t x1 = std::min(x0 + 2, lastX);
+            uint8_t lo = 255, hi = 0;
+            for (uint32_t y = y0; y <= y1; ++y)
+            {
+                const uint8_t *row = texels(y);
+                for (uint32_t x = x0; x <= x1; ++x)
+                {
+                    lo = std::min(lo, row[x]);
+                    hi = std::max(hi, row[x]);
+                }
+            }
+            outMin[bx] = lo;
+            outMax[bx] = hi;
+        }
+    }
+}
+
+// coarser blocks merge 2x2 children, which already carry the overlap
+static void minmax_merge_rect(const MinMaxLevel &src, MinMaxLevel &level, uint32_t bx0, uint32_t by0, uint32_t bx1, uint32_t by1)
+{
+    const uint32_t lastX = src.width - 1, lastY = src.height - 1;
+    for (uint32_t by = by0; by <= by1; ++by)
+    {
+        const uint32_t r0 = std::min(2 * by, lastY), r1 = std::min(2 * by + 1, lastY);
+        const uint8_t *min0 = src.min.row(r0), *min1 = src.min.row(r1);
+        const uint8_t *max0 = src.max.row(r0), *max1 = src.max.row(r1);
+        uint8_t *outMin = level.min.writableRow(by);
+        uint8_t *outMax = level.max.writableRow(by);
+        for (uint32_t bx = bx0; bx <= bx1; ++bx)
+        {
+            const uint32_t c0 = std::min(2 * bx, lastX), c1 = std::min(2 * bx + 1, lastX);
+            outMin[bx] = std::min({min0[c0], min0[c1], min1[c0], min1[c1]});
+            outMax[bx] = std::max({max0[c0], max0[c1], max1[c0], max1[c1]});
+        }
+    }
+}
+
+static MinMaxLevel minmax_level(uint32_t width, uint32_t height)
+{
+    MinMaxLevel level;
+    level.width = width;
+    level.height = height;
+    level.min.assign(width, height);
+    level.max.assign(width, height);
+    return level;
+}
+
+std::vector<MinMaxLevel> buildMinMaxPyramid(const uint8_t *texels, uint32_t width, uint32_t height, WorkerPool *pool)
+{
+    std::vector<MinMaxLevel> levels;
+    if (width == 0 || height == 0)
+        return levels;
+
+    {
+        MinMaxLevel level = minmax_level((width + 1) / 2, (height + 1) / 2);
+        const auto rows = [&](uint32_t y) { return texels + static_cast<size_t>(y) * width; };
+        for_rows(pool, level.height, [&](size_t begin, size_t end) {
+            minmax_base_rect(rows, width, height, level, 0u, static_cast<uint32_t>(begin), level.width - 1, static_cast<uint32_t>(end - 1));
+        });
+        levels.push_back(std::move(level));
+    }
+
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const MinMaxLevel &src = levels.back();
+        MinMaxLevel level = minmax_level((src.width + 1) / 2, (src.height + 1) / 2);
+        for_rows(pool, level.height, [&](size_t begin, size_t end) {
+            minmax_merge_rect(src, level, 0u, static_cast<uint32_t>(begin), level.width - 1, static_cast<uint32_t>(end - 1));
+        });
+        levels.push_back(std::move(level));
+    }
+
+    return levels;
+}
+
+void updateMinMaxPyramid(std::vector<MinMaxLevel> &pyramid, const RowBands &texels, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    if (pyramid.empty())
+        return;
+
+    // level 0 block b reads texels 2b .. 2b + 2, so texel x lands in blocks (x - 1) / 2 .. x / 2
+    uint32_t bx0 = x0 > 0 ? (x0 - 1) / 2 : 0u, by0 = y0 > 0 ? (y0 - 1) / 2 : 0u;
+    uint32_t bx1 = std::min(x1 / 2, pyramid[0].width - 1), by1 = std::min(y1 / 2, pyramid[0].height - 1);
+    minmax_base_rect([&](uint32_t y) { return texels.row(y); }, texels.width, texels.height, pyramid[0], bx0, by0, bx1, by1);
+
+    for (size_t l = 1; l < pyramid.size(); ++l)
+    {
+        bx0 /= 2, by0 /= 2, bx1 /= 2, by1 /= 2;
+        minmax_merge_rect(pyramid[l - 1], pyramid[l], bx0, by0, bx1, by1);
+    }
+}
+
+void minMaxBounds(const std::vector<MinMaxLevel> &pyramid, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint8_t &lo, uint8_t &hi)
+{
+    // coarsest level whose blocks are at least as large as the rectangle
+    const uint32_t extent = std::max(x1 - x0, y1 - y0);
+    size_t level = 0;
+    while (level + 1 < pyramid.size() && (2u << level) < extent)
+        ++level;
+
+    const MinMaxLevel &l = pyramid[level];
+    const uint32_t shift = static_cast<uint32_t>(level) + 1;
+
+    const uint32_t bx0 = std::min(x0 >> shift, l.width - 1), bx1 = std::min(x1 >> shift, l.width - 1);
+    const uint32_t by0 = std::min(y0 >> shift, l.height - 1), by1 = std::min(y1 >> shift, l.height - 1);
+
+    lo = 255;
+    hi = 0;
+    for (uint32_t by = by0; by <= by1; ++by)
+    {
+        for (uint32_t bx = bx0; bx <= bx1; ++bx)
+        {
+            lo = std::min(lo, l.min.at(bx, by));
+            hi = std::max(hi, l.max.at(bx, by));
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef HEIGHTMAP_HPP
+#define HEIGHTMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct WorkerPool;
+
+// -- CPU side of the heightmap texture, heights decode like test_tes.glsl: texture().y * 64 - 16 --
+constexpr float HEIGHT_SCALE = 64.0f;
+constexpr float HEIGHT_OFFSET = -16.0f;
+
+inline float texel_height(uint8_t texel)
+{
+    return static_cast<float>(texel) * (HEIGHT_SCALE / 255.0f) + HEIGHT_OFFSET;
+}
+
+/**
+ * @brief Single channel 8-bit heightmap, the channel the shaders read. Rows
+ * are stored bottom-up, in the order they are uploaded to GL.
+ */
+struct Heightmap
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> texels;
+
+    const uint8_t *data() const { return texels.data(); }
+    uint8_t at(uint32_t x, uint32_t y) const { return texels[static_cast<size_t>(y) * width + x]; }
+
+    // bilinear filtered height at uv in [0, 1], GL_LINEAR + GL_CLAMP_TO_EDGE addressing
+    float sample(float u, float v) const;
+};
+
+// decoded with stb_image, any format it reads, flipped like create_texture_2d()
+Heightmap decodeHeightmap(const std::string &filepath);
+
+/**
+ * @brief Raw heightmap file: a 16 byte header ("THM1", width, height,
+ * reserved) followed by width * height texels, bottom row first. Mapping it
+ * skips decoding entirely, pages fault in on first touch.
+ */
+struct MappedHeightmap
+{
+    const uint8_t *texels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    void *base = nullptr;
+    size_t size = 0;
+
+    void release();
+};
+
+void saveRawHeightmap(const std::string &filepath, const Heightmap &heightmap);
+Heightmap readRawHeightmap(const std::string &filepath);
+MappedHeightmap mapRawHeightmap(const std::string &filepath);
+
+// value noise octaves, deterministic in seed
+Heightmap makeSyntheticHeightmap(uint32_t width, uint32_t height, uint32_t seed, WorkerPool *pool = nullptr);
+
+// inclusive texel rectangle, the convention of minMaxBounds
+struct TexelRect
+{
+    uint32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    size_t area() const { return static_cast<size_t>(x1 - x0 + 1) * (y1 - y0 + 1); }
+};
+
+/**
+ * @brief width * height bytes, bottom row first, in bands of BAND_ROWS rows
+ * that copies share until one of them writes. A copy costs a pointer per
+ * band; writableRow() clones a band another copy still holds before handing
+ * it out, so a writer pays for the bands it touches and the other copies
+ * never see the write. One writer per copy, readers need no locks.
+ */
+struct RowBands
+{
+    static constexpr uint32_t BAND_SHIFT = 6;
+    static constexpr uint32_t BAND_ROWS = 1u << BAND_SHIFT;
+    static constexpr size_t PADDING = 4; // after every band, the last texels may be over-read by 32 bit gathers
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // zeros when data is null, else width * height bytes
+    void assign(uint32_t width, uint32_t height, const uint8_t *data = nullptr);
+
+    const uint8_t *row(uint32_t y) const { return bandData[y >> BAND_SHIFT] + static_cast<size_t>(y & (BAND_ROWS - 1)) * width; }
+    uint8_t at(uint32_t x, uint32_t y) const { return row(y)[x]; }
+
+    // row y to write, its band unshared first
+    uint8_t *writableRow(uint32_t y);
+
+    // unshares the bands of rows [y0, y1] and returns how many were cloned; parallel writers call it first, on one thread
+    size_t unshare(uint32_t y0, uint32_t y1);
+
+    // first row of every band, what row() indexes
+    const uint8_t *const *bandPointers() const { return bandData.data(); }
+
+private:
+    std::vector<std::shared_ptr<uint8_t[]>> bands;
+    std::vector<uint8_t *> bandData;
+};
+
+struct HeightLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> texels;
+};
+
+// 2x2 box filtered chain below the base level, odd edges clamp
+std::vector<HeightLevel> buildMipChain(const uint8_t *texels, uint32_t width, uint32_t height, WorkerPool *pool = nullptr);
+
+// recomputes the texels of every level that read the inclusive texel rectangle, after an edit
+void updateMipChain(std::vector<HeightLevel> &levels, const uint8_t *texels, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0,
+                    uint32_t x1, uint32_t y1);
+
+struct MinMaxLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    RowBands min; // banded like the texels, so an edit copies only the blocks over it
+    RowBands max;
+};
+
+/**
+ * @brief Conservative height bounds per 2^(level+1) texel block. Blocks
+ * overlap their right and top neighbour by one texel so every bilinear
+ * footprint that starts in a block stays inside its bounds.
+ */
+std::vector<MinMaxLevel> buildMinMaxPyramid(const uint8_t *texels, uint32_t width, uint32_t height, WorkerPool *pool = nullptr);
+
+// recomputes the blocks of every level that cover the inclusive texel rectangle, after an edit
+void updateMinMaxPyramid(std::vector<MinMaxLevel> &pyramid, const RowBands &texels, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+// conservative texel range [lo, hi] over the inclusive texel rectangle, reads at most 2x2 blocks
+void minMaxBounds(const std::vector<MinMaxLevel> &pyramid, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint8_t &lo, uint8_t &hi);
+
+#endif // HEIGHTMAP_HPP
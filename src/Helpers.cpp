@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 
@@ -101,4 +103,132 @@ GLuint createProgram(std::string vertexPath, std::string fragmentPath, std::stri
 
    return programHandle;
 
-}
\ No newline at end of file
+}
+
+GLuint createCaptureProgram(std::string vertexPath, std::string tcsPath, std::string tesPath, const std::vector<const char*>& varyings, std::string programName)
+{
+   const GLuint vertex_shader_handle = compile_shader(vertexPath, GL_VERTEX_SHADER);
+   const GLuint tcs_shader_handle    = compile_shader(tcsPath, GL_TESS_CONTROL_SHADER);
+   const GLuint tes_shader_handle    = compile_shader(tesPath, GL_TESS_EVALUATION_SHADER);
+
+   GLuint programHandle = glCreateProgram();
+   glAttachShader(programHandle, vertex_shader_handle);
+   glAttachShader(programHandle, tcs_shader_handle);
+   glAttachShader(programHandle, tes_shader_handle);
+
+   // varyings must be declared before linking, captured interleaved into a single buffer
+   glTransformFeedbackVaryings(programHandle, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+   glLinkProgram(programHandle);
+   check_link_status(programHandle, programName);
+
+   glDeleteShader(vertex_shader_handle);
+   glDeleteShader(tcs_shader_handle);
+   glDeleteShader(tes_shader_handle);
+
+   return programHandle;
+}
+
+GLuint createCaptureProgram(std::string vertexPath, const std::vector<const char*>& varyings, std::string programName)
+{
+   const GLuint vertex_shader_handle = compile_shader(vertexPath, GL_VERTEX_SHADER);
+
+   GLuint programHandle = glCreateProgram();
+   glAttachShader(programHandle, vertex_shader_handle);
+
+   glTransformFeedbackVaryings(programHandle, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+   glLinkProgram(programHandle);
+   check_link_status(programHandle, programName);
+
+   glDeleteShader(vertex_shader_handle);
+
+   return programHandle;
+}
+
+bool has_gl_extension(const char* name)
+{
+   GLint count = 0;
+   glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+   for (GLint i = 0; i < count; ++i)
+      if (std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i))), name) == 0)
+         return true;
+   return false;
+}
+
+size_t texture_memory_bytes(GLuint texture)
+{
+   if (texture == 0u)
+      return 0u;
+
+   GLint levels = 0;
+   glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+   if (levels == 0)
+   {
+      // mutable storage, walk levels until one is empty
+      glGetTextureParameteriv(texture, GL_TEXTURE_MAX_LEVEL, &levels);
+      levels = std::min(levels + 1, 32);
+   }
+
+   size_t bytes = 0;
+   for (GLint level = 0; level < levels; ++level)
+   {
+      GLint width = 0, height = 0;
+      glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_WIDTH, &width);
+      glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_HEIGHT, &height);
+      if (width == 0 || height == 0)
+         break;
+
+      GLint bits = 0;
+      for (const GLenum component : {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE})
+      {
+         GLint size = 0;
+         glGetTextureLevelParameteriv(texture, level, component, &size);
+         bits += size;
+      }
+      bytes += static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>((bits + 7) / 8);
+   }
+   return bytes;
+}
+
+size_t buffer_memory_bytes(GLuint buffer)
+{
+   if (buffer == 0u)
+      return 0u;
+
+   GLint64 size = 0;
+   glGetNamedBufferParameteri64v(buffer, GL_BUFFER_SIZE, &size);
+   return static_cast<size_t>(size);
+}
+
+OffscreenTarget createOffscreenTarget(uint32_t width, uint32_t height, GLenum colorFormat)
+{
+   OffscreenTarget target;
+
+   glGenRenderbuffers(1, &target.color);
+   glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+   glRenderbufferStorage(GL_RENDERBUFFER, colorFormat, width, height);
+
+   glGenRenderbuffers(1, &target.depth);
+   glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+   glBindRenderbuffer(GL_RENDERBUFFER, 0u);
+
+   glGenFramebuffers(1, &target.fbo);
+   glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+   if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      EXIT("Offscreen framebuffer incomplete");
+
+   glViewport(0, 0, width, height);
+   return target;
+}
+
+void destroyOffscreenTarget(OffscreenTarget &target)
+{
+   glBindFramebuffer(GL_FRAMEBUFFER, 0u);
+   glDeleteFramebuffers(1, &target.fbo);
+   glDeleteRenderbuffers(1, &target.color);
+   glDeleteRenderbuffers(1, &target.depth);
+   target = {};
+}
@@ -1,13 +1,34 @@
 #ifndef HELPERS_HPP
 #define HELPERS_HPP
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 
 GLuint createProgram(std::string vertexPath, std::string fragmentPath, std::string programName);
 GLuint createProgram(std::string vertexPath, std::string fragmentPath, std::string tcsPath, std::string tesPath, std::string programName);
+GLuint createCaptureProgram(std::string vertexPath, std::string tcsPath, std::string tesPath, const std::vector<const char*>& varyings, std::string programName);
+GLuint createCaptureProgram(std::string vertexPath, const std::vector<const char*>& varyings, std::string programName);
+
+bool has_gl_extension(const char* name);
+
+// storage a texture's levels occupy, from the sizes the driver reports
+size_t texture_memory_bytes(GLuint texture);
+size_t buffer_memory_bytes(GLuint buffer);
+
+struct OffscreenTarget
+{
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+};
+
+// width x height color + DEPTH24 renderbuffers, leaves the framebuffer bound and the viewport set
+OffscreenTarget createOffscreenTarget(uint32_t width, uint32_t height, GLenum colorFormat = GL_RGBA8);
+void destroyOffscreenTarget(OffscreenTarget &target);
 
 inline void set_uni_vec2(GLuint programHandle, const std::string& uni_name, const glm::vec2& vec2)
 { glUniform2fv(glGetUniformLocation(programHandle, uni_name.c_str()), 1, &(vec2[0])); }
@@ -24,6 +45,9 @@ inline void set_uni_mat4(GLuint programHandle, const std::string& uni_name, cons
 inline void set_uni_int(GLuint programHandle, const std::string& uni_name, const GLint i)
 { glUniform1i(glGetUniformLocation(programHandle, uni_name.c_str()), i); }
 
+inline void bind_uniform_block(GLuint programHandle, const std::string& block_name, const GLuint binding)
+{ glUniformBlockBinding(programHandle, glGetUniformBlockIndex(programHandle, block_name.c_str()), binding); }
+
 inline void set_uni_float(GLuint programHandle, const std::string& uni_name, const GLfloat f)
 { glUniform1f(glGetUniformLocation(programHandle, uni_name.c_str()), f); }
 
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HORIZON_MAP_X86 1
+#endif
+
+#include "HorizonMap.hpp"
+#include "Profiler.hpp"
+#include "WorkerPool.hpp"
+
+constexpr size_t HORIZON_ROW_GRAIN = 8;
+
+// one texel offset of the march along a direction
+struct HorizonStep
+{
+    int32_t dx;
+    int32_t dy;
+    float scale; // world rise per texel step over the world distance of the offset
+};
+
+static std::vector<HorizonStep> horizon_steps(const HeightField &field, const HorizonSettings &settings, uint32_t direction)
+{
+    const float angle = 6.28318531f * static_cast<float>(direction) / static_cast<float>(HorizonMap::DIRECTIONS);
+    const float cx = std::cos(angle), cy = -std::sin(angle);
+    const float texelX = field.extent.x / static_cast<float>(field.width);
+    const float texelZ = field.extent.y / static_cast<float>(field.height);
+    const float reach = static_cast<float>(settings.reach);
+
+    std::vector<HorizonStep> steps;
+    int32_t lastX = 0, lastY = 0;
+    for (float t = 1.0f; t <= reach; t = std::max(t * settings.stepGrowth, t + 1.0f))
+    {
+        const int32_t dx = static_cast<int32_t>(std::lround(t * cx)), dy = static_cast<int32_t>(std::lround(t * cy));
+        if (dx == lastX && dy == lastY)
+            continue;
+        const float distance = std::sqrt(static_cast<float>(dx * dx) * texelX * texelX + static_cast<float>(dy * dy) * texelZ * texelZ);
+        steps.push_back({dx, dy, (HEIGHT_SCALE / 255.0f) / distance});
+        lastX = dx;
+        lastY = dy;
+    }
+    return steps;
+}
+
+// best[x] = max(best[x], (source[x] - row[x]) * scale) over [x, end)
+static void rise_row(const uint8_t *row, const uint8_t *source, float scale, uint32_t x, uint32_t end, float *best)
+{
+    for (; x < end; ++x)
+        best[x] = std::max(best[x], static_cast<float>(static_cast<int32_t>(source[x]) - static_cast<int32_t>(row[x])) * scale);
+}
+
+#ifdef HORIZON_MAP_X86
+
+// a multiply and a max per lane, the same operations as rise_row
+__attribute__((target("avx2"))) static uint32_t rise_row_avx2(const uint8_t *row, const uint8_t *source, float scale, uint32_t x, uint32_t end,
+                                                              float *best)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    for (; x + 8 <= end; x += 8)
+    {
+        const __m256i h = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x)));
+        const __m256i q = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + x)));
+        const __m256 rise = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(q, h)), s);
+        _mm256_storeu_ps(best + x, _mm256_max_ps(_mm256_loadu_ps(best + x), rise));
+    }
+    return x;
+}
+
+static bool horizon_use_avx2(const HorizonSettings &settings)
+{
+    return settings.simd && cpuHasAvx2();
+}
+
+#else
+
+static uint32_t rise_row_avx2(const uint8_t *, const uint8_t *, float, uint32_t x, uint32_t, float *)
+{
+    return x;
+}
+
+static bool horizon_use_avx2(const HorizonSettings &)
+{
+    return false;
+}
+
+#endif // HORIZON_MAP_X86
+
+// horizons in direction d of rows [y0, y1] over columns [x0, x1]; a row marches every offset at once, so the loads stay contiguous
+static void horizon_rows(HorizonMap &map, const HeightField &field, const std::vector<HorizonStep> &steps, bool avx2, uint32_t d, uint32_t x0,
+                         uint32_t x1, uint32_t y0, uint32_t y1)
+{
+    const int32_t width = static_cast<int32_t>(field.width), height = static_cast<int32_t>(field.height);
+    std::vector<float> best(field.width);
+
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        const uint8_t *row = field.texels.row(y);
+        std::fill(best.begin() + x0, best.begin() + x1 + 1, 0.0f);
+        for (const HorizonStep &step : steps)
+        {
+            const int32_t sy = static_cast<int32_t>(y) + step.dy;
+            if (sy < 0 || sy >= height)
+                continue;
+
+            // columns whose offset texel lies inside the map
+            const int32_t begin = std::max(static_cast<int32_t>(x0), -step.dx);
+            const int32_t end = std::min(static_cast<int32_t>(x1) + 1, width - step.dx);
+            if (begin >= end)
+                continue;
+
+            const uint8_t *source = field.texels.row(static_cast<uint32_t>(sy)) + step.dx;
+            uint32_t x = static_cast<uint32_t>(begin);
+            if (avx2)
+                x = rise_row_avx2(row, source, step.scale, x, static_cast<uint32_t>(end), best.data());
+            rise_row(row, source, step.scale, x, static_cast<uint32_t>(end), best.data());
+        }
+
+        uint8_t *out = map.planes[d / 4].data() + static_cast<size_t>(y) * field.width * 4u + d % 4u;
+        for (uint32_t x = x0; x <= x1; ++x)
+            out[x * 4u] = static_cast<uint8_t>(std::rint(best[x] / (1.0f + best[x]) * 255.0f));
+    }
+}
+
+float HorizonMap::horizonTan(uint32_t x, uint32_t y, uint32_t d) const
+{
+    const float v = planes[d / 4][(static_cast<size_t>(y) * width + x) * 4u + d % 4u] / 255.0f;
+    return v / std::max(1.0f - v, 1.0f / 255.0f);
+}
+
+HorizonMap buildHorizonMap(const HeightField &field, const HorizonSettings &settings, WorkerPool *pool)
+{
+    PROFILE_CPU("horizon_map/build");
+
+    HorizonMap map;
+    map.settings = settings;
+    map.width = field.width;
+    map.height = field.height;
+    for (std::vector<uint8_t> &plane : map.planes)
+        plane.resize(static_cast<size_t>(field.width) * field.height * 4u);
+
+    updateHorizonMap(map, field, TexelRect{0u, 0u, field.width - 1, field.height - 1}, pool);
+    return map;
+}
+
+TexelRect updateHorizonMap(HorizonMap &map, const HeightField &field, const TexelRect &rect, WorkerPool *pool)
+{
+    PROFILE_CPU("horizon_map/update");
+
+    const bool avx2 = horizon_use_avx2(map.settings);
+    TexelRect changed = rect;
+    for (uint32_t d = 0; d < HorizonMap::DIRECTIONS; ++d)
+    {
+        const std::vector<HorizonStep> steps = horizon_steps(field, map.settings, d);
+
+        // a texel sees rect in direction d only from rect minus one of the offsets, or from inside it
+        int32_t minX = 0, maxX = 0, minY = 0, maxY = 0;
+        for (const HorizonStep &step : steps)
+        {
+            minX = std::min(minX, step.dx), maxX = std::max(maxX, step.dx);
+            minY = std::min(minY, step.dy), maxY = std::max(maxY, step.dy);
+        }
+        const TexelRect swept{static_cast<uint32_t>(std::max(static_cast<int32_t>(rect.x0) - maxX, 0)),
+                              static_cast<uint32_t>(std::max(static_cast<int32_t>(rect.y0) - maxY, 0)),
+                              static_cast<uint32_t>(std::min(static_cast<int32_t>(rect.x1) - minX, static_cast<int32_t>(field.width) - 1)),
+                              static_cast<uint32_t>(std::min(static_cast<int32_t>(rect.y1) - minY, static_cast<int32_t>(field.height) - 1))};
+
+        const size_t rows = static_cast<size_t>(swept.y1 - swept.y0 + 1);
+        const auto body = [&](size_t begin, size_t end, size_t) {
+            horizon_rows(map, field, steps, avx2, d, swept.x0, swept.x1, swept.y0 + static_cast<uint32_t>(begin), swept.y0 + static_cast<uint32_t>(end - 1));
+        };
+        if (pool && rows > HORIZON_ROW_GRAIN)
+            pool->parallelFor(rows, HORIZON_ROW_GRAIN, body);
+        else
+            body(0u, rows, 0u);
+
+        changed = {std::min(changed.x0, swept.x0), std::min(changed.y0, swept.y0), std::max(changed.x1, swept.x1), std::max(changed.y1, swept.y1)};
+    }
+    return changed;
+}
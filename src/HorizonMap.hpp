@@ -0,0 +1,50 @@
+#ifndef HORIZON_MAP_HPP
+#define HORIZON_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "HeightField.hpp"
+
+struct WorkerPool;
+
+struct HorizonSettings
+{
+    uint32_t reach = 256;     // texels searched along each direction
+    float stepGrowth = 1.12f; // march steps grow geometrically, far ridges are sampled more sparsely
+    bool simd = true;         // AVX2 rows when the CPU has it, off for comparisons
+};
+
+/**
+ * @brief Per texel horizon of the height field in DIRECTIONS azimuths, for
+ * soft sun shadows from one fetch per plane. Direction d points at angle
+ * d * 360 / DIRECTIONS degrees from +x towards -z, like the sun azimuth.
+ * A horizon is the steepest rise to any texel within reach, stored as
+ * tan / (1 + tan) in unorm8 so flat ground keeps full precision; texels
+ * outside the map do not occlude.
+ */
+struct HorizonMap
+{
+    static constexpr uint32_t DIRECTIONS = 8;
+    static constexpr uint32_t PLANES = DIRECTIONS / 4; // RGBA8 each, directions 4p .. 4p + 3
+
+    HorizonSettings settings;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> planes[PLANES]; // bottom row first
+
+    // tangent of the horizon elevation in direction d at texel (x, y)
+    float horizonTan(uint32_t x, uint32_t y, uint32_t d) const;
+};
+
+HorizonMap buildHorizonMap(const HeightField &field, const HorizonSettings &settings, WorkerPool *pool = nullptr);
+
+/**
+ * @brief Recomputes the horizons after the texels of rect changed and
+ * returns the rect that was rewritten. Each direction only revisits the
+ * texels that look at rect along it, rect swept back over the march.
+ */
+TexelRect updateHorizonMap(HorizonMap &map, const HeightField &field, const TexelRect &rect, WorkerPool *pool = nullptr);
+
+#endif // HORIZON_MAP_HPP
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <fstream>
+
+#include "InputLog.hpp"
+#include "Defines.hpp"
+
+static CameraState to_state(const InputLog::Record &record)
+{
+    CameraState state;
+    state.pos = {record.pos[0], record.pos[1], record.pos[2]};
+    state.yaw = record.yaw;
+    state.pitch = record.pitch;
+    return state;
+}
+
+void InputLog::clear()
+{
+    frameCount = 0;
+    records.clear();
+}
+
+void InputLog::record(const CameraState &state, uint32_t timeUs)
+{
+    const uint32_t frame = frameCount++;
+    if (!records.empty() && to_state(records.back()) == state)
+        return;
+
+    Record record;
+    record.frame = frame;
+    record.timeUs = timeUs;
+    record.pos[0] = state.pos.x;
+    record.pos[1] = state.pos.y;
+    record.pos[2] = state.pos.z;
+    record.yaw = state.yaw;
+    record.pitch = state.pitch;
+    records.push_back(record);
+}
+
+CameraState InputLog::stateAt(uint32_t frame) const
+{
+    if (records.empty())
+        return {};
+
+    // last record at or before frame
+    auto it = std::upper_bound(records.begin(), records.end(), frame, [](uint32_t f, const Record &r) { return f < r.frame; });
+    if (it != records.begin())
+        --it;
+    return to_state(*it);
+}
+
+bool InputLog::save(const std::string &filepath, std::string &error) const
+{
+    std::ofstream ofs{filepath, std::ios::out | std::ios::binary};
+    if (!ofs.is_open())
+    {
+        error = "Failed to open input log " + filepath;
+        return false;
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.fixedDt = fixedDt;
+    header.frameCount = frameCount;
+    header.recordCount = static_cast<uint32_t>(records.size());
+
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Record)));
+
+    if (!ofs)
+    {
+        error = "Failed to write input log " + filepath;
+        return false;
+    }
+    return true;
+}
+
+bool loadInputLog(const std::string &filepath, InputLog &log, std::string &error)
+{
+    std::ifstream ifs{filepath, std::ios::in | std::ios::binary};
+    if (!ifs.is_open())
+    {
+        error = "Failed to open input log " + filepath;
+        return false;
+    }
+
+    InputLog::Header header;
+    ifs.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!ifs || header.magic != InputLog::MAGIC)
+    {
+        error = filepath + " is not an input log";
+        return false;
+    }
+    if (header.version != InputLog::VERSION)
+    {
+        error = "Unsupported input log version " + std::to_string(header.version) + " in " + filepath;
+        return false;
+    }
+
+    InputLog loaded;
+    loaded.fixedDt = header.fixedDt;
+    loaded.frameCount = header.frameCount;
+    loaded.records.resize(header.recordCount);
+    ifs.read(reinterpret_cast<char *>(loaded.records.data()), static_cast<std::streamsize>(loaded.records.size() * sizeof(InputLog::Record)));
+
+    if (!ifs)
+    {
+        error = "Truncated input log " + filepath;
+        return false;
+    }
+
+    log = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct CameraState
+{
+    glm::vec3 pos{0.0f};
+    float yaw = 0.0f;   // degrees
+    float pitch = 0.0f; // degrees
+
+    bool operator==(const CameraState &o) const { return pos == o.pos && yaw == o.yaw && pitch == o.pitch; }
+    bool operator!=(const CameraState &o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Camera state per frame, stored only on frames where it changed.
+ * Replay is driven by frame index rather than wall time, so a log
+ * reproduces the exact same views at the fixed timestep it was recorded
+ * with, independent of how fast the replaying machine renders.
+ *
+ * File layout (little endian): Header, then Header::recordCount Records.
+ */
+struct InputLog
+{
+    static constexpr uint32_t MAGIC = 0x4D414354u; // "TCAM"
+    static constexpr uint32_t VERSION = 1u;
+
+#pragma pack(push, 1)
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        float fixedDt;
+        uint32_t frameCount;
+        uint32_t recordCount;
+    };
+
+    struct Record
+    {
+        uint32_t frame;
+        uint32_t timeUs; // wall time since recording started, informational
+        float pos[3];
+        float yaw;
+        float pitch;
+    };
+#pragma pack(pop)
+
+    float fixedDt = 1.0f / 60.0f;
+    uint32_t frameCount = 0;
+    std::vector<Record> records;
+
+    void clear();
+
+    // appends the state of the next frame, dropped when nothing changed since the last record
+    void record(const CameraState &state, uint32_t timeUs);
+
+    // state in effect at frame, frames past the end hold the last state
+    CameraState stateAt(uint32_t frame) const;
+
+    // false with the reason in error when the file cannot be written
+    bool save(const std::string &filepath, std::string &error) const;
+};
+
+// false with the reason in error when the file cannot be read or is not an input log
+bool loadInputLog(const std::string &filepath, InputLog &log, std::string &error);
+
+#endif // INPUT_LOG_HPP
@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LodBudget.hpp"
+
+void LodBudget::reset()
+{
+    detail = std::clamp(1.0f, settings.minDetail, settings.maxDetail);
+    load = 0.0f;
+    changes = 0;
+    lastSample = 0;
+    changeFrame = 0;
+    primed = false;
+}
+
+bool LodBudget::update(uint64_t sampleFrame, float gpuMs, uint64_t primitives, uint64_t nextFrame)
+{
+    // nothing new, or rendered before the last change took effect
+    if (sampleFrame == 0 || sampleFrame == lastSample || sampleFrame < changeFrame)
+        return false;
+    lastSample = sampleFrame;
+
+    float sampleLoad = 0.0f;
+    if (settings.targetGpuMs > 0.0f)
+        sampleLoad = std::max(sampleLoad, gpuMs / settings.targetGpuMs);
+    if (settings.targetTriangles > 0.0f)
+        sampleLoad = std::max(sampleLoad, static_cast<float>(primitives) / settings.targetTriangles);
+    if (sampleLoad <= 0.0f)
+        return false;
+
+    load = primed ? load + settings.smoothing * (sampleLoad - load) : sampleLoad;
+    primed = true;
+
+    if (load <= 1.0f && load >= 1.0f - settings.deadBand)
+        return false;
+
+    // cost grows roughly with detail^2 (tess level along both patch axes), aim for the middle of the dead band
+    const float goal = 1.0f - 0.5f * settings.deadBand;
+    const float step = std::clamp(std::sqrt(goal / load), 1.0f - settings.maxStepDown, 1.0f + settings.maxStepUp);
+    const float next = std::clamp(detail * step, settings.minDetail, settings.maxDetail);
+    if (std::abs(next - detail) < 1e-4f)
+        return false;
+
+    detail = next;
+    ++changes;
+    changeFrame = nextFrame;
+    primed = false;
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef LOD_BUDGET_HPP
+#define LOD_BUDGET_HPP
+
+#include <cstdint>
+
+/**
+ * @brief Closed-loop controller holding the terrain pass to a GPU time and/or
+ * triangle budget. Produces one detail factor that scales the configured max
+ * tess level and LOD band distances together.
+ *
+ * Measurements arrive late (see PerfMonitor), so after every change samples
+ * issued before it took effect are ignored. A dead band below the budget
+ * gives hysteresis, and steps are rate limited, shrinking faster than they
+ * grow: a steady frame time wins over peak detail.
+ */
+struct LodBudget
+{
+    struct Settings
+    {
+        float targetGpuMs = 8.0f;    // terrain pass, 0 = no time budget
+        float targetTriangles = 0.0f; // 0 = no triangle budget
+        float deadBand = 0.15f;      // no change while load is within [1 - deadBand, 1]
+        float maxStepDown = 0.15f;   // largest relative decrease per change
+        float maxStepUp = 0.03f;     // largest relative increase per change
+        float smoothing = 0.5f;      // weight of a new sample in the load average
+        float minDetail = 0.25f;
+        float maxDetail = 1.0f;
+    };
+
+    Settings settings;
+
+    float detail = 1.0f; // applied factor
+    float load = 0.0f;   // smoothed measurement / budget, worst of the enabled budgets
+    uint64_t changes = 0;
+
+    void reset();
+
+    /**
+     * @brief Feeds the newest resolved sample, issued in sampleFrame, before
+     * frame nextFrame is issued. Returns true when detail changed. Repeated
+     * or stale samples are ignored, so calling it every frame is fine.
+     */
+    bool update(uint64_t sampleFrame, float gpuMs, uint64_t primitives, uint64_t nextFrame);
+
+private:
+    uint64_t lastSample = 0;
+    uint64_t changeFrame = 0; // first frame rendered with the current detail
+    bool primed = false;      // load holds at least one sample of the current detail
+};
+
+#endif // LOD_BUDGET_HPP
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#include "LodEval.hpp"
+#include "Renderer.hpp"
+#include "TessLod.hpp"
+#include "Uniforms.hpp"
+
+// lodRanges far beyond the terrain so every corner lands in band 0
+constexpr float REFERENCE_RANGE = 1e9f;
+
+std::vector<LodView> sampleLodViews(const CameraPath &path, uint32_t count)
+{
+    std::vector<LodView> views(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float t = count > 1 ? path.duration() * i / (count - 1) : 0.0f;
+        path.sample(t, views[i].pos, views[i].yaw, views[i].pitch);
+    }
+    return views;
+}
+
+std::vector<LodView> sampleLodViews(const InputLog &log, uint32_t count)
+{
+    std::vector<LodView> views(count);
+    const uint32_t last = log.frameCount > 0 ? log.frameCount - 1 : 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const CameraState state = log.stateAt(count > 1 ? last * i / (count - 1) : 0);
+        views[i] = {state.pos, state.yaw, state.pitch, {}};
+    }
+    return views;
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static LodError summarize_error(std::vector<float> &diffs)
+{
+    LodError error;
+    if (diffs.empty())
+        return error;
+
+    error.mean = std::accumulate(diffs.begin(), diffs.end(), 0.0) / static_cast<double>(diffs.size());
+    error.max = *std::max_element(diffs.begin(), diffs.end());
+    const auto p95 = diffs.begin() + static_cast<std::ptrdiff_t>(0.95 * static_cast<double>(diffs.size() - 1));
+    std::nth_element(diffs.begin(), p95, diffs.end());
+    error.p95 = *p95;
+    return error;
+}
+
+// camera, LOD settings, framebuffer and viewport of the caller
+struct SavedState
+{
+    CameraState camera{g_camera.pos, g_camera.yaw, g_camera.pitch};
+    int maxTessLevel = g_app.maxTessLevel;
+    glm::vec4 lodRanges = g_app.lodRanges;
+    bool lodBudget = g_app.lodBudget;
+    GLint framebuffer = 0;
+    GLint viewport[4] = {};
+
+    SavedState()
+    {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        g_app.lodBudget = false; // measure the settings as given
+    }
+
+    ~SavedState()
+    {
+        g_app.maxTessLevel = maxTessLevel;
+        g_app.lodRanges = lodRanges;
+        g_app.lodBudget = lodBudget;
+        g_camera.pos = camera.pos;
+        setCameraOrientation(camera.yaw, camera.pitch);
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+};
+
+static void set_view(const LodView &view)
+{
+    g_camera.pos = view.pos;
+    setCameraOrientation(view.yaw, view.pitch);
+}
+
+void LodEvaluator::init(uint32_t targetWidth, uint32_t targetHeight)
+{
+    width = targetWidth;
+    height = targetHeight;
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    colorTarget = createOffscreenTarget(width, height);
+    evalTarget = createOffscreenTarget(width, height, GL_RG32F);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+
+    program = createProgram(g_app.shaderDir + "test_vert.glsl", g_app.shaderDir + "eval_frag.glsl",
+                            g_app.shaderDir + "test_tcs.glsl", g_app.shaderDir + "test_tes.glsl", "EVAL");
+    bind_uniform_block(program, "FrameUniforms", UNIFORM_BINDING_FRAME);
+
+    glGenQueries(2, queries);
+}
+
+void LodEvaluator::release()
+{
+    glDeleteQueries(2, queries);
+    glDeleteProgram(program);
+    destroyOffscreenTarget(evalTarget);
+    destroyOffscreenTarget(colorTarget);
+    program = 0;
+}
+
+// depth and height instead of shading, one draw per patch
+void LodEvaluator::renderEval(std::vector<float> &out)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, evalTarget.fbo);
+    glViewport(0, 0, width, height);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    uploadFrameUniforms();
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_HEIGHTMAP]);
+    glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
+    for (size_t patch = 0; patch < g_app.patchCenters.size(); ++patch)
+        glDrawArrays(GL_PATCHES, static_cast<GLint>(patch * NUM_PATCH_PTS), NUM_PATCH_PTS);
+    glBindVertexArray(0u);
+    g_stream.endFrame();
+
+    out.resize(static_cast<size_t>(width) * height * 2);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RG, GL_FLOAT, out.data());
+}
+
+void LodEvaluator::captureReference(std::vector<LodView> &views)
+{
+    const SavedState saved;
+
+    g_app.maxTessLevel = REFERENCE_TESS_LEVEL;
+    g_app.lodRanges = {REFERENCE_RANGE, 2.0f * REFERENCE_RANGE, 3.0f * REFERENCE_RANGE, 4.0f * REFERENCE_RANGE};
+    for (LodView &view : views)
+    {
+        set_view(view);
+        renderEval(view.reference);
+    }
+}
+
+LodResult LodEvaluator::measure(const std::vector<LodView> &views, int maxTessLevel, float rangeScale, uint32_t repeats)
+{
+    const SavedState saved;
+
+    LodResult result;
+    result.maxTessLevel = maxTessLevel;
+    result.rangeScale = rangeScale;
+    result.lodRanges = scaled_lod_ranges(rangeScale);
+    g_app.maxTessLevel = maxTessLevel;
+    g_app.lodRanges = result.lodRanges;
+
+    depthDiffs.clear();
+    heightDiffs.clear();
+    size_t mismatched = 0, pixelCount = 0;
+    repeats = std::max(repeats, 1u);
+
+    for (const LodView &view : views)
+    {
+        set_view(view);
+
+        // time the real frame, the eval pass below is not representative
+        glBindFramebuffer(GL_FRAMEBUFFER, colorTarget.fbo);
+        glViewport(0, 0, width, height);
+        std::vector<double> gpuMs, cpuMs;
+        GLuint64 primitives = 0;
+        for (uint32_t r = 0; r < repeats; ++r)
+        {
+            const auto cpuStart = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+            glBeginQuery(GL_PRIMITIVES_GENERATED, queries[1]);
+            g_frameGraph.execute();
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            glEndQuery(GL_TIME_ELAPSED);
+            g_stream.endFrame();
+            cpuMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count());
+
+            // offline measurement, blocking on the result is fine
+            GLuint64 gpuNs = 0;
+            glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &gpuNs);
+            glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &primitives);
+            gpuMs.push_back(static_cast<double>(gpuNs) * 1e-6);
+        }
+        result.gpuMs += median(gpuMs) / views.size();
+        result.cpuMs += median(cpuMs) / views.size();
+        result.triangles += static_cast<double>(primitives) / views.size();
+
+        size_t estimate = 0;
+        for (size_t p = 0; p < g_tessCache.controlPoints.size(); p += NUM_PATCH_PTS)
+            estimate += patch_tessellation(&g_tessCache.controlPoints[p], view.pos, maxTessLevel, result.lodRanges).triangles;
+        result.estTriangles += static_cast<double>(estimate) / views.size();
+
+        renderEval(pixels);
+        for (size_t i = 0; i < pixels.size(); i += 2)
+        {
+            const bool covered = pixels[i] > 0.0f;
+            const bool referenceCovered = view.reference[i] > 0.0f;
+            ++pixelCount;
+            if (covered != referenceCovered)
+                ++mismatched;
+            else if (covered)
+            {
+                depthDiffs.push_back(std::abs(pixels[i] - view.reference[i]));
+                heightDiffs.push_back(std::abs(pixels[i + 1] - view.reference[i + 1]));
+            }
+        }
+    }
+
+    result.depth = summarize_error(depthDiffs);
+    result.height = summarize_error(heightDiffs);
+    result.coverageMismatch = pixelCount ? static_cast<double>(mismatched) / pixelCount : 0.0;
+    return result;
+}
+
+// a result is on the front when no other is at least as good on both axes and strictly better on one
+template <typename Cost>
+static void mark_pareto(std::vector<LodResult> &results, Cost &&cost, bool LodResult::*flag)
+{
+    for (LodResult &a : results)
+    {
+        a.*flag = std::none_of(results.begin(), results.end(), [&](const LodResult &b) {
+            const double ca = cost(a), cb = cost(b);
+            return cb <= ca && b.height.p95 <= a.height.p95 && (cb < ca || b.height.p95 < a.height.p95);
+        });
+    }
+}
+
+void LodEvaluator::markPareto(std::vector<LodResult> &results)
+{
+    mark_pareto(results, [](const LodResult &r) { return r.triangles; }, &LodResult::paretoTriangles);
+    mark_pareto(results, [](const LodResult &r) { return r.gpuMs; }, &LodResult::paretoGpu);
+}
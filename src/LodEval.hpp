@@ -0,0 +1,88 @@
+#ifndef LOD_EVAL_HPP
+#define LOD_EVAL_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CameraPath.hpp"
+#include "Helpers.hpp"
+#include "InputLog.hpp"
+
+// one camera position of an evaluation run
+struct LodView
+{
+    glm::vec3 pos;
+    float yaw;
+    float pitch;
+    std::vector<float> reference; // RG32F readback of the reference render
+};
+
+// count views spread evenly over the whole path / log
+std::vector<LodView> sampleLodViews(const CameraPath &path, uint32_t count);
+std::vector<LodView> sampleLodViews(const InputLog &log, uint32_t count);
+
+struct LodError
+{
+    double mean = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+struct LodResult
+{
+    int maxTessLevel = 0;
+    float rangeScale = 1.0f;
+    glm::vec4 lodRanges{0.0f};
+
+    double gpuMs = 0.0;          // median over repeats, mean over views
+    double cpuMs = 0.0;
+    double triangles = 0.0;      // GL_PRIMITIVES_GENERATED, mean over views
+    double estTriangles = 0.0;   // patch_tessellation() upper bound, mean over views
+
+    LodError depth;                // |linear view depth - reference| on pixels both renders cover
+    LodError height;               // |world height - reference|
+    double coverageMismatch = 0.0; // fraction of pixels covered by exactly one of the two renders
+
+    bool paretoTriangles = false;  // on the (triangles, height.p95) front
+    bool paretoGpu = false;        // on the (gpuMs, height.p95) front
+};
+
+/**
+ * @brief Scores LOD settings against a reference render with every patch at
+ * the finest tess level. Times full frame graph frames into its own target
+ * and compares an eval pass writing view depth and world height. Needs init()
+ * and setupFrameGraph(); passes that must not run offscreen (gui) have to be
+ * disabled by the caller. Camera and LOD settings are restored afterwards.
+ */
+struct LodEvaluator
+{
+    static constexpr int REFERENCE_TESS_LEVEL = 64;
+
+    void init(uint32_t width, uint32_t height);
+    void release();
+
+    // fills view.reference for every view
+    void captureReference(std::vector<LodView> &views);
+    LodResult measure(const std::vector<LodView> &views, int maxTessLevel, float rangeScale, uint32_t repeats);
+
+    static void markPareto(std::vector<LodResult> &results);
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    GLuint program = 0;
+    GLuint queries[2] = {};
+    OffscreenTarget colorTarget;
+    OffscreenTarget evalTarget;
+
+private:
+    void renderEval(std::vector<float> &out);
+
+    std::vector<float> pixels;
+    std::vector<float> depthDiffs;
+    std::vector<float> heightDiffs;
+};
+
+#endif // LOD_EVAL_HPP
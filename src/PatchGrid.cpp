@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PatchGrid.hpp"
+
+std::vector<float> buildPatchGrid(float width, float height, uint32_t resolution)
+{
+    std::vector<float> vertices;
+    vertices.reserve(static_cast<size_t>(resolution) * resolution * 4 * PATCH_GRID_FLOATS_PER_VERTEX);
+
+    const float rez = static_cast<float>(resolution);
+    const auto push = [&](uint32_t i, uint32_t j) {
+        vertices.push_back(-width / 2.0f + width * i / rez);   // v.x
+        vertices.push_back(0.0f);                              // v.y
+        vertices.push_back(-height / 2.0f + height * j / rez); // v.z
+        vertices.push_back(i / rez);                           // u
+        vertices.push_back(j / rez);                           // v
+    };
+
+    for (uint32_t i = 0; i < resolution; ++i)
+    {
+        for (uint32_t j = 0; j < resolution; ++j)
+        {
+            push(i, j);
+            push(i + 1, j);
+            push(i, j + 1);
+            push(i + 1, j + 1);
+        }
+    }
+
+    return vertices;
+}
+
+std::vector<PatchBounds> buildPatchBounds(const std::vector<float> &grid, const std::vector<MinMaxLevel> &pyramid,
+                                          uint32_t heightmapWidth, uint32_t heightmapHeight)
+{
+    constexpr size_t PATCH_FLOATS = 4 * PATCH_GRID_FLOATS_PER_VERTEX;
+
+    std::vector<PatchBounds> bounds(grid.size() / PATCH_FLOATS);
+    for (size_t p = 0; p < bounds.size(); ++p)
+    {
+        const float *v00 = &grid[p * PATCH_FLOATS];
+        const float *v11 = v00 + 3 * PATCH_GRID_FLOATS_PER_VERTEX;
+
+        // texels a bilinear lookup anywhere in the patch can touch
+        const auto texel = [](float uv, uint32_t size) {
+            return static_cast<uint32_t>(std::clamp(std::floor(uv * size - 0.5f), 0.0f, static_cast<float>(size - 1)));
+        };
+        const uint32_t x0 = texel(v00[3], heightmapWidth);
+        const uint32_t y0 = texel(v00[4], heightmapHeight);
+        const uint32_t x1 = std::min(texel(v11[3], heightmapWidth) + 1, heightmapWidth - 1);
+        const uint32_t y1 = std::min(texel(v11[4], heightmapHeight) + 1, heightmapHeight - 1);
+
+        uint8_t lo, hi;
+        minMaxBounds(pyramid, x0, y0, x1, y1, lo, hi);
+
+        bounds[p].min = {v00[0], texel_height(lo), v00[2]};
+        bounds[p].max = {v11[0], texel_height(hi), v11[2]};
+    }
+
+    return bounds;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    const glm::vec4 row0{m[0][0], m[1][0], m[2][0], m[3][0]};
+    const glm::vec4 row1{m[0][1], m[1][1], m[2][1], m[3][1]};
+    const glm::vec4 row2{m[0][2], m[1][2], m[2][2], m[3][2]};
+    const glm::vec4 row3{m[0][3], m[1][3], m[2][3], m[3][3]};
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // left
+    frustum.planes[1] = row3 - row0; // right
+    frustum.planes[2] = row3 + row1; // bottom
+    frustum.planes[3] = row3 - row1; // top
+    frustum.planes[4] = row3 + row2; // near
+    frustum.planes[5] = row3 - row2; // far
+    return frustum;
+}
+
+bool Frustum::intersects(const PatchBounds &box) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        // corner furthest along the plane normal
+        const glm::vec3 p{
+            plane.x >= 0.0f ? box.max.x : box.min.x,
+            plane.y >= 0.0f ? box.max.y : box.min.y,
+            plane.z >= 0.0f ? box.max.z : box.min.z,
+        };
+        if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void cullPatches(const Frustum &frustum, const std::vector<PatchBounds> &bounds, std::vector<uint32_t> &visible)
+{
+    visible.clear();
+    for (size_t p = 0; p < bounds.size(); ++p)
+        if (frustum.intersects(bounds[p]))
+            visible.push_back(static_cast<uint32_t>(p));
+}
@@ -0,0 +1,47 @@
+#ifndef PATCH_GRID_HPP
+#define PATCH_GRID_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Heightmap.hpp"
+
+constexpr uint32_t PATCH_GRID_FLOATS_PER_VERTEX = 5; // pos.xyz, uv
+
+/**
+ * @brief resolution x resolution quad patches of 4 control points covering
+ * [-width / 2, width / 2] x [-height / 2, height / 2] on the xz plane,
+ * interleaved pos / uv. Control point order is 00, 01, 10, 11 as
+ * test_tcs.glsl expects.
+ */
+std::vector<float> buildPatchGrid(float width, float height, uint32_t resolution);
+
+struct PatchBounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// world space box of every patch, heights from the min/max pyramid of the heightmap it samples
+std::vector<PatchBounds> buildPatchBounds(const std::vector<float> &grid, const std::vector<MinMaxLevel> &pyramid,
+                                          uint32_t heightmapWidth, uint32_t heightmapHeight);
+
+/**
+ * @brief View frustum planes (Gribb / Hartmann extraction), normals point
+ * inwards.
+ */
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    bool intersects(const PatchBounds &box) const;
+};
+
+// indices of the patches whose boxes touch the frustum
+void cullPatches(const Frustum &frustum, const std::vector<PatchBounds> &bounds, std::vector<uint32_t> &visible);
+
+#endif // PATCH_GRID_HPP
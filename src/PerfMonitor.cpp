@@ -0,0 +1,182 @@
+#include <algorithm>
+
+#include "PerfMonitor.hpp"
+#include "Helpers.hpp"
+
+// the ARB extension and GL 4.6 share token values
+const GLenum PerfMonitor::STAT_TARGETS[STAT_COUNT] = {
+    GL_VERTICES_SUBMITTED,
+    GL_VERTEX_SHADER_INVOCATIONS,
+    GL_TESS_CONTROL_SHADER_PATCHES,
+    GL_TESS_EVALUATION_SHADER_INVOCATIONS,
+    GL_PRIMITIVES_GENERATED,
+    GL_CLIPPING_INPUT_PRIMITIVES,
+    GL_CLIPPING_OUTPUT_PRIMITIVES,
+    GL_FRAGMENT_SHADER_INVOCATIONS,
+};
+
+const char *const PerfMonitor::STAT_NAMES[STAT_COUNT] = {
+    "Vertices submitted",
+    "VS invocations",
+    "TCS patches",
+    "TES invocations",
+    "Primitives generated",
+    "Clipping input",
+    "Clipping output",
+    "FS invocations",
+};
+
+void PerfMonitor::init()
+{
+    pipelineStatistics = GLAD_GL_VERSION_4_6 || has_gl_extension("GL_ARB_pipeline_statistics_query");
+
+    for (size_t f = 0; f < QUERY_FRAMES; ++f)
+    {
+        // primitives generated is core, the rest need the extension
+        glGenQueries(STAT_COUNT, queries[f]);
+        glGenQueries(2, timestamps[f]);
+        issued[f] = false;
+    }
+}
+
+void PerfMonitor::release()
+{
+    for (size_t f = 0; f < QUERY_FRAMES; ++f)
+    {
+        glDeleteQueries(STAT_COUNT, queries[f]);
+        glDeleteQueries(2, timestamps[f]);
+    }
+    memory.clear();
+    terrain = {};
+}
+
+// oldest first, stops at the first frame the GPU has not finished so results stay in order
+void PerfMonitor::collect()
+{
+    for (size_t i = 0; i < QUERY_FRAMES; ++i)
+    {
+        const size_t slot = (frame + i) % QUERY_FRAMES;
+        if (!issued[slot])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(timestamps[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+            glGetQueryObjectiv(queries[slot][STAT_PRIMITIVES_GENERATED], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        issued[slot] = false;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(timestamps[slot][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(timestamps[slot][1], GL_QUERY_RESULT, &end);
+
+        for (size_t s = 0; s < STAT_COUNT; ++s)
+        {
+            if (!pipelineStatistics && s != STAT_PRIMITIVES_GENERATED)
+                continue;
+            GLuint64 value = 0;
+            glGetQueryObjectui64v(queries[slot][s], GL_QUERY_RESULT, &value);
+            statistics[s] = value;
+        }
+
+        terrain.frame = issuedFrame[slot];
+        terrain.gpuMs = static_cast<float>(end - begin) * 1e-6f;
+        terrain.primitives = statistics[STAT_PRIMITIVES_GENERATED];
+    }
+}
+
+void PerfMonitor::beginQueries()
+{
+    collect();
+
+    // a slot still pending QUERY_FRAMES frames later is dropped rather than waited on
+    const size_t slot = frame % QUERY_FRAMES;
+    issued[slot] = false;
+
+    glQueryCounter(timestamps[slot][0], GL_TIMESTAMP);
+
+    for (size_t s = 0; s < STAT_COUNT; ++s)
+        if (pipelineStatistics || s == STAT_PRIMITIVES_GENERATED)
+            glBeginQuery(STAT_TARGETS[s], queries[slot][s]);
+}
+
+void PerfMonitor::endQueries()
+{
+    const size_t slot = frame % QUERY_FRAMES;
+    for (size_t s = 0; s < STAT_COUNT; ++s)
+        if (pipelineStatistics || s == STAT_PRIMITIVES_GENERATED)
+            glEndQuery(STAT_TARGETS[s]);
+    glQueryCounter(timestamps[slot][1], GL_TIMESTAMP);
+
+    issued[slot] = true;
+    issuedFrame[slot] = frame + 1;
+    ++frame;
+}
+
+void PerfMonitor::pushFrame(float frameCpuMs, float frameGpuMs)
+{
+    cpuMs[head] = frameCpuMs;
+    gpuMs[head] = frameGpuMs;
+    head = (head + 1) % HISTORY;
+    samples = std::min(samples + 1, HISTORY);
+}
+
+void PerfMonitor::updateLodBands(const std::vector<glm::vec3> &controlPoints, const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges)
+{
+    for (LodBand &band : bands)
+        band = {};
+
+    for (size_t i = 0; i + 3 < controlPoints.size(); i += 4)
+    {
+        const PatchTess tess = patch_tessellation(&controlPoints[i], cameraPos, maxTessLevel, lodRanges);
+        LodBand &band = bands[tess.finestBand()];
+        ++band.patches;
+        band.triangles += tess.triangles;
+    }
+}
+
+void PerfMonitor::trackTexture(const std::string &name, GLuint texture)
+{
+    memory.push_back({name, texture, true, 0u});
+}
+
+void PerfMonitor::trackBuffer(const std::string &name, GLuint buffer)
+{
+    memory.push_back({name, buffer, false, 0u});
+}
+
+void PerfMonitor::refreshMemory()
+{
+    for (MemoryEntry &entry : memory)
+        entry.bytes = entry.texture ? texture_memory_bytes(entry.handle) : buffer_memory_bytes(entry.handle);
+}
+
+size_t PerfMonitor::totalMemory() const
+{
+    size_t total = 0;
+    for (const MemoryEntry &entry : memory)
+        total += entry.bytes;
+    return total;
+}
+
+void PerfMonitor::histogram(const float *values, size_t count, float maxMs, float *bins, size_t binCount)
+{
+    std::fill(bins, bins + binCount, 0.0f);
+    if (maxMs <= 0.0f)
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t bin = static_cast<size_t>(values[i] / maxMs * static_cast<float>(binCount));
+        bins[std::min(bin, binCount - 1)] += 1.0f;
+    }
+}
+
+float PerfMonitor::maxMs() const
+{
+    float peak = 0.0f;
+    for (size_t i = 0; i < samples; ++i)
+        peak = std::max({peak, cpuMs[i], gpuMs[i]});
+    return peak;
+}
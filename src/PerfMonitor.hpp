@@ -0,0 +1,112 @@
+#ifndef PERF_MONITOR_HPP
+#define PERF_MONITOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "TessLod.hpp"
+
+/**
+ * @brief Numbers behind the performance panel: rolling frame time history,
+ * pipeline statistics of the terrain pass, patch and triangle counts per LOD
+ * band and GPU memory per tracked resource.
+ *
+ * Pipeline statistics are read as soon as the GPU finished them, usually a
+ * frame late, and dropped when still pending QUERY_FRAMES frames later, so
+ * the panel never stalls the pipeline. The same
+ * readback feeds the LOD budget controller through terrain.
+ */
+struct PerfMonitor
+{
+    static constexpr size_t HISTORY = 240;
+    static constexpr size_t QUERY_FRAMES = 4;
+    static constexpr size_t HISTOGRAM_BINS = 32;
+
+    enum Statistic
+    {
+        STAT_VERTICES_SUBMITTED,
+        STAT_VS_INVOCATIONS,
+        STAT_TCS_PATCHES,
+        STAT_TES_INVOCATIONS,
+        STAT_PRIMITIVES_GENERATED,
+        STAT_CLIPPING_INPUT,
+        STAT_CLIPPING_OUTPUT,
+        STAT_FS_INVOCATIONS,
+        STAT_COUNT,
+    };
+
+    static const GLenum STAT_TARGETS[STAT_COUNT];
+    static const char *const STAT_NAMES[STAT_COUNT];
+
+    struct LodBand
+    {
+        size_t patches = 0;
+        size_t triangles = 0; // conservative, see patch_tessellation()
+    };
+
+    // GPU time and primitives of the wrapped work in one frame
+    struct PassSample
+    {
+        uint64_t frame = 0; // beginQueries() call it was issued in, 0 = none yet
+        float gpuMs = 0.0f;
+        uint64_t primitives = 0;
+    };
+
+    struct MemoryEntry
+    {
+        std::string name;
+        GLuint handle = 0;
+        bool texture = false;
+        size_t bytes = 0;
+    };
+
+    bool pipelineStatistics = false; // GL 4.6 or GL_ARB_pipeline_statistics_query
+
+    float cpuMs[HISTORY] = {};
+    float gpuMs[HISTORY] = {};
+    size_t head = 0; // next write position
+    size_t samples = 0;
+
+    uint64_t statistics[STAT_COUNT] = {};
+    PassSample terrain; // latest resolved sample
+    LodBand bands[NUM_LOD_RANGES];
+    std::vector<MemoryEntry> memory;
+
+    void init();
+    void release();
+
+    // wrap the GL work the statistics should cover, once per frame
+    void beginQueries();
+    void endQueries();
+    // number the next beginQueries() will issue under
+    uint64_t nextFrame() const { return frame + 1; }
+
+    void pushFrame(float frameCpuMs, float frameGpuMs);
+
+    void updateLodBands(const std::vector<glm::vec3> &controlPoints, const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges);
+
+    void trackTexture(const std::string &name, GLuint texture);
+    void trackBuffer(const std::string &name, GLuint buffer);
+    void refreshMemory();
+    size_t totalMemory() const;
+
+    // distribution of the history over [0, maxMs], values past maxMs land in the last bin
+    static void histogram(const float *values, size_t count, float maxMs, float *bins, size_t binCount);
+    float maxMs() const;
+
+private:
+    void collect();
+
+    GLuint queries[QUERY_FRAMES][STAT_COUNT] = {};
+    GLuint timestamps[QUERY_FRAMES][2] = {};
+    bool issued[QUERY_FRAMES] = {};
+    uint64_t issuedFrame[QUERY_FRAMES] = {};
+    uint64_t frame = 0;
+};
+
+#endif // PERF_MONITOR_HPP
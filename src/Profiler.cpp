@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#include "Profiler.hpp"
+#include "Defines.hpp"
+
+Profiler g_profiler;
+
+static thread_local Profiler::ThreadBuffer *t_buffer = nullptr;
+static thread_local std::string t_name;
+
+static std::string json_escape(const char *s)
+{
+    std::string out;
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            out += '\\';
+        out += *s;
+    }
+    return out;
+}
+
+void Profiler::ThreadBuffer::push(const char *zoneName, uint64_t beginNs, uint64_t endNs)
+{
+    const size_t n = count.load(std::memory_order_relaxed);
+    if (n == EVENTS_PER_THREAD)
+    {
+        ++dropped;
+        return;
+    }
+    events[n] = {zoneName, beginNs, endNs};
+    count.store(n + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::init()
+{
+    for (size_t f = 0; f < GPU_QUERY_FRAMES; ++f)
+        glGenQueries(2 * MAX_GPU_ZONES, queries[f]);
+    gpu.name = "GPU";
+    gpu.id = 0;
+    initialized = true;
+
+    // cost of one enabled zone, reported so captures can be corrected for it
+    constexpr size_t CALIBRATION_ZONES = 4096;
+    enabled.store(true, std::memory_order_relaxed);
+    const uint64_t begin = now();
+    for (size_t i = 0; i < CALIBRATION_ZONES; ++i)
+    {
+        PROFILE_CPU("calibration");
+    }
+    stats.zoneCostNs = static_cast<double>(now() - begin) / CALIBRATION_ZONES;
+    enabled.store(false, std::memory_order_relaxed);
+
+    threadBuffer().count.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::release()
+{
+    enabled.store(false, std::memory_order_relaxed);
+    if (initialized)
+    {
+        for (size_t f = 0; f < GPU_QUERY_FRAMES; ++f)
+            glDeleteQueries(2 * MAX_GPU_ZONES, queries[f]);
+        initialized = false;
+    }
+}
+
+void Profiler::start()
+{
+    if (!initialized)
+        EXIT("Profiler::init() has not been called");
+
+    // zones only record while enabled and every thread is idle between frames, so resetting here is race free
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : threads)
+        {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped = 0;
+        }
+    }
+    gpu.count.store(0, std::memory_order_relaxed);
+    gpu.dropped = 0;
+    stats.cpuEvents = stats.gpuEvents = stats.dropped = 0;
+    stats.overheadMs = 0.0;
+
+    GLint64 glNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &glNow);
+    gpuToCpuNs = static_cast<int64_t>(now()) - static_cast<int64_t>(glNow);
+
+    enabled.store(true, std::memory_order_release);
+}
+
+void Profiler::stop()
+{
+    enabled.store(false, std::memory_order_release);
+
+    glFinish();
+    for (size_t f = 0; f < GPU_QUERY_FRAMES; ++f)
+        resolve(f, true);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.cpuEvents = 0;
+    stats.dropped = gpu.dropped;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : threads)
+    {
+        stats.cpuEvents += buffer->count.load(std::memory_order_acquire);
+        stats.dropped += buffer->dropped;
+    }
+    stats.gpuEvents = gpu.count.load(std::memory_order_relaxed);
+    stats.overheadMs = static_cast<double>(stats.cpuEvents) * stats.zoneCostNs * 1e-6;
+}
+
+void Profiler::endFrame()
+{
+    ++frame;
+    resolve(frame % GPU_QUERY_FRAMES, false);
+}
+
+void Profiler::resolve(size_t slot, bool wait)
+{
+    const uint32_t zones = queryCount[slot];
+    queryCount[slot] = 0;
+
+    for (uint32_t z = 0; z < zones; ++z)
+    {
+        if (!wait)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][2 * z + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                ++gpu.dropped;
+                continue;
+            }
+        }
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(queries[slot][2 * z], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[slot][2 * z + 1], GL_QUERY_RESULT, &end);
+        gpu.push(queryNames[slot][z], static_cast<uint64_t>(static_cast<int64_t>(begin) + gpuToCpuNs),
+                 static_cast<uint64_t>(static_cast<int64_t>(end) + gpuToCpuNs));
+    }
+}
+
+void Profiler::cpuEvent(const char *zoneName, uint64_t beginNs, uint64_t endNs)
+{
+    threadBuffer().push(zoneName, beginNs, endNs);
+}
+
+uint32_t Profiler::gpuBegin(const char *zoneName)
+{
+    const size_t slot = frame % GPU_QUERY_FRAMES;
+    const uint32_t zone = queryCount[slot];
+    if (zone == MAX_GPU_ZONES)
+    {
+        ++gpu.dropped;
+        return UINT32_MAX;
+    }
+
+    queryCount[slot] = zone + 1;
+    queryNames[slot][zone] = zoneName;
+    glQueryCounter(queries[slot][2 * zone], GL_TIMESTAMP);
+    return zone;
+}
+
+void Profiler::gpuEnd(uint32_t zone)
+{
+    glQueryCounter(queries[frame % GPU_QUERY_FRAMES][2 * zone + 1], GL_TIMESTAMP);
+}
+
+Profiler::ThreadBuffer &Profiler::threadBuffer()
+{
+    if (t_buffer)
+        return *t_buffer;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<ThreadBuffer>());
+    t_buffer = threads.back().get();
+    t_buffer->id = static_cast<uint32_t>(threads.size());
+    t_buffer->name = t_name.empty() ? "thread " + std::to_string(t_buffer->id) : t_name;
+    return *t_buffer;
+}
+
+void Profiler::setThreadName(const std::string &name)
+{
+    t_name = name;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (t_buffer)
+        t_buffer->name = name;
+}
+
+const char *Profiler::intern(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.insert(name).first->c_str();
+}
+
+void Profiler::writeTrace(const std::string &filepath) const
+{
+    std::ofstream ofs{filepath, std::ios::out};
+    if (!ofs.is_open())
+        EXIT("Failed to open trace file " + filepath);
+
+    std::vector<const ThreadBuffer *> buffers{&gpu};
+    for (const std::unique_ptr<ThreadBuffer> &buffer : threads)
+        buffers.push_back(buffer.get());
+
+    uint64_t base = UINT64_MAX;
+    for (const ThreadBuffer *buffer : buffers)
+    {
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+            base = std::min(base, buffer->events[i].beginNs);
+    }
+
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    ofs << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"terrain\"}}";
+
+    for (const ThreadBuffer *buffer : buffers)
+    {
+        ofs << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"" << json_escape(buffer->name.c_str()) << "\"}}";
+        ofs << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"sort_index\":" << buffer->id << "}}";
+
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Event &event = buffer->events[i];
+            ofs << ",\n{\"name\":\"" << json_escape(event.name) << "\",\"cat\":\"" << (buffer == &gpu ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"ts\":" << static_cast<double>(event.beginNs - base) * 1e-3
+                << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) * 1e-3 << "}";
+        }
+    }
+
+    ofs << "\n]}\n";
+
+    if (!ofs)
+        EXIT("Failed to write trace file " + filepath);
+}
@@ -0,0 +1,152 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+ * @brief Scoped CPU and GPU zones captured into a Chrome trace_event file
+ * (loads in Perfetto and chrome://tracing).
+ *
+ * CPU zones append to a buffer owned by the recording thread, only the first
+ * zone a thread records takes a lock to register its buffer. GPU zones are
+ * GL_TIMESTAMP query pairs from a pool rotated over GPU_QUERY_FRAMES frames,
+ * endFrame() resolves the oldest frame without waiting. While disabled a
+ * zone costs one relaxed atomic load.
+ *
+ * Zone names must outlive the capture: string literals, or intern().
+ */
+struct Profiler
+{
+    static constexpr size_t EVENTS_PER_THREAD = 1u << 16;
+    static constexpr size_t GPU_QUERY_FRAMES = 4;
+    static constexpr size_t MAX_GPU_ZONES = 128; // per frame
+
+    struct Event
+    {
+        const char *name;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+
+    struct ThreadBuffer
+    {
+        std::string name;
+        uint32_t id = 0;
+        std::atomic<size_t> count{0}; // written by the owning thread only
+        size_t dropped = 0;
+        std::unique_ptr<Event[]> events{new Event[EVENTS_PER_THREAD]};
+
+        void push(const char *name, uint64_t beginNs, uint64_t endNs);
+    };
+
+    struct Stats
+    {
+        size_t cpuEvents = 0;
+        size_t gpuEvents = 0;
+        size_t dropped = 0;
+        double zoneCostNs = 0.0; // measured per CPU zone at init
+        double overheadMs = 0.0; // estimated time spent inside the profiler this capture
+    };
+
+    std::atomic<bool> enabled{false};
+    Stats stats;
+
+    void init();
+    void release();
+
+    // begin/end a capture, call on the GL thread between frames
+    void start();
+    void stop();
+
+    void endFrame();
+
+    void setThreadName(const std::string &name);
+    const char *intern(const std::string &name);
+
+    void writeTrace(const std::string &filepath) const;
+
+    static uint64_t now();
+
+    // hot path, used by the zone guards
+    void cpuEvent(const char *name, uint64_t beginNs, uint64_t endNs);
+    uint32_t gpuBegin(const char *name);
+    void gpuEnd(uint32_t zone);
+
+private:
+    ThreadBuffer &threadBuffer();
+    void resolve(size_t slot, bool wait);
+
+    std::mutex mutex; // guards registration and interning only
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    std::unordered_set<std::string> names;
+
+    ThreadBuffer gpu;
+    GLuint queries[GPU_QUERY_FRAMES][2 * MAX_GPU_ZONES] = {};
+    const char *queryNames[GPU_QUERY_FRAMES][MAX_GPU_ZONES] = {};
+    uint32_t queryCount[GPU_QUERY_FRAMES] = {};
+    size_t frame = 0;
+    int64_t gpuToCpuNs = 0; // added to GL timestamps to land on the steady_clock timeline
+    bool initialized = false;
+};
+
+extern Profiler g_profiler;
+
+struct CpuZone
+{
+    const char *name;
+    uint64_t beginNs = 0;
+
+    explicit CpuZone(const char *zoneName)
+        : name(g_profiler.enabled.load(std::memory_order_relaxed) ? zoneName : nullptr)
+    {
+        if (name)
+            beginNs = Profiler::now();
+    }
+
+    ~CpuZone()
+    {
+        if (name)
+            g_profiler.cpuEvent(name, beginNs, Profiler::now());
+    }
+
+    CpuZone(const CpuZone &) = delete;
+    CpuZone &operator=(const CpuZone &) = delete;
+};
+
+// GL thread only
+struct GpuZone
+{
+    uint32_t zone;
+
+    explicit GpuZone(const char *zoneName)
+        : zone(g_profiler.enabled.load(std::memory_order_relaxed) ? g_profiler.gpuBegin(zoneName) : UINT32_MAX)
+    {
+    }
+
+    ~GpuZone()
+    {
+        if (zone != UINT32_MAX)
+            g_profiler.gpuEnd(zone);
+    }
+
+    GpuZone(const GpuZone &) = delete;
+    GpuZone &operator=(const GpuZone &) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_CPU(name) CpuZone PROFILE_CONCAT(cpuZone_, __LINE__){name}
+#define PROFILE_GPU(name) GpuZone PROFILE_CONCAT(gpuZone_, __LINE__){name}
+#define PROFILE_ZONE(name) PROFILE_CPU(name); PROFILE_GPU(name)
+
+#endif // PROFILER_HPP
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include "RenderQueue.hpp"
+#include "Defines.hpp"
+
+void RenderQueue::init(size_t threadCount, size_t capacityPerThread)
+{
+    arenas.assign(threadCount, {});
+    for (CommandArena &arena : arenas)
+        arena.reserve(capacityPerThread);
+
+    merged.reserve(threadCount * capacityPerThread);
+}
+
+void RenderQueue::beginFrame()
+{
+    for (CommandArena &arena : arenas)
+    {
+        arena.count = 0;
+        arena.overflows = 0;
+    }
+    stats = {};
+}
+
+void RenderQueue::sortArena(size_t thread)
+{
+    CommandArena &arena = arenas[thread];
+    std::sort(arena.commands.begin(), arena.commands.begin() + arena.count,
+              [](const Command &a, const Command &b) { return a.sortKey < b.sortKey; });
+}
+
+void RenderQueue::merge()
+{
+    merged.clear();
+
+    // arenas are few, a linear scan over the heads beats a heap here
+    const size_t arenaCount = arenas.size();
+    heads.assign(arenaCount, 0u);
+
+    for (;;)
+    {
+        size_t best = arenaCount;
+        for (size_t a = 0; a < arenaCount; ++a)
+        {
+            if (heads[a] == arenas[a].count)
+                continue;
+            if (best == arenaCount || arenas[a].commands[heads[a]].sortKey < arenas[best].commands[heads[best]].sortKey)
+                best = a;
+        }
+
+        if (best == arenaCount)
+            break;
+
+        merged.push_back(&arenas[best].commands[heads[best]++]);
+    }
+}
+
+void RenderQueue::replay()
+{
+    merge();
+
+    for (const CommandArena &arena : arenas)
+        stats.overflows += arena.overflows;
+
+    GLuint boundProgram = ~0u;
+    GLuint boundVertexArray = ~0u;
+    GLuint boundTextures[TEXTURE_UNITS];
+    std::fill(std::begin(boundTextures), std::end(boundTextures), ~0u);
+
+    stats.commands = merged.size();
+    for (size_t i = 0; i < merged.size(); ++i)
+    {
+        const Command &command = *merged[i];
+        switch (command.type)
+        {
+        case COMMAND_POLYGON_MODE:
+            glPolygonMode(GL_FRONT_AND_BACK, command.polygonMode.mode);
+            break;
+        case COMMAND_CLEAR:
+            glClearColor(command.clear.color[0], command.clear.color[1], command.clear.color[2], command.clear.color[3]);
+            glClear(command.clear.mask);
+            break;
+        case COMMAND_BIND_UNIFORM_RANGE:
+            glBindBufferRange(GL_UNIFORM_BUFFER, command.uniformRange.binding, command.uniformRange.buffer,
+                              command.uniformRange.offset, command.uniformRange.size);
+            break;
+        case COMMAND_BIND_TEXTURE:
+            if (command.texture.texture == boundTextures[command.texture.unit])
+            {
+                ++stats.skippedBinds;
+                break;
+            }
+            glActiveTexture(GL_TEXTURE0 + command.texture.unit);
+            glBindTexture(GL_TEXTURE_2D, command.texture.texture);
+            boundTextures[command.texture.unit] = command.texture.texture;
+            break;
+        case COMMAND_DRAW:
+        {
+            if (command.draw.program != boundProgram)
+            {
+                glUseProgram(command.draw.program);
+                boundProgram = command.draw.program;
+            }
+            else
+                ++stats.skippedBinds;
+
+            if (command.draw.vertexArray != boundVertexArray)
+            {
+                glBindVertexArray(command.draw.vertexArray);
+                boundVertexArray = command.draw.vertexArray;
+            }
+            else
+                ++stats.skippedBinds;
+
+            // gather following draws with the same state into one call, ranges
+            // that continue the previous one fold into it
+            drawFirsts.assign(1u, command.draw.first);
+            drawCounts.assign(1u, command.draw.count);
+            while (i + 1 < merged.size())
+            {
+                const Command &next = *merged[i + 1];
+                if (next.type != COMMAND_DRAW || next.draw.program != command.draw.program ||
+                    next.draw.vertexArray != command.draw.vertexArray || next.draw.mode != command.draw.mode)
+                    break;
+
+                if (next.draw.first == drawFirsts.back() + drawCounts.back())
+                    drawCounts.back() += next.draw.count;
+                else
+                {
+                    drawFirsts.push_back(next.draw.first);
+                    drawCounts.push_back(next.draw.count);
+                }
+                ++stats.mergedDraws;
+                ++i;
+            }
+
+            if (drawFirsts.size() == 1u)
+                glDrawArrays(command.draw.mode, drawFirsts[0], drawCounts[0]);
+            else
+                glMultiDrawArrays(command.draw.mode, drawFirsts.data(), drawCounts.data(), static_cast<GLsizei>(drawFirsts.size()));
+            ++stats.draws;
+            break;
+        }
+        case COMMAND_CALLBACK:
+            command.callback.fn(command.callback.user);
+            // the callback may have changed any binding
+            boundProgram = ~0u;
+            boundVertexArray = ~0u;
+            std::fill(std::begin(boundTextures), std::end(boundTextures), ~0u);
+            break;
+        default:
+            break;
+        }
+    }
+
+    glBindVertexArray(0u);
+    glUseProgram(0u);
+}
+
+void RenderQueue::polygonMode(CommandArena &arena, uint64_t key, GLenum mode)
+{
+    if (Command *command = arena.push(COMMAND_POLYGON_MODE, key))
+        command->polygonMode.mode = mode;
+}
+
+void RenderQueue::clear(CommandArena &arena, uint64_t key, float r, float g, float b, float a, GLbitfield mask)
+{
+    if (Command *command = arena.push(COMMAND_CLEAR, key))
+    {
+        command->clear.color[0] = r;
+        command->clear.color[1] = g;
+        command->clear.color[2] = b;
+        command->clear.color[3] = a;
+        command->clear.mask = mask;
+    }
+}
+
+void RenderQueue::bindUniformRange(CommandArena &arena, uint64_t key, GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (Command *command = arena.push(COMMAND_BIND_UNIFORM_RANGE, key))
+        command->uniformRange = {binding, buffer, offset, size};
+}
+
+void RenderQueue::bindTexture(CommandArena &arena, uint64_t key, GLuint unit, GLuint texture)
+{
+    if (unit >= TEXTURE_UNITS)
+        EXIT("Render queue texture unit " + std::to_string(unit) + " out of range");
+    if (Command *command = arena.push(COMMAND_BIND_TEXTURE, key))
+        command->texture = {unit, texture};
+}
+
+void RenderQueue::draw(CommandArena &arena, uint64_t key, GLuint program, GLuint vertexArray, GLenum mode, GLint first, GLsizei count)
+{
+    if (Command *command = arena.push(COMMAND_DRAW, key))
+        command->draw = {program, vertexArray, mode, first, count};
+}
+
+void RenderQueue::callback(CommandArena &arena, uint64_t key, void (*fn)(void *), void *user)
+{
+    if (Command *command = arena.push(COMMAND_CALLBACK, key))
+        command->callback = {fn, user};
+}
@@ -0,0 +1,141 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum CommandType : uint32_t
+{
+    COMMAND_POLYGON_MODE = 0,
+    COMMAND_CLEAR,
+    COMMAND_BIND_UNIFORM_RANGE,
+    COMMAND_BIND_TEXTURE,
+    COMMAND_DRAW,
+    COMMAND_CALLBACK, // escape hatch for passes that still issue GL directly
+    COMMAND_COUNT
+};
+
+enum CommandLayer : uint32_t
+{
+    LAYER_SETUP = 0,
+    LAYER_OPAQUE = 1,
+    LAYER_OVERLAY = 2,
+};
+
+/**
+ * @brief Plain-old-data command, recorded on any thread and executed on the
+ * GL thread. Sort key layout: [63..56] layer, [55..40] state, [39..0] depth
+ * or sequence, so replay groups by state and draws front to back.
+ */
+struct Command
+{
+    uint64_t sortKey;
+    CommandType type;
+    union
+    {
+        struct { GLenum mode; } polygonMode;
+        struct { float color[4]; GLbitfield mask; } clear;
+        struct { GLuint binding; GLuint buffer; GLintptr offset; GLsizeiptr size; } uniformRange;
+        struct { GLuint unit; GLuint texture; } texture;
+        struct { GLuint program; GLuint vertexArray; GLenum mode; GLint first; GLsizei count; } draw;
+        struct { void (*fn)(void *); void *user; } callback;
+    };
+};
+
+inline uint64_t make_sort_key(uint32_t layer, uint32_t state, uint64_t depth)
+{
+    return (static_cast<uint64_t>(layer & 0xFFu) << 56u) | (static_cast<uint64_t>(state & 0xFFFFu) << 40u) | (depth & 0xFFFFFFFFFFull);
+}
+
+// positive floats compare like their bit patterns, keep the top 32 bits of the 40 bit field
+inline uint64_t depth_sort_bits(float depth)
+{
+    if (!(depth > 0.0f))
+        return 0;
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return static_cast<uint64_t>(bits) << 8u;
+}
+
+/**
+ * @brief Fixed capacity command storage owned by one recording thread.
+ * Reset every frame, never allocates while recording.
+ */
+struct CommandArena
+{
+    std::vector<Command> commands;
+    size_t count = 0;
+    size_t overflows = 0;
+
+    void reserve(size_t capacity) { commands.resize(capacity); }
+
+    Command *push(CommandType type, uint64_t sortKey)
+    {
+        if (count == commands.size())
+        {
+            ++overflows;
+            return nullptr;
+        }
+
+        Command *command = &commands[count++];
+        command->type = type;
+        command->sortKey = sortKey;
+        return command;
+    }
+};
+
+/**
+ * @brief One arena per recording thread. Workers sort their own arena, the
+ * GL thread k-way merges them by sort key and replays the result, skipping
+ * redundant program / vertex array / texture binds. Runs of draws with the
+ * same state go out as one glMultiDrawArrays, in sort order.
+ */
+struct RenderQueue
+{
+    static constexpr GLuint TEXTURE_UNITS = 16; // units bindTexture() may name, the GL minimum per stage
+
+    struct Stats
+    {
+        size_t commands = 0;
+        size_t draws = 0;
+        size_t mergedDraws = 0; // draws folded into a neighbour's call
+        size_t skippedBinds = 0;
+        size_t overflows = 0;
+    };
+
+    std::vector<CommandArena> arenas;
+    std::vector<const Command *> merged;
+    Stats stats;
+
+    void init(size_t threadCount, size_t capacityPerThread);
+
+    CommandArena &arena(size_t thread) { return arenas[thread]; }
+
+    void beginFrame();
+
+    // sorts a single arena, safe to call from the thread that recorded it
+    void sortArena(size_t thread);
+
+    // merges every arena and executes the commands, GL thread only
+    void replay();
+
+    // convenience recorders
+    void polygonMode(CommandArena &arena, uint64_t key, GLenum mode);
+    void clear(CommandArena &arena, uint64_t key, float r, float g, float b, float a, GLbitfield mask);
+    void bindUniformRange(CommandArena &arena, uint64_t key, GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void bindTexture(CommandArena &arena, uint64_t key, GLuint unit, GLuint texture); // unit < TEXTURE_UNITS
+    void draw(CommandArena &arena, uint64_t key, GLuint program, GLuint vertexArray, GLenum mode, GLint first, GLsizei count);
+    void callback(CommandArena &arena, uint64_t key, void (*fn)(void *), void *user);
+
+private:
+    void merge();
+
+    std::vector<size_t> heads; // merge cursor per arena, reused across frames
+    std::vector<GLint> drawFirsts; // ranges of the draw run being replayed
+    std::vector<GLsizei> drawCounts;
+};
+
+#endif // RENDER_QUEUE_HPP
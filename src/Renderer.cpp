@@ -0,0 +1,877 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include "Defines.hpp"
+#include "HeightField.hpp"
+#include "Helpers.hpp"
+#include "PatchGrid.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "TerrainEdit.hpp"
+#include "Uniforms.hpp"
+#include "Visibility.hpp"
+
+OpenGLManager g_gl;
+CameraManager g_camera;
+AppManager g_app;
+PassManager g_passes;
+
+TessCache g_tessCache;
+StreamRing g_stream;
+WorkerPool g_pool;
+RenderQueue g_queue;
+FrameGraph g_frameGraph;
+PerfMonitor g_perf;
+LodBudget g_budget;
+TerrainMaps g_terrainMaps;
+HorizonMap g_horizonMap;
+TerrainGenerator g_generator;
+HeightFeed g_feed;
+
+// a feed frame uploaded, and the fence behind the first frame that drew it once that was submitted
+struct FeedInFlight
+{
+    int64_t writeNanos = 0;
+    GLsync fence = nullptr;
+};
+static std::vector<FeedInFlight> g_feedInFlight;
+
+void updateCameraMatrix()
+{
+    g_camera.view = glm::lookAt(g_camera.pos, g_camera.pos + g_camera.forward, {0.0f, 1.0f, 0.0f});
+}
+
+void setCameraOrientation(float yawDegrees, float pitchDegrees)
+{
+    g_camera.yaw = yawDegrees;
+    g_camera.pitch = pitchDegrees;
+    g_camera.forward = {
+        glm::cos(glm::radians(yawDegrees)) * glm::cos(glm::radians(pitchDegrees)),
+        glm::sin(glm::radians(pitchDegrees)),
+        -glm::sin(glm::radians(yawDegrees)) * glm::cos(glm::radians(pitchDegrees)),
+    };
+    g_camera.forward = glm::normalize(g_camera.forward);
+
+    updateCameraMatrix();
+}
+
+GLuint create_texture_2d(const std::string tex_filepath, Heightmap *retained)
+{
+    GLuint tex_handle;
+    glGenTextures(1, &tex_handle);
+    glBindTexture(GL_TEXTURE_2D, tex_handle);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    stbi_set_flip_vertically_on_load(true);
+    int tex_width, tex_height, tex_num_chan;
+    unsigned char *tex_data = stbi_load(tex_filepath.c_str(), &tex_width, &tex_height, &tex_num_chan, 4);
+
+    if (!tex_data)
+        EXIT("Failed to load texture " + tex_filepath);
+
+    uint64_t format = 0x0;
+    switch (tex_num_chan)
+    {
+    case 1:
+        format = GL_RGBA;
+        break;
+    case 3:
+        format = GL_RGB;
+        break;
+    case 4:
+        format = GL_RGBA;
+        break;
+    default:
+        EXIT("Failed to load texture " + tex_filepath);
+    }
+
+    glTexImage2D(GL_TEXTURE_2D, 0, format, tex_width, tex_height, 0, format, GL_UNSIGNED_BYTE, tex_data);
+
+    g_app.heightmap_x_dim = static_cast<size_t>(tex_width);
+    g_app.heightmap_y_dim = static_cast<size_t>(tex_height);
+
+    if (retained)
+    {
+        // the channel the shaders decode, for CPU height queries
+        retained->width = static_cast<uint32_t>(tex_width);
+        retained->height = static_cast<uint32_t>(tex_height);
+        retained->texels.resize(static_cast<size_t>(tex_width) * tex_height);
+        for (size_t i = 0; i < retained->texels.size(); ++i)
+            retained->texels[i] = tex_data[i * 4 + 1];
+    }
+
+    stbi_image_free(tex_data);
+
+    return tex_handle;
+}
+
+GLuint create_heightmap_texture(const Heightmap &heightmap)
+{
+    GLuint tex_handle;
+    glGenTextures(1, &tex_handle);
+    glBindTexture(GL_TEXTURE_2D, tex_handle);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // what stbi_load(..., 4) makes of a gray image, so edits and filters see the same texture either way
+    std::vector<uint8_t> rgba(heightmap.texels.size() * 4u);
+    for (size_t i = 0; i < heightmap.texels.size(); ++i)
+    {
+        const uint8_t texel = heightmap.texels[i];
+        rgba[i * 4 + 0] = texel;
+        rgba[i * 4 + 1] = texel;
+        rgba[i * 4 + 2] = texel;
+        rgba[i * 4 + 3] = 255u;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(heightmap.width), static_cast<GLsizei>(heightmap.height), 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, rgba.data());
+
+    g_app.heightmap_x_dim = heightmap.width;
+    g_app.heightmap_y_dim = heightmap.height;
+
+    return tex_handle;
+}
+
+/**
+ * @brief Uploads rect of one texture level through the stream ring, in bands
+ * of at most a quarter of the ring so a large rect never blocks on the whole
+ * ring. fill(out, y0, rows) writes the tightly packed rows of a band.
+ */
+template <typename Fill>
+static void stream_texture_rect(GLuint texture, GLint level, GLenum format, GLenum type, size_t texelBytes, const TexelRect &rect, Fill &&fill)
+{
+    const uint32_t width = rect.x1 - rect.x0 + 1;
+    const size_t rowBytes = static_cast<size_t>(width) * texelBytes;
+    const uint32_t bandRows = static_cast<uint32_t>(std::max<size_t>(g_stream.capacity / 4u / rowBytes, 1u));
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_stream.buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t y0 = rect.y0; y0 <= rect.y1; y0 += bandRows)
+    {
+        const uint32_t rows = std::min(bandRows, rect.y1 - y0 + 1);
+
+        // uploads run before the frame records anything, so fencing them early lets the ring recycle them
+        if (g_stream.stats.frameBytes + rowBytes * rows > g_stream.capacity / 2u)
+            g_stream.endFrame();
+        const StreamRing::Allocation alloc = g_stream.allocate(rowBytes * rows);
+        fill(static_cast<uint8_t *>(alloc.ptr), y0, rows);
+
+        glTexSubImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(rect.x0), static_cast<GLint>(y0), static_cast<GLsizei>(width),
+                        static_cast<GLsizei>(rows), format, type, reinterpret_cast<const void *>(alloc.offset));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+    glBindTexture(GL_TEXTURE_2D, 0u);
+}
+
+// one level of a derived map, rows copied as they are
+static void upload_map_rect(GLuint texture, GLint level, GLenum format, GLenum type, const uint8_t *texels, uint32_t levelWidth, size_t texelBytes,
+                            const TexelRect &rect)
+{
+    const size_t rowBytes = static_cast<size_t>(rect.x1 - rect.x0 + 1) * texelBytes;
+    stream_texture_rect(texture, level, format, type, texelBytes, rect, [&](uint8_t *out, uint32_t y0, uint32_t rows) {
+        for (uint32_t y = y0; y < y0 + rows; ++y, out += rowBytes)
+            memcpy(out, texels + (static_cast<size_t>(y) * levelWidth + rect.x0) * texelBytes, rowBytes);
+    });
+}
+
+// the levels of g_terrainMaps that cover a changed level 0 rect
+static void upload_terrain_maps(const TexelRect &rect)
+{
+    const bool rg16 = g_terrainMaps.settings.normalFormat == NormalFormat::RG16;
+    for (size_t l = 0; l < g_terrainMaps.levels.size(); ++l)
+    {
+        const TexelRect levelRect = terrainMapLevelRect(g_terrainMaps, rect, l);
+        if (levelRect.x0 > levelRect.x1 || levelRect.y0 > levelRect.y1)
+            continue;
+        const TerrainMapLevel &level = g_terrainMaps.levels[l];
+        upload_map_rect(g_gl.textures[TEXTURE_NORMALS], static_cast<GLint>(l), GL_RG, rg16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE,
+                        level.normals.data(), level.width, g_terrainMaps.normalTexelBytes(), levelRect);
+        upload_map_rect(g_gl.textures[TEXTURE_SURFACE], static_cast<GLint>(l), GL_RG, GL_UNSIGNED_BYTE, level.surface.data(), level.width, 2u,
+                        levelRect);
+    }
+}
+
+// normals, slope and curvature of the field with their mips, next to the heightmap
+static void create_terrain_maps(const HeightField &field)
+{
+    const auto start = std::chrono::steady_clock::now();
+    g_terrainMaps = buildTerrainMaps(field, g_app.terrainMaps, &g_pool);
+    g_app.terrainMapsMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const GLsizei levels = static_cast<GLsizei>(g_terrainMaps.levels.size());
+    const GLenum formats[2] = {static_cast<GLenum>(g_terrainMaps.settings.normalFormat == NormalFormat::RG16 ? GL_RG16 : GL_RG8), GL_RG8};
+    glGenTextures(2, &g_gl.textures[TEXTURE_NORMALS]);
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_NORMALS + i]);
+        glTexStorage2D(GL_TEXTURE_2D, levels, formats[i], static_cast<GLsizei>(field.width), static_cast<GLsizei>(field.height));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0u);
+    upload_terrain_maps({0u, 0u, field.width - 1u, field.height - 1u});
+    g_stream.endFrame();
+
+    g_app.terrainRect = {field.origin.x, field.origin.y, field.extent.x, field.extent.y};
+    LOG("Terrain maps %ux%u, %zu levels, %s normals in %.1f ms\n", field.width, field.height, g_terrainMaps.levels.size(),
+        normalFormatName(g_terrainMaps.settings.normalFormat), g_app.terrainMapsMs);
+}
+
+static void upload_horizon_map(const TexelRect &rect)
+{
+    for (uint32_t p = 0; p < HorizonMap::PLANES; ++p)
+        upload_map_rect(g_gl.textures[TEXTURE_HORIZON_0 + p], 0, GL_RGBA, GL_UNSIGNED_BYTE, g_horizonMap.planes[p].data(), g_horizonMap.width, 4u, rect);
+}
+
+// horizons for the sun shadows, one level: a box filtered horizon is no horizon of the coarser texel
+static void create_horizon_map(const HeightField &field)
+{
+    const auto start = std::chrono::steady_clock::now();
+    g_horizonMap = buildHorizonMap(field, g_app.horizon, &g_pool);
+    g_app.horizonMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    glGenTextures(HorizonMap::PLANES, &g_gl.textures[TEXTURE_HORIZON_0]);
+    for (uint32_t p = 0; p < HorizonMap::PLANES; ++p)
+    {
+        glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_HORIZON_0 + p]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, static_cast<GLsizei>(field.width), static_cast<GLsizei>(field.height));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0u);
+    upload_horizon_map({0u, 0u, field.width - 1u, field.height - 1u});
+    g_stream.endFrame();
+
+    LOG("Horizon map %ux%u, %u directions within %u texels in %.1f ms\n", field.width, field.height, HorizonMap::DIRECTIONS,
+        g_horizonMap.settings.reach, g_app.horizonMs);
+}
+
+void init()
+{
+    PROFILE_CPU("init");
+
+    {
+    PROFILE_CPU("init/shaders");
+    g_gl.programs[PROGRAM_DEFAULT] = createProgram(g_app.shaderDir + "default.vert", g_app.shaderDir + "default.frag",
+                                                   g_app.shaderDir + "tcs.glsl", g_app.shaderDir + "tes.glsl", "DEFAULT");
+    g_gl.programs[PROGRAM_DEFAULT] = createProgram(g_app.shaderDir + "test_vert.glsl", g_app.shaderDir + "test_frag.glsl",
+                                                   g_app.shaderDir + "test_tcs.glsl", g_app.shaderDir + "test_tes.glsl", "DEFAULT");
+    g_gl.programs[PROGRAM_TESS_CAPTURE] = createCaptureProgram(g_app.shaderDir + "test_vert.glsl", g_app.shaderDir + "test_tcs.glsl",
+                                                               g_app.shaderDir + "test_tes.glsl", TessCache::CAPTURE_VARYINGS, "TESS_CAPTURE");
+    g_gl.programs[PROGRAM_TESS_CACHED] = createProgram(g_app.shaderDir + "tess_cache_vert.glsl", g_app.shaderDir + "test_frag.glsl", "TESS_CACHED");
+
+    for (const GLuint program : {g_gl.programs[PROGRAM_DEFAULT], g_gl.programs[PROGRAM_TESS_CAPTURE], g_gl.programs[PROGRAM_TESS_CACHED]})
+        bind_uniform_block(program, "FrameUniforms", UNIFORM_BINDING_FRAME);
+    for (const GLuint program : {g_gl.programs[PROGRAM_DEFAULT], g_gl.programs[PROGRAM_TESS_CACHED]})
+    {
+        glUseProgram(program);
+        set_uni_int(program, "viewshedMap", 1);
+        set_uni_int(program, "normalMap", 2);
+        set_uni_int(program, "surfaceMap", 3);
+        set_uni_int(program, "horizonMap0", 4);
+        set_uni_int(program, "horizonMap1", 5);
+    }
+    glUseProgram(0u);
+    }
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &g_app.uniformAlignment);
+    g_stream.init(g_app.streamRingBytes);
+
+    g_camera.projection = glm::perspective(glm::radians(45.0f), (float)g_app.viewerHeight / (float)g_app.viewerWidth, 0.1f, 100000.0f);
+    updateCameraMatrix();
+
+    size_t heightmap_width = 0;
+    size_t heightmap_height = 0;
+
+    // the generator fills its tiles on the pool
+    {
+        PROFILE_CPU("init/workers");
+        g_pool.init();
+    }
+
+    // read or generate heightmap
+    {
+        PROFILE_CPU("init/heightmap");
+        Heightmap retained;
+        ProceduralSource source;
+        std::string feed;
+        g_app.procedural = parseProceduralSource(g_app.heightmapPath, source);
+        if (g_app.procedural)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            g_generator.init(source.noise, &g_pool);
+            retained = g_generator.heightmap(source.x, source.y, source.width, source.height);
+            g_app.generatorMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            g_gl.textures[TEXTURE_HEIGHTMAP] = create_heightmap_texture(retained);
+
+            const TerrainGenerator::Stats stats = g_generator.stats();
+            LOG("Generated %ux%u procedural terrain (seed %u) in %.1f ms on %zu threads, %.2f Mtexels/s per core\n", source.width,
+                source.height, source.noise.seed, g_app.generatorMs, g_pool.threadCount(), stats.mtexelsPerCore());
+        }
+        else if (parseFeedSource(g_app.heightmapPath, feed))
+        {
+            if (!g_feed.attach(feed))
+                EXIT("No frames from height feed " + feed);
+            retained = g_feed.snapshot();
+            g_gl.textures[TEXTURE_HEIGHTMAP] = create_heightmap_texture(retained);
+            g_app.liveFeed = true;
+            LOG("Following height feed %s, %ux%u\n", feed.c_str(), g_feed.width(), g_feed.height());
+        }
+        else
+            g_gl.textures[TEXTURE_HEIGHTMAP] = create_texture_2d(g_app.heightmapPath, &retained);
+
+        // CPU height queries, with the filter that reproduces this device's texture() bit for bit
+        const glm::vec2 extent{static_cast<float>(retained.width), static_cast<float>(retained.height)};
+        auto field = std::make_shared<HeightField>(makeHeightField(std::move(retained), glm::vec2{-0.5f * extent.x, -0.5f * extent.y}, extent));
+        const HeightFilterCheck check = checkHeightFilters(g_gl.textures[TEXTURE_HEIGHTMAP], *field, g_app.shaderDir, 4096);
+        field->filter = check.best();
+        LOG("Height queries use the %s filter, %zu of %zu probes differ from the GPU (max %g)\n", heightFilterName(field->filter),
+            check.mismatches[static_cast<size_t>(field->filter)], check.samples, check.maxError[static_cast<size_t>(field->filter)]);
+        if (g_app.liveFeed)
+            g_feed.track(field, &g_pool);
+        publishHeightField(std::move(field));
+    }
+
+    struct Vertex
+    {
+        float pos[3];
+        float uv[2];
+
+        Vertex()
+            : pos{0.0f, 0.0f, 0.0f}, uv{0.0f, 0.0f}
+        {
+        }
+
+        Vertex(float x, float y, float z, float u, float v)
+            : pos{x, y, z}, uv{u, v}
+        {
+        }
+    };
+
+    // create test patch
+    {
+        PROFILE_CPU("init/test_patch");
+        constexpr size_t vertex_count = 4;
+        std::array<Vertex, vertex_count> vertices;
+
+        constexpr float dim = 5;
+        constexpr float half_dim = dim / 2.0f;
+
+        vertices[0] = {-half_dim, -half_dim, 0.0f, 0.0f, 0.0f};
+        vertices[1] = { half_dim, -half_dim, 0.0f, 1.0f, 0.0f};
+        vertices[2] = {-half_dim,  half_dim, 0.0f, 0.0f, 1.0f};
+        vertices[3] = { half_dim,  half_dim, 0.0f, 1.0f, 1.0f};
+
+        glGenVertexArrays(1, &g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST]);
+        glGenBuffers(1, &g_gl.buffers[BUFFER_PATCH_TEST_VERTEX]);
+
+        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST]);
+
+        glBindBuffer(GL_ARRAY_BUFFER, g_gl.buffers[BUFFER_PATCH_TEST_VERTEX]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0u);
+        glVertexAttribPointer(0u, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
+
+        glEnableVertexAttribArray(1u);
+        glVertexAttribPointer(1u, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+
+        glBindVertexArray(0u);
+        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+        glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
+
+        g_app.test_vertex_count = vertex_count;
+    }
+
+    // create mesh
+    {
+        PROFILE_CPU("init/mesh");
+
+        constexpr size_t patch_resolution = 20;
+        constexpr size_t vertex_count = patch_resolution * patch_resolution * 4;
+        std::array<Vertex, vertex_count> vertices;
+
+        const float res = static_cast<float>(patch_resolution);
+        const float x_dim = static_cast<float>(g_app.heightmap_x_dim);
+        const float y_dim = static_cast<float>(g_app.heightmap_y_dim);
+        const float half_x_dim = x_dim / 2.0f;
+        const float half_y_dim = y_dim / 2.0f;
+
+        size_t v_idx = 0;
+        for (size_t y = 0; y < patch_resolution; ++y)
+        {
+            for (size_t x = 0; x < patch_resolution; ++x)
+            {
+                // bottom-left
+                vertices[v_idx++] = {
+                    -half_x_dim + x_dim * x / res, // x
+                    0.0f,                          // y
+                    -half_y_dim + y_dim * y / res, // z
+                    x / res,                       // u
+                    y / res};                      // v
+
+                // bottom-right
+                vertices[v_idx++] = {
+                    -half_x_dim + x_dim * (x + 1) / res, // x
+                    0.0f,                                // y
+                    -half_y_dim + y_dim * y / res,       // z
+                    (x + 1) / res,                       // u
+                    y / res};                            // v
+
+                // top-left
+                vertices[v_idx++] = {
+                    -half_x_dim + x_dim * x / res,       // x
+                    0.0f,                                // y
+                    -half_y_dim + y_dim * (y + 1) / res, // z
+                    x / res,                             // u
+                    (y + 1) / res};                      // v
+
+                // top-right
+                vertices[v_idx++] = {
+                    -half_x_dim + x_dim * (x + 1) / res, // x
+                    0.0f,                                // y
+                    -half_y_dim + y_dim * (y + 1) / res, // z
+                    (x + 1) / res,                       // u
+                    (y + 1) / res};                      // v
+            }
+        }
+
+        assert(v_idx == vertex_count);
+
+        glGenVertexArrays(1, &g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
+        glGenBuffers(1, &g_gl.buffers[BUFFER_PATCH_VERTEX]);
+
+        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
+
+        glBindBuffer(GL_ARRAY_BUFFER, g_gl.buffers[BUFFER_PATCH_VERTEX]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0u);
+        glVertexAttribPointer(0u, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
+
+        glEnableVertexAttribArray(1u);
+        glVertexAttribPointer(1u, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+
+        glBindVertexArray(0u);
+        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+        glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
+
+        g_app.vertex_count = vertex_count;
+    }
+
+    {
+    PROFILE_CPU("init/patches");
+    unsigned rez = 20;
+    const std::vector<float> vertices = buildPatchGrid(static_cast<float>(g_app.heightmap_x_dim), static_cast<float>(g_app.heightmap_y_dim), rez);
+    std::cout << "Loaded " << rez*rez << " patches of 4 control points each" << std::endl;
+    std::cout << "Processing " << rez*rez*4 << " vertices in vertex shader" << std::endl;
+
+    // first, configure the cube's VAO (and terrainVBO)
+    unsigned int terrainVAO, terrainVBO;
+    glGenVertexArrays(1, &terrainVAO);
+    glBindVertexArray(terrainVAO);
+
+    glGenBuffers(1, &terrainVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // texCoord attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(sizeof(float) * 3));
+    glEnableVertexAttribArray(1);
+
+    glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
+
+    g_gl.buffers[BUFFER_PATCH_VERTEX] = terrainVBO;
+    g_gl.vertexArrays[VERTEXARRAY_PATCHES] = terrainVAO;
+
+    std::vector<glm::vec3> controlPoints;
+    for (size_t i = 0; i < vertices.size(); i += 5)
+        controlPoints.emplace_back(vertices[i], vertices[i + 1], vertices[i + 2]);
+
+    {
+        PROFILE_CPU("init/tess_cache");
+        g_tessCache.init(g_gl.programs[PROGRAM_TESS_CAPTURE], g_gl.programs[PROGRAM_TESS_CACHED], controlPoints, g_app.tessCacheBytes);
+    }
+
+    for (size_t i = 0; i < controlPoints.size(); i += NUM_PATCH_PTS)
+        g_app.patchCenters.push_back((controlPoints[i] + controlPoints[i + 1] + controlPoints[i + 2] + controlPoints[i + 3]) * 0.25f);
+    }
+
+    {
+        PROFILE_CPU("init/terrain_maps");
+        create_terrain_maps(*currentHeightField());
+    }
+    {
+        PROFILE_CPU("init/horizon_map");
+        create_horizon_map(*currentHeightField());
+    }
+    g_queue.init(g_pool.threadCount(), g_app.patchCenters.size() + 64u);
+
+    g_perf.init();
+    g_perf.trackTexture("heightmap", g_gl.textures[TEXTURE_HEIGHTMAP]);
+    g_perf.trackTexture("terrain_normals", g_gl.textures[TEXTURE_NORMALS]);
+    g_perf.trackTexture("terrain_surface", g_gl.textures[TEXTURE_SURFACE]);
+    g_perf.trackTexture("horizon_0", g_gl.textures[TEXTURE_HORIZON_0]);
+    g_perf.trackTexture("horizon_1", g_gl.textures[TEXTURE_HORIZON_1]);
+    g_perf.trackBuffer("patch_vertices", g_gl.buffers[BUFFER_PATCH_VERTEX]);
+    g_perf.trackBuffer("test_patch_vertices", g_gl.buffers[BUFFER_PATCH_TEST_VERTEX]);
+    g_perf.trackBuffer("tess_cache", g_tessCache.buffer);
+    g_perf.trackBuffer("stream_ring", g_stream.buffer);
+    g_perf.refreshMemory();
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+// band_tess_level() of the coarsest band must stay above 0 or its patches are discarded
+constexpr int MIN_BUDGET_TESS_LEVEL = 4;
+
+static void resolveFrameLod()
+{
+    float detail = 1.0f;
+    if (g_app.lodBudget)
+    {
+        const PerfMonitor::PassSample &sample = g_perf.terrain;
+        g_budget.update(sample.frame, sample.gpuMs, sample.primitives, g_perf.nextFrame());
+        detail = g_budget.detail;
+    }
+
+    g_app.frameMaxTessLevel = std::clamp(static_cast<int>(std::lround(g_app.maxTessLevel * detail)),
+                                         std::min(g_app.maxTessLevel, MIN_BUDGET_TESS_LEVEL), 64);
+    g_app.frameLodRanges = g_app.lodRanges * detail;
+}
+
+// per-frame uniforms go through the stream ring, no implicit sync on rewrite
+void uploadFrameUniforms()
+{
+    resolveFrameLod();
+
+    StreamRing::Allocation alloc = g_stream.allocate(sizeof(FrameUniforms), static_cast<size_t>(g_app.uniformAlignment));
+    FrameUniforms *uniforms = static_cast<FrameUniforms *>(alloc.ptr);
+    uniforms->viewMatrix = g_camera.view;
+    uniforms->projMatrix = g_camera.projection;
+    uniforms->minTessLevel = g_app.minTessLevel;
+    uniforms->maxTessLevel = g_app.frameMaxTessLevel;
+    uniforms->minRange = g_app.minRange;
+    uniforms->maxRange = g_app.maxRange;
+    uniforms->showDebugLOD = g_app.showDebugLOD;
+    uniforms->lodRanges = g_app.frameLodRanges;
+    uniforms->showViewshed = g_app.showViewshed && g_gl.textures[TEXTURE_VIEWSHED] != 0u;
+    uniforms->viewshedRect = g_app.viewshedRect;
+    uniforms->shading = g_app.shading;
+    uniforms->shadows = g_app.shadows;
+    const float azimuth = glm::radians(g_app.sunAzimuth), elevation = glm::radians(g_app.sunElevation);
+    uniforms->lightDir = {glm::cos(azimuth) * glm::cos(elevation), glm::sin(elevation), -glm::sin(azimuth) * glm::cos(elevation),
+                          glm::radians(g_app.sunRadius)};
+    uniforms->terrainRect = g_app.terrainRect;
+    glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, g_stream.buffer, alloc.offset, alloc.size);
+}
+
+void updateTessCache()
+{
+    PROFILE_CPU("tess_cache/update");
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_HEIGHTMAP]);
+    g_tessCache.update(g_camera.pos, g_app.frameMaxTessLevel, g_app.frameLodRanges, g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
+}
+
+static void drawTessCache(void *)
+{
+    g_tessCache.draw(g_gl.programs[PROGRAM_DEFAULT], g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
+}
+
+// terrain patch draws are recorded by the worker pool into per-thread arenas
+static void recordFrame()
+{
+    PROFILE_CPU("render/record");
+
+    g_queue.beginFrame();
+    CommandArena &arena = g_queue.arena(0);
+
+    uint64_t sequence = 0;
+    const auto setupKey = [&sequence]() { return make_sort_key(LAYER_SETUP, 0u, sequence++); };
+
+    g_queue.polygonMode(arena, setupKey(), g_app.wireframe ? GL_LINE : GL_FILL);
+    g_queue.clear(arena, setupKey(), 0.12f, 0.63f, 0.22f, 1.0f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    g_queue.bindTexture(arena, setupKey(), 0u, g_gl.textures[TEXTURE_HEIGHTMAP]);
+    if (g_app.showViewshed)
+        g_queue.bindTexture(arena, setupKey(), 1u, g_gl.textures[TEXTURE_VIEWSHED]);
+    if (g_app.shading != 0)
+    {
+        g_queue.bindTexture(arena, setupKey(), 2u, g_gl.textures[TEXTURE_NORMALS]);
+        g_queue.bindTexture(arena, setupKey(), 3u, g_gl.textures[TEXTURE_SURFACE]);
+    }
+    if (g_app.shadows)
+    {
+        g_queue.bindTexture(arena, setupKey(), 4u, g_gl.textures[TEXTURE_HORIZON_0]);
+        g_queue.bindTexture(arena, setupKey(), 5u, g_gl.textures[TEXTURE_HORIZON_1]);
+    }
+    // set_uni_float(g_gl.programs[PROGRAM_DEFAULT], "u_heightScale", g_app.heightScale);
+
+    if (g_app.renderType == 0)
+    {
+        g_queue.draw(arena, make_sort_key(LAYER_OPAQUE, PROGRAM_DEFAULT, 0u), g_gl.programs[PROGRAM_DEFAULT],
+                     g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST], GL_PATCHES, 0, static_cast<GLsizei>(g_app.test_vertex_count));
+    }
+    else if (g_app.tessCache)
+    {
+        g_queue.callback(arena, make_sort_key(LAYER_OPAQUE, PROGRAM_TESS_CACHED, 0u), &drawTessCache, nullptr);
+    }
+    else
+    {
+        const glm::vec3 cameraPos = g_camera.pos;
+        const GLuint program = g_gl.programs[PROGRAM_DEFAULT];
+        const GLuint vertexArray = g_gl.vertexArrays[VERTEXARRAY_PATCHES];
+
+        // one draw per patch, sorted front to back during the merge
+        const auto recordPatches = [&](size_t begin, size_t end, size_t worker) {
+            PROFILE_CPU("record_patches");
+            CommandArena &workerArena = g_queue.arena(worker);
+            for (size_t patch = begin; patch < end; ++patch)
+            {
+                const float depth = glm::length(g_app.patchCenters[patch] - cameraPos);
+                g_queue.draw(workerArena, make_sort_key(LAYER_OPAQUE, PROGRAM_DEFAULT, depth_sort_bits(depth)), program,
+                             vertexArray, GL_PATCHES, static_cast<GLint>(patch * NUM_PATCH_PTS), NUM_PATCH_PTS);
+            }
+        };
+
+        if (g_app.threadedRecording)
+            g_pool.parallelFor(g_app.patchCenters.size(), g_app.recordGrain, recordPatches);
+        else
+            recordPatches(0u, g_app.patchCenters.size(), 0u);
+    }
+
+    const auto sortArenas = [](size_t begin, size_t end, size_t) {
+        PROFILE_CPU("sort_arenas");
+        for (size_t a = begin; a < end; ++a)
+            g_queue.sortArena(a);
+    };
+
+    if (g_app.threadedRecording)
+        g_pool.parallelFor(g_queue.arenas.size(), 1u, sortArenas);
+    else
+        sortArenas(0u, g_queue.arenas.size(), 0u);
+}
+
+void uploadViewshed(const Viewshed &viewshed, const HeightField &field)
+{
+    if (g_gl.textures[TEXTURE_VIEWSHED] == 0u)
+    {
+        glGenTextures(1, &g_gl.textures[TEXTURE_VIEWSHED]);
+        glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_VIEWSHED]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // rows of one byte texels are not 4 byte aligned in general
+    glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_VIEWSHED]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, static_cast<GLsizei>(viewshed.width), static_cast<GLsizei>(viewshed.height), 0, GL_RED,
+                 GL_UNSIGNED_BYTE, viewshed.visible.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0u);
+
+    g_app.viewshedRect = viewshed.worldRect(field);
+    g_app.showViewshed = true;
+}
+
+static void upload_height_rect(const HeightField &field, const TexelRect &rect)
+{
+    // the shaders read green only, the gray texel keeps the texture looking like the source image
+    const uint32_t width = rect.x1 - rect.x0 + 1;
+    stream_texture_rect(g_gl.textures[TEXTURE_HEIGHTMAP], 0, GL_RGBA, GL_UNSIGNED_BYTE, 4u, rect, [&](uint8_t *out, uint32_t y0, uint32_t rows) {
+        for (uint32_t y = y0; y < y0 + rows; ++y)
+        {
+            const uint8_t *row = field.texels.row(y) + rect.x0;
+            for (uint32_t x = 0; x < width; ++x, out += 4)
+            {
+                out[0] = out[1] = out[2] = row[x];
+                out[3] = 255u;
+            }
+        }
+    });
+
+    // the differences reach one texel further, the mips cover the rect at their scale
+    upload_terrain_maps(updateTerrainMaps(g_terrainMaps, field, rect, &g_pool));
+
+    // bilinear filtering reaches one texel beyond the rect
+    const glm::vec2 texel{field.extent.x / static_cast<float>(field.width), field.extent.y / static_cast<float>(field.height)};
+    const glm::vec2 min{field.origin.x + (static_cast<float>(rect.x0) - 1.0f) * texel.x, field.origin.y + (static_cast<float>(rect.y0) - 1.0f) * texel.y};
+    const glm::vec2 max{field.origin.x + (static_cast<float>(rect.x1) + 2.0f) * texel.x, field.origin.y + (static_cast<float>(rect.y1) + 2.0f) * texel.y};
+    g_tessCache.invalidate(min, max);
+}
+
+void uploadHeightRects(const HeightField &field, const std::vector<TexelRect> &rects)
+{
+    if (rects.empty())
+        return;
+    PROFILE_CPU("render/upload_height");
+
+    TexelRect &stale = g_app.horizonStale;
+    for (const TexelRect &rect : rects)
+    {
+        upload_height_rect(field, rect);
+        stale = g_app.horizonOutdated ? TexelRect{std::min(stale.x0, rect.x0), std::min(stale.y0, rect.y0), std::max(stale.x1, rect.x1),
+                                                  std::max(stale.y1, rect.y1)}
+                                      : rect;
+        g_app.horizonOutdated = true;
+    }
+
+    // horizons reach far: one sweep over the rects of a stroke step, and none while no shadows are drawn
+    if (g_app.shadows)
+        refreshHorizonMap(field);
+}
+
+void refreshHorizonMap(const HeightField &field)
+{
+    if (!g_app.horizonOutdated)
+        return;
+    upload_horizon_map(updateHorizonMap(g_horizonMap, field, g_app.horizonStale, &g_pool));
+    g_app.horizonOutdated = false;
+}
+
+void updateHeightFeed()
+{
+    if (!g_app.liveFeed)
+        return;
+    PROFILE_CPU("render/height_feed");
+
+    // the last upload has been drawn by the frame submitted since, nothing of this frame is recorded yet
+    if (!g_feedInFlight.empty() && !g_feedInFlight.back().fence)
+        g_feedInFlight.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // polled, not waited on: a sample runs up to the frame that notices the fence
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    while (!g_feedInFlight.empty() && g_feedInFlight.front().fence)
+    {
+        const GLenum state = glClientWaitSync(g_feedInFlight.front().fence, 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(g_feedInFlight.front().fence);
+        g_app.feedLatencies[g_app.feedLatencyHead] = static_cast<float>(now - g_feedInFlight.front().writeNanos) * 1e-6f;
+        g_app.feedLatencyHead = (g_app.feedLatencyHead + 1) % AppManager::FEED_LATENCIES;
+        ++g_app.feedDrawn;
+        g_feedInFlight.erase(g_feedInFlight.begin());
+    }
+
+    std::vector<TexelRect> rects;
+    int64_t writeNanos = 0;
+    if (std::shared_ptr<const HeightField> field = g_feed.update(rects, writeNanos))
+    {
+        uploadHeightRects(*field, rects);
+        publishHeightField(std::move(field));
+        g_feedInFlight.push_back({writeNanos, nullptr});
+    }
+}
+
+/**
+ * @brief Records the frame into the render queue and replays it. All GL
+ * calls happen on this thread during replay.
+ */
+void render()
+{
+    const auto recordStart = std::chrono::steady_clock::now();
+
+    recordFrame();
+
+    const auto replayStart = std::chrono::steady_clock::now();
+
+    {
+        PROFILE_CPU("render/replay");
+        g_queue.replay();
+    }
+
+    const auto replayEnd = std::chrono::steady_clock::now();
+    g_app.recordMs = std::chrono::duration<float, std::milli>(replayStart - recordStart).count();
+    g_app.replayMs = std::chrono::duration<float, std::milli>(replayEnd - replayStart).count();
+}
+
+void release()
+{
+    g_perf.release();
+    g_frameGraph.release();
+    g_tessCache.release();
+    g_stream.release();
+    g_generator.release();
+    for (const FeedInFlight &frame : g_feedInFlight)
+        if (frame.fence)
+            glDeleteSync(frame.fence);
+    g_feedInFlight.clear();
+    g_feed.release();
+    g_pool.release();
+    publishHeightField(nullptr);
+}
+
+/**
+ * @brief Declares the frame's passes and what they touch, the frame graph
+ * derives order, barriers and transient allocations from it. The target is
+ * whatever framebuffer is bound when the graph executes.
+ */
+void setupFrameGraph()
+{
+    g_frameGraph.init();
+
+    const FrameGraph::Handle backbuffer = g_frameGraph.importTexture("backbuffer", 0u, true);
+    const FrameGraph::Handle heightmap = g_frameGraph.importTexture("heightmap", g_gl.textures[TEXTURE_HEIGHTMAP]);
+    const FrameGraph::Handle normals = g_frameGraph.importTexture("terrain_normals", g_gl.textures[TEXTURE_NORMALS]);
+    const FrameGraph::Handle surface = g_frameGraph.importTexture("terrain_surface", g_gl.textures[TEXTURE_SURFACE]);
+    const FrameGraph::Handle horizon0 = g_frameGraph.importTexture("horizon_0", g_gl.textures[TEXTURE_HORIZON_0]);
+    const FrameGraph::Handle horizon1 = g_frameGraph.importTexture("horizon_1", g_gl.textures[TEXTURE_HORIZON_1]);
+    const FrameGraph::Handle frameUniforms = g_frameGraph.importBuffer("frame_uniforms", g_stream.buffer);
+    const FrameGraph::Handle tessCache = g_frameGraph.importBuffer("tess_cache", g_tessCache.buffer);
+
+    g_passes.frameSetup = g_frameGraph.addPass("frame_setup", &uploadFrameUniforms);
+    g_frameGraph.write(g_passes.frameSetup, frameUniforms, ACCESS_HOST_WRITE);
+
+    g_passes.tessCapture = g_frameGraph.addPass("tess_capture", &updateTessCache);
+    g_frameGraph.read(g_passes.tessCapture, frameUniforms, ACCESS_UNIFORM);
+    g_frameGraph.read(g_passes.tessCapture, heightmap, ACCESS_SAMPLED);
+    g_frameGraph.write(g_passes.tessCapture, tessCache, ACCESS_TRANSFORM_FEEDBACK);
+
+    g_passes.terrain = g_frameGraph.addPass("terrain", [] {
+        // the LOD budget controller reads its GPU time and primitives from these queries
+        if (!g_app.perfQueries && !g_app.lodBudget)
+            return render();
+
+        g_perf.beginQueries();
+        render();
+        g_perf.endQueries();
+    });
+    g_frameGraph.read(g_passes.terrain, frameUniforms, ACCESS_UNIFORM);
+    g_frameGraph.read(g_passes.terrain, heightmap, ACCESS_SAMPLED);
+    g_frameGraph.read(g_passes.terrain, normals, ACCESS_SAMPLED);
+    g_frameGraph.read(g_passes.terrain, surface, ACCESS_SAMPLED);
+    g_frameGraph.read(g_passes.terrain, horizon0, ACCESS_SAMPLED);
+    g_frameGraph.read(g_passes.terrain, horizon1, ACCESS_SAMPLED);
+    g_frameGraph.read(g_passes.terrain, tessCache, ACCESS_VERTEX);
+    g_frameGraph.write(g_passes.terrain, backbuffer, ACCESS_COLOR_ATTACHMENT | ACCESS_DEPTH_ATTACHMENT);
+}
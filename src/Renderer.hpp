@@ -0,0 +1,213 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FrameGraph.hpp"
+#include "HeightFeed.hpp"
+#include "Heightmap.hpp"
+#include "HorizonMap.hpp"
+#include "LodBudget.hpp"
+#include "PerfMonitor.hpp"
+#include "RenderQueue.hpp"
+#include "StreamRing.hpp"
+#include "TerrainGenerator.hpp"
+#include "TerrainMaps.hpp"
+#include "TessCache.hpp"
+#include "TessLod.hpp"
+#include "WorkerPool.hpp"
+
+struct HeightField;
+struct Viewshed;
+
+constexpr uint32_t VIEWER_WIDTH = 900u;
+constexpr uint32_t VIEWER_HEIGHT = 700u;
+constexpr uint32_t NUM_PATCH_PTS = 4u;
+
+enum
+{
+    PROGRAM_DEFAULT = 0,
+    PROGRAM_TESS_CAPTURE = 1,
+    PROGRAM_TESS_CACHED = 2,
+    PROGRAM_COUNT
+};
+
+enum
+{
+    TEXTURE_HEIGHTMAP = 0,
+    TEXTURE_VIEWSHED = 1,
+    TEXTURE_NORMALS = 2,
+    TEXTURE_SURFACE = 3,
+    TEXTURE_HORIZON_0 = 4, // horizon directions 0 - 3
+    TEXTURE_HORIZON_1 = 5, // horizon directions 4 - 7
+    TEXTURE_COUNT
+};
+
+enum
+{
+    VERTEXARRAY_PATCH_TEST = 0,
+    VERTEXARRAY_PATCHES = 1,
+    VERTEXARRAY_COUNT
+};
+
+enum
+{
+    BUFFER_PATCH_TEST_VERTEX = 0,
+    BUFFER_PATCH_VERTEX = 1,
+    BUFFER_COUNT
+};
+
+struct OpenGLManager
+{
+    GLuint programs[PROGRAM_COUNT];
+    GLuint textures[TEXTURE_COUNT];
+    GLuint vertexArrays[VERTEXARRAY_COUNT];
+    GLuint buffers[BUFFER_COUNT];
+};
+
+extern OpenGLManager g_gl;
+
+struct CameraManager
+{
+    float pitch = 0.0f; // degrees
+    float yaw = 90.0f;  // degrees
+
+    glm::vec3 pos{0.0, 0.0, 50.0};
+    glm::vec3 forward{0.0f, 0.0f, -1.0f};
+
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+};
+
+extern CameraManager g_camera;
+
+struct AppManager
+{
+    std::string shaderDir = "../src/shaders/";
+    std::string heightmapPath = "../assets/test3.png";
+    std::string calibrationPath = "tess_profiles.txt"; // calibrated tess settings per GPU / driver
+    std::string calibrationCameraPath = "../assets/paths/flyover.cam";
+    uint32_t viewerWidth = VIEWER_WIDTH;
+    uint32_t viewerHeight = VIEWER_HEIGHT;
+
+    size_t heightmap_x_dim = 0;
+    size_t heightmap_y_dim = 0;
+    size_t test_vertex_count = 0;
+    size_t vertex_count = 0;
+
+    bool wireframe = false;
+    bool showDebugLOD = false;
+    float heightScale = 1.0f;
+    int renderType = 0; // 0 = test, 1 = scene
+    int minTessLevel = 8;
+    int maxTessLevel = 64;
+    float minRange = 50.0f;  // Min LOD up to ...
+    float maxRange = 500.0f; // Max LOD after ...
+    glm::vec4 lodRanges = scaled_lod_ranges(1.0f);
+
+    // what the current frame renders with, the settings above scaled by g_budget when lodBudget is on
+    bool lodBudget = false;
+    int frameMaxTessLevel = 64;
+    glm::vec4 frameLodRanges = scaled_lod_ranges(1.0f);
+
+    bool tessCache = false;
+    size_t tessCacheBytes = 128u << 20u;
+    size_t streamRingBytes = 8u << 20u;
+    GLint uniformAlignment = 256;
+
+    std::vector<glm::vec3> patchCenters;
+    bool threadedRecording = true;
+    size_t recordGrain = 32;
+    float recordMs = 0.0f;
+    float replayMs = 0.0f;
+
+    bool perfQueries = false; // pipeline statistics around the terrain pass, issued for lodBudget as well
+
+    bool showViewshed = false;       // overlay TEXTURE_VIEWSHED, filled by uploadViewshed()
+    glm::vec4 viewshedRect{0.0f};    // world xz min corner and size it covers
+
+    TerrainMapSettings terrainMaps;  // TEXTURE_NORMALS / TEXTURE_SURFACE, read at init
+    int shading = 0;                 // 0 = height, 1 = lit, 2 = slope, 3 = curvature
+    float sunAzimuth = 135.0f;       // degrees, counter-clockwise from +x like the camera yaw
+    float sunElevation = 35.0f;      // degrees
+    glm::vec4 terrainRect{0.0f};     // world xz min corner and size the heightmap covers
+    float terrainMapsMs = 0.0f;      // last full build
+
+    HorizonSettings horizon;         // TEXTURE_HORIZON_*, read at init
+    bool shadows = false;            // soft sun shadows from the horizon map
+    float sunRadius = 2.0f;          // degrees, widens the penumbra
+    float horizonMs = 0.0f;          // last full build
+    bool horizonOutdated = false;    // edits not swept yet, refreshHorizonMap() catches up
+    TexelRect horizonStale;          // bounds of those edits
+
+    bool procedural = false;         // heightmapPath named a window of g_generator
+    float generatorMs = 0.0f;        // wall time of that window
+
+    bool liveFeed = false;           // heightmapPath named a feed, updateHeightFeed() follows it
+    static constexpr size_t FEED_LATENCIES = 1024;
+    float feedLatencies[FEED_LATENCIES] = {}; // ring of the latest, ms from the producer publishing a frame to the GPU finishing the first frame that drew it
+    size_t feedLatencyHead = 0;       // next write position
+    uint64_t feedDrawn = 0;           // feed frames drawn, the ring holds the last min(feedDrawn, FEED_LATENCIES)
+};
+
+extern AppManager g_app;
+
+struct PassManager
+{
+    size_t frameSetup = 0;
+    size_t tessCapture = 0;
+    size_t terrain = 0;
+    size_t gui = 0;
+};
+
+extern PassManager g_passes;
+
+extern TessCache g_tessCache;
+extern StreamRing g_stream;
+extern WorkerPool g_pool;
+extern RenderQueue g_queue;
+extern FrameGraph g_frameGraph;
+extern PerfMonitor g_perf;
+extern LodBudget g_budget;
+extern TerrainMaps g_terrainMaps;
+extern HorizonMap g_horizonMap;
+extern TerrainGenerator g_generator;
+extern HeightFeed g_feed;
+
+void updateCameraMatrix();
+void setCameraOrientation(float yawDegrees, float pitchDegrees);
+
+// retained, if given, receives the green channel the shaders sample
+GLuint create_texture_2d(const std::string tex_filepath, Heightmap *retained = nullptr);
+
+// the same texture from texels already in memory, gray in every channel like a one channel image
+GLuint create_heightmap_texture(const Heightmap &heightmap);
+
+// R8 overlay of a computed viewshed, shown from the next frame on
+void uploadViewshed(const Viewshed &viewshed, const HeightField &field);
+
+// copies rects of the field's texels into the heightmap through the stream ring, rebuilds the terrain and horizon maps over them and re-tessellates the patches over them, call before the frame records
+void uploadHeightRects(const HeightField &field, const std::vector<TexelRect> &rects);
+
+// sweeps the horizons over the edits uploadHeightRects() deferred while the shadows were off
+void refreshHorizonMap(const HeightField &field);
+
+// uploads and publishes what changed in the newest feed frame, and times the frames drawn since; call before the frame records
+void updateHeightFeed();
+
+// loads shaders + heightmap from g_app paths and builds the patch grid, needs a current GL 4.5 context
+void init();
+void render();
+void release();
+
+void uploadFrameUniforms();
+void updateTessCache();
+
+// declares frame_setup, tess_capture and terrain, callers append their own passes (e.g. gui)
+void setupFrameGraph();
+
+#endif // RENDERER_HPP
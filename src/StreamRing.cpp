@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "StreamRing.hpp"
+#include "Defines.hpp"
+
+void StreamRing::init(size_t capacityBytes)
+{
+    // keep the wrap point aligned for every alignment we hand out
+    capacity = (capacityBytes + MIN_ALIGNMENT - 1) & ~(MIN_ALIGNMENT - 1);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+    mapped = static_cast<uint8_t *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+    if (!mapped)
+        EXIT("Failed to persistently map stream ring");
+
+    writePos = 0;
+    readPos = 0;
+    stats = {};
+}
+
+void StreamRing::release()
+{
+    for (const Fence &fence : fences)
+        glDeleteSync(fence.sync);
+    fences.clear();
+
+    if (buffer)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    buffer = 0;
+    mapped = nullptr;
+}
+
+StreamRing::Allocation StreamRing::allocate(size_t size, size_t alignment)
+{
+    if (size > capacity)
+        EXIT("Stream ring allocation of " + std::to_string(size) + " bytes exceeds capacity");
+
+    if (alignment < MIN_ALIGNMENT)
+        alignment = MIN_ALIGNMENT;
+
+    retire(false);
+
+    size_t offset = static_cast<size_t>(writePos % capacity);
+    size_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+
+    // never straddle the end, skip to the start of the buffer instead
+    const bool wrap = offset + padding + size > capacity;
+    if (wrap)
+    {
+        padding = capacity - offset;
+        ++stats.wraps;
+    }
+
+    // bytes free right where the allocation would start
+    const auto room = [&]() -> size_t {
+        const size_t inFlight = static_cast<size_t>(writePos - readPos);
+        if (!wrap)
+            return inFlight + padding < capacity ? capacity - inFlight - padding : 0u;
+        // the skipped tail is dead, what counts is the start of the buffer up to the oldest byte in flight
+        if (inFlight == 0)
+            return capacity;
+        const size_t readOffset = static_cast<size_t>(readPos % capacity);
+        return inFlight < capacity && readOffset <= offset ? readOffset : 0u;
+    };
+    while (room() < size)
+    {
+        if (fences.empty())
+            EXIT("Stream ring exhausted within a single frame, increase its capacity");
+        retire(true);
+    }
+
+    if (writePos == readPos)
+        readPos += padding;
+    writePos += padding;
+    offset = static_cast<size_t>(writePos % capacity);
+    writePos += size;
+
+    stats.frameBytes += padding + size;
+    ++stats.frameAllocations;
+
+    Allocation allocation;
+    allocation.ptr = mapped + offset;
+    allocation.offset = static_cast<GLintptr>(offset);
+    allocation.size = static_cast<GLsizeiptr>(size);
+    return allocation;
+}
+
+StreamRing::Allocation StreamRing::upload(const void *data, size_t size, size_t alignment)
+{
+    Allocation allocation = allocate(size, alignment);
+    std::memcpy(allocation.ptr, data, size);
+    return allocation;
+}
+
+void StreamRing::endFrame()
+{
+    fences.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), writePos});
+
+    stats.peakFrameBytes = std::max(stats.peakFrameBytes, stats.frameBytes);
+    stats.frameBytes = 0;
+    stats.frameAllocations = 0;
+}
+
+/**
+ * @brief Reclaims space of finished frames. Without wait only fences that
+ * already signaled are consumed, with wait the oldest fence is blocked on.
+ */
+void StreamRing::retire(bool wait)
+{
+    while (!fences.empty())
+    {
+        const Fence &fence = fences.front();
+
+        GLenum status = glClientWaitSync(fence.sync, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED && wait)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            do
+            {
+                status = glClientWaitSync(fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000u);
+            } while (status == GL_TIMEOUT_EXPIRED);
+
+            ++stats.stalls;
+            stats.stallNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        if (status == GL_WAIT_FAILED)
+            EXIT("glClientWaitSync failed on stream ring fence");
+
+        readPos = std::max(readPos, fence.writePos); // an idle wrap may have moved past it
+        glDeleteSync(fence.sync);
+        fences.pop_front();
+
+        // a single blocking retire frees one frame, the caller re-checks the space
+        if (wait)
+            return;
+    }
+}
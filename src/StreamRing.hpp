@@ -0,0 +1,69 @@
+#ifndef STREAM_RING_HPP
+#define STREAM_RING_HPP
+
+#include <cstdint>
+#include <deque>
+
+#include <glad/glad.h>
+
+/**
+ * @brief Persistently + coherently mapped ring buffer for every per-frame
+ * upload (uniforms, patch lists, indirect commands, height tiles). Space is
+ * handed out linearly and reclaimed when the fence placed at the end of the
+ * frame that used it has signaled, so writes never trigger an implicit sync.
+ */
+struct StreamRing
+{
+    struct Allocation
+    {
+        void *ptr = nullptr; // CPU write pointer
+        GLintptr offset = 0; // offset into buffer, for glBindBufferRange / glBindVertexBuffer / indirect
+        GLsizeiptr size = 0;
+    };
+
+    struct Stats
+    {
+        uint64_t stalls = 0;      // allocations that had to block on a fence
+        uint64_t stallNanos = 0;  // total time spent blocked
+        uint64_t wraps = 0;
+        size_t frameBytes = 0;    // bytes handed out since the last endFrame()
+        size_t frameAllocations = 0;
+        size_t peakFrameBytes = 0;
+    };
+
+    struct Fence
+    {
+        GLsync sync;
+        uint64_t writePos; // ring position reclaimed once sync signals
+    };
+
+    GLuint buffer = 0;
+    uint8_t *mapped = nullptr;
+    size_t capacity = 0;
+
+    // monotonic byte counters, physical offset = pos % capacity
+    uint64_t writePos = 0;
+    uint64_t readPos = 0;
+
+    std::deque<Fence> fences;
+    Stats stats;
+
+    static constexpr size_t MIN_ALIGNMENT = 256u;
+
+    void init(size_t capacityBytes);
+    void release();
+
+    // aligned sub-allocation, blocks on the oldest in-flight frame only when the ring is full
+    Allocation allocate(size_t size, size_t alignment = MIN_ALIGNMENT);
+
+    // copies data into a fresh allocation
+    Allocation upload(const void *data, size_t size, size_t alignment = MIN_ALIGNMENT);
+
+    // fences everything allocated this frame, call once after the frame's GL commands were issued
+    void endFrame();
+
+private:
+    void retire(bool wait);
+};
+
+#endif // STREAM_RING_HPP
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "TerrainEdit.hpp"
+#include "WorkerPool.hpp"
+
+// brushes at least this many texels split their rows over the pool
+constexpr size_t PARALLEL_DAB_TEXELS = 128u * 128u;
+constexpr size_t DAB_ROW_GRAIN = 8;
+
+// 4x4 ordered dither thresholds, centered in their sixteenths
+constexpr float BAYER[16] = {0.5f, 8.5f, 2.5f, 10.5f, 12.5f, 4.5f, 14.5f, 6.5f, 3.5f, 11.5f, 1.5f, 9.5f, 15.5f, 7.5f, 13.5f, 5.5f};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char *brushModeName(BrushMode mode)
+{
+    switch (mode)
+    {
+    case BrushMode::Raise:
+        return "raise";
+    case BrushMode::Lower:
+        return "lower";
+    case BrushMode::Smooth:
+        return "smooth";
+    case BrushMode::Flatten:
+        return "flatten";
+    default:
+        return "unknown";
+    }
+}
+
+void TerrainEditor::init(std::shared_ptr<const HeightField> field, WorkerPool *workers)
+{
+    working = *field;
+    pool = workers;
+    active = false;
+    dabIndex = 0;
+    dirty.clear();
+    ready.clear();
+    committed.clear();
+    strokeRects.clear();
+    published = field;
+    stroke = {};
+    history.init(working.texels);
+}
+
+void TerrainEditor::beginStroke(const Brush &settings, glm::vec2 position)
+{
+    brush = settings;
+    active = true;
+    stroke = {};
+    stroke.radius = brush.radius;
+
+    const float height = working.sample((position.x - working.origin.x) / working.extent.x, (position.y - working.origin.y) / working.extent.y);
+    flattenTexel = (height - HEIGHT_OFFSET) / (HEIGHT_SCALE / 255.0f);
+
+    dab(position);
+    last = position;
+}
+
+void TerrainEditor::strokeTo(glm::vec2 position)
+{
+    if (!active)
+        return;
+
+    // the remainder of the segment carries over, dabs stay evenly spaced across calls
+    const float step = std::max(brush.spacing * brush.radius, 1e-3f);
+    const glm::vec2 delta = position - last;
+    const float distance = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+    const int dabs = static_cast<int>(distance / step);
+    if (dabs == 0)
+        return;
+
+    const glm::vec2 start = last;
+    const glm::vec2 offset{delta.x * (step / distance), delta.y * (step / distance)};
+    for (int i = 1; i <= dabs; ++i)
+    {
+        last = glm::vec2{start.x + offset.x * static_cast<float>(i), start.y + offset.y * static_cast<float>(i)};
+        dab(last);
+    }
+}
+
+std::shared_ptr<const HeightField> TerrainEditor::endStroke()
+{
+    active = false;
+    updateBounds();
+    history.write(working.texels, strokeRects);
+    return snapshot(strokeRects);
+}
+
+std::shared_ptr<const HeightField> TerrainEditor::undo()
+{
+    return restore(&HeightTileStore::undo);
+}
+
+std::shared_ptr<const HeightField> TerrainEditor::redo()
+{
+    return restore(&HeightTileStore::redo);
+}
+
+std::shared_ptr<const HeightField> TerrainEditor::restore(bool (HeightTileStore::*step)(std::vector<TexelRect> &))
+{
+    std::vector<TexelRect> changed;
+    if (active || !(history.*step)(changed))
+        return nullptr;
+
+    // only the tiles that differ between the versions come back, bounds and upload follow them like a stroke
+    const std::shared_ptr<const HeightVersion> version = history.current();
+    for (const TexelRect &rect : changed)
+    {
+        version->read(rect, working.texels);
+        updateMinMaxPyramid(working.bounds, working.texels, rect.x0, rect.y0, rect.x1, rect.y1);
+        ready.push_back(rect);
+    }
+    return snapshot(changed);
+}
+
+std::shared_ptr<const HeightField> TerrainEditor::snapshot(std::vector<TexelRect> &changed)
+{
+    working.parent = published;
+    working.changed.swap(changed);
+    changed.clear();
+    std::shared_ptr<const HeightField> field = std::make_shared<const HeightField>(working);
+    working.parent.reset();
+    working.changed.clear();
+    published = field;
+    return field;
+}
+
+const std::vector<TexelRect> &TerrainEditor::commit()
+{
+    updateBounds();
+    committed.swap(ready);
+    ready.clear();
+    return committed;
+}
+
+void TerrainEditor::dab(glm::vec2 position)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // texel space, texel i centered on i
+    const float kx = static_cast<float>(working.width) / working.extent.x;
+    const float ky = static_cast<float>(working.height) / working.extent.y;
+    const float cx = (position.x - working.origin.x) * kx - 0.5f, cy = (position.y - working.origin.y) * ky - 0.5f;
+    const float rx = brush.radius * kx, ry = brush.radius * ky;
+    const int32_t lastX = static_cast<int32_t>(working.width) - 1, lastY = static_cast<int32_t>(working.height) - 1;
+
+    const int32_t x0 = std::max(static_cast<int32_t>(std::ceil(cx - rx)), 0), x1 = std::min(static_cast<int32_t>(std::floor(cx + rx)), lastX);
+    const int32_t y0 = std::max(static_cast<int32_t>(std::ceil(cy - ry)), 0), y1 = std::min(static_cast<int32_t>(std::floor(cy + ry)), lastY);
+    if (x0 > x1 || y0 > y1 || rx <= 0.0f || ry <= 0.0f)
+        return;
+
+    // Smooth averages the texels as they were, one texel around the rect with the field's edges clamped
+    const int32_t sourceWidth = x1 - x0 + 3;
+    if (brush.mode == BrushMode::Smooth)
+    {
+        source.resize(static_cast<size_t>(sourceWidth) * (y1 - y0 + 3));
+        for (int32_t y = y0 - 1; y <= y1 + 1; ++y)
+        {
+            const uint8_t *row = working.texels.row(static_cast<uint32_t>(std::clamp(y, 0, lastY)));
+            uint8_t *out = source.data() + static_cast<size_t>(y - y0 + 1) * sourceWidth;
+            for (int32_t x = x0 - 1; x <= x1 + 1; ++x)
+                out[x - x0 + 1] = row[std::clamp(x, 0, lastX)];
+        }
+    }
+
+    const float step = HEIGHT_SCALE / 255.0f;
+    const float blend = std::clamp(brush.strength, 0.0f, 1.0f);
+    const float hardness = std::clamp(brush.hardness, 0.0f, 0.999f);
+    const uint32_t shift = dabIndex++;
+
+    const auto rows = [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r)
+        {
+            const int32_t y = y0 + static_cast<int32_t>(r);
+            const float dy = (static_cast<float>(y) - cy) / ry;
+            uint8_t *row = working.texels.writableRow(static_cast<uint32_t>(y));
+            const float *dither = BAYER + ((static_cast<uint32_t>(y) + (shift >> 2)) & 3u) * 4u;
+
+            for (int32_t x = x0; x <= x1; ++x)
+            {
+                const float dx = (static_cast<float>(x) - cx) / rx;
+                const float d = std::sqrt(dx * dx + dy * dy);
+                if (d >= 1.0f)
+                    continue;
+
+                // full strength inside hardness, smoothstep to zero at the rim
+                const float t = d <= hardness ? 1.0f : (1.0f - d) / (1.0f - hardness);
+                const float weight = t * t * (3.0f - 2.0f * t);
+
+                const float h = static_cast<float>(row[x]);
+                float delta = 0.0f;
+                switch (brush.mode)
+                {
+                case BrushMode::Raise:
+                    delta = brush.strength / step * weight;
+                    break;
+                case BrushMode::Lower:
+                    delta = -brush.strength / step * weight;
+                    break;
+                case BrushMode::Flatten:
+                    delta = (flattenTexel - h) * blend * weight;
+                    break;
+                case BrushMode::Smooth:
+                {
+                    const uint8_t *s = source.data() + static_cast<size_t>(r) * sourceWidth + (x - x0);
+                    const uint32_t sum = s[0] + s[1] + s[2] + s[sourceWidth] + s[sourceWidth + 1] + s[sourceWidth + 2] +
+                                         s[2 * sourceWidth] + s[2 * sourceWidth + 1] + s[2 * sourceWidth + 2];
+                    delta = (static_cast<float>(sum) * (1.0f / 9.0f) - h) * blend * weight;
+                    break;
+                }
+                default:
+                    break;
+                }
+
+                const float threshold = dither[(static_cast<uint32_t>(x) + shift) & 3u] * (1.0f / 16.0f);
+                row[x] = static_cast<uint8_t>(std::clamp(std::floor(h + delta + threshold), 0.0f, 255.0f));
+            }
+        }
+    };
+
+    // bands still shared with a published snapshot are copied here, once, before the rows split over the pool
+    stroke.bandsCopied += working.texels.unshare(static_cast<uint32_t>(y0), static_cast<uint32_t>(y1));
+
+    const size_t rowCount = static_cast<size_t>(y1 - y0 + 1);
+    const TexelRect rect{static_cast<uint32_t>(x0), static_cast<uint32_t>(y0), static_cast<uint32_t>(x1), static_cast<uint32_t>(y1)};
+    if (pool && rect.area() >= PARALLEL_DAB_TEXELS)
+        pool->parallelFor(rowCount, DAB_ROW_GRAIN, rows);
+    else
+        rows(0u, rowCount, 0u);
+
+    dirty.push_back(rect);
+    ++stroke.dabs;
+    stroke.texels += rect.area();
+    stroke.applyMs += elapsed_ms(start);
+}
+
+void TerrainEditor::updateBounds()
+{
+    if (dirty.empty())
+        return;
+    const auto start = std::chrono::steady_clock::now();
+
+    // consecutive dabs overlap, fold a rect into another while the union wastes no more than the two cover
+    std::vector<TexelRect> merged;
+    for (const TexelRect &rect : dirty)
+    {
+        TexelRect current = rect;
+        for (size_t i = 0; i < merged.size();)
+        {
+            const TexelRect &other = merged[i];
+            const TexelRect both{std::min(current.x0, other.x0), std::min(current.y0, other.y0), std::max(current.x1, other.x1),
+                                 std::max(current.y1, other.y1)};
+            if (both.area() <= current.area() + other.area())
+            {
+                // the grown rect may now absorb ones it skipped
+                current = both;
+                merged[i] = merged.back();
+                merged.pop_back();
+                i = 0;
+                continue;
+            }
+            ++i;
+        }
+        merged.push_back(current);
+    }
+    dirty.clear();
+
+    for (const TexelRect &rect : merged)
+    {
+        updateMinMaxPyramid(working.bounds, working.texels, rect.x0, rect.y0, rect.x1, rect.y1);
+        stroke.dirtyTexels += rect.area();
+        ready.push_back(rect);
+        strokeRects.push_back(rect);
+    }
+    stroke.boundsMs += elapsed_ms(start);
+}
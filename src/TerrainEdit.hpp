@@ -0,0 +1,116 @@
+#ifndef TERRAIN_EDIT_HPP
+#define TERRAIN_EDIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+#include "HeightTiles.hpp"
+
+struct WorkerPool;
+
+enum class BrushMode : uint8_t
+{
+    Raise,
+    Lower,
+    Smooth,  // towards the 3x3 average
+    Flatten, // towards the height under the stroke's first dab
+    Count
+};
+
+const char *brushModeName(BrushMode mode);
+
+struct Brush
+{
+    BrushMode mode = BrushMode::Raise;
+    float radius = 32.0f;  // world units
+    float strength = 0.5f; // Raise / Lower: height per dab at the center, Smooth / Flatten: blend per dab in [0, 1]
+    float hardness = 0.5f; // inner fraction of the radius at full strength, the rest fades out
+    float spacing = 0.25f; // distance between dabs along a stroke, in radii
+};
+
+struct StrokeStats
+{
+    float radius = 0.0f; // world units
+    uint32_t dabs = 0;
+    size_t texels = 0;       // brushed, summed over dabs
+    size_t dirtyTexels = 0;  // committed, summed over commits
+    size_t bandsCopied = 0;  // texel bands unshared from published snapshots
+    double applyMs = 0.0;    // brush kernels
+    double boundsMs = 0.0;   // incremental min/max updates
+    double uploadMs = 0.0;   // added by whoever uploads the committed rects
+};
+
+/**
+ * @brief Sculpts a private copy of a height field with brushes. Every dab
+ * records the texel rectangle it changed; commit() merges them, brings the
+ * min/max pyramid up to date over just those rectangles and hands them out
+ * for upload, so neither the GPU texture nor the bounds are rebuilt per
+ * stroke. Readers keep the published snapshot until endStroke() returns the
+ * edited one, which shares every band of texels and bounds the stroke did
+ * not write with the snapshots before it.
+ *
+ * Every finished stroke becomes a version of a copy-on-write tile store,
+ * which holds the undo history at the cost of the tiles strokes touched.
+ *
+ * 8 bit texels cannot hold a fraction of a step, so fractional changes are
+ * dithered with an ordered pattern that shifts every dab: repeated dabs
+ * average to the requested height instead of rounding away.
+ */
+struct TerrainEditor
+{
+    // edits a copy of source, whose snapshots name it as their first parent
+    void init(std::shared_ptr<const HeightField> source, WorkerPool *pool = nullptr);
+
+    const HeightField &field() const { return working; }
+    bool stroking() const { return active; }
+
+    // world xz, dabs once at position
+    void beginStroke(const Brush &brush, glm::vec2 position);
+
+    // dabs every brush.spacing radii along the segment from the last dab
+    void strokeTo(glm::vec2 position);
+
+    // snapshot of the edited field to publish, the stats of the finished stroke stay in stroke
+    std::shared_ptr<const HeightField> endStroke();
+
+    // rects changed since the last commit, merged, with the bounds over them up to date; upload these
+    const std::vector<TexelRect> &commit();
+
+    // restore the tiles of the previous / next stroke into the working field, null when there is none or a stroke is running
+    std::shared_ptr<const HeightField> undo();
+    std::shared_ptr<const HeightField> redo();
+
+    // the versioned tiles, readers may take current() from any thread
+    const HeightTileStore &versions() const { return history; }
+
+    StrokeStats stroke;
+
+private:
+    void dab(glm::vec2 position);
+    void updateBounds(); // merges dirty into ready
+    std::shared_ptr<const HeightField> restore(bool (HeightTileStore::*step)(std::vector<TexelRect> &));
+    std::shared_ptr<const HeightField> snapshot(std::vector<TexelRect> &changed); // takes changed
+
+    HeightField working;
+    WorkerPool *pool = nullptr;
+    Brush brush;
+    bool active = false;
+    glm::vec2 last{0.0f};   // world xz of the last dab
+    float flattenTexel = 0; // Flatten target, texel units
+    uint32_t dabIndex = 0;  // shifts the dither pattern
+
+    std::vector<TexelRect> dirty;     // brushed, bounds not updated yet
+    std::vector<TexelRect> ready;     // bounds updated, not handed out yet
+    std::vector<TexelRect> committed; // returned by commit()
+    std::vector<TexelRect> strokeRects; // everything the running stroke changed, for its version
+    HeightTileStore history;
+    std::weak_ptr<const HeightField> published; // the last snapshot handed out, parent of the next
+    std::vector<uint8_t> source;      // Smooth reads the texels as they were before the dab
+};
+
+#endif // TERRAIN_EDIT_HPP
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TERRAIN_GENERATOR_X86 1
+#endif
+
+#include "Defines.hpp"
+#include "HeightField.hpp"
+#include "Profiler.hpp"
+#include "TerrainGenerator.hpp"
+#include "WorkerPool.hpp"
+
+constexpr uint32_t MAX_OCTAVES = 16;
+
+// unit gradients 45 degrees apart, picked by the top three hash bits
+alignas(32) constexpr float GRADIENT_X[8] = {1.0f, -1.0f, 0.0f, 0.0f, 0.70710678f, -0.70710678f, 0.70710678f, -0.70710678f};
+alignas(32) constexpr float GRADIENT_Y[8] = {0.0f, 0.0f, 1.0f, -1.0f, 0.70710678f, 0.70710678f, -0.70710678f, -0.70710678f};
+
+// lattice of one octave seen from a tile: the tile origin split into a whole cell and a fraction, so lane positions stay small floats
+struct OctaveFrame
+{
+    uint32_t cellX, cellY; // wraps for far tiles, only the hash sees it
+    float fracX, fracY;
+    float frequency; // cells per texel
+    uint32_t seed;
+};
+
+static OctaveFrame octave_frame(const GeneratedTile &tile, double frequency, uint32_t seed)
+{
+    const double ox = static_cast<double>(tile.x) * GeneratedTile::SIZE * frequency;
+    const double oy = static_cast<double>(tile.y) * GeneratedTile::SIZE * frequency;
+    const double cx = std::floor(ox), cy = std::floor(oy);
+    return {static_cast<uint32_t>(static_cast<int64_t>(cx)), static_cast<uint32_t>(static_cast<int64_t>(cy)), static_cast<float>(ox - cx),
+            static_cast<float>(oy - cy), static_cast<float>(frequency), seed};
+}
+
+static inline uint32_t lattice_hash(uint32_t x, uint32_t y, uint32_t seed)
+{
+    uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return h;
+}
+
+static inline float corner(uint32_t x, uint32_t y, uint32_t seed, float dx, float dy)
+{
+    const uint32_t g = lattice_hash(x, y, seed) >> 29;
+    return GRADIENT_X[g] * dx + GRADIENT_Y[g] * dy;
+}
+
+// gradient noise at texel (lx, ly) of the tile, about [-1, 1]
+static inline float gradient_noise(const OctaveFrame &o, float lx, float ly)
+{
+    const float px = o.fracX + lx * o.frequency, py = o.fracY + ly * o.frequency;
+    const float fx = std::floor(px), fy = std::floor(py);
+    const uint32_t ix = o.cellX + static_cast<uint32_t>(static_cast<int32_t>(fx)), iy = o.cellY + static_cast<uint32_t>(static_cast<int32_t>(fy));
+    const float tx = px - fx, ty = py - fy;
+    const float u = tx * tx * tx * (tx * (tx * 6.0f - 15.0f) + 10.0f);
+    const float v = ty * ty * ty * (ty * (ty * 6.0f - 15.0f) + 10.0f);
+
+    const float n00 = corner(ix, iy, o.seed, tx, ty);
+    const float n10 = corner(ix + 1u, iy, o.seed, tx - 1.0f, ty);
+    const float n01 = corner(ix, iy + 1u, o.seed, tx, ty - 1.0f);
+    const float n11 = corner(ix + 1u, iy + 1u, o.seed, tx - 1.0f, ty - 1.0f);
+    const float a = n00 + (n10 - n00) * u;
+    const float b = n01 + (n11 - n01) * u;
+    return (a + (b - a) * v) * 1.41421356f;
+}
+
+// every frame and weight of one tile, shared by the scalar and AVX2 rows
+struct TileFrames
+{
+    OctaveFrame warp[4]; // x low, x high, y low, y high
+    OctaveFrame octaves[MAX_OCTAVES];
+    float amplitude[MAX_OCTAVES];
+    uint32_t octaveCount;
+    float warpScale;
+    float fbmScale;   // h = fbm * fbmScale + ridged * ridgeScale + bias
+    float ridgeScale;
+    float bias;
+};
+
+static TileFrames tile_frames(const NoiseSettings &settings, const GeneratedTile &tile)
+{
+    TileFrames frames;
+    const double base = 1.0 / std::max(settings.wavelength, 1.0f);
+    for (uint32_t i = 0; i < 4; ++i)
+        frames.warp[i] = octave_frame(tile, base * (i & 1u ? 2.0 : 1.0), settings.seed * 0x9e3779b9u + 0x632be5abu * (i + 1u));
+
+    frames.octaveCount = std::clamp(settings.octaves, 1u, MAX_OCTAVES);
+    double frequency = base;
+    float amplitude = 1.0f, sum = 0.0f;
+    for (uint32_t o = 0; o < frames.octaveCount; ++o)
+    {
+        frames.octaves[o] = octave_frame(tile, frequency, settings.seed * 0x9e3779b9u + 0x85ebca6bu * o);
+        frames.amplitude[o] = amplitude;
+        sum += amplitude;
+        amplitude *= settings.gain;
+        frequency *= settings.lacunarity;
+    }
+
+    // the two sums are independent, blending them narrows the spread; stretch it back around mid height
+    const float ridge = std::clamp(settings.ridge, 0.0f, 1.0f);
+    const float contrast = 1.0f / std::sqrt((1.0f - ridge) * (1.0f - ridge) + ridge * ridge);
+    frames.warpScale = settings.warp;
+    frames.fbmScale = (1.0f - ridge) * contrast / sum;
+    frames.ridgeScale = ridge * contrast / sum;
+    frames.bias = 0.5f - ridge * contrast * 0.5f;
+    return frames;
+}
+
+static uint8_t tile_texel(const TileFrames &f, bool warp, float x, float y)
+{
+    float sx = x, sy = y;
+    if (warp)
+    {
+        // two octaves per axis, the displacement varies as slowly as the terrain's largest features
+        const float wx = gradient_noise(f.warp[0], x, y) + gradient_noise(f.warp[1], x, y) * 0.5f;
+        const float wy = gradient_noise(f.warp[2], x, y) + gradient_noise(f.warp[3], x, y) * 0.5f;
+        sx = x + wx * f.warpScale;
+        sy = y + wy * f.warpScale;
+    }
+
+    // ridged multifractal weights each octave by the one before, detail gathers on the crests
+    float fbm = 0.0f, ridged = 0.0f, weight = 1.0f;
+    for (uint32_t o = 0; o < f.octaveCount; ++o)
+    {
+        const float n = gradient_noise(f.octaves[o], sx, sy);
+        fbm = fbm + n * f.amplitude[o];
+        const float crest = 1.0f - std::fabs(n);
+        const float r = crest * crest * weight;
+        weight = std::min(r * 2.0f, 1.0f);
+        ridged = ridged + r * f.amplitude[o];
+    }
+
+    const float h = fbm * f.fbmScale + ridged * f.ridgeScale + f.bias;
+    return static_cast<uint8_t>(std::rint(std::clamp(h, 0.0f, 1.0f) * 255.0f));
+}
+
+#ifdef TERRAIN_GENERATOR_X86
+
+// no FMA, so the lanes match tile_texel bit for bit
+#define AVX2_KERNEL __attribute__((target("avx2")))
+
+AVX2_KERNEL static inline __m256i hash8(__m256i x, __m256i y, __m256i seed)
+{
+    __m256i h = _mm256_xor_si256(_mm256_xor_si256(_mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int32_t>(0x8da6b343u))),
+                                                  _mm256_mullo_epi32(y, _mm256_set1_epi32(static_cast<int32_t>(0xd8163841u)))),
+                                 seed);
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x2c1b3c6d));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x297a2d39));
+    return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+}
+
+AVX2_KERNEL static inline __m256 corner8(__m256i x, __m256i y, __m256i seed, __m256 dx, __m256 dy)
+{
+    const __m256i g = _mm256_srli_epi32(hash8(x, y, seed), 29);
+    const __m256 gx = _mm256_permutevar8x32_ps(_mm256_load_ps(GRADIENT_X), g);
+    const __m256 gy = _mm256_permutevar8x32_ps(_mm256_load_ps(GRADIENT_Y), g);
+    return _mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy));
+}
+
+AVX2_KERNEL static inline __m256 fade8(__m256 t)
+{
+    const __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))),
+                                       _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+AVX2_KERNEL static inline __m256 gradient_noise8(const OctaveFrame &o, __m256 lx, __m256 ly)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 px = _mm256_add_ps(_mm256_set1_ps(o.fracX), _mm256_mul_ps(lx, _mm256_set1_ps(o.frequency)));
+    const __m256 py = _mm256_add_ps(_mm256_set1_ps(o.fracY), _mm256_mul_ps(ly, _mm256_set1_ps(o.frequency)));
+    const __m256 fx = _mm256_floor_ps(px), fy = _mm256_floor_ps(py);
+    const __m256i ix = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(o.cellX)), _mm256_cvttps_epi32(fx));
+    const __m256i iy = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(o.cellY)), _mm256_cvttps_epi32(fy));
+    const __m256i ix1 = _mm256_add_epi32(ix, _mm256_set1_epi32(1)), iy1 = _mm256_add_epi32(iy, _mm256_set1_epi32(1));
+    const __m256i seed = _mm256_set1_epi32(static_cast<int32_t>(o.seed));
+    const __m256 tx = _mm256_sub_ps(px, fx), ty = _mm256_sub_ps(py, fy);
+    const __m256 tx1 = _mm256_sub_ps(tx, one), ty1 = _mm256_sub_ps(ty, one);
+    const __m256 u = fade8(tx), v = fade8(ty);
+
+    const __m256 n00 = corner8(ix, iy, seed, tx, ty);
+    const __m256 n10 = corner8(ix1, iy, seed, tx1, ty);
+    const __m256 n01 = corner8(ix, iy1, seed, tx, ty1);
+    const __m256 n11 = corner8(ix1, iy1, seed, tx1, ty1);
+    const __m256 a = _mm256_add_ps(n00, _mm256_mul_ps(_mm256_sub_ps(n10, n00), u));
+    const __m256 b = _mm256_add_ps(n01, _mm256_mul_ps(_mm256_sub_ps(n11, n01), u));
+    return _mm256_mul_ps(_mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), v)), _mm256_set1_ps(1.41421356f));
+}
+
+// tile_texel for 8 texels of row y from x
+AVX2_KERNEL static void tile_texels_avx2(const TileFrames &f, bool warp, uint32_t x, uint32_t y, uint8_t *out)
+{
+    const __m256 half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f), sign = _mm256_set1_ps(-0.0f);
+    const __m256 lx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+    const __m256 ly = _mm256_set1_ps(static_cast<float>(y));
+
+    __m256 sx = lx, sy = ly;
+    if (warp)
+    {
+        const __m256 wx = _mm256_add_ps(gradient_noise8(f.warp[0], lx, ly), _mm256_mul_ps(gradient_noise8(f.warp[1], lx, ly), half));
+        const __m256 wy = _mm256_add_ps(gradient_noise8(f.warp[2], lx, ly), _mm256_mul_ps(gradient_noise8(f.warp[3], lx, ly), half));
+        sx = _mm256_add_ps(lx, _mm256_mul_ps(wx, _mm256_set1_ps(f.warpScale)));
+        sy = _mm256_add_ps(ly, _mm256_mul_ps(wy, _mm256_set1_ps(f.warpScale)));
+    }
+
+    __m256 fbm = _mm256_setzero_ps(), ridged = _mm256_setzero_ps(), weight = one;
+    for (uint32_t o = 0; o < f.octaveCount; ++o)
+    {
+        const __m256 n = gradient_noise8(f.octaves[o], sx, sy);
+        const __m256 amplitude = _mm256_set1_ps(f.amplitude[o]);
+        fbm = _mm256_add_ps(fbm, _mm256_mul_ps(n, amplitude));
+        const __m256 crest = _mm256_sub_ps(one, _mm256_andnot_ps(sign, n));
+        const __m256 r = _mm256_mul_ps(_mm256_mul_ps(crest, crest), weight);
+        weight = _mm256_min_ps(_mm256_mul_ps(r, _mm256_set1_ps(2.0f)), one);
+        ridged = _mm256_add_ps(ridged, _mm256_mul_ps(r, amplitude));
+    }
+
+    const __m256 h = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fbm, _mm256_set1_ps(f.fbmScale)), _mm256_mul_ps(ridged, _mm256_set1_ps(f.ridgeScale))),
+                                   _mm256_set1_ps(f.bias));
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(h, _mm256_setzero_ps()), one);
+    const __m256i texels = _mm256_cvtps_epi32(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)));
+
+    // 8 x 32 bit to 8 bytes
+    const __m256i words = _mm256_packus_epi32(texels, texels);
+    const __m256i bytes = _mm256_packus_epi16(words, words);
+    const uint32_t lo = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(bytes)));
+    const uint32_t hi = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1)));
+    memcpy(out, &lo, 4);
+    memcpy(out + 4, &hi, 4);
+}
+
+static bool generator_use_avx2(const NoiseSettings &settings)
+{
+    return settings.simd && cpuHasAvx2();
+}
+
+#else
+
+static void tile_texels_avx2(const TileFrames &, bool, uint32_t, uint32_t, uint8_t *)
+{
+}
+
+static bool generator_use_avx2(const NoiseSettings &)
+{
+    return false;
+}
+
+#endif // TERRAIN_GENERATOR_X86
+
+void generateTile(const NoiseSettings &settings, GeneratedTile &tile)
+{
+    const TileFrames frames = tile_frames(settings, tile);
+    const bool warp = settings.warp != 0.0f;
+    const bool avx2 = generator_use_avx2(settings);
+
+    for (uint32_t y = 0; y < GeneratedTile::SIZE; ++y)
+    {
+        uint8_t *row = tile.texels + y * GeneratedTile::SIZE;
+        if (avx2)
+        {
+            for (uint32_t x = 0; x < GeneratedTile::SIZE; x += 8)
+                tile_texels_avx2(frames, warp, x, y, row + x);
+            continue;
+        }
+        for (uint32_t x = 0; x < GeneratedTile::SIZE; ++x)
+            row[x] = tile_texel(frames, warp, static_cast<float>(x), static_cast<float>(y));
+    }
+}
+
+void TerrainGenerator::init(const NoiseSettings &noise, WorkerPool *workers, size_t cacheBytes)
+{
+    settings = noise;
+    pool = workers;
+    cacheLimit = cacheBytes;
+    cache.clear();
+    lru.clear();
+    counters = {};
+}
+
+void TerrainGenerator::release()
+{
+    cache.clear();
+    lru.clear();
+    pool = nullptr;
+}
+
+void TerrainGenerator::tiles(const std::vector<glm::ivec2> &keys, std::vector<std::shared_ptr<const GeneratedTile>> &out)
+{
+    PROFILE_CPU("generator/tiles");
+    out.assign(keys.size(), nullptr);
+
+    // hits move to the front, misses are generated once however often they were asked for
+    std::vector<glm::ivec2> missing;
+    std::unordered_map<glm::ivec2, size_t, KeyHash> missingIndex;
+    for (const glm::ivec2 &key : keys)
+    {
+        const auto it = cache.find(key);
+        if (it != cache.end())
+        {
+            lru.splice(lru.begin(), lru, it->second.lru);
+            ++counters.hits;
+        }
+        else if (missingIndex.emplace(key, missing.size()).second)
+        {
+            missing.push_back(key);
+            ++counters.misses;
+        }
+    }
+
+    std::vector<std::shared_ptr<const GeneratedTile>> made(missing.size());
+    std::vector<uint64_t> nanos(pool ? pool->threadCount() : 1u, 0u);
+    const auto generate = [&](size_t begin, size_t end, size_t worker) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            auto tile = std::make_shared<GeneratedTile>();
+            tile->x = missing[i].x;
+            tile->y = missing[i].y;
+            generateTile(settings, *tile);
+            made[i] = std::move(tile);
+            nanos[worker] += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    };
+    if (pool && missing.size() > 1)
+        pool->parallelFor(missing.size(), 1u, generate);
+    else
+        generate(0u, missing.size(), 0u);
+
+    for (const uint64_t n : nanos)
+        counters.generateNanos += n;
+    counters.generatedTexels += missing.size() * static_cast<uint64_t>(GeneratedTile::SIZE) * GeneratedTile::SIZE;
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        const auto found = missingIndex.find(keys[i]);
+        out[i] = found != missingIndex.end() ? made[found->second] : cache.at(keys[i]).tile;
+    }
+
+    // the request holds its tiles, so evicting one it asked for only costs a later miss
+    for (size_t i = 0; i < missing.size(); ++i)
+    {
+        lru.push_front(missing[i]);
+        cache[missing[i]] = {std::move(made[i]), lru.begin()};
+    }
+    while (!lru.empty() && cache.size() * sizeof(GeneratedTile) > cacheLimit)
+    {
+        cache.erase(lru.back());
+        lru.pop_back();
+        ++counters.evicted;
+    }
+}
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+Heightmap TerrainGenerator::heightmap(int64_t x, int64_t y, uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0)
+        EXIT("Procedural heightmap needs a non-empty size");
+
+    const int64_t size = GeneratedTile::SIZE;
+    const int64_t tx0 = floor_div(x, size), ty0 = floor_div(y, size);
+    const int64_t tx1 = floor_div(x + width - 1, size), ty1 = floor_div(y + height - 1, size);
+
+    std::vector<glm::ivec2> keys;
+    for (int64_t ty = ty0; ty <= ty1; ++ty)
+        for (int64_t tx = tx0; tx <= tx1; ++tx)
+            keys.emplace_back(static_cast<int32_t>(tx), static_cast<int32_t>(ty));
+    std::vector<std::shared_ptr<const GeneratedTile>> found;
+    tiles(keys, found);
+
+    Heightmap heightmap;
+    heightmap.width = width;
+    heightmap.height = height;
+    heightmap.texels.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        const GeneratedTile &tile = *found[i];
+        const int64_t left = static_cast<int64_t>(tile.x) * size, bottom = static_cast<int64_t>(tile.y) * size;
+        const int64_t cx0 = std::max(left, x), cx1 = std::min(left + size, x + width);
+        const int64_t cy0 = std::max(bottom, y), cy1 = std::min(bottom + size, y + height);
+        for (int64_t row = cy0; row < cy1; ++row)
+            memcpy(heightmap.texels.data() + static_cast<size_t>(row - y) * width + (cx0 - x), tile.texels + (row - bottom) * size + (cx0 - left),
+                   static_cast<size_t>(cx1 - cx0));
+    }
+    return heightmap;
+}
+
+TerrainGenerator::Stats TerrainGenerator::stats() const
+{
+    Stats stats = counters;
+    stats.cachedTiles = cache.size();
+    stats.cachedBytes = cache.size() * sizeof(GeneratedTile);
+    return stats;
+}
+
+bool parseProceduralSource(const std::string &path, ProceduralSource &source)
+{
+    const std::string prefix = "procedural:";
+    if (path.compare(0, prefix.size(), prefix) != 0)
+        return false;
+
+    source = {};
+    size_t start = prefix.size();
+    while (start < path.size())
+    {
+        const size_t end = std::min(path.find(',', start), path.size());
+        const std::string item = path.substr(start, end - start);
+        start = end + 1;
+        if (item.empty())
+            continue;
+
+        const size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            EXIT("Procedural heightmap option without a value: " + item);
+        const std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+
+        try
+        {
+            if (key == "seed")
+                source.noise.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "size")
+            {
+                const size_t cross = value.find('x');
+                source.width = static_cast<uint32_t>(std::stoul(value.substr(0, cross)));
+                source.height = cross == std::string::npos ? source.width : static_cast<uint32_t>(std::stoul(value.substr(cross + 1)));
+            }
+            else if (key == "x")
+                source.x = std::stoll(value);
+            else if (key == "y")
+                source.y = std::stoll(value);
+            else if (key == "octaves")
+                source.noise.octaves = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "wavelength")
+                source.noise.wavelength = std::stof(value);
+            else if (key == "lacunarity")
+                source.noise.lacunarity = std::stof(value);
+            else if (key == "gain")
+                source.noise.gain = std::stof(value);
+            else if (key == "ridge")
+                source.noise.ridge = std::stof(value);
+            else if (key == "warp")
+                source.noise.warp = std::stof(value);
+            else if (key == "simd")
+                source.noise.simd = value != "0";
+            else
+                EXIT("Unknown procedural heightmap option " + key);
+        }
+        catch (const std::exception &)
+        {
+            EXIT("Bad procedural heightmap option " + item);
+        }
+    }
+    return true;
+}
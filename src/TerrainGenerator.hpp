@@ -0,0 +1,117 @@
+#ifndef TERRAIN_GENERATOR_HPP
+#define TERRAIN_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Heightmap.hpp"
+
+struct WorkerPool;
+
+struct NoiseSettings
+{
+    uint32_t seed = 1;
+    uint32_t octaves = 8;
+    float wavelength = 1024.0f; // texels per cycle of the first octave
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+    float ridge = 0.5f; // blend of fBm (0) and ridged multifractal (1)
+    float warp = 96.0f; // domain warp displacement in texels, 0 = off
+    bool simd = true;   // AVX2 lanes when the CPU has it, off for comparisons
+};
+
+struct GeneratedTile
+{
+    static constexpr uint32_t SIZE = 256; // texels per side
+
+    int32_t x = 0, y = 0;        // tile, SIZE texels per side, may be negative
+    uint8_t texels[SIZE * SIZE]; // bottom row first
+};
+
+/**
+ * @brief Gradient noise fBm blended with ridged multifractal over a domain
+ * warped by two more octaves. A texel depends on its coordinates and the
+ * settings only, so a tile comes out the same whichever thread makes it and
+ * whatever was made before.
+ */
+void generateTile(const NoiseSettings &settings, GeneratedTile &tile);
+
+/**
+ * @brief Endless procedural height source. Tiles are made on demand, the
+ * missing ones of a request in parallel on the pool, and kept in an LRU so
+ * revisited ground costs a copy. One caller at a time.
+ */
+struct TerrainGenerator
+{
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evicted = 0;
+        uint64_t generatedTexels = 0;
+        uint64_t generateNanos = 0; // summed over the threads that generated, per core throughput is texels / time
+        size_t cachedTiles = 0;
+        size_t cachedBytes = 0;
+
+        double mtexelsPerCore() const { return generateNanos ? generatedTexels * 1e3 / static_cast<double>(generateNanos) : 0.0; }
+    };
+
+    void init(const NoiseSettings &settings, WorkerPool *pool = nullptr, size_t cacheBytes = 64u << 20);
+    void release();
+
+    // out[i] receives tile keys[i], what the cache lacks is generated first
+    void tiles(const std::vector<glm::ivec2> &keys, std::vector<std::shared_ptr<const GeneratedTile>> &out);
+
+    // texels [x, x + width) x [y, y + height) of the endless field
+    Heightmap heightmap(int64_t x, int64_t y, uint32_t width, uint32_t height);
+
+    const NoiseSettings &config() const { return settings; }
+    Stats stats() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const glm::ivec2 &key) const
+        {
+            return static_cast<size_t>(static_cast<uint32_t>(key.y)) * 0x9e3779b97f4a7c15ull ^ static_cast<uint32_t>(key.x);
+        }
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const GeneratedTile> tile;
+        std::list<glm::ivec2>::iterator lru;
+    };
+
+    NoiseSettings settings;
+    WorkerPool *pool = nullptr;
+    size_t cacheLimit = 0;
+    std::unordered_map<glm::ivec2, Entry, KeyHash> cache;
+    std::list<glm::ivec2> lru; // most recently used first
+    Stats counters;
+};
+
+/**
+ * @brief A heightmap path of the form
+ * "procedural:seed=7,size=4096x4096,x=0,y=0,octaves=8,wavelength=1024,ridge=0.5,warp=96"
+ * stands for that window of the generator, every key optional. False for
+ * any other path.
+ */
+struct ProceduralSource
+{
+    NoiseSettings noise;
+    uint32_t width = 4096;
+    uint32_t height = 4096;
+    int64_t x = 0, y = 0; // texel of the window's bottom left corner
+};
+
+bool parseProceduralSource(const std::string &path, ProceduralSource &source);
+
+#endif // TERRAIN_GENERATOR_HPP
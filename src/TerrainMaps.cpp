@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TERRAIN_MAPS_X86 1
+#endif
+
+#include "Profiler.hpp"
+#include "TerrainMaps.hpp"
+#include "WorkerPool.hpp"
+
+constexpr size_t MAP_ROW_GRAIN = 16;
+
+const char *normalFormatName(NormalFormat format)
+{
+    switch (format)
+    {
+    case NormalFormat::RG8: return "rg8";
+    case NormalFormat::RG16: return "rg16";
+    default: return "unknown";
+    }
+}
+
+glm::vec2 octEncode(glm::vec3 n)
+{
+    const float scale = 1.0f / (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+    glm::vec2 oct{n.x * scale, n.z * scale};
+    if (n.y < 0.0f)
+    {
+        const glm::vec2 folded{(1.0f - std::fabs(oct.y)) * (oct.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::fabs(oct.x)) * (oct.y >= 0.0f ? 1.0f : -1.0f)};
+        oct = folded;
+    }
+    return oct;
+}
+
+glm::vec3 octDecode(glm::vec2 oct)
+{
+    glm::vec3 n{oct.x, 1.0f - std::fabs(oct.x) - std::fabs(oct.y), oct.y};
+    if (n.y < 0.0f)
+    {
+        const float x = n.x;
+        n.x = (1.0f - std::fabs(n.z)) * (x >= 0.0f ? 1.0f : -1.0f);
+        n.z = (1.0f - std::fabs(x)) * (n.z >= 0.0f ? 1.0f : -1.0f);
+    }
+    const float scale = 1.0f / std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    return glm::vec3{n.x * scale, n.y * scale, n.z * scale};
+}
+
+// constants of the level 0 kernel, heights in texel steps
+struct MapKernel
+{
+    float gradientX; // world dh/dx per texel step of R - L
+    float gradientZ;
+    float curvatureX; // world laplacian per texel step of L + R - 2C
+    float curvatureZ;
+    float invRange;
+    bool rg16;
+};
+
+static MapKernel map_kernel(const HeightField &field, const TerrainMapSettings &settings)
+{
+    const float step = HEIGHT_SCALE / 255.0f;
+    const float texelX = field.extent.x / static_cast<float>(field.width);
+    const float texelZ = field.extent.y / static_cast<float>(field.height);
+    return {step / (2.0f * texelX), step / (2.0f * texelZ), step / (texelX * texelX), step / (texelZ * texelZ),
+            1.0f / settings.curvatureRange, settings.normalFormat == NormalFormat::RG16};
+}
+
+// normal = normalize(-dh/dx, 1, -dh/dz), whose octahedral coordinates need no normalization: -g / (|gx| + |gz| + 1)
+static inline void map_texel(const MapKernel &k, int32_t l, int32_t r, int32_t d, int32_t u, int32_t c, uint8_t *normal, uint8_t *surface)
+{
+    const float gx = static_cast<float>(r - l) * k.gradientX;
+    const float gz = static_cast<float>(u - d) * k.gradientZ;
+    const float sum = std::fabs(gx) + std::fabs(gz) + 1.0f;
+    const float ox = -gx / sum, oz = -gz / sum;
+
+    if (k.rg16)
+    {
+        const uint16_t x = static_cast<uint16_t>(std::rint(ox * 32767.5f + 32767.5f));
+        const uint16_t z = static_cast<uint16_t>(std::rint(oz * 32767.5f + 32767.5f));
+        normal[0] = static_cast<uint8_t>(x), normal[1] = static_cast<uint8_t>(x >> 8);
+        normal[2] = static_cast<uint8_t>(z), normal[3] = static_cast<uint8_t>(z >> 8);
+    }
+    else
+    {
+        normal[0] = static_cast<uint8_t>(std::rint(ox * 127.5f + 127.5f));
+        normal[1] = static_cast<uint8_t>(std::rint(oz * 127.5f + 127.5f));
+    }
+
+    const float length2 = gx * gx + gz * gz;
+    const float laplacian = static_cast<float>(l + r - 2 * c) * k.curvatureX + static_cast<float>(d + u - 2 * c) * k.curvatureZ;
+    surface[0] = static_cast<uint8_t>(std::rint(std::sqrt(length2 / (length2 + 1.0f)) * 255.0f));
+    surface[1] = static_cast<uint8_t>(std::rint(std::clamp(laplacian * k.invRange, -1.0f, 1.0f) * 127.5f + 127.5f));
+}
+
+#ifdef TERRAIN_MAPS_X86
+
+// no FMA, so the rows match the scalar texels bit for bit
+#define AVX2_KERNEL __attribute__((target("avx2")))
+
+AVX2_KERNEL static inline __m256i load_texels(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+// low 16 bits of 8 lanes, saturated, to 16 bytes
+AVX2_KERNEL static inline void store_pairs(uint8_t *out, __m256i v)
+{
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+}
+
+// texels [x, end) of row y, 8 at a time; x - 1 and end must lie inside the row
+AVX2_KERNEL static uint32_t map_row_avx2(const MapKernel &k, const uint8_t *down, const uint8_t *row, const uint8_t *up, uint32_t x, uint32_t end,
+                                         uint8_t *normals, uint8_t *surface)
+{
+    const __m256 gradientX = _mm256_set1_ps(k.gradientX), gradientZ = _mm256_set1_ps(k.gradientZ);
+    const __m256 curvatureX = _mm256_set1_ps(k.curvatureX), curvatureZ = _mm256_set1_ps(k.curvatureZ);
+    const __m256 invRange = _mm256_set1_ps(k.invRange);
+    const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 unorm8 = _mm256_set1_ps(127.5f), unorm16 = _mm256_set1_ps(32767.5f), full8 = _mm256_set1_ps(255.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    for (; x + 8 <= end; x += 8)
+    {
+        const __m256i l = load_texels(row + x - 1), r = load_texels(row + x + 1), c = load_texels(row + x);
+        const __m256i d = load_texels(down + x), u = load_texels(up + x);
+
+        const __m256 gx = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(r, l)), gradientX);
+        const __m256 gz = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(u, d)), gradientZ);
+        const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(sign, gx), _mm256_andnot_ps(sign, gz)), one);
+        const __m256 ox = _mm256_div_ps(_mm256_xor_ps(gx, sign), sum);
+        const __m256 oz = _mm256_div_ps(_mm256_xor_ps(gz, sign), sum);
+
+        if (k.rg16)
+        {
+            const __m256i nx = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(ox, unorm16), unorm16));
+            const __m256i nz = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(oz, unorm16), unorm16));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(normals + static_cast<size_t>(x) * 4u), _mm256_or_si256(nx, _mm256_slli_epi32(nz, 16)));
+        }
+        else
+        {
+            const __m256i nx = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(ox, unorm8), unorm8));
+            const __m256i nz = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(oz, unorm8), unorm8));
+            store_pairs(normals + static_cast<size_t>(x) * 2u, _mm256_or_si256(nx, _mm256_slli_epi32(nz, 8)));
+        }
+
+        const __m256 length2 = _mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gz, gz));
+        const __m256i slope = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sqrt_ps(_mm256_div_ps(length2, _mm256_add_ps(length2, one))), full8));
+
+        const __m256i c2 = _mm256_add_epi32(c, c);
+        const __m256 laplacian = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_add_epi32(l, r), c2)), curvatureX),
+                                               _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_add_epi32(d, u), c2)), curvatureZ));
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(laplacian, invRange), minusOne), one);
+        const __m256i curvature = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, unorm8), unorm8));
+        store_pairs(surface + static_cast<size_t>(x) * 2u, _mm256_or_si256(slope, _mm256_slli_epi32(curvature, 8)));
+    }
+    return x;
+}
+
+// byte k of every 32 bit lane
+AVX2_KERNEL static inline __m256 lane_byte(__m256i v, int k)
+{
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(v, _mm256_set1_epi32(8 * k)), _mm256_set1_epi32(0xff)));
+}
+
+// octDecode of unorm8 pairs, same operations in the same order
+AVX2_KERNEL static inline void decode_normals(__m256 bx, __m256 bz, __m256 &x, __m256 &y, __m256 &z)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), unorm8 = _mm256_set1_ps(127.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+    const __m256 ox = _mm256_sub_ps(_mm256_div_ps(bx, unorm8), one);
+    const __m256 oz = _mm256_sub_ps(_mm256_div_ps(bz, unorm8), one);
+    const __m256 ny = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign, ox)), _mm256_andnot_ps(sign, oz));
+
+    const __m256 below = _mm256_cmp_ps(ny, zero, _CMP_LT_OQ);
+    const __m256 foldX = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign, oz)), _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(ox, zero, _CMP_GE_OQ)));
+    const __m256 foldZ = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign, ox)), _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(oz, zero, _CMP_GE_OQ)));
+    const __m256 nx = _mm256_blendv_ps(ox, foldX, below), nz = _mm256_blendv_ps(oz, foldZ, below);
+
+    const __m256 scale = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz))));
+    x = _mm256_mul_ps(nx, scale), y = _mm256_mul_ps(ny, scale), z = _mm256_mul_ps(nz, scale);
+}
+
+// downsample_maps for RG8 normals, parents [x, end) of row y 8 at a time, returns where the scalar rest starts
+AVX2_KERNEL static uint32_t downsample_row_avx2(const TerrainMapLevel &src, TerrainMapLevel &dst, uint32_t y, uint32_t x, uint32_t end)
+{
+    const size_t row0 = static_cast<size_t>(std::min(2 * y, src.height - 1)) * src.width;
+    const size_t row1 = static_cast<size_t>(std::min(2 * y + 1, src.height - 1)) * src.width;
+    const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), unorm8 = _mm256_set1_ps(127.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+    const __m256i two = _mm256_set1_epi32(2), byte = _mm256_set1_epi32(0xff);
+
+    for (; x + 8 <= end; x += 8)
+    {
+        // a 32 bit lane holds parent x's even and odd child, two bytes each
+        const __m256i n0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src.normals.data() + (row0 + 2 * x) * 2));
+        const __m256i n1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src.normals.data() + (row1 + 2 * x) * 2));
+        __m256 sx = zero, sy = zero, sz = zero;
+        for (const __m256i n : {n0, n1})
+        {
+            for (int child = 0; child < 2; ++child)
+            {
+                __m256 cx, cy, cz;
+                decode_normals(lane_byte(n, 2 * child), lane_byte(n, 2 * child + 1), cx, cy, cz);
+                sx = _mm256_add_ps(sx, cx), sy = _mm256_add_ps(sy, cy), sz = _mm256_add_ps(sz, cz);
+            }
+        }
+
+        // octEncode
+        const __m256 scale = _mm256_div_ps(one, _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(sign, sx), _mm256_andnot_ps(sign, sy)), _mm256_andnot_ps(sign, sz)));
+        const __m256 ox = _mm256_mul_ps(sx, scale), oz = _mm256_mul_ps(sz, scale);
+        const __m256 below = _mm256_cmp_ps(sy, zero, _CMP_LT_OQ);
+        const __m256 foldX = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign, oz)), _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(ox, zero, _CMP_GE_OQ)));
+        const __m256 foldZ = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign, ox)), _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(oz, zero, _CMP_GE_OQ)));
+        const __m256i ex = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_blendv_ps(ox, foldX, below), unorm8), unorm8));
+        const __m256i ez = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_blendv_ps(oz, foldZ, below), unorm8), unorm8));
+        store_pairs(dst.normals.data() + (static_cast<size_t>(y) * dst.width + x) * 2, _mm256_or_si256(ex, _mm256_slli_epi32(ez, 8)));
+
+        // slope and curvature bytes summed per channel, rounded like the scalar path
+        const __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src.surface.data() + (row0 + 2 * x) * 2));
+        const __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src.surface.data() + (row1 + 2 * x) * 2));
+        const __m256i slopes = _mm256_add_epi32(_mm256_and_si256(s0, byte), _mm256_and_si256(_mm256_srli_epi32(s0, 16), byte));
+        const __m256i curvatures = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(s0, 8), byte), _mm256_srli_epi32(s0, 24));
+        const __m256i slope = _mm256_srli_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(slopes, _mm256_add_epi32(_mm256_and_si256(s1, byte), _mm256_and_si256(_mm256_srli_epi32(s1, 16), byte))), two), 2);
+        const __m256i curvature = _mm256_srli_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(curvatures, _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(s1, 8), byte), _mm256_srli_epi32(s1, 24))), two), 2);
+        store_pairs(dst.surface.data() + (static_cast<size_t>(y) * dst.width + x) * 2, _mm256_or_si256(slope, _mm256_slli_epi32(curvature, 8)));
+    }
+    return x;
+}
+
+static bool maps_use_avx2(const TerrainMapSettings &settings)
+{
+    return settings.simd && cpuHasAvx2();
+}
+
+#else
+
+static uint32_t map_row_avx2(const MapKernel &, const uint8_t *, const uint8_t *, const uint8_t *, uint32_t x, uint32_t, uint8_t *, uint8_t *)
+{
+    return x;
+}
+
+static uint32_t downsample_row_avx2(const TerrainMapLevel &, TerrainMapLevel &, uint32_t, uint32_t x, uint32_t)
+{
+    return x;
+}
+
+static bool maps_use_avx2(const TerrainMapSettings &)
+{
+    return false;
+}
+
+#endif // TERRAIN_MAPS_X86
+
+// level 0 over the inclusive rect, edges clamp like GL_CLAMP_TO_EDGE
+static void map_rect(const HeightField &field, const MapKernel &k, bool avx2, TerrainMapLevel &level, uint32_t x0, uint32_t y0, uint32_t x1,
+                     uint32_t y1)
+{
+    const uint32_t lastX = field.width - 1, lastY = field.height - 1;
+    const size_t normalBytes = k.rg16 ? 4u : 2u;
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        const uint8_t *row = field.texels.row(y);
+        const uint8_t *down = field.texels.row(y > 0 ? y - 1 : 0);
+        const uint8_t *up = field.texels.row(std::min(y + 1, lastY));
+        uint8_t *normals = level.normals.data() + static_cast<size_t>(y) * field.width * normalBytes;
+        uint8_t *surface = level.surface.data() + static_cast<size_t>(y) * field.width * 2u;
+
+        const auto scalar = [&](uint32_t x) {
+            map_texel(k, row[x > 0 ? x - 1 : 0], row[std::min(x + 1, lastX)], down[x], up[x], row[x], normals + x * normalBytes, surface + x * 2u);
+        };
+
+        uint32_t x = x0;
+        if (x == 0)
+            scalar(x++);
+        if (avx2 && x <= x1)
+            x = map_row_avx2(k, down, row, up, x, std::min(x1 + 1, lastX), normals, surface);
+        for (; x <= x1; ++x)
+            scalar(x);
+    }
+}
+
+static glm::vec3 load_normal(const uint8_t *texel, bool rg16)
+{
+    if (rg16)
+    {
+        const float x = static_cast<float>(texel[0] | texel[1] << 8), z = static_cast<float>(texel[2] | texel[3] << 8);
+        return octDecode(glm::vec2{x / 32767.5f - 1.0f, z / 32767.5f - 1.0f});
+    }
+    return octDecode(glm::vec2{texel[0] / 127.5f - 1.0f, texel[1] / 127.5f - 1.0f});
+}
+
+static void store_normal(glm::vec3 n, uint8_t *texel, bool rg16)
+{
+    const glm::vec2 oct = octEncode(n);
+    if (rg16)
+    {
+        const uint16_t x = static_cast<uint16_t>(std::rint(oct.x * 32767.5f + 32767.5f));
+        const uint16_t z = static_cast<uint16_t>(std::rint(oct.y * 32767.5f + 32767.5f));
+        texel[0] = static_cast<uint8_t>(x), texel[1] = static_cast<uint8_t>(x >> 8);
+        texel[2] = static_cast<uint8_t>(z), texel[3] = static_cast<uint8_t>(z >> 8);
+    }
+    else
+    {
+        texel[0] = static_cast<uint8_t>(std::rint(oct.x * 127.5f + 127.5f));
+        texel[1] = static_cast<uint8_t>(std::rint(oct.y * 127.5f + 127.5f));
+    }
+}
+
+// 2x2 box of src into the inclusive rect of dst, odd edges clamp like downsample_rect
+static void downsample_maps(const TerrainMapLevel &src, TerrainMapLevel &dst, bool rg16, bool avx2, uint32_t x0, uint32_t y0, uint32_t x1,
+                            uint32_t y1)
+{
+    const uint32_t lastX = src.width - 1, lastY = src.height - 1;
+    const size_t normalBytes = rg16 ? 4u : 2u;
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        const size_t row0 = static_cast<size_t>(std::min(2 * y, lastY)) * src.width;
+        const size_t row1 = static_cast<size_t>(std::min(2 * y + 1, lastY)) * src.width;
+        const uint32_t start = avx2 && !rg16 ? downsample_row_avx2(src, dst, y, x0, x1 + 1) : x0;
+        for (uint32_t x = start; x <= x1; ++x)
+        {
+            const size_t c[4] = {row0 + std::min(2 * x, lastX), row0 + std::min(2 * x + 1, lastX), row1 + std::min(2 * x, lastX),
+                                 row1 + std::min(2 * x + 1, lastX)};
+            const size_t out = static_cast<size_t>(y) * dst.width + x;
+
+            glm::vec3 n{0.0f};
+            uint32_t slope = 2, curvature = 2;
+            for (const size_t i : c)
+            {
+                n += load_normal(src.normals.data() + i * normalBytes, rg16);
+                slope += src.surface[i * 2];
+                curvature += src.surface[i * 2 + 1];
+            }
+            store_normal(n, dst.normals.data() + out * normalBytes, rg16);
+            dst.surface[out * 2] = static_cast<uint8_t>(slope >> 2);
+            dst.surface[out * 2 + 1] = static_cast<uint8_t>(curvature >> 2);
+        }
+    }
+}
+
+template <typename Fn>
+static void for_map_rows(WorkerPool *pool, uint32_t y0, uint32_t y1, Fn &&fn)
+{
+    const size_t rows = static_cast<size_t>(y1 - y0 + 1);
+    const auto body = [&](size_t begin, size_t end, size_t) { fn(y0 + static_cast<uint32_t>(begin), y0 + static_cast<uint32_t>(end - 1)); };
+    if (pool && rows > MAP_ROW_GRAIN)
+        pool->parallelFor(rows, MAP_ROW_GRAIN, body);
+    else
+        body(0u, rows, 0u);
+}
+
+TerrainMaps buildTerrainMaps(const HeightField &field, const TerrainMapSettings &settings, WorkerPool *pool)
+{
+    PROFILE_CPU("terrain_maps/build");
+
+    TerrainMaps maps;
+    maps.settings = settings;
+
+    uint32_t width = field.width, height = field.height;
+    while (true)
+    {
+        TerrainMapLevel level;
+        level.width = width;
+        level.height = height;
+        level.normals.resize(static_cast<size_t>(width) * height * maps.normalTexelBytes());
+        level.surface.resize(static_cast<size_t>(width) * height * 2u);
+        maps.levels.push_back(std::move(level));
+        if (width == 1 && height == 1)
+            break;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    updateTerrainMaps(maps, field, TexelRect{0u, 0u, field.width - 1, field.height - 1}, pool);
+    return maps;
+}
+
+TexelRect terrainMapLevelRect(const TerrainMaps &maps, const TexelRect &rect, size_t level)
+{
+    const TerrainMapLevel &target = maps.levels[level];
+    return {rect.x0 >> level, rect.y0 >> level, std::min(rect.x1 >> level, target.width - 1), std::min(rect.y1 >> level, target.height - 1)};
+}
+
+TexelRect updateTerrainMaps(TerrainMaps &maps, const HeightField &field, const TexelRect &rect, WorkerPool *pool)
+{
+    PROFILE_CPU("terrain_maps/update");
+
+    // central differences reach one texel, so the texels around the rect change too
+    const TexelRect grown{rect.x0 > 0 ? rect.x0 - 1 : 0u, rect.y0 > 0 ? rect.y0 - 1 : 0u, std::min(rect.x1 + 1, field.width - 1),
+                          std::min(rect.y1 + 1, field.height - 1)};
+    const MapKernel kernel = map_kernel(field, maps.settings);
+    const bool avx2 = maps_use_avx2(maps.settings);
+
+    for_map_rows(pool, grown.y0, grown.y1, [&](uint32_t y0, uint32_t y1) { map_rect(field, kernel, avx2, maps.levels[0], grown.x0, y0, grown.x1, y1); });
+
+    for (size_t l = 1; l < maps.levels.size(); ++l)
+    {
+        // a change only in a dropped odd edge reaches no texel of the coarser levels
+        const TexelRect level = terrainMapLevelRect(maps, grown, l);
+        if (level.x0 > level.x1 || level.y0 > level.y1)
+            break;
+        for_map_rows(pool, level.y0, level.y1, [&](uint32_t y0, uint32_t y1) {
+            downsample_maps(maps.levels[l - 1], maps.levels[l], kernel.rg16, avx2, level.x0, y0, level.x1, y1);
+        });
+    }
+    return grown;
+}
@@ -0,0 +1,69 @@
+#ifndef TERRAIN_MAPS_HPP
+#define TERRAIN_MAPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+
+struct WorkerPool;
+
+enum class NormalFormat : uint8_t
+{
+    RG8,  // 2 bytes, about 0.5 degrees
+    RG16, // 4 bytes, for close-up lighting
+    Count
+};
+
+const char *normalFormatName(NormalFormat format);
+
+struct TerrainMapSettings
+{
+    NormalFormat normalFormat = NormalFormat::RG8;
+    float curvatureRange = 0.25f; // |laplacian| in 1 / world units that saturates the curvature channel
+    bool simd = true;             // AVX2 rows when the CPU has it, off for comparisons
+};
+
+struct TerrainMapLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> normals; // octahedral xz, unorm RG8 or RG16, bottom row first
+    std::vector<uint8_t> surface; // RG8: sin of the slope angle, curvature with 128 flat and above 128 concave
+};
+
+/**
+ * @brief Attributes derived from the height field, for shading with one
+ * fetch per map: normals from central differences of the decoded heights,
+ * slope and Laplacian curvature. Level 0 matches the heightmap texel for
+ * texel, the mips are 2x2 box filtered like buildMipChain (normals are
+ * averaged as vectors and renormalized).
+ */
+struct TerrainMaps
+{
+    TerrainMapSettings settings;
+    std::vector<TerrainMapLevel> levels; // level 0 down to 1x1
+
+    size_t normalTexelBytes() const { return settings.normalFormat == NormalFormat::RG16 ? 4u : 2u; }
+};
+
+TerrainMaps buildTerrainMaps(const HeightField &field, const TerrainMapSettings &settings, WorkerPool *pool = nullptr);
+
+/**
+ * @brief Recomputes the maps after the texels of rect changed. Returns the
+ * level 0 rect that was rewritten, rect grown by the texel the differences
+ * reach; level l changed over that rect >> l.
+ */
+TexelRect updateTerrainMaps(TerrainMaps &maps, const HeightField &field, const TexelRect &rect, WorkerPool *pool = nullptr);
+
+// the rect of level that covers a changed level 0 rect
+TexelRect terrainMapLevelRect(const TerrainMaps &maps, const TexelRect &rect, size_t level);
+
+// unit normal <-> octahedral coordinates in [-1, 1]^2, y up
+glm::vec2 octEncode(glm::vec3 normal);
+glm::vec3 octDecode(glm::vec2 oct);
+
+#endif // TERRAIN_MAPS_HPP
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TerrainRay.hpp"
+#include "WorkerPool.hpp"
+
+// stands in for an unbounded block side, finite so slab math never sees inf - inf
+constexpr double OPEN = 1e30;
+
+// rays per parallelFor chunk
+constexpr size_t RAY_GRAIN = 64;
+
+namespace
+{
+// the ray in cell space: s = texel coordinate - 0.5, so cell i spans [i, i + 1] between texel centers i and i + 1
+struct CellRay
+{
+    double ox, oy, oh;
+    double dx, dy, dh;
+};
+} // namespace
+
+// clips [t0, t1] to the slab lo <= o + d * t <= hi
+static bool clip_slab(double o, double d, double lo, double hi, double &t0, double &t1)
+{
+    if (d == 0.0)
+        return o >= lo && o <= hi;
+
+    double a = (lo - o) / d;
+    double b = (hi - o) / d;
+    if (a > b)
+        std::swap(a, b);
+    t0 = std::max(t0, a);
+    t1 = std::min(t1, b);
+    return t0 <= t1;
+}
+
+static double cell_height(const HeightField &f, int32_t x, int32_t y)
+{
+    x = std::clamp(x, 0, static_cast<int32_t>(f.width) - 1);
+    y = std::clamp(y, 0, static_cast<int32_t>(f.height) - 1);
+    return texel_height(f.texels.at(static_cast<uint32_t>(x), static_cast<uint32_t>(y)));
+}
+
+/**
+ * @brief First t in [ta, tb] where the ray is on or below the bilinear patch
+ * of cell (ix, iy). Along the ray the patch is a quadratic in t, so the gap
+ * ray - surface is solved in closed form. Cells -1 and width - 1 are the
+ * clamped half texel borders.
+ */
+static bool hit_cell(const HeightField &f, const CellRay &r, int32_t ix, int32_t iy, double ta, double tb, double &t)
+{
+    const double h00 = cell_height(f, ix, iy), h10 = cell_height(f, ix + 1, iy);
+    const double h01 = cell_height(f, ix, iy + 1), h11 = cell_height(f, ix + 1, iy + 1);
+    const double e1 = h10 - h00, e2 = h01 - h00, e3 = h00 - h10 - h01 + h11;
+    const double ax = r.ox - ix, ay = r.oy - iy;
+
+    // gap(t) = qa t^2 + qb t + qc
+    const double qa = -e3 * r.dx * r.dy;
+    const double qb = r.dh - (e1 * r.dx + e2 * r.dy + e3 * (ax * r.dy + ay * r.dx));
+    const double qc = r.oh - (h00 + e1 * ax + e2 * ay + e3 * ax * ay);
+    const auto gap = [&](double s) { return (qa * s + qb) * s + qc; };
+
+    if (gap(ta) <= 0.0)
+    {
+        t = ta;
+        return true;
+    }
+
+    double best = tb + 1.0;
+    const auto consider = [&](double root) {
+        if (root > ta && root <= tb)
+            best = std::min(best, root);
+    };
+
+    if (std::abs(qa) <= 1e-12 * (std::abs(qb) + std::abs(qc)))
+    {
+        if (qb != 0.0)
+            consider(-qc / qb);
+    }
+    else
+    {
+        const double disc = qb * qb - 4.0 * qa * qc;
+        if (disc >= 0.0)
+        {
+            // cancellation free pair of roots
+            const double q = -0.5 * (qb + std::copysign(std::sqrt(disc), qb));
+            consider(q / qa);
+            if (q != 0.0)
+                consider(qc / q);
+        }
+    }
+
+    if (best <= tb)
+    {
+        t = best;
+        return true;
+    }
+    // a tangent root lost to rounding
+    if (gap(tb) <= 0.0)
+    {
+        t = tb;
+        return true;
+    }
+    return false;
+}
+
+RayHit raycastHeightField(const HeightField &field, glm::vec3 origin, glm::vec3 direction, float tMax)
+{
+    RayHit result;
+    if (field.bounds.empty())
+        return result;
+
+    const double kx = field.width / static_cast<double>(field.extent.x);
+    const double ky = field.height / static_cast<double>(field.extent.y);
+    const CellRay r{(origin.x - field.origin.x) * kx - 0.5, (origin.z - field.origin.y) * ky - 0.5, origin.y,
+                    direction.x * kx, direction.z * ky, direction.y};
+
+    const int32_t lastX = static_cast<int32_t>(field.width) - 2;
+    const int32_t lastY = static_cast<int32_t>(field.height) - 2;
+    const size_t top = field.bounds.size() - 1;
+
+    // the part over uv [0, 1] and below the highest texel; a ray starting under the terrain hits where it enters
+    double t0 = 0.0, t1 = tMax;
+    if (!clip_slab(r.ox, r.dx, -0.5, field.width - 0.5, t0, t1) || !clip_slab(r.oy, r.dy, -0.5, field.height - 0.5, t0, t1) ||
+        !clip_slab(r.oh, r.dh, -OPEN, texel_height(field.bounds[top].max.at(0u, 0u)), t0, t1))
+        return result;
+
+    // current cell, clamped to the cells the bounds cover; the border cells share their neighbour's blocks
+    int32_t cx = std::clamp(static_cast<int32_t>(std::floor(r.ox + r.dx * t0)), 0, lastX);
+    int32_t cy = std::clamp(static_cast<int32_t>(std::floor(r.oy + r.dy * t0)), 0, lastY);
+    size_t level = top;
+
+    while (true)
+    {
+        const MinMaxLevel &l = field.bounds[level];
+        const int32_t shift = static_cast<int32_t>(level) + 1;
+        const int32_t bx = cx >> shift, by = cy >> shift;
+
+        // block cells, edge blocks open towards the border
+        const int32_t loX = bx << shift, hiX = std::min(((bx + 1) << shift) - 1, lastX);
+        const int32_t loY = by << shift, hiY = std::min(((by + 1) << shift) - 1, lastY);
+        const double x0 = loX == 0 ? -OPEN : loX, x1 = hiX == lastX ? OPEN : hiX + 1.0;
+        const double y0 = loY == 0 ? -OPEN : loY, y1 = hiY == lastY ? OPEN : hiY + 1.0;
+
+        double ta = t0, tb = t1;
+        clip_slab(r.ox, r.dx, x0, x1, ta, tb);
+        clip_slab(r.oy, r.dy, y0, y1, ta, tb);
+
+        const double maxHeight = texel_height(l.max.at(static_cast<uint32_t>(bx), static_cast<uint32_t>(by)));
+        const bool above = ta > tb || std::min(r.oh + r.dh * ta, r.oh + r.dh * tb) > maxHeight;
+
+        if (!above && level > 0)
+        {
+            --level;
+            continue;
+        }
+
+        if (!above)
+        {
+            // finest block, solve every cell it holds (up to 3x3 with the borders) and keep the nearest hit
+            double best = tb + 1.0;
+            for (int32_t iy = loY == 0 ? -1 : loY; iy <= (hiY == lastY ? lastY + 1 : hiY); ++iy)
+            {
+                for (int32_t ix = loX == 0 ? -1 : loX; ix <= (hiX == lastX ? lastX + 1 : hiX); ++ix)
+                {
+                    double ca = ta, cb = std::min(tb, best);
+                    double t;
+                    if (clip_slab(r.ox, r.dx, ix, ix + 1.0, ca, cb) && clip_slab(r.oy, r.dy, iy, iy + 1.0, ca, cb) &&
+                        hit_cell(field, r, ix, iy, ca, cb, t))
+                        best = std::min(best, t);
+                }
+            }
+            if (best <= tb)
+            {
+                result.hit = true;
+                result.t = static_cast<float>(best);
+                result.position = origin + direction * result.t;
+                return result;
+            }
+        }
+
+        if (tb >= t1)
+            return result;
+
+        // step into the neighbouring block across the face the ray leaves through
+        const double exitX = r.dx > 0.0 ? (x1 - r.ox) / r.dx : r.dx < 0.0 ? (x0 - r.ox) / r.dx : OPEN;
+        const double exitY = r.dy > 0.0 ? (y1 - r.oy) / r.dy : r.dy < 0.0 ? (y0 - r.oy) / r.dy : OPEN;
+        cx = exitX <= tb ? (r.dx > 0.0 ? hiX + 1 : loX - 1) : std::clamp(static_cast<int32_t>(std::floor(r.ox + r.dx * tb)), loX, hiX);
+        cy = exitY <= tb ? (r.dy > 0.0 ? hiY + 1 : loY - 1) : std::clamp(static_cast<int32_t>(std::floor(r.oy + r.dy * tb)), loY, hiY);
+        if (cx < 0 || cx > lastX || cy < 0 || cy > lastY)
+            return result;
+
+        level = std::min(level + 1, top);
+    }
+}
+
+void raycastHeightField(const HeightField &field, const glm::vec3 *origins, const glm::vec3 *directions, size_t count, float tMax,
+                        RayHit *hits, WorkerPool *pool)
+{
+    const auto cast = [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            hits[i] = raycastHeightField(field, origins[i], directions[i], tMax);
+    };
+    if (pool)
+        pool->parallelFor(count, RAY_GRAIN, cast);
+    else
+        cast(0u, count, 0u);
+}
+
+RayHit marchHeightField(const HeightField &field, glm::vec3 origin, glm::vec3 direction, float tMax, float step)
+{
+    RayHit result;
+
+    const glm::vec2 texelsPerUnit{field.width / field.extent.x, field.height / field.extent.y};
+    const float horizontal = std::max(std::abs(direction.x) * texelsPerUnit.x, std::abs(direction.z) * texelsPerUnit.y);
+    const float dt = horizontal > 0.0f ? step / horizontal : step / std::abs(direction.y);
+
+    const auto gap = [&](float t) {
+        const glm::vec3 p = origin + direction * t;
+        return p.y - field.sample((p.x - field.origin.x) / field.extent.x, (p.z - field.origin.y) / field.extent.y);
+    };
+
+    // only the part of the ray over the terrain and below its highest texel
+    double t0 = 0.0, t1 = tMax;
+    const double kx = texelsPerUnit.x, ky = texelsPerUnit.y;
+    if (!clip_slab((origin.x - field.origin.x) * kx, direction.x * kx, 0.0, field.width, t0, t1) ||
+        !clip_slab((origin.z - field.origin.y) * ky, direction.z * ky, 0.0, field.height, t0, t1) ||
+        !clip_slab(origin.y, direction.y, -OPEN, texel_height(field.bounds.back().max.at(0u, 0u)), t0, t1))
+        return result;
+
+    const float end = static_cast<float>(t1);
+    float prev = static_cast<float>(t0);
+    if (gap(prev) > 0.0f)
+    {
+        while (true)
+        {
+            if (prev >= end)
+                return result;
+            const float t = std::min(prev + dt, end);
+            if (gap(t) <= 0.0f)
+            {
+                float lo = prev, hi = t;
+                for (int i = 0; i < 24; ++i)
+                {
+                    const float mid = 0.5f * (lo + hi);
+                    (gap(mid) > 0.0f ? lo : hi) = mid;
+                }
+                prev = hi;
+                break;
+            }
+            prev = t;
+        }
+    }
+
+    result.hit = true;
+    result.t = prev;
+    result.position = origin + direction * prev;
+    return result;
+}
+
+void viewportRay(const glm::mat4 &view, const glm::mat4 &projection, float x, float y, float width, float height, glm::vec3 &origin,
+                 glm::vec3 &direction)
+{
+    const glm::mat4 inverse = glm::inverse(projection * view);
+    const float ndcX = 2.0f * x / width - 1.0f;
+    const float ndcY = 1.0f - 2.0f * y / height;
+
+    const glm::vec4 near = inverse * glm::vec4{ndcX, ndcY, -1.0f, 1.0f};
+    const glm::vec4 far = inverse * glm::vec4{ndcX, ndcY, 1.0f, 1.0f};
+    origin = glm::vec3{near} / near.w;
+    direction = glm::normalize(glm::vec3{far} / far.w - origin);
+}
@@ -0,0 +1,40 @@
+#ifndef TERRAIN_RAY_HPP
+#define TERRAIN_RAY_HPP
+
+#include <cfloat>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+
+struct WorkerPool;
+
+struct RayHit
+{
+    bool hit = false;
+    float t = 0.0f;           // position = origin + direction * t
+    glm::vec3 position{0.0f}; // world space
+};
+
+/**
+ * @brief First point of origin + direction * t, t in [0, tMax], on or below
+ * the terrain. Walks the max levels of field.bounds top down, skipping every
+ * block the ray passes above, and solves the ray against the bilinear patch
+ * of the texel heights in the cells that remain. That surface is the Float
+ * filter; under Fixed8 it differs by less than one 8 bit step.
+ */
+RayHit raycastHeightField(const HeightField &field, glm::vec3 origin, glm::vec3 direction, float tMax = FLT_MAX);
+
+// independent rays (sensor fans, AI probes), split over pool when given
+void raycastHeightField(const HeightField &field, const glm::vec3 *origins, const glm::vec3 *directions, size_t count, float tMax,
+                        RayHit *hits, WorkerPool *pool = nullptr);
+
+// reference: fixed steps of step texels through field.sample(), refined by bisection
+RayHit marchHeightField(const HeightField &field, glm::vec3 origin, glm::vec3 direction, float tMax = FLT_MAX, float step = 0.5f);
+
+// ray through the viewport pixel (x, y), top-left origin, direction normalized
+void viewportRay(const glm::mat4 &view, const glm::mat4 &projection, float x, float y, float width, float height, glm::vec3 &origin,
+                 glm::vec3 &direction);
+
+#endif // TERRAIN_RAY_HPP
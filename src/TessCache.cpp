@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "TessCache.hpp"
+#include "TessLod.hpp"
+#include "Helpers.hpp"
+#include "Defines.hpp"
+
+constexpr size_t ALLOCATION_ALIGNMENT = 256u;
+
+const std::vector<const char *> TessCache::CAPTURE_VARYINGS = {"WorldPos", "Height", "debugColor"};
+
+/**
+ * @brief Packs the 6 tess levels and the summed LOD bands (drives debugColor)
+ * of a patch into a single key. Two patches with equal keys produce the same
+ * tessellation topology.
+ */
+static uint64_t patch_key(const glm::vec3 *corners, const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges, size_t &vertexBound)
+{
+    const PatchTess tess = patch_tessellation(corners, cameraPos, maxTessLevel, lodRanges);
+    vertexBound = tess.triangles * 3;
+
+    uint64_t key = 0;
+    for (int i = 0; i < 4; ++i)
+        key = (key << 8) | static_cast<uint8_t>(std::clamp(tess.outer[i], 0, 255));
+    for (int i = 0; i < 2; ++i)
+        key = (key << 8) | static_cast<uint8_t>(std::clamp(tess.inner[i], 0, 255));
+    key = (key << 8) | static_cast<uint8_t>(tess.band[0] + tess.band[1] + tess.band[2] + tess.band[3]);
+
+    return key;
+}
+
+void TessCache::init(GLuint capture, GLuint draw, const std::vector<glm::vec3> &points, size_t capacityBytes)
+{
+    captureProgram = capture;
+    drawProgram = draw;
+    controlPoints = points;
+
+    const size_t patchCount = controlPoints.size() / 4;
+    slots.assign(patchCount, {});
+    for (Slot &slot : slots)
+        glGenTransformFeedbacks(1, &slot.feedback);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, capacityBytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+    // separate attrib format / binding so every patch only rebinds the buffer offset
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    glEnableVertexAttribArray(0u);
+    glVertexAttribFormat(0u, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, worldPos));
+    glVertexAttribBinding(0u, 0u);
+
+    glEnableVertexAttribArray(1u);
+    glVertexAttribFormat(1u, 1, GL_FLOAT, GL_FALSE, offsetof(Vertex, height));
+    glVertexAttribBinding(1u, 0u);
+
+    glEnableVertexAttribArray(2u);
+    glVertexAttribFormat(2u, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, debugColor));
+    glVertexAttribBinding(2u, 0u);
+
+    glBindVertexArray(0u);
+
+    stats = {};
+    stats.bytesCapacity = capacityBytes;
+    freeList = {{0u, capacityBytes}};
+}
+
+void TessCache::release()
+{
+    for (Slot &slot : slots)
+        glDeleteTransformFeedbacks(1, &slot.feedback);
+    slots.clear();
+
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteBuffers(1, &buffer);
+    vertexArray = 0;
+    buffer = 0;
+    freeList.clear();
+}
+
+void TessCache::invalidate()
+{
+    for (Slot &slot : slots)
+        slot.valid = false;
+
+    freeList = {{0u, stats.bytesCapacity}};
+    stats.bytesUsed = 0;
+}
+
+void TessCache::invalidate(const glm::vec2 &min, const glm::vec2 &max)
+{
+    for (size_t patch = 0; patch < slots.size(); ++patch)
+    {
+        Slot &slot = slots[patch];
+        if (!slot.valid)
+            continue;
+
+        glm::vec2 patchMin{controlPoints[patch * 4].x, controlPoints[patch * 4].z}, patchMax = patchMin;
+        for (size_t i = 1; i < 4; ++i)
+        {
+            const glm::vec3 &p = controlPoints[patch * 4 + i];
+            patchMin = glm::min(patchMin, glm::vec2{p.x, p.z});
+            patchMax = glm::max(patchMax, glm::vec2{p.x, p.z});
+        }
+        if (patchMax.x < min.x || patchMin.x > max.x || patchMax.y < min.y || patchMin.y > max.y)
+            continue;
+
+        free(slot.offset, slot.size);
+        slot.valid = false;
+    }
+}
+
+void TessCache::update(const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges, GLuint patchVertexArray)
+{
+    capture.clear();
+    live.clear();
+
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.overflows = 0;
+
+    for (size_t patch = 0; patch < slots.size(); ++patch)
+    {
+        Slot &slot = slots[patch];
+
+        size_t vertexBound = 0;
+        const uint64_t key = patch_key(&controlPoints[patch * 4], cameraPos, maxTessLevel, lodRanges, vertexBound);
+
+        ++stats.totalLookups;
+        if (slot.valid && slot.key == key)
+        {
+            ++stats.hits;
+            ++stats.totalHits;
+            continue;
+        }
+
+        ++stats.misses;
+        if (slot.valid)
+        {
+            free(slot.offset, slot.size);
+            slot.valid = false;
+        }
+
+        const size_t size = vertexBound * sizeof(Vertex);
+        if (!allocate(size, slot.offset))
+        {
+            ++stats.overflows;
+            live.push_back(patch);
+            continue;
+        }
+
+        slot.size = size;
+        slot.key = key;
+        slot.valid = true;
+        capture.push_back(patch);
+    }
+
+    // -- re-tessellate changed patches into their buffer ranges --
+    if (!capture.empty())
+    {
+        glUseProgram(captureProgram);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(patchVertexArray);
+
+        for (const size_t patch : capture)
+        {
+            const Slot &slot = slots[patch];
+            glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, slot.feedback);
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0u, buffer, slot.offset, slot.size);
+            glBeginTransformFeedback(GL_TRIANGLES);
+            glDrawArrays(GL_PATCHES, static_cast<GLint>(patch * 4), 4);
+            glEndTransformFeedback();
+        }
+
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0u);
+        glDisable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(0u);
+    }
+}
+
+void TessCache::draw(GLuint liveProgram, GLuint patchVertexArray)
+{
+    // -- draw cached triangles, vertex counts come straight from the feedback objects --
+    glUseProgram(drawProgram);
+
+    glBindVertexArray(vertexArray);
+    for (const Slot &slot : slots)
+    {
+        if (!slot.valid)
+            continue;
+
+        glBindVertexBuffer(0u, buffer, slot.offset, sizeof(Vertex));
+        glDrawTransformFeedback(GL_TRIANGLES, slot.feedback);
+    }
+
+    // -- patches without cache space are tessellated as usual --
+    if (!live.empty())
+    {
+        glUseProgram(liveProgram);
+        glBindVertexArray(patchVertexArray);
+        for (const size_t patch : live)
+            glDrawArrays(GL_PATCHES, static_cast<GLint>(patch * 4), 4);
+    }
+
+    glBindVertexArray(0u);
+}
+
+float TessCache::hitRate() const
+{
+    return stats.totalLookups ? static_cast<float>(stats.totalHits) / static_cast<float>(stats.totalLookups) : 0.0f;
+}
+
+bool TessCache::allocate(size_t size, size_t &offset)
+{
+    size = (size + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1);
+
+    // first fit, the list stays short since patch sizes only come in a few classes
+    for (auto it = freeList.begin(); it != freeList.end(); ++it)
+    {
+        if (it->size < size)
+            continue;
+
+        offset = it->offset;
+        it->offset += size;
+        it->size -= size;
+        if (it->size == 0)
+            freeList.erase(it);
+
+        stats.bytesUsed += size;
+        return true;
+    }
+
+    return false;
+}
+
+void TessCache::free(size_t offset, size_t size)
+{
+    size = (size + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1);
+    stats.bytesUsed -= size;
+
+    auto it = std::lower_bound(freeList.begin(), freeList.end(), offset,
+                               [](const Range &range, size_t o) { return range.offset < o; });
+    it = freeList.insert(it, {offset, size});
+
+    // merge with the following range
+    auto next = it + 1;
+    if (next != freeList.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        freeList.erase(next);
+    }
+
+    // merge with the preceding range
+    if (it != freeList.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset)
+        {
+            prev->size += it->size;
+            freeList.erase(it);
+        }
+    }
+}
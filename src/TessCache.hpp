@@ -0,0 +1,96 @@
+#ifndef TESS_CACHE_HPP
+#define TESS_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Caches tessellated + displaced terrain patches captured with
+ * transform feedback. Tess levels in test_tcs.glsl depend only on the
+ * distance from the camera to the patch corners, so a still or rotating
+ * camera re-produces identical triangles every frame. Each patch owns a
+ * sub-range of one large vertex buffer, keyed by its tess factors, and is
+ * only re-captured once those factors change.
+ */
+struct TessCache
+{
+    // Interleaved layout written by GL_INTERLEAVED_ATTRIBS, see CAPTURE_VARYINGS
+    struct Vertex
+    {
+        float worldPos[3];
+        float height;
+        float debugColor[3];
+    };
+
+    struct Slot
+    {
+        uint64_t key = 0;
+        size_t offset = 0;
+        size_t size = 0;
+        GLuint feedback = 0;
+        bool valid = false;
+    };
+
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t overflows = 0; // patches drawn live because the buffer was full
+        uint64_t totalHits = 0;
+        uint64_t totalLookups = 0;
+        size_t bytesUsed = 0;
+        size_t bytesCapacity = 0;
+    };
+
+    GLuint captureProgram = 0;
+    GLuint drawProgram = 0;
+    GLuint buffer = 0;
+    GLuint vertexArray = 0;
+
+    std::vector<glm::vec3> controlPoints; // 4 per patch, world space
+    std::vector<Slot> slots;
+    std::vector<Range> freeList; // sorted by offset, coalesced on release
+    std::vector<size_t> capture;  // per frame scratch, patch indices
+    std::vector<size_t> live;
+    Stats stats;
+
+    static const std::vector<const char *> CAPTURE_VARYINGS;
+
+    void init(GLuint captureProgram, GLuint drawProgram, const std::vector<glm::vec3> &controlPoints, size_t capacityBytes);
+    void release();
+
+    // drops every cached patch, e.g. after the heightmap changed
+    void invalidate();
+
+    // drops the patches overlapping the world xz rectangle, for local heightmap edits
+    void invalidate(const glm::vec2 &min, const glm::vec2 &max);
+
+    /**
+     * @brief Re-captures patches whose tess factors changed. Expects the
+     * FrameUniforms block and the heightmap to be bound.
+     */
+    void update(const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges, GLuint patchVertexArray);
+
+    /**
+     * @brief Draws the whole terrain from the cache. Patches that did not fit
+     * in the buffer during update() are drawn live with liveProgram.
+     */
+    void draw(GLuint liveProgram, GLuint patchVertexArray);
+
+    float hitRate() const;
+
+private:
+    bool allocate(size_t size, size_t &offset);
+    void free(size_t offset, size_t size);
+};
+
+#endif // TESS_CACHE_HPP
@@ -0,0 +1,79 @@
+#ifndef TESS_LOD_HPP
+#define TESS_LOD_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// -- CPU mirror of selectLOD() in test_tcs.glsl, keep both in sync --
+constexpr int NUM_LOD_RANGES = 4;
+constexpr float DEFAULT_LOD_RANGES[NUM_LOD_RANGES] = {200.0f, 400.0f, 800.0f, 1000.0f};
+
+inline int select_lod_band(float d, const glm::vec4 &lodRanges)
+{
+    for (int band = 0; band < NUM_LOD_RANGES - 1; ++band)
+        if (d < lodRanges[band])
+            return band;
+    return NUM_LOD_RANGES - 1;
+}
+
+// default bands stretched by scale, scale > 1 keeps fine levels further out
+inline glm::vec4 scaled_lod_ranges(float scale)
+{
+    return glm::vec4{DEFAULT_LOD_RANGES[0], DEFAULT_LOD_RANGES[1], DEFAULT_LOD_RANGES[2], DEFAULT_LOD_RANGES[3]} * scale;
+}
+
+inline int band_tess_level(int band, int maxTessLevel)
+{
+    // matches the integer division done in GLSL (u_maxTessLevel / num_lod_ranges * n)
+    return band == 0 ? maxTessLevel : maxTessLevel / NUM_LOD_RANGES * (NUM_LOD_RANGES - band);
+}
+
+// fractional_odd_spacing rounds every level up to the next odd integer
+inline size_t odd_ceil(int level)
+{
+    const int clamped = std::clamp(level, 1, 64);
+    return static_cast<size_t>(clamped % 2 == 0 ? clamped + 1 : clamped);
+}
+
+struct PatchTess
+{
+    int band[4];  // per corner, order 00, 01, 10, 11
+    int outer[4];
+    int inner[2];
+    size_t triangles; // conservative bound
+
+    // finest band touching the patch
+    int finestBand() const { return std::min(std::min(band[0], band[1]), std::min(band[2], band[3])); }
+};
+
+/**
+ * @brief Tess levels test_tcs.glsl assigns to the patch with the given
+ * corners, and a conservative triangle count for them.
+ */
+inline PatchTess patch_tessellation(const glm::vec3 *corners, const glm::vec3 &cameraPos, int maxTessLevel, const glm::vec4 &lodRanges)
+{
+    PatchTess tess;
+    int level[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        tess.band[i] = select_lod_band(glm::length(corners[i] - cameraPos), lodRanges);
+        level[i] = band_tess_level(tess.band[i], maxTessLevel);
+    }
+
+    tess.outer[0] = std::max(level[2], level[0]);
+    tess.outer[1] = std::max(level[0], level[1]);
+    tess.outer[2] = std::max(level[1], level[3]);
+    tess.outer[3] = std::max(level[3], level[2]);
+    tess.inner[0] = std::max(level[1], level[3]);
+    tess.inner[1] = std::max(level[0], level[2]);
+
+    // interior grid + the ring stitched to each outer edge
+    const size_t a = odd_ceil(tess.inner[0]);
+    const size_t b = odd_ceil(tess.inner[1]);
+    tess.triangles = 2 * a * b + 2 * (odd_ceil(tess.outer[0]) + odd_ceil(tess.outer[1]) + odd_ceil(tess.outer[2]) + odd_ceil(tess.outer[3]));
+    return tess;
+}
+
+#endif // TESS_LOD_HPP
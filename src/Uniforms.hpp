@@ -0,0 +1,38 @@
+#ifndef UNIFORMS_HPP
+#define UNIFORMS_HPP
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+enum
+{
+    UNIFORM_BINDING_FRAME = 0,
+    UNIFORM_BINDING_COUNT
+};
+
+// std140 mirror of the FrameUniforms block declared in the test_* / tess_cache shaders
+struct FrameUniforms
+{
+    glm::mat4 viewMatrix;
+    glm::mat4 projMatrix;
+    int32_t minTessLevel;
+    int32_t maxTessLevel;
+    float minRange;
+    float maxRange;
+    int32_t showDebugLOD;
+    int32_t pad[3];
+    glm::vec4 lodRanges; // band limits of selectLOD() in test_tcs.glsl
+    int32_t showViewshed;
+    int32_t pad2[3];
+    glm::vec4 viewshedRect; // world xz min corner and size the viewshed texture covers
+    int32_t shading;        // AppManager::shading
+    int32_t shadows;        // horizon map sun shadows
+    int32_t pad3[2];
+    glm::vec4 lightDir;     // world, towards the sun; w is the sun's angular radius
+    glm::vec4 terrainRect;  // world xz min corner and size of the heightmap and its derived maps
+};
+
+static_assert(sizeof(FrameUniforms) == 256, "FrameUniforms must match the std140 block layout");
+
+#endif // UNIFORMS_HPP
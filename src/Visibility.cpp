@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#include "Visibility.hpp"
+#include "WorkerPool.hpp"
+
+// texels between terrain samples along a sight line
+constexpr float LOS_SPACING = 0.5f;
+
+// samples per batched height query, keeps the scratch on the stack
+constexpr size_t LOS_BLOCK = 256;
+
+// sight lines per parallelFor chunk
+constexpr size_t LOS_GRAIN = 16;
+
+// viewshed rays per sector, sectors are claimed by the pool workers as they free up
+constexpr size_t SECTOR_RAYS = 32;
+
+bool lineOfSight(const HeightField &field, glm::vec3 observer, glm::vec3 target)
+{
+    const glm::vec2 uv0{(observer.x - field.origin.x) / field.extent.x, (observer.z - field.origin.y) / field.extent.y};
+    const glm::vec2 uv1{(target.x - field.origin.x) / field.extent.x, (target.z - field.origin.y) / field.extent.y};
+    const glm::vec2 delta = uv1 - uv0;
+    const float rise = target.y - observer.y;
+
+    const float texels = std::sqrt(delta.x * delta.x * field.width * field.width + delta.y * delta.y * field.height * field.height);
+    const size_t steps = std::max<size_t>(static_cast<size_t>(std::ceil(texels / LOS_SPACING)), 1u);
+    const float invSteps = 1.0f / static_cast<float>(steps);
+
+    // interior samples only, end points resting on the surface do not block themselves
+    float u[LOS_BLOCK], v[LOS_BLOCK], ray[LOS_BLOCK], terrain[LOS_BLOCK];
+    for (size_t begin = 1; begin < steps; begin += LOS_BLOCK)
+    {
+        const size_t count = std::min(LOS_BLOCK, steps - begin);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float s = static_cast<float>(begin + i) * invSteps;
+            u[i] = uv0.x + delta.x * s;
+            v[i] = uv0.y + delta.y * s;
+            ray[i] = observer.y + rise * s;
+        }
+        field.sample(u, v, terrain, count);
+
+        int blocked = 0;
+        for (size_t i = 0; i < count; ++i)
+            blocked |= terrain[i] > ray[i];
+        if (blocked)
+            return false;
+    }
+    return true;
+}
+
+void lineOfSight(const HeightField &field, const glm::vec3 *observers, const glm::vec3 *targets, size_t count, uint8_t *visible,
+                 WorkerPool *pool)
+{
+    const auto test = [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i)
+            visible[i] = lineOfSight(field, observers[i], targets[i]) ? 1u : 0u;
+    };
+    if (pool)
+        pool->parallelFor(count, LOS_GRAIN, test);
+    else
+        test(0u, count, 0u);
+}
+
+glm::vec4 Viewshed::worldRect(const HeightField &field) const
+{
+    const float texelX = field.extent.x / static_cast<float>(field.width);
+    const float texelY = field.extent.y / static_cast<float>(field.height);
+    return {field.origin.x + static_cast<float>(x) * texelX, field.origin.y + static_cast<float>(y) * texelY,
+            static_cast<float>(width) * texelX, static_cast<float>(height) * texelY};
+}
+
+Viewshed computeViewshed(const HeightField &field, const ViewshedSettings &settings, WorkerPool *pool)
+{
+    Viewshed result;
+
+    // texel coordinates, texel i centered on i
+    const float kx = static_cast<float>(field.width) / field.extent.x;
+    const float ky = static_cast<float>(field.height) / field.extent.y;
+    const int32_t lastX = static_cast<int32_t>(field.width) - 1;
+    const int32_t lastY = static_cast<int32_t>(field.height) - 1;
+    const int32_t ox = std::clamp(static_cast<int32_t>(std::lround((settings.observer.x - field.origin.x) * kx - 0.5f)), 0, lastX);
+    const int32_t oy = std::clamp(static_cast<int32_t>(std::lround((settings.observer.y - field.origin.y) * ky - 0.5f)), 0, lastY);
+    const float eye = field.sample((settings.observer.x - field.origin.x) / field.extent.x, (settings.observer.y - field.origin.y) / field.extent.y) +
+                      settings.observerHeight;
+
+    const int32_t rx = static_cast<int32_t>(std::ceil(settings.radius * kx));
+    const int32_t ry = static_cast<int32_t>(std::ceil(settings.radius * ky));
+    const int32_t x0 = std::max(ox - rx, 0), x1 = std::min(ox + rx, lastX);
+    const int32_t y0 = std::max(oy - ry, 0), y1 = std::min(oy + ry, lastY);
+
+    result.x = static_cast<uint32_t>(x0);
+    result.y = static_cast<uint32_t>(y0);
+    result.width = static_cast<uint32_t>(x1 - x0 + 1);
+    result.height = static_cast<uint32_t>(y1 - y0 + 1);
+    result.visible.assign(static_cast<size_t>(result.width) * result.height, 0u);
+    result.visible[static_cast<size_t>(oy - y0) * result.width + static_cast<size_t>(ox - x0)] = 255u;
+
+    // ray end points: the region border, in order around it so neighbouring rays share a sector
+    std::vector<glm::ivec2> border;
+    for (int32_t x = x0; x <= x1; ++x)
+        border.push_back({x, y0});
+    for (int32_t y = y0 + 1; y <= y1; ++y)
+        border.push_back({x1, y});
+    for (int32_t x = x1 - 1; x >= x0 && y1 > y0; --x)
+        border.push_back({x, y1});
+    for (int32_t y = y1 - 1; y > y0 && x1 > x0; --y)
+        border.push_back({x0, y});
+
+    const auto height = [&](int32_t x, int32_t y) {
+        return texel_height(field.texels.at(static_cast<uint32_t>(std::min(x, lastX)), static_cast<uint32_t>(std::min(y, lastY))));
+    };
+    const auto mark = [&](int32_t x, int32_t y) {
+        // several rays may reach a texel, all of them only ever store 255
+        std::atomic_ref<uint8_t>(result.visible[static_cast<size_t>(y - y0) * result.width + static_cast<size_t>(x - x0)])
+            .store(255u, std::memory_order_relaxed);
+    };
+
+    const auto sweep = [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r)
+        {
+            const int32_t dx = border[r].x - ox, dy = border[r].y - oy;
+            const int32_t steps = std::max(std::abs(dx), std::abs(dy));
+            if (steps == 0)
+                continue;
+
+            // the major axis advances one texel per step, the minor one is interpolated across two texels
+            const bool alongX = std::abs(dx) >= std::abs(dy);
+            const float minorStep = static_cast<float>(alongX ? dy : dx) / static_cast<float>(steps);
+            const float worldStep = std::sqrt((dx / kx) * (dx / kx) + (dy / ky) * (dy / ky)) / static_cast<float>(steps);
+
+            float horizon = -FLT_MAX;
+            for (int32_t k = 1; k <= steps; ++k)
+            {
+                const int32_t major = (alongX ? ox : oy) + (alongX ? (dx > 0 ? k : -k) : (dy > 0 ? k : -k));
+                const float minor = static_cast<float>(alongX ? oy : ox) + minorStep * static_cast<float>(k);
+                const int32_t m0 = static_cast<int32_t>(std::floor(minor));
+                const float f = minor - static_cast<float>(m0);
+                const int32_t nearest = f < 0.5f ? m0 : m0 + 1;
+
+                const int32_t cx = alongX ? major : nearest, cy = alongX ? nearest : major;
+                const float h0 = alongX ? height(major, m0) : height(m0, major);
+                const float h1 = alongX ? height(major, m0 + 1) : height(m0 + 1, major);
+                const float terrain = h0 + (h1 - h0) * f;
+
+                const float cellX = static_cast<float>(cx - ox) / kx, cellY = static_cast<float>(cy - oy) / ky;
+                const float cellDistance = std::sqrt(cellX * cellX + cellY * cellY);
+                if ((height(cx, cy) + settings.targetHeight - eye) / cellDistance >= horizon)
+                    mark(cx, cy);
+                horizon = std::max(horizon, (terrain - eye) / (worldStep * static_cast<float>(k)));
+            }
+        }
+    };
+
+    if (pool)
+        pool->parallelFor(border.size(), SECTOR_RAYS, sweep);
+    else
+        sweep(0u, border.size(), 0u);
+
+    return result;
+}
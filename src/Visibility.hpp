@@ -0,0 +1,52 @@
+#ifndef VISIBILITY_HPP
+#define VISIBILITY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "HeightField.hpp"
+
+struct WorkerPool;
+
+/**
+ * @brief True when the segment observer -> target (world space) clears the
+ * terrain. The terrain is sampled every half texel between the end points
+ * through the batched height queries, so the surface is the one the GPU
+ * renders and the samples go through the AVX2 path 8 at a time.
+ */
+bool lineOfSight(const HeightField &field, glm::vec3 observer, glm::vec3 target);
+
+// visible[i] = 1 when observers[i] sees targets[i], split over pool when given
+void lineOfSight(const HeightField &field, const glm::vec3 *observers, const glm::vec3 *targets, size_t count, uint8_t *visible,
+                 WorkerPool *pool = nullptr);
+
+struct ViewshedSettings
+{
+    glm::vec2 observer{0.0f};    // world xz
+    float observerHeight = 2.0f; // eye above the ground
+    float targetHeight = 0.0f;   // a texel counts as visible when this far above it is
+    float radius = 512.0f;       // world units, square region
+};
+
+struct Viewshed
+{
+    uint32_t x = 0, y = 0;          // first texel of the region
+    uint32_t width = 0, height = 0; // texels
+    std::vector<uint8_t> visible;   // 255 visible, 0 hidden, bottom row first
+
+    // world xz of the region's texel footprints: min corner, size
+    glm::vec4 worldRect(const HeightField &field) const;
+};
+
+/**
+ * @brief R2 viewshed: one ray from the observer to every texel on the border
+ * of the region, each walking its major axis texel by texel while tracking
+ * the steepest horizon so far. Rays are independent, batches of them run as
+ * sectors on the pool; a texel any ray sees is visible.
+ */
+Viewshed computeViewshed(const HeightField &field, const ViewshedSettings &settings, WorkerPool *pool = nullptr);
+
+#endif // VISIBILITY_HPP
@@ -0,0 +1,137 @@
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "WorkerPool.hpp"
+#include "Profiler.hpp"
+
+static bool pin_thread(std::thread::native_handle_type thread, size_t core)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % std::max<size_t>(std::thread::hardware_concurrency(), 1u), &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)core;
+    return false;
+#endif
+}
+
+bool WorkerPool::pinCurrentThread(size_t core)
+{
+#ifdef __linux__
+    return pin_thread(pthread_self(), core);
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+void WorkerPool::init(size_t workerCount, bool pinThreads)
+{
+    if (workerCount == 0)
+    {
+        const size_t hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    quit = false;
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(&WorkerPool::workerLoop, this, i + 1);
+        if (pinThreads)
+            pin_thread(workers.back().native_handle(), i + 1);
+    }
+}
+
+void WorkerPool::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+void WorkerPool::run(void *ctx, size_t count, size_t grain, InvokeFn invoke)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max<size_t>(grain, 1u);
+
+    // not worth waking anyone for a single chunk
+    if (workers.empty() || count <= grain)
+    {
+        invoke(ctx, 0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobCtx = ctx;
+        jobInvoke = invoke;
+        jobCount = count;
+        jobGrain = grain;
+        next.store(0, std::memory_order_relaxed);
+        active = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return active == 0; });
+}
+
+void WorkerPool::execute(size_t worker)
+{
+    for (;;)
+    {
+        const size_t begin = next.fetch_add(jobGrain, std::memory_order_relaxed);
+        if (begin >= jobCount)
+            return;
+
+        jobInvoke(jobCtx, begin, std::min(begin + jobGrain, jobCount), worker);
+    }
+}
+
+void WorkerPool::workerLoop(size_t worker)
+{
+    g_profiler.setThreadName("worker " + std::to_string(worker));
+
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+
+        {
+            PROFILE_CPU("parallel_for");
+            execute(worker);
+        }
+
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last = --active == 0;
+        }
+        if (last)
+            done.notify_one();
+    }
+}
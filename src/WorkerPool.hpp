@@ -0,0 +1,64 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running one parallelFor at a time. The
+ * calling thread participates as worker 0, so per-thread data can be indexed
+ * by the worker argument in [0, threadCount()).
+ */
+struct WorkerPool
+{
+    using InvokeFn = void (*)(void *ctx, size_t begin, size_t end, size_t worker);
+
+    void init(size_t workerCount = 0, bool pinThreads = false); // 0 = hardware_concurrency - 1
+    void release();
+
+    // pins the calling thread to one core, worker i runs on core i when the pool is pinned
+    static bool pinCurrentThread(size_t core);
+
+    size_t threadCount() const { return workers.size() + 1; }
+
+    /**
+     * @brief Splits [0, count) into chunks of grain items, fn(begin, end, worker)
+     * runs once per chunk. Blocks until every chunk finished. Does not allocate.
+     */
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, Fn &&fn)
+    {
+        using F = std::remove_reference_t<Fn>;
+        run(const_cast<void *>(static_cast<const void *>(&fn)), count, grain,
+            [](void *ctx, size_t begin, size_t end, size_t worker) { (*static_cast<F *>(ctx))(begin, end, worker); });
+    }
+
+private:
+    void run(void *ctx, size_t count, size_t grain, InvokeFn invoke);
+    void execute(size_t worker);
+    void workerLoop(size_t worker);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // current job, published under mutex
+    void *jobCtx = nullptr;
+    InvokeFn jobInvoke = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    uint64_t generation = 0;
+    size_t active = 0;
+    bool quit = false;
+
+    std::atomic<size_t> next{0};
+};
+
+#endif // WORKER_POOL_HPP
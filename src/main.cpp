@@ -1,86 +1,174 @@
-#include <array>
-#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <stb/stb_image.h>
 #include <imgui/imgui.h>
 #include <imgui/backends/imgui_impl_glfw.h>
 #include <imgui/backends/imgui_impl_opengl3.h>
 
+#include "Calibration.hpp"
+#include "CollisionMesh.hpp"
 #include "Defines.hpp"
-#include "Helpers.hpp"
+#include "FrameCapture.hpp"
+#include "FramePacer.hpp"
+#include "GlCapture.hpp"
+#include "HeightField.hpp"
+#include "InputLog.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "TerrainEdit.hpp"
+#include "TerrainRay.hpp"
+#include "Visibility.hpp"
+
+FramePacer g_pacer;
+
+struct InputManager
+{
+    enum Mode
+    {
+        LIVE,
+        RECORDING,
+        REPLAYING,
+    };
 
-constexpr uint32_t VIEWER_WIDTH = 900u;
-constexpr uint32_t VIEWER_HEIGHT = 700u;
-constexpr uint32_t NUM_PATCH_PTS = 4u;
+    Mode mode = LIVE;
+    char logPath[256] = "camera.tcam";
+    InputLog log;
+    uint32_t replayFrame = 0;
+    std::chrono::steady_clock::time_point recordStart;
+    float cursorX = 0.0f, cursorY = 0.0f; // last cursor event, kept through replays and ImGui drags
+    bool cursorSeen = false;
+};
 
-enum
+InputManager g_input;
+
+struct TraceCapture
 {
-    PROGRAM_DEFAULT = 0,
-    PROGRAM_COUNT
+    char path[256] = "terrain.trace.json";
+    int frames = 120;
+    int remaining = 0; // frames left in the running capture
 };
 
-enum
+TraceCapture g_trace;
+
+struct RecordingState
 {
-    TEXTURE_HEIGHTMAP = 0,
-    TEXTURE_COUNT
+    char directory[256] = "captures";     // screenshots and image sequences
+    char stream[256] = "flythrough.rgba"; // raw video, "|cmd" pipes it into an encoder
+    enum Request
+    {
+        NONE,
+        SCREENSHOT,
+        IMAGES,
+        VIDEO
+    } request = NONE; // started before the next capture point, which knows the framebuffer size
 };
 
-enum
+RecordingState g_recording;
+
+struct CalibrationState
+{
+    CalibrationSettings settings;
+    TessProfile profile;
+    bool pending = false; // recalibrate before the next frame
+};
+
+CalibrationState g_calibration;
+
+struct PickState
 {
-    VERTEXARRAY_PATCH_TEST = 0,
-    VERTEXARRAY_PATCHES = 1,
-    VERTEXARRAY_COUNT
+    bool hit = false;
+    glm::vec3 position{0.0f}; // terrain point under the cursor
+    float micros = 0.0f;      // ray cast time
 };
 
-enum
+PickState g_pick;
+
+struct ViewshedState
 {
-    BUFFER_PATCH_TEST_VERTEX = 0,
-    BUFFER_PATCH_VERTEX = 1,
-    BUFFER_COUNT
+    ViewshedSettings settings;
+    bool pending = false; // compute at the last picked point before the next frame
+    float ms = 0.0f;
+    size_t texels = 0;
 };
 
-struct OpenGLManager
+ViewshedState g_viewshed;
+
+struct CollisionState
 {
-    GLuint programs[PROGRAM_COUNT];
-    GLuint textures[TEXTURE_COUNT];
-    GLuint vertexArrays[VERTEXARRAY_COUNT];
-    GLuint buffers[BUFFER_COUNT];
-} g_gl;
+    bool enabled = false;
+    int lod = 2;
+    float radius = 64.0f; // world units around the cursor pick
+    size_t meshes = 0;    // ready around the pick last frame
+    size_t triangles = 0;
+};
 
-struct CameraManager
+CollisionState g_collision;
+CollisionMeshService g_collisionMeshes;
+
+struct SculptState
 {
-    float pitch; // radians
-    float yaw;   // radians
+    bool enabled = false; // left drag sculpts instead of turning the camera
+    Brush brush;
+    int step = 0; // -1 undo, 1 redo before the next frame
+};
 
-    glm::vec3 pos{0.0, 0.0, 50.0};
-    glm::vec3 forward{0.0f, 0.0f, -1.0f};
+SculptState g_sculpt;
+TerrainEditor g_editor;
 
-    glm::mat4 view{1.0f};
-    glm::mat4 projection{1.0f};
-} g_camera;
+static CameraState camera_state()
+{
+    return {g_camera.pos, g_camera.yaw, g_camera.pitch};
+}
 
-struct AppManager
+static void apply_camera_state(const CameraState &state)
 {
-    size_t heightmap_x_dim = 0;
-    size_t heightmap_y_dim = 0;
-    size_t test_vertex_count = 0;
-    size_t vertex_count = 0;
-
-    bool wireframe = false;
-    bool showDebugLOD = false;
-    float heightScale = 1.0f;
-    int renderType = 0; // 0 = test, 1 = scene
-    int minTessLevel = 8;
-    int maxTessLevel = 64;
-    float minRange = 50.0f;  // Min LOD up to ...
-    float maxRange = 500.0f; // Max LOD after ...
-} g_app;
-
-void updateCameraMatrix()
+    g_camera.pos = state.pos;
+    setCameraOrientation(state.yaw, state.pitch);
+}
+
+/**
+ * @brief Captures or applies the camera for the frame about to be rendered.
+ * Runs once per frame after input events have been polled, so a replayed
+ * frame N sees exactly the state recorded for frame N.
+ */
+static void updateInput()
+{
+    if (g_input.mode == InputManager::RECORDING)
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - g_input.recordStart;
+        g_input.log.record(camera_state(), static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+    else if (g_input.mode == InputManager::REPLAYING)
+    {
+        apply_camera_state(g_input.log.stateAt(g_input.replayFrame++));
+        if (g_input.replayFrame >= g_input.log.frameCount)
+            g_input.mode = InputManager::LIVE;
+    }
+}
+
+// casts the ray under the cursor against the published height field
+static void pickTerrain(GLFWwindow *window, double x, double y)
 {
-    g_camera.view = glm::lookAt(g_camera.pos, g_camera.pos + g_camera.forward, {0.0f, 1.0f, 0.0f});
+    const std::shared_ptr<const HeightField> field = currentHeightField();
+    int width = 0, height = 0;
+    glfwGetWindowSize(window, &width, &height);
+    if (!field || width <= 0 || height <= 0)
+        return;
+
+    glm::vec3 origin, direction;
+    viewportRay(g_camera.view, g_camera.projection, static_cast<float>(x), static_cast<float>(y), static_cast<float>(width),
+                static_cast<float>(height), origin, direction);
+
+    const auto start = std::chrono::steady_clock::now();
+    const RayHit hit = raycastHeightField(*field, origin, direction);
+    g_pick.micros = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+    g_pick.hit = hit.hit;
+    g_pick.position = hit.position;
 }
 
 /**
@@ -93,48 +181,46 @@ void updateCameraMatrix()
  */
 void cursorPosCallback(GLFWwindow *window, double x, double y)
 {
-    static float x0 = x, y0 = y;
-    const float dx = x - x0;
-    const float dy = y0 - y;
+    // every event moves the reference, so the first one after a replay or an ImGui drag does not jump
+    const float dx = g_input.cursorSeen ? static_cast<float>(x) - g_input.cursorX : 0.0f;
+    const float dy = g_input.cursorSeen ? g_input.cursorY - static_cast<float>(y) : 0.0f;
+    g_input.cursorX = static_cast<float>(x);
+    g_input.cursorY = static_cast<float>(y);
+    g_input.cursorSeen = true;
 
     ImGuiIO &io = ImGui::GetIO();
-    if (io.WantCaptureMouse)
+    if (io.WantCaptureMouse || g_input.mode == InputManager::REPLAYING)
         return;
 
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+    const bool left = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    const bool sculpting = g_sculpt.enabled && left;
+    if (left && !sculpting)
     {
         const static float scalar = 5e-2;
-        static float pitch = 0.0f;
-        static float yaw = 90.0f;
 
-        pitch += scalar * dy;
-        yaw += scalar * dx;
+        const float pitch = std::clamp(g_camera.pitch + scalar * dy, -89.0f, 89.0f);
+        const float yaw = g_camera.yaw + scalar * dx;
 
-        pitch = std::clamp(pitch, -89.0f, 89.0f);
-
-        g_camera.forward = {
-            glm::cos(glm::radians(yaw)) * glm::cos(glm::radians(pitch)),
-            glm::sin(glm::radians(pitch)),
-            -glm::sin(glm::radians(yaw)) * glm::cos(glm::radians(pitch)),
-        };
-        g_camera.forward = glm::normalize(g_camera.forward);
-
-        updateCameraMatrix();
+        setCameraOrientation(yaw, pitch);
     }
-    else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+    else if (!sculpting && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
     {
         g_camera.pos.y -= dy;
         updateCameraMatrix();
     }
 
-    x0 = x;
-    y0 = y;
+    // one ray per event, after the camera moved, serves both the readout and the brush
+    pickTerrain(window, x, y);
+    if (sculpting && g_pick.hit && g_editor.stroking())
+        g_editor.strokeTo(glm::vec2{g_pick.position.x, g_pick.position.z});
+    else if (sculpting && g_pick.hit)
+        g_editor.beginStroke(g_sculpt.brush, glm::vec2{g_pick.position.x, g_pick.position.z});
 }
 
 void mouseScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
 {
     ImGuiIO &io = ImGui::GetIO();
-    if (io.WantCaptureMouse)
+    if (io.WantCaptureMouse || g_input.mode == InputManager::REPLAYING)
         return;
 
     const float scalar = 3.0f;
@@ -143,303 +229,173 @@ void mouseScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
     updateCameraMatrix();
 }
 
-GLuint create_texture_2d(const std::string tex_filepath)
+/**
+ * @brief Sweeps the tess settings offscreen and stores the result for this
+ * GPU / driver. Blocks, the window does not update meanwhile.
+ */
+static void calibrate()
 {
-    GLuint tex_handle;
-    glGenTextures(1, &tex_handle);
-    glBindTexture(GL_TEXTURE_2D, tex_handle);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    LOG("-- Begin -- Calibration on %s\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // the sweep brackets whole frames with its own queries and measures the settings as given
+    const bool perfQueries = g_app.perfQueries;
+    const bool lodBudget = g_app.lodBudget;
+    g_app.perfQueries = false;
+    g_app.lodBudget = false;
+    g_frameGraph.setEnabled(g_passes.gui, false);
 
-    stbi_set_flip_vertically_on_load(true);
-    int tex_width, tex_height, tex_num_chan;
-    unsigned char *tex_data = stbi_load(tex_filepath.c_str(), &tex_width, &tex_height, &tex_num_chan, 4);
+    g_calibration.profile = calibrateTessProfile(loadCameraPath(g_app.calibrationCameraPath), g_calibration.settings);
 
-    if (!tex_data)
-        EXIT("Failed to load texture " + tex_filepath);
+    g_frameGraph.setEnabled(g_passes.gui, true);
+    g_app.perfQueries = perfQueries;
+    g_app.lodBudget = lodBudget;
 
-    uint64_t format = 0x0;
-    switch (tex_num_chan)
-    {
-    case 1:
-        format = GL_RGBA;
-        break;
-    case 3:
-        format = GL_RGB;
-        break;
-    case 4:
-        format = GL_RGBA;
-        break;
-    default:
-        EXIT("Failed to load texture " + tex_filepath);
-    }
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format, tex_width, tex_height, 0, format, GL_UNSIGNED_BYTE, tex_data);
-
-    g_app.heightmap_x_dim = static_cast<size_t>(tex_width);
-    g_app.heightmap_y_dim = static_cast<size_t>(tex_height);
-
-    stbi_image_free(tex_data);
-
-    return tex_handle;
+    saveTessProfile(g_app.calibrationPath, g_calibration.profile);
+    applyTessProfile(g_calibration.profile);
+    LOG("-- End -- Calibration: max tess %d, range scale %.2f\n", g_calibration.profile.maxTessLevel, g_calibration.profile.rangeScale);
 }
 
-void init()
+// observer on the terrain point last picked under the cursor
+static void computeViewshedAtPick()
 {
-    g_gl.programs[PROGRAM_DEFAULT] = createProgram("../src/shaders/default.vert", "../src/shaders/default.frag",
-                                                   "../src/shaders/tcs.glsl", "../src/shaders/tes.glsl", "DEFAULT");
-    g_gl.programs[PROGRAM_DEFAULT] = createProgram("../src/shaders/test_vert.glsl", "../src/shaders/test_frag.glsl",
-                                                   "../src/shaders/test_tcs.glsl", "../src/shaders/test_tes.glsl", "DEFAULT");
-
-    g_camera.projection = glm::perspective(glm::radians(45.0f), (float)VIEWER_HEIGHT / (float)VIEWER_WIDTH, 0.1f, 100000.0f);
-    updateCameraMatrix();
+    const std::shared_ptr<const HeightField> field = currentHeightField();
+    if (!field)
+        return;
 
-    size_t heightmap_width = 0;
-    size_t heightmap_height = 0;
+    g_viewshed.settings.observer = glm::vec2{g_pick.position.x, g_pick.position.z};
+    const auto start = std::chrono::steady_clock::now();
+    const Viewshed viewshed = computeViewshed(*field, g_viewshed.settings, &g_pool);
+    g_viewshed.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    g_viewshed.texels = viewshed.visible.size();
 
-    // read heightmap
-    {
-        g_gl.textures[TEXTURE_HEIGHTMAP] = create_texture_2d("../assets/test3.png");
-    }
+    uploadViewshed(viewshed, *field);
+}
 
-    struct Vertex
+/**
+ * @brief Uploads what the brush changed since the last frame and, once the
+ * button is up, publishes the edited field to the CPU readers.
+ */
+static void updateSculpt(GLFWwindow *window)
+{
+    if (g_sculpt.step != 0)
     {
-        float pos[3];
-        float uv[2];
-
-        Vertex()
-            : pos{0.0f, 0.0f, 0.0f}, uv{0.0f, 0.0f}
+        const std::shared_ptr<const HeightField> field = g_sculpt.step < 0 ? g_editor.undo() : g_editor.redo();
+        g_sculpt.step = 0;
+        if (field)
         {
+            uploadHeightRects(*field, g_editor.commit());
+            publishHeightField(field);
         }
+    }
 
-        Vertex(float x, float y, float z, float u, float v)
-            : pos{x, y, z}, uv{u, v}
-        {
-        }
-    };
-
-    // create test patch
-    {
-        constexpr size_t vertex_count = 4;
-        std::array<Vertex, vertex_count> vertices;
-
-        constexpr float dim = 5;
-        constexpr float half_dim = dim / 2.0f;
-
-        vertices[0] = {-half_dim, -half_dim, 0.0f, 0.0f, 0.0f};
-        vertices[1] = { half_dim, -half_dim, 0.0f, 1.0f, 0.0f};
-        vertices[2] = {-half_dim,  half_dim, 0.0f, 0.0f, 1.0f};
-        vertices[3] = { half_dim,  half_dim, 0.0f, 1.0f, 1.0f};
-
-        glGenVertexArrays(1, &g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST]);
-        glGenBuffers(1, &g_gl.buffers[BUFFER_PATCH_TEST_VERTEX]);
-
-        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST]);
-
-        glBindBuffer(GL_ARRAY_BUFFER, g_gl.buffers[BUFFER_PATCH_TEST_VERTEX]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    if (!g_editor.stroking())
+        return;
 
-        glEnableVertexAttribArray(0u);
-        glVertexAttribPointer(0u, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
+    const auto start = std::chrono::steady_clock::now();
+    uploadHeightRects(g_editor.field(), g_editor.commit());
+    g_editor.stroke.uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-        glEnableVertexAttribArray(1u);
-        glVertexAttribPointer(1u, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) != GLFW_PRESS || !g_sculpt.enabled)
+        publishHeightField(g_editor.endStroke());
+}
 
-        glBindVertexArray(0u);
-        glBindBuffer(GL_ARRAY_BUFFER, 0u);
+static void perfPanel()
+{
+    if (!ImGui::CollapsingHeader("Performance", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
 
-        glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
+    const int count = static_cast<int>(g_perf.samples);
+    const int offset = g_perf.samples == PerfMonitor::HISTORY ? static_cast<int>(g_perf.head) : 0;
+    const float scale = std::max(g_perf.maxMs(), 1.0f);
+
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "CPU %.2f ms", g_pacer.stats.cpuMs);
+    ImGui::PlotLines("##cpu", g_perf.cpuMs, count, offset, overlay, 0.0f, scale, ImVec2(0.0f, 50.0f));
+    snprintf(overlay, sizeof(overlay), "GPU %.2f ms", g_pacer.stats.gpuMs);
+    ImGui::PlotLines("##gpu", g_perf.gpuMs, count, offset, overlay, 0.0f, scale, ImVec2(0.0f, 50.0f));
+
+    float bins[PerfMonitor::HISTOGRAM_BINS];
+    snprintf(overlay, sizeof(overlay), "CPU 0 - %.1f ms", scale);
+    PerfMonitor::histogram(g_perf.cpuMs, g_perf.samples, scale, bins, PerfMonitor::HISTOGRAM_BINS);
+    ImGui::PlotHistogram("##cpu_hist", bins, static_cast<int>(PerfMonitor::HISTOGRAM_BINS), 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+    snprintf(overlay, sizeof(overlay), "GPU 0 - %.1f ms", scale);
+    PerfMonitor::histogram(g_perf.gpuMs, g_perf.samples, scale, bins, PerfMonitor::HISTOGRAM_BINS);
+    ImGui::PlotHistogram("##gpu_hist", bins, static_cast<int>(PerfMonitor::HISTOGRAM_BINS), 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+
+    ImGui::Checkbox("Pipeline Statistics", &g_app.perfQueries);
+    if (g_app.perfQueries && ImGui::BeginTable("Statistics", 2))
+    {
+        for (size_t s = 0; s < PerfMonitor::STAT_COUNT; ++s)
+        {
+            if (!g_perf.pipelineStatistics && s != PerfMonitor::STAT_PRIMITIVES_GENERATED)
+                continue;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(PerfMonitor::STAT_NAMES[s]);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(g_perf.statistics[s]));
+        }
+        ImGui::EndTable();
 
-        g_app.test_vertex_count = vertex_count;
+        const uint64_t patches = g_perf.statistics[PerfMonitor::STAT_TCS_PATCHES];
+        if (g_perf.pipelineStatistics && patches > 0)
+            ImGui::Text("Measured %.1f triangles / patch", static_cast<double>(g_perf.statistics[PerfMonitor::STAT_PRIMITIVES_GENERATED]) / patches);
+        if (!g_perf.pipelineStatistics)
+            ImGui::TextUnformatted("GL_ARB_pipeline_statistics_query not supported");
     }
 
-    // create mesh
+    g_perf.updateLodBands(g_tessCache.controlPoints, g_camera.pos, g_app.frameMaxTessLevel, g_app.frameLodRanges);
+    if (ImGui::BeginTable("LOD Bands", 5))
     {
-
-        constexpr size_t patch_resolution = 20;
-        constexpr size_t vertex_count = patch_resolution * patch_resolution * 4;
-        std::array<Vertex, vertex_count> vertices;
-
-        const float res = static_cast<float>(patch_resolution);
-        const float x_dim = static_cast<float>(g_app.heightmap_x_dim);
-        const float y_dim = static_cast<float>(g_app.heightmap_y_dim);
-        const float half_x_dim = x_dim / 2.0f;
-        const float half_y_dim = y_dim / 2.0f;
-
-        size_t v_idx = 0;
-        for (size_t y = 0; y < patch_resolution; ++y)
+        ImGui::TableSetupColumn("Band");
+        ImGui::TableSetupColumn("Tess Lvl");
+        ImGui::TableSetupColumn("Patches");
+        ImGui::TableSetupColumn("Triangles");
+        ImGui::TableSetupColumn("Tri / Patch");
+        ImGui::TableHeadersRow();
+        for (int b = 0; b < NUM_LOD_RANGES; ++b)
         {
-            for (size_t x = 0; x < patch_resolution; ++x)
+            const PerfMonitor::LodBand &band = g_perf.bands[b];
+            ImGui::TableNextRow();
+            if (b < NUM_LOD_RANGES - 1)
+            {
+                ImGui::TableNextColumn(); ImGui::Text("< %.0f", g_app.frameLodRanges[b]);
+            }
+            else
             {
-                // bottom-left
-                vertices[v_idx++] = {
-                    -half_x_dim + x_dim * x / res, // x
-                    0.0f,                          // y
-                    -half_y_dim + y_dim * y / res, // z
-                    x / res,                       // u
-                    y / res};                      // v
-
-                // bottom-right
-                vertices[v_idx++] = {
-                    -half_x_dim + x_dim * (x + 1) / res, // x
-                    0.0f,                                // y
-                    -half_y_dim + y_dim * y / res,       // z
-                    (x + 1) / res,                       // u
-                    y / res};                            // v
-
-                // top-left
-                vertices[v_idx++] = {
-                    -half_x_dim + x_dim * x / res,       // x
-                    0.0f,                                // y
-                    -half_y_dim + y_dim * (y + 1) / res, // z
-                    x / res,                             // u
-                    (y + 1) / res};                      // v
-
-                // top-right
-                vertices[v_idx++] = {
-                    -half_x_dim + x_dim * (x + 1) / res, // x
-                    0.0f,                                // y
-                    -half_y_dim + y_dim * (y + 1) / res, // z
-                    (x + 1) / res,                       // u
-                    (y + 1) / res};                      // v
+                ImGui::TableNextColumn(); ImGui::Text(">= %.0f", g_app.frameLodRanges[b - 1]);
             }
+            ImGui::TableNextColumn(); ImGui::Text("%d", band_tess_level(b, g_app.frameMaxTessLevel));
+            ImGui::TableNextColumn(); ImGui::Text("%zu", band.patches);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", band.triangles);
+            ImGui::TableNextColumn(); ImGui::Text("%.0f", band.patches ? static_cast<double>(band.triangles) / band.patches : 0.0);
         }
-
-        assert(v_idx == vertex_count);
-
-        glGenVertexArrays(1, &g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
-        glGenBuffers(1, &g_gl.buffers[BUFFER_PATCH_VERTEX]);
-
-        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
-
-        glBindBuffer(GL_ARRAY_BUFFER, g_gl.buffers[BUFFER_PATCH_VERTEX]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-
-        glEnableVertexAttribArray(0u);
-        glVertexAttribPointer(0u, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
-
-        glEnableVertexAttribArray(1u);
-        glVertexAttribPointer(1u, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
-
-        glBindVertexArray(0u);
-        glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-        glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
-
-        g_app.vertex_count = vertex_count;
+        ImGui::EndTable();
     }
+    ImGui::TextUnformatted("Band = finest corner band, triangles are the CPU upper bound");
 
+    if (ImGui::GetFrameCount() % 60 == 0)
+        g_perf.refreshMemory();
+    if (ImGui::BeginTable("GPU Memory", 2))
     {
-    std::vector<float> vertices;
-
-    float width = g_app.heightmap_x_dim;
-    float height = g_app.heightmap_y_dim;
-
-    unsigned rez = 20;
-    for(unsigned i = 0; i <= rez-1; i++)
-    {
-        for(unsigned j = 0; j <= rez-1; j++)
+        for (const PerfMonitor::MemoryEntry &entry : g_perf.memory)
         {
-            vertices.push_back(-width/2.0f + width*i/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*j/(float)rez); // v.z
-            vertices.push_back(i / (float)rez); // u
-            vertices.push_back(j / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*(i+1)/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*j/(float)rez); // v.z
-            vertices.push_back((i+1) / (float)rez); // u
-            vertices.push_back(j / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*i/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*(j+1)/(float)rez); // v.z
-            vertices.push_back(i / (float)rez); // u
-            vertices.push_back((j+1) / (float)rez); // v
-
-            vertices.push_back(-width/2.0f + width*(i+1)/(float)rez); // v.x
-            vertices.push_back(0.0f); // v.y
-            vertices.push_back(-height/2.0f + height*(j+1)/(float)rez); // v.z
-            vertices.push_back((i+1) / (float)rez); // u
-            vertices.push_back((j+1) / (float)rez); // v
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(entry.name.c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%.2f MB", entry.bytes / (1024.0f * 1024.0f));
         }
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted("frame graph transients");
+        ImGui::TableNextColumn(); ImGui::Text("%.2f MB", g_frameGraph.stats.transientBytesAllocated / (1024.0f * 1024.0f));
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted("total");
+        ImGui::TableNextColumn(); ImGui::Text("%.2f MB", (g_perf.totalMemory() + g_frameGraph.stats.transientBytesAllocated) / (1024.0f * 1024.0f));
+        ImGui::EndTable();
     }
-    std::cout << "Loaded " << rez*rez << " patches of 4 control points each" << std::endl;
-    std::cout << "Processing " << rez*rez*4 << " vertices in vertex shader" << std::endl;
-
-    // first, configure the cube's VAO (and terrainVBO)
-    unsigned int terrainVAO, terrainVBO;
-    glGenVertexArrays(1, &terrainVAO);
-    glBindVertexArray(terrainVAO);
-
-    glGenBuffers(1, &terrainVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // texCoord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(sizeof(float) * 3));
-    glEnableVertexAttribArray(1);
-
-    glPatchParameteri(GL_PATCH_VERTICES, NUM_PATCH_PTS);
-
-    g_gl.buffers[BUFFER_PATCH_VERTEX] = terrainVBO;
-    g_gl.vertexArrays[VERTEXARRAY_PATCHES] = terrainVAO;
-    }
-}
-
-void render()
-{
-    if (g_app.wireframe)
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    else
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-    glClearColor(0.12f, 0.63f, 0.22f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glUseProgram(g_gl.programs[PROGRAM_DEFAULT]);
-    glBindTexture(GL_TEXTURE_2D, g_gl.textures[TEXTURE_HEIGHTMAP]);
-
-    set_uni_mat4(g_gl.programs[PROGRAM_DEFAULT], "u_projMatrix", g_camera.projection);
-    set_uni_mat4(g_gl.programs[PROGRAM_DEFAULT], "u_viewMatrix", g_camera.view);
-    set_uni_int(g_gl.programs[PROGRAM_DEFAULT], "u_minTessLevel", g_app.minTessLevel);
-    set_uni_int(g_gl.programs[PROGRAM_DEFAULT], "u_maxTessLevel", g_app.maxTessLevel);
-    set_uni_float(g_gl.programs[PROGRAM_DEFAULT], "u_minRange", g_app.minRange);
-    set_uni_float(g_gl.programs[PROGRAM_DEFAULT], "u_maxRange", g_app.maxRange);
-    set_uni_int(g_gl.programs[PROGRAM_DEFAULT], "u_showDebugLOD", g_app.showDebugLOD);
-    // set_uni_float(g_gl.programs[PROGRAM_DEFAULT], "u_heightScale", g_app.heightScale);
-
-    if (g_app.renderType == 0)
-    {
-        // glBindTexture(GL_TEXTURE_2D, 0);
-        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCH_TEST]);
-        glDrawArrays(GL_PATCHES, 0, (static_cast<GLsizei>(g_app.test_vertex_count)));
-    }
-    else
-    {
-        glBindVertexArray(g_gl.vertexArrays[VERTEXARRAY_PATCHES]);
-        glDrawArrays(GL_PATCHES, 0, (static_cast<GLsizei>(g_app.vertex_count)));
-    }
-
-
-    glBindVertexArray(0);
-    glUseProgram(0);
 }
 
-void release()
+static void buildGui()
 {
-}
+    PROFILE_CPU("gui/build");
 
-void gui()
-{
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -449,14 +405,289 @@ void gui()
         ImGui::Checkbox("Wireframe", &g_app.wireframe);
         ImGui::Checkbox("LOD Visual", &g_app.showDebugLOD);
         ImGui::SliderFloat("Height Scale", &g_app.heightScale, 0.1f, 200.0f);
+        if (g_pick.hit)
+            ImGui::Text("Cursor: %.1f, %.1f, %.1f (%.1f us)", g_pick.position.x, g_pick.position.y, g_pick.position.z, g_pick.micros);
+        else
+            ImGui::Text("Cursor: no terrain (%.1f us)", g_pick.micros);
 
         ImGui::InputInt("Min Tess Lvl", &g_app.minTessLevel);
         ImGui::InputInt("Max Tess Lvl", &g_app.maxTessLevel);
         ImGui::SliderFloat("Min LOD Range", &g_app.minRange, 1.0f, 500.0f);
         ImGui::SliderFloat("Max LOD Range", &g_app.maxRange, 1.0f, 1500.0f);
+        if (ImGui::DragFloat4("LOD Bands", &g_app.lodRanges.x, 5.0f, 1.0f, 5000.0f, "%.0f"))
+        {
+            // selectLOD() divides by the band widths, keep them increasing
+            for (int i = 1; i < NUM_LOD_RANGES; ++i)
+                g_app.lodRanges[i] = std::max(g_app.lodRanges[i], g_app.lodRanges[i - 1] + 1.0f);
+        }
+
+        ImGui::Text("Profile: max tess %d, range scale %.2f (%.2f ms, height p95 %.2f)", g_calibration.profile.maxTessLevel,
+                    g_calibration.profile.rangeScale, g_calibration.profile.gpuMs, g_calibration.profile.heightError);
+        ImGui::InputFloat("Error Budget", &g_calibration.settings.errorBudget, 0.05f, 0.25f, "%.2f");
+        ImGui::SameLine();
+        if (ImGui::Button("Recalibrate"))
+            g_calibration.pending = true;
+
+        if (ImGui::Checkbox("LOD Budget", &g_app.lodBudget))
+            g_budget.reset();
+        if (g_app.lodBudget)
+        {
+            LodBudget::Settings &budget = g_budget.settings;
+            ImGui::InputFloat("Budget GPU ms", &budget.targetGpuMs, 0.5f, 2.0f, "%.1f");
+            ImGui::InputFloat("Budget Triangles", &budget.targetTriangles, 1e4f, 1e5f, "%.0f");
+            ImGui::SliderFloat("Dead Band", &budget.deadBand, 0.0f, 0.5f);
+            ImGui::SliderFloat("Min Detail", &budget.minDetail, 0.05f, 1.0f);
+            ImGui::Text("Detail %.2f (max tess %d), load %.2f, %llu changes", g_budget.detail, g_app.frameMaxTessLevel, g_budget.load,
+                        static_cast<unsigned long long>(g_budget.changes));
+        }
+
+        ImGui::Separator();
+        ImGui::Combo("Shading", &g_app.shading, "Height\0Lit\0Slope\0Curvature\0");
+        if (ImGui::Checkbox("Sun Shadows", &g_app.shadows) && g_app.shadows)
+            refreshHorizonMap(*currentHeightField());
+        if (g_app.shading == 1 || g_app.shadows)
+        {
+            ImGui::SliderFloat("Sun Azimuth", &g_app.sunAzimuth, 0.0f, 360.0f);
+            ImGui::SliderFloat("Sun Elevation", &g_app.sunElevation, 0.0f, 90.0f);
+        }
+        if (g_app.shadows)
+            ImGui::SliderFloat("Sun Radius", &g_app.sunRadius, 0.25f, 10.0f);
+        ImGui::Text("Maps: %s normals, %zu levels, built in %.1f ms", normalFormatName(g_terrainMaps.settings.normalFormat),
+                    g_terrainMaps.levels.size(), g_app.terrainMapsMs);
+        ImGui::Text("Horizons: %u directions within %u texels, built in %.1f ms", HorizonMap::DIRECTIONS, g_horizonMap.settings.reach,
+                    g_app.horizonMs);
+        if (g_app.procedural)
+        {
+            const TerrainGenerator::Stats generator = g_generator.stats();
+            ImGui::Text("Generator: seed %u, %zu tiles cached (%.1f MB), %.2f Mtexels/s per core, %.1f ms", g_generator.config().seed,
+                        generator.cachedTiles, generator.cachedBytes / (1024.0 * 1024.0), generator.mtexelsPerCore(), g_app.generatorMs);
+        }
+
+        ImGui::Separator();
+        ImGui::Checkbox("Viewshed", &g_app.showViewshed);
+        ImGui::SameLine();
+        if (ImGui::Button("At Cursor Pick") && g_pick.hit)
+            g_viewshed.pending = true;
+        ImGui::SliderFloat("Observer Height", &g_viewshed.settings.observerHeight, 0.0f, 100.0f);
+        ImGui::SliderFloat("Viewshed Radius", &g_viewshed.settings.radius, 16.0f, 4096.0f);
+        ImGui::Text("Viewshed %.2f ms for %zu texels", g_viewshed.ms, g_viewshed.texels);
+
+        ImGui::Checkbox("Collision Meshes", &g_collision.enabled);
+        if (g_collision.enabled)
+        {
+            ImGui::SliderInt("Collision LOD", &g_collision.lod, 0, 6);
+            ImGui::SliderFloat("Collision Radius", &g_collision.radius, 8.0f, 512.0f);
+
+            // what a body at the cursor would get this frame, the rest arrives on later frames
+            std::vector<std::shared_ptr<const CollisionMesh>> meshes;
+            if (g_pick.hit)
+                g_collisionMeshes.requestAround(glm::vec2{g_pick.position.x, g_pick.position.z}, g_collision.radius,
+                                                static_cast<uint32_t>(g_collision.lod), meshes);
+            g_collision.meshes = meshes.size();
+            g_collision.triangles = 0;
+            for (const std::shared_ptr<const CollisionMesh> &mesh : meshes)
+                g_collision.triangles += mesh->triangleCount();
+
+            const CollisionMeshService::Stats stats = g_collisionMeshes.stats();
+            ImGui::Text("Around cursor %zu meshes, %zu triangles", g_collision.meshes, g_collision.triangles);
+            ImGui::Text("Cache %zu meshes %.2f MB, built %llu (%.2f ms avg), queued %zu", stats.cachedMeshes,
+                        stats.cachedBytes / (1024.0f * 1024.0f), static_cast<unsigned long long>(stats.built),
+                        stats.built ? stats.buildNanos * 1e-6 / stats.built : 0.0, stats.queued);
+        }
+
+        ImGui::Separator();
+        if (g_app.liveFeed)
+        {
+            // the feed owns the terrain, a stroke would be overwritten by the next frame
+            const HeightFeed::Stats &feed = g_feed.stats;
+            ImGui::Text("Live feed %ux%u: %llu frames, %llu skipped, %llu torn", g_feed.width(), g_feed.height(),
+                        static_cast<unsigned long long>(feed.frames), static_cast<unsigned long long>(feed.skipped),
+                        static_cast<unsigned long long>(feed.torn));
+            ImGui::Text("Last frame: %zu texels in %zu rects, diff %.2f ms, apply %.2f ms", feed.changedTexels, feed.changedRects, feed.diffMs,
+                        feed.applyMs);
+            if (g_app.feedDrawn > 0)
+                ImGui::Text("Latency %.1f ms, producer publish to GPU done",
+                            g_app.feedLatencies[(g_app.feedLatencyHead + AppManager::FEED_LATENCIES - 1) % AppManager::FEED_LATENCIES]);
+        }
+        else
+            ImGui::Checkbox("Sculpt", &g_sculpt.enabled);
+        if (g_sculpt.enabled)
+        {
+            int mode = static_cast<int>(g_sculpt.brush.mode);
+            for (int m = 0; m < static_cast<int>(BrushMode::Count); ++m)
+            {
+                if (m > 0)
+                    ImGui::SameLine();
+                ImGui::RadioButton(brushModeName(static_cast<BrushMode>(m)), &mode, m);
+            }
+            g_sculpt.brush.mode = static_cast<BrushMode>(mode);
+            ImGui::SliderFloat("Brush Radius", &g_sculpt.brush.radius, 1.0f, 1024.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Brush Strength", &g_sculpt.brush.strength, 0.01f, 1.0f);
+            ImGui::SliderFloat("Brush Hardness", &g_sculpt.brush.hardness, 0.0f, 1.0f);
+
+            const StrokeStats &stroke = g_editor.stroke;
+            ImGui::Text("Stroke r=%.0f: %u dabs, %zu texels (%zu uploaded), %zu bands copied", stroke.radius, stroke.dabs, stroke.texels,
+                        stroke.dirtyTexels, stroke.bandsCopied);
+            ImGui::Text("Apply %.2f ms, bounds %.2f ms, upload %.2f ms", stroke.applyMs, stroke.boundsMs, stroke.uploadMs);
+
+            const HeightTileStore::Stats history = g_editor.versions().stats();
+            if (ImGui::Button("Undo"))
+                g_sculpt.step = -1;
+            ImGui::SameLine();
+            if (ImGui::Button("Redo"))
+                g_sculpt.step = 1;
+            ImGui::SameLine();
+            ImGui::Text("%zu / %zu versions, %.2f MB of tiles", history.undoVersions, history.redoVersions,
+                        history.historyBytes / (1024.0f * 1024.0f));
+        }
 
         ImGui::RadioButton("Test"   , &g_app.renderType, 0); ImGui::SameLine();
         ImGui::RadioButton("Terrain", &g_app.renderType, 1);
+
+        ImGui::Separator();
+        ImGui::Checkbox("Tess Cache", &g_app.tessCache);
+        if (g_app.tessCache)
+        {
+            const TessCache::Stats &stats = g_tessCache.stats;
+            ImGui::Text("Hits %zu / Misses %zu / Overflow %zu", stats.hits, stats.misses, stats.overflows);
+            ImGui::Text("Hit Rate %.1f%%", 100.0f * g_tessCache.hitRate());
+            ImGui::Text("Memory %.2f / %.2f MB", stats.bytesUsed / (1024.0f * 1024.0f), stats.bytesCapacity / (1024.0f * 1024.0f));
+        }
+
+        ImGui::Separator();
+        ImGui::SliderInt("Frames In Flight", &g_pacer.framesInFlight, 1, static_cast<int>(FramePacer::MAX_FRAMES_IN_FLIGHT));
+        int swapMode = g_pacer.swapMode;
+        if (ImGui::Combo("Swap", &swapMode, g_pacer.adaptiveSupported ? "Immediate\0VSync\0Adaptive\0" : "Immediate\0VSync\0"))
+            g_pacer.setSwapMode(static_cast<FramePacer::SwapMode>(swapMode));
+        ImGui::InputFloat("Target Frame ms", &g_pacer.targetFrameMs, 1.0f, 5.0f, "%.1f");
+        {
+            const FramePacer::Stats &stats = g_pacer.stats;
+            ImGui::Text("Frame %.2f ms (%.0f fps)", stats.frameMs, stats.frameMs > 0.0f ? 1000.0f / stats.frameMs : 0.0f);
+            ImGui::Text("CPU %.2f  GPU %.2f  Swap %.2f  Wait %.2f ms", stats.cpuMs, stats.gpuMs, stats.swapMs, stats.waitMs);
+            ImGui::Text("Present latency %.2f ms", stats.latencyMs);
+        }
+
+        ImGui::Separator();
+        ImGui::Checkbox("Threaded Recording", &g_app.threadedRecording);
+        ImGui::Text("Record %.3f ms on %zu threads, replay %.3f ms", g_app.recordMs,
+                    g_app.threadedRecording ? g_pool.threadCount() : size_t{1}, g_app.replayMs);
+        ImGui::Text("Commands %zu, draws %zu (+%zu merged), skipped binds %zu", g_queue.stats.commands, g_queue.stats.draws,
+                    g_queue.stats.mergedDraws, g_queue.stats.skippedBinds);
+
+        ImGui::Separator();
+        if (ImGui::BeginTable("Passes", 4))
+        {
+            ImGui::TableSetupColumn("Pass");
+            ImGui::TableSetupColumn("CPU ms");
+            ImGui::TableSetupColumn("GPU ms");
+            ImGui::TableSetupColumn("Barriers");
+            ImGui::TableHeadersRow();
+            for (const size_t p : g_frameGraph.order)
+            {
+                const FrameGraph::Pass &pass = g_frameGraph.passes[p];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(pass.name.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", pass.cpuMs);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", pass.gpuMs);
+                ImGui::TableNextColumn(); ImGui::Text("0x%x", pass.barriers);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::Text("Culled passes %zu, transient %.2f MB (%.2f MB requested)", g_frameGraph.stats.culledPasses,
+                    g_frameGraph.stats.transientBytesAllocated / (1024.0f * 1024.0f),
+                    g_frameGraph.stats.transientBytesRequested / (1024.0f * 1024.0f));
+
+        ImGui::Separator();
+        ImGui::InputText("Input Log", g_input.logPath, sizeof(g_input.logPath));
+        if (g_input.mode == InputManager::LIVE)
+        {
+            if (ImGui::Button("Record"))
+            {
+                g_input.log.clear();
+                g_input.log.fixedDt = g_pacer.targetFrameMs > 0.0f ? g_pacer.targetFrameMs * 1e-3f : 1.0f / 60.0f;
+                g_input.recordStart = std::chrono::steady_clock::now();
+                g_input.mode = InputManager::RECORDING;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Replay"))
+            {
+                std::string error;
+                if (loadInputLog(g_input.logPath, g_input.log, error))
+                {
+                    g_input.replayFrame = 0;
+                    g_input.mode = g_input.log.frameCount > 0 ? InputManager::REPLAYING : InputManager::LIVE;
+                }
+                else
+                {
+                    LOG("%s\n", error.c_str());
+                }
+            }
+        }
+        else if (ImGui::Button("Stop"))
+        {
+            std::string error;
+            if (g_input.mode == InputManager::RECORDING && !g_input.log.save(g_input.logPath, error))
+            {
+                LOG("%s\n", error.c_str());
+            }
+            g_input.mode = InputManager::LIVE;
+        }
+        if (g_input.mode == InputManager::RECORDING)
+            ImGui::Text("Recording frame %u, %zu changes", g_input.log.frameCount, g_input.log.records.size());
+        else if (g_input.mode == InputManager::REPLAYING)
+            ImGui::Text("Replaying frame %u / %u", g_input.replayFrame, g_input.log.frameCount);
+
+        ImGui::Separator();
+        ImGui::InputText("Trace", g_trace.path, sizeof(g_trace.path));
+        ImGui::InputInt("Trace Frames", &g_trace.frames);
+        g_trace.frames = std::max(g_trace.frames, 1);
+        if (g_trace.remaining == 0)
+        {
+            if (ImGui::Button("Capture Trace"))
+            {
+                g_profiler.start();
+                g_trace.remaining = g_trace.frames;
+            }
+        }
+        else
+        {
+            ImGui::Text("Capturing, %d frames left", g_trace.remaining);
+        }
+        {
+            const Profiler::Stats &stats = g_profiler.stats;
+            ImGui::Text("Last trace: %zu CPU / %zu GPU zones, %zu dropped", stats.cpuEvents, stats.gpuEvents, stats.dropped);
+            ImGui::Text("Zone cost %.0f ns, overhead %.3f ms", stats.zoneCostNs, stats.overheadMs);
+        }
+
+        ImGui::Separator();
+        ImGui::InputText("Capture Dir", g_recording.directory, sizeof(g_recording.directory));
+        ImGui::InputText("Video Stream", g_recording.stream, sizeof(g_recording.stream));
+        if (!g_frameCapture.active())
+        {
+            if (ImGui::Button("Screenshot"))
+                g_recording.request = RecordingState::SCREENSHOT;
+            ImGui::SameLine();
+            if (ImGui::Button("Record Frames"))
+                g_recording.request = RecordingState::IMAGES;
+            ImGui::SameLine();
+            if (ImGui::Button("Record Video"))
+                g_recording.request = RecordingState::VIDEO;
+        }
+        else if (ImGui::Button("Stop Recording"))
+            g_frameCapture.stop();
+        {
+            const FrameCapture::Stats &stats = g_frameCapture.stats;
+            ImGui::Text("Captured %llu, written %llu, dropped %llu", static_cast<unsigned long long>(stats.captured),
+                        static_cast<unsigned long long>(stats.written.load()), static_cast<unsigned long long>(stats.dropped));
+            ImGui::Text("Render thread %.3f ms / frame", stats.captured ? stats.issueNanos * 1e-6 / stats.captured : 0.0);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Stream Ring %.2f MB, peak %.1f KB / frame", g_stream.capacity / (1024.0f * 1024.0f), g_stream.stats.peakFrameBytes / 1024.0f);
+        ImGui::Text("Stalls %llu (%.3f ms), wraps %llu", static_cast<unsigned long long>(g_stream.stats.stalls),
+                    g_stream.stats.stallNanos * 1e-6, static_cast<unsigned long long>(g_stream.stats.wraps));
+
+        perfPanel();
     }
     ImGui::End();
 
@@ -464,6 +695,13 @@ void gui()
     // ImGui::ShowDemoWindow(&demo);
 
     ImGui::Render();
+}
+
+void gui()
+{
+    buildGui();
+
+    PROFILE_CPU("gui/draw");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -508,23 +746,120 @@ int main()
 
     LOG("-- Begin -- Demo\n");
     LOG("-- Begin -- Init\n");
+    g_profiler.init();
+    g_profiler.setThreadName("main");
+
+    // TERRAIN_TRACE=path captures init and the first frames
+    if (const char *tracePath = std::getenv("TERRAIN_TRACE"))
+    {
+        snprintf(g_trace.path, sizeof(g_trace.path), "%s", tracePath);
+        g_profiler.start();
+        g_trace.remaining = g_trace.frames;
+    }
+
+    // TERRAIN_GL_CAPTURE=path records the GL call stream from init on, TERRAIN_GL_CAPTURE_FRAMES=first:count
+    if (const char *capturePath = std::getenv("TERRAIN_GL_CAPTURE"))
+    {
+        unsigned first = 0, count = 60;
+        if (const char *frames = std::getenv("TERRAIN_GL_CAPTURE_FRAMES"))
+            sscanf(frames, "%u:%u", &first, &count);
+        g_glCapture.start(capturePath, first, count);
+    }
+
+    // TERRAIN_NORMALS=rg16 for close-up lighting, rg8 otherwise
+    if (const char *normals = std::getenv("TERRAIN_NORMALS"))
+        g_app.terrainMaps.normalFormat = strcmp(normals, "rg16") == 0 ? NormalFormat::RG16 : NormalFormat::RG8;
+
     init();
-    LOG("-- End -- Init\n");
+    setupFrameGraph();
+    g_collisionMeshes.init(CollisionMeshSettings{});
+    g_editor.init(currentHeightField(), &g_pool);
+    g_app.perfQueries = true;
+
+    g_passes.gui = g_frameGraph.addPass("gui", &gui);
+    g_frameGraph.write(g_passes.gui, g_frameGraph.findResource("backbuffer"), ACCESS_COLOR_ATTACHMENT);
+
+    // calibrate once per GPU / driver, TERRAIN_CALIBRATE forces a new sweep
+    const char *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    if (!std::getenv("TERRAIN_CALIBRATE") && loadTessProfile(g_app.calibrationPath, renderer, version, g_calibration.profile))
+        applyTessProfile(g_calibration.profile);
+    else
+        calibrate();
 
-    glEnable(GL_DEPTH_TEST);
+    g_pacer.init();
+    LOG("-- End -- Init\n");
 
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        {
+            PROFILE_CPU("frame");
+
+            g_pacer.beginFrame();
+
+            {
+                PROFILE_CPU("poll_events");
+                glfwPollEvents();
+                updateInput();
+            }
+
+            if (g_calibration.pending)
+            {
+                g_calibration.pending = false;
+                calibrate();
+            }
 
-        render();
+            if (g_viewshed.pending)
+            {
+                g_viewshed.pending = false;
+                computeViewshedAtPick();
+            }
 
-        gui();
+            updateSculpt(window);
+            updateHeightFeed();
 
-        glfwSwapBuffers(window);
+            g_frameGraph.setEnabled(g_passes.tessCapture, g_app.renderType == 1 && g_app.tessCache);
+            g_frameGraph.execute();
+
+            if (g_recording.request != RecordingState::NONE)
+            {
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                if (g_recording.request == RecordingState::VIDEO)
+                    g_frameCapture.start(FrameCapture::Output::Raw, g_recording.stream, width, height);
+                else
+                    g_frameCapture.start(FrameCapture::Output::Images, g_recording.directory, width, height,
+                                         g_recording.request == RecordingState::SCREENSHOT ? 1u : 0u);
+                g_recording.request = RecordingState::NONE;
+            }
+            g_frameCapture.capture(0u);
+            if (g_frameCapture.done())
+                g_frameCapture.stop();
+
+            g_stream.endFrame();
+            g_pacer.endFrame();
+            g_perf.pushFrame(g_pacer.lastCpuMs, g_pacer.lastGpuMs);
+
+            PROFILE_CPU("present");
+            g_pacer.present(window);
+        }
+
+        g_profiler.endFrame();
+        g_glCapture.endFrame();
+        if (g_trace.remaining > 0 && --g_trace.remaining == 0)
+        {
+            g_profiler.stop();
+            g_profiler.writeTrace(g_trace.path);
+            LOG("Wrote trace %s (%zu CPU, %zu GPU zones)\n", g_trace.path, g_profiler.stats.cpuEvents, g_profiler.stats.gpuEvents);
+        }
     }
 
+    g_glCapture.stop();
+    g_frameCapture.stop();
+    g_pacer.release();
+    g_collisionMeshes.release();
     release();
+    g_profiler.release();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
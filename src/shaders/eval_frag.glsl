@@ -0,0 +1,30 @@
+#version 410 core
+
+in vec3 WorldPos;
+
+// x = linear view depth, y = world height, cleared to 0 where no terrain covers the pixel
+out vec2 EvalSample;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 u_viewMatrix;
+    mat4 u_projMatrix;
+    int u_minTessLevel;
+    int u_maxTessLevel;
+    float u_minRange;
+    float u_maxRange;
+    int u_showDebugLOD;
+    vec4 u_lodRanges;
+    int u_showViewshed;
+    vec4 u_viewshedRect;
+    int u_shading;
+    int u_shadows;
+    vec4 u_lightDir;
+    vec4 u_terrainRect;
+};
+
+void main()
+{
+    float depth = -(u_viewMatrix * vec4(WorldPos, 1.0)).z;
+    EvalSample = vec2(depth, WorldPos.y);
+}
@@ -0,0 +1,13 @@
+#version 410 core
+layout (location = 0) in vec2 aUV;
+
+uniform sampler2D heightMap;
+
+out float Height; // captured, compared against the CPU height queries
+
+void main()
+{
+    // same lookup and decode as test_tes.glsl
+    Height = texture(heightMap, aUV).y * 64.0 - 16.0;
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
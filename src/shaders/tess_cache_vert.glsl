@@ -0,0 +1,34 @@
+#version 410 core
+layout (location = 0) in vec3 aWorldPos;
+layout (location = 1) in float aHeight;
+layout (location = 2) in vec3 aDebugColor;
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 u_viewMatrix;
+    mat4 u_projMatrix;
+    int u_minTessLevel;
+    int u_maxTessLevel;
+    float u_minRange;
+    float u_maxRange;
+    int u_showDebugLOD;
+    vec4 u_lodRanges;
+    int u_showViewshed;
+    vec4 u_viewshedRect;
+    int u_shading;
+    int u_shadows;
+    vec4 u_lightDir;
+    vec4 u_terrainRect;
+};
+
+out float Height;
+out vec3 debugColor;
+out vec3 WorldPos;
+
+void main()
+{
+    gl_Position = u_projMatrix * u_viewMatrix * vec4(aWorldPos, 1.0);
+    Height = aHeight;
+    debugColor = aDebugColor;
+    WorldPos = aWorldPos;
+}
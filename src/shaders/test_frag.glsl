@@ -2,10 +2,61 @@
 
 in float Height;
 in vec3 debugColor;
+in vec3 WorldPos;
 
 out vec4 FragColor;
 
-uniform int u_showDebugLOD;
+layout (std140) uniform FrameUniforms
+{
+    mat4 u_viewMatrix;
+    mat4 u_projMatrix;
+    int u_minTessLevel;
+    int u_maxTessLevel;
+    float u_minRange;
+    float u_maxRange;
+    int u_showDebugLOD;
+    vec4 u_lodRanges;
+    int u_showViewshed;
+    vec4 u_viewshedRect;
+    int u_shading;
+    int u_shadows;
+    vec4 u_lightDir;
+    vec4 u_terrainRect;
+};
+
+uniform sampler2D viewshedMap; // 1 where the viewshed observer sees the terrain
+uniform sampler2D normalMap;   // octahedral xz of the unit normal
+uniform sampler2D surfaceMap;  // sin of the slope angle, curvature with 0.5 flat
+uniform sampler2D horizonMap0; // horizon tan / (1 + tan) of directions 0 - 3, 45 degrees apart from +x towards -z
+uniform sampler2D horizonMap1; // directions 4 - 7
+
+vec3 octDecode(vec2 oct)
+{
+    vec3 n = vec3(oct.x, 1.0 - abs(oct.x) - abs(oct.y), oct.y);
+    if (n.y < 0.0)
+        n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+float horizonAngle(float encoded)
+{
+    return atan(encoded / max(1.0 - encoded, 1.0 / 255.0));
+}
+
+// 1 in full sun, 0 below the horizon, the sun's disc fades across it
+float sunVisibility(vec2 uv)
+{
+    vec4 h0 = texture(horizonMap0, uv);
+    vec4 h1 = texture(horizonMap1, uv);
+    float horizon[8] = float[8](h0.x, h0.y, h0.z, h0.w, h1.x, h1.y, h1.z, h1.w);
+
+    // the two stored directions around the sun's azimuth
+    float a = mod(atan(-u_lightDir.z, u_lightDir.x) * (8.0 / 6.28318531), 8.0);
+    int i = min(int(a), 7);
+    float angle = mix(horizonAngle(horizon[i]), horizonAngle(horizon[(i + 1) % 8]), a - float(i));
+    float elevation = asin(clamp(u_lightDir.y, -1.0, 1.0));
+    return smoothstep(-u_lightDir.w, u_lightDir.w, elevation - angle);
+}
 
 void main()
 {
@@ -15,8 +66,42 @@ void main()
     {
         FragColor = vec4(debugColor, 1.0f);
     }
+    else if (u_shading != 0)
+    {
+        // one fetch of the precomputed maps instead of extra height taps for the differences
+        vec2 uv = (WorldPos.xz - u_terrainRect.xy) / u_terrainRect.zw;
+        if (u_shading == 1)
+        {
+            vec3 n = octDecode(texture(normalMap, uv).xy * 2.0 - 1.0);
+            float light = 0.25 + 0.75 * max(dot(n, u_lightDir.xyz), 0.0);
+            FragColor = vec4(vec3(0.35 + 0.65 * h) * light, 1.0);
+        }
+        else if (u_shading == 2)
+        {
+            float slope = texture(surfaceMap, uv).x;
+            FragColor = vec4(mix(vec3(0.2, 0.6, 0.2), vec3(0.8, 0.3, 0.1), slope), 1.0);
+        }
+        else
+        {
+            float curvature = texture(surfaceMap, uv).y * 2.0 - 1.0;
+            FragColor = vec4(vec3(0.5) + vec3(-curvature, 0.0, curvature) * 0.5, 1.0);
+        }
+    }
     else
     {
         FragColor = vec4(h, h, h, 1.0);
     }
+
+    if (bool(u_shadows) && !bool(u_showDebugLOD) && u_shading < 2)
+        FragColor.rgb *= mix(0.45, 1.0, sunVisibility((WorldPos.xz - u_terrainRect.xy) / u_terrainRect.zw));
+
+    if (bool(u_showViewshed))
+    {
+        vec2 uv = (WorldPos.xz - u_viewshedRect.xy) / u_viewshedRect.zw;
+        if (all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0))))
+        {
+            float seen = texture(viewshedMap, uv).r;
+            FragColor.rgb = mix(FragColor.rgb * vec3(0.7, 0.3, 0.3), FragColor.rgb * vec3(0.6, 1.0, 0.6), seen);
+        }
+    }
 }
\ No newline at end of file
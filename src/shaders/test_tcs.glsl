@@ -6,21 +6,32 @@ in vec2 TexCoord[];
 out vec2 TextureCoord[];
 out vec3 lodColor[];
 
-uniform mat4 u_viewMatrix;
-uniform int u_minTessLevel;
-uniform int u_maxTessLevel;
-uniform float u_minRange;
-uniform float u_maxRange;
+layout (std140) uniform FrameUniforms
+{
+    mat4 u_viewMatrix;
+    mat4 u_projMatrix;
+    int u_minTessLevel;
+    int u_maxTessLevel;
+    float u_minRange;
+    float u_maxRange;
+    int u_showDebugLOD;
+    vec4 u_lodRanges;
+    int u_showViewshed;
+    vec4 u_viewshedRect;
+    int u_shading;
+    int u_shadows;
+    vec4 u_lightDir;
+    vec4 u_terrainRect;
+};
 
 const float transition_range = 0.33f;
 const int num_lod_ranges = 4;
-const float LODRanges[4] = float[4](200.0f, 400.0f, 800.0f, 1000.0f);
 
 vec3 selectLOD(float d)
 {
-    if (d < LODRanges[0])
+    if (d < u_lodRanges[0])
     {
-        float weight = clamp(abs(d) / LODRanges[0], 0.0, 1.0 );
+        float weight = clamp(abs(d) / u_lodRanges[0], 0.0, 1.0 );
         float tess_level = u_maxTessLevel;
         float debugColor = 1.0f;
 
@@ -34,9 +45,9 @@ vec3 selectLOD(float d)
 
         return vec3(weight, tess_level, debugColor);
     }
-    else if (d < LODRanges[1])
+    else if (d < u_lodRanges[1])
     {
-        float weight = clamp((LODRanges[1] - abs(d)) / (LODRanges[1] - LODRanges[0]), 0.0, 1.0 );
+        float weight = clamp((u_lodRanges[1] - abs(d)) / (u_lodRanges[1] - u_lodRanges[0]), 0.0, 1.0 );
         float tess_level = u_maxTessLevel / num_lod_ranges * 3;
         float debugColor = 0.75f;
 
@@ -49,9 +60,9 @@ vec3 selectLOD(float d)
         // }
         return vec3(weight, tess_level, debugColor);
     }
-    else if (d < LODRanges[2])
+    else if (d < u_lodRanges[2])
     {
-        float weight = clamp((LODRanges[2] - abs(d)) / (LODRanges[2] - LODRanges[1]), 0.0, 1.0 );
+        float weight = clamp((u_lodRanges[2] - abs(d)) / (u_lodRanges[2] - u_lodRanges[1]), 0.0, 1.0 );
         float tess_level = u_maxTessLevel / num_lod_ranges * 2;
         float debugColor = 0.5f;
 
@@ -66,7 +77,7 @@ vec3 selectLOD(float d)
     }
     else
     {
-        float weight = clamp((LODRanges[3] - abs(d)) / (LODRanges[3] - LODRanges[2]), 0.0, 1.0 );
+        float weight = clamp((u_lodRanges[3] - abs(d)) / (u_lodRanges[3] - u_lodRanges[2]), 0.0, 1.0 );
         float tess_level = u_maxTessLevel / num_lod_ranges;
         return vec3(weight, tess_level, 0.25);
     }
@@ -2,14 +2,30 @@
 layout(quads, fractional_odd_spacing, ccw) in;
 
 uniform sampler2D heightMap;
-uniform mat4 u_viewMatrix;
-uniform mat4 u_projMatrix;
+layout (std140) uniform FrameUniforms
+{
+    mat4 u_viewMatrix;
+    mat4 u_projMatrix;
+    int u_minTessLevel;
+    int u_maxTessLevel;
+    float u_minRange;
+    float u_maxRange;
+    int u_showDebugLOD;
+    vec4 u_lodRanges;
+    int u_showViewshed;
+    vec4 u_viewshedRect;
+    int u_shading;
+    int u_shadows;
+    vec4 u_lightDir;
+    vec4 u_terrainRect;
+};
 
 in vec2 TextureCoord[];
 in vec3 lodColor[];
 
 out float Height;
 out vec3 debugColor;
+out vec3 WorldPos; // captured by the tessellation cache
 
 void main()
 {
@@ -40,6 +56,7 @@ void main()
     vec4 p1 = (p11 - p10) * u + p10;
     vec4 p = (p1 - p0) * v + p0 + normal * Height;
 
+    WorldPos = p.xyz;
     gl_Position = u_projMatrix * u_viewMatrix * p;
     debugColor = lodColor[0];
 }
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CameraPath.hpp"
+#include "FrameCapture.hpp"
+#include "HeightField.hpp"
+#include "GlCapture.hpp"
+#include "HeadlessContext.hpp"
+#include "Helpers.hpp"
+#include "InputLog.hpp"
+#include "Profiler.hpp"
+#include "Defines.hpp"
+#include "Renderer.hpp"
+#include "TerrainEdit.hpp"
+
+// frames whose queries may be outstanding before the CPU blocks on the oldest one
+constexpr size_t QUERY_RING = 4;
+
+// --edit-bench brush radii in texels, and dabs per radius
+constexpr uint32_t EDIT_RADII[] = {8, 32, 128, 512};
+constexpr uint32_t EDIT_DABS = 32;
+
+struct BenchConfig
+{
+    std::string cameraPath = "../assets/paths/flyover.cam";
+    std::string replay; // recorded input log, replaces the camera path when set
+    std::string output; // empty = stdout
+    std::string trace;  // Chrome trace of init and the whole run, empty = profiler off
+    std::string glCapture; // GL call stream of setup + the first glCaptureFrames measured frames
+    uint32_t glCaptureFrames = 60;
+    std::string captureDir; // PPM per measured frame through the async readback ring
+    std::string captureRaw; // raw RGBA stream of the measured frames, "|cmd" pipes it
+    uint32_t frames = 0; // 0 = whole camera path
+    uint32_t warmup = 30;
+    float fps = 60.0f;
+    float budgetMs = 0.0f;        // LOD budget targets, both 0 = controller off
+    float budgetTriangles = 0.0f;
+    bool editBench = false; // brush strokes after the run, edit-to-visible latency per radius
+};
+
+struct FrameSample
+{
+    double cpuMs;
+    double gpuMs;
+    uint64_t primitives;
+    float detail; // LOD budget factor the frame rendered with
+};
+
+struct Summary
+{
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct EditResult
+{
+    uint32_t radius = 0; // texels
+    StrokeStats stroke;
+    std::vector<double> latencyMs; // per dab, brush to the finished frame showing it
+    size_t historyBytes = 0;       // undo history the stroke added
+    double undoMs = 0.0;           // undo through upload, GPU finished
+};
+
+static void usage()
+{
+    std::cerr << "usage: terrain_bench [options]\n"
+                 "  --heightmap PATH      heightmap image (default " << g_app.heightmapPath << ")\n"
+                 "                        or procedural:seed=N,size=WxH,x=X,y=Y,... for a generated window\n"
+                 "                        or feed:/NAME to follow a live height feed (terrain_feed), timing its latency\n"
+                 "  --shader-dir PATH     shader directory (default " << g_app.shaderDir << ")\n"
+                 "  --camera-path PATH    keyframed camera path\n"
+                 "  --replay PATH         replay a recorded input log frame by frame instead\n"
+                 "  --frames N            measured frames, 0 = length of the camera path or log\n"
+                 "  --warmup N            unmeasured frames before the run\n"
+                 "  --fps F               fixed camera timestep\n"
+                 "  --width W --height H  offscreen target size\n"
+                 "  --min-tess N --max-tess N --min-range F --max-range F\n"
+                 "  --tess-cache          draw through the transform feedback cache\n"
+                 "  --budget-ms F         hold the terrain pass to F ms GPU time with the LOD budget controller\n"
+                 "  --budget-tris N       hold the terrain pass to N primitives\n"
+                 "  --single-thread       record commands on the GL thread only\n"
+                 "  --shading N           0 height, 1 lit, 2 slope, 3 curvature from the derived maps\n"
+                 "  --shadows             soft sun shadows from the horizon map\n"
+                 "  --output PATH         write JSON here instead of stdout\n"
+                 "  --trace PATH          write a Chrome trace_event capture of the run\n"
+                 "  --gl-capture PATH     record the GL call stream for terrain_glreplay\n"
+                 "  --gl-capture-frames N measured frames recorded after setup and warmup (default 60)\n"
+                 "  --capture-dir DIR     write every measured frame as DIR/frame_NNNNNN.ppm\n"
+                 "  --capture-raw PATH    write measured frames as raw RGBA, \"|cmd\" pipes them to cmd\n"
+                 "  --edit-bench          after the run, time brush dabs of 8 to 512 texels through upload and a frame\n";
+}
+
+static BenchConfig parse_args(int argc, char **argv)
+{
+    BenchConfig config;
+    g_app.renderType = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                EXIT("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--heightmap")          g_app.heightmapPath = value();
+        else if (arg == "--shader-dir")    g_app.shaderDir = value();
+        else if (arg == "--camera-path")   config.cameraPath = value();
+        else if (arg == "--replay")        config.replay = value();
+        else if (arg == "--frames")        config.frames = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--warmup")        config.warmup = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--fps")           config.fps = std::stof(value());
+        else if (arg == "--width")         g_app.viewerWidth = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--height")        g_app.viewerHeight = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--min-tess")      g_app.minTessLevel = std::stoi(value());
+        else if (arg == "--max-tess")      g_app.maxTessLevel = std::stoi(value());
+        else if (arg == "--min-range")     g_app.minRange = std::stof(value());
+        else if (arg == "--max-range")     g_app.maxRange = std::stof(value());
+        else if (arg == "--tess-cache")    g_app.tessCache = true;
+        else if (arg == "--budget-ms")     config.budgetMs = std::stof(value());
+        else if (arg == "--budget-tris")   config.budgetTriangles = std::stof(value());
+        else if (arg == "--single-thread") g_app.threadedRecording = false;
+        else if (arg == "--shading")       g_app.shading = std::stoi(value());
+        else if (arg == "--shadows")       g_app.shadows = true;
+        else if (arg == "--output")        config.output = value();
+        else if (arg == "--trace")         config.trace = value();
+        else if (arg == "--gl-capture")    config.glCapture = value();
+        else if (arg == "--gl-capture-frames") config.glCaptureFrames = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--capture-dir")   config.captureDir = value();
+        else if (arg == "--capture-raw")   config.captureRaw = value();
+        else if (arg == "--edit-bench")    config.editBench = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            usage();
+            EXIT("Unknown argument " + arg);
+        }
+    }
+
+    if (config.budgetMs > 0.0f || config.budgetTriangles > 0.0f)
+    {
+        g_app.lodBudget = true;
+        g_budget.settings.targetGpuMs = config.budgetMs;
+        g_budget.settings.targetTriangles = config.budgetTriangles;
+    }
+
+    return config;
+}
+
+static Summary summarize(std::vector<double> values)
+{
+    Summary summary;
+    if (values.empty())
+        return summary;
+
+    std::sort(values.begin(), values.end());
+    const auto percentile = [&](double p) {
+        const double rank = p * static_cast<double>(values.size() - 1);
+        const size_t lo = static_cast<size_t>(rank);
+        const size_t hi = std::min(lo + 1, values.size() - 1);
+        return values[lo] + (values[hi] - values[lo]) * (rank - static_cast<double>(lo));
+    };
+
+    summary.mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    summary.min = values.front();
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = values.back();
+    return summary;
+}
+
+static void write_summary(std::ostream &os, const char *name, const Summary &s, bool last)
+{
+    os << "    \"" << name << "\": {\"mean\": " << s.mean << ", \"min\": " << s.min << ", \"p50\": " << s.p50
+       << ", \"p90\": " << s.p90 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}"
+       << (last ? "\n" : ",\n");
+}
+
+template <typename T, typename Fn>
+static void write_array(std::ostream &os, const char *name, const std::vector<T> &samples, Fn &&fn, bool last)
+{
+    os << "    \"" << name << "\": [";
+    for (size_t i = 0; i < samples.size(); ++i)
+        os << (i ? ", " : "") << fn(samples[i]);
+    os << "]" << (last ? "\n" : ",\n");
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string out;
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void write_json(std::ostream &os, const BenchConfig &config, const std::vector<FrameSample> &samples,
+                       const std::vector<EditResult> &edits)
+{
+    std::vector<double> cpu, gpu, primitives;
+    for (const FrameSample &sample : samples)
+    {
+        cpu.push_back(sample.cpuMs);
+        gpu.push_back(sample.gpuMs);
+        primitives.push_back(static_cast<double>(sample.primitives));
+    }
+
+    os << "{\n";
+    os << "  \"renderer\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_RENDERER))) << "\",\n";
+    os << "  \"version\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_VERSION))) << "\",\n";
+    os << "  \"config\": {\n";
+    os << "    \"heightmap\": \"" << json_escape(g_app.heightmapPath) << "\",\n";
+    os << "    \"camera_path\": \"" << json_escape(config.cameraPath) << "\",\n";
+    os << "    \"replay\": \"" << json_escape(config.replay) << "\",\n";
+    os << "    \"width\": " << g_app.viewerWidth << ", \"height\": " << g_app.viewerHeight << ",\n";
+    os << "    \"frames\": " << samples.size() << ", \"warmup\": " << config.warmup << ", \"fps\": " << config.fps << ",\n";
+    os << "    \"min_tess\": " << g_app.minTessLevel << ", \"max_tess\": " << g_app.maxTessLevel << ",\n";
+    os << "    \"min_range\": " << g_app.minRange << ", \"max_range\": " << g_app.maxRange << ",\n";
+    os << "    \"tess_cache\": " << (g_app.tessCache ? "true" : "false") << ",\n";
+    os << "    \"shading\": " << g_app.shading << ", \"shadows\": " << (g_app.shadows ? "true" : "false") << ",\n";
+    os << "    \"budget_ms\": " << config.budgetMs << ", \"budget_tris\": " << config.budgetTriangles << ",\n";
+    os << "    \"threads\": " << (g_app.threadedRecording ? g_pool.threadCount() : 1u) << ",\n";
+    os << "    \"capture\": \"" << json_escape(!config.captureDir.empty() ? config.captureDir : config.captureRaw) << "\"\n";
+    os << "  },\n";
+    if (g_frameCapture.stats.captured > 0)
+    {
+        const FrameCapture::Stats &stats = g_frameCapture.stats;
+        os << "  \"capture\": {\"captured\": " << stats.captured << ", \"dropped\": " << stats.dropped
+           << ", \"written\": " << stats.written << ", \"issue_ms\": " << stats.issueNanos * 1e-6 / stats.captured
+           << ", \"write_ms\": " << (stats.written ? stats.writeNanos * 1e-6 / stats.written : 0.0) << "},\n";
+    }
+    if (!edits.empty())
+    {
+        os << "  \"edits\": [\n";
+        for (size_t i = 0; i < edits.size(); ++i)
+        {
+            const EditResult &edit = edits[i];
+            const StrokeStats &stroke = edit.stroke;
+            const Summary latency = summarize(edit.latencyMs);
+            os << "    {\"radius\": " << edit.radius << ", \"dabs\": " << stroke.dabs << ", \"texels_per_dab\": "
+               << stroke.texels / std::max(stroke.dabs, 1u) << ", \"uploaded_texels\": " << stroke.dirtyTexels
+               << ", \"apply_ms\": " << stroke.applyMs / std::max(stroke.dabs, 1u) << ", \"bounds_ms\": "
+               << stroke.boundsMs / std::max(stroke.dabs, 1u) << ", \"upload_ms\": " << stroke.uploadMs / std::max(stroke.dabs, 1u)
+               << ", \"history_kb\": " << edit.historyBytes / 1024.0 << ", \"undo_ms\": " << edit.undoMs
+               << ", \"latency_ms\": {\"mean\": " << latency.mean << ", \"p50\": " << latency.p50 << ", \"p95\": " << latency.p95
+               << ", \"max\": " << latency.max << "}}" << (i + 1 < edits.size() ? ",\n" : "\n");
+        }
+        os << "  ],\n";
+    }
+    if (g_app.liveFeed)
+    {
+        const HeightFeed::Stats &feed = g_feed.stats;
+        // the ring keeps the latest FEED_LATENCIES, order does not matter to the percentiles
+        const size_t kept = static_cast<size_t>(std::min<uint64_t>(g_app.feedDrawn, AppManager::FEED_LATENCIES));
+        const Summary latency = summarize(std::vector<double>(g_app.feedLatencies, g_app.feedLatencies + kept));
+        os << "  \"feed\": {\"frames\": " << feed.frames << ", \"skipped\": " << feed.skipped << ", \"torn\": " << feed.torn
+           << ", \"bands_copied\": " << feed.bandsCopied << ", \"drawn\": " << g_app.feedDrawn
+           << ", \"latency_ms\": {\"mean\": " << latency.mean << ", \"p50\": " << latency.p50 << ", \"p95\": " << latency.p95
+           << ", \"max\": " << latency.max << "}},\n";
+    }
+    os << "  \"summary\": {\n";
+    write_summary(os, "cpu_ms", summarize(cpu), false);
+    write_summary(os, "gpu_ms", summarize(gpu), false);
+    write_summary(os, "primitives", summarize(primitives), true);
+    os << "  },\n";
+    os << "  \"frames\": {\n";
+    write_array(os, "cpu_ms", samples, [](const FrameSample &s) { return s.cpuMs; }, false);
+    write_array(os, "gpu_ms", samples, [](const FrameSample &s) { return s.gpuMs; }, false);
+    // under the budget primitives are g_perf samples a few frames old, only their summary lines up with the run
+    if (!g_app.lodBudget)
+        write_array(os, "primitives", samples, [](const FrameSample &s) { return s.primitives; }, false);
+    write_array(os, "detail", samples, [](const FrameSample &s) { return s.detail; }, true);
+    os << "  }\n";
+    os << "}\n";
+}
+
+/**
+ * @brief Strokes across the middle of the terrain, one dab at a time, each
+ * committed, uploaded and rendered before the next. Latency runs from the
+ * dab to glFinish of the frame that shows it.
+ */
+static std::vector<EditResult> run_edit_bench()
+{
+    std::vector<EditResult> results;
+    TerrainEditor editor;
+    editor.init(currentHeightField(), &g_pool);
+
+    const HeightField &field = editor.field();
+    const float texel = field.extent.x / static_cast<float>(field.width);
+    const glm::vec2 center{field.origin.x + 0.5f * field.extent.x, field.origin.y + 0.5f * field.extent.y};
+
+    for (const uint32_t radius : EDIT_RADII)
+    {
+        Brush brush;
+        brush.radius = static_cast<float>(radius) * texel;
+        brush.strength = 0.25f;
+
+        EditResult result;
+        result.radius = radius;
+        for (uint32_t dab = 0; dab < EDIT_DABS; ++dab)
+        {
+            // a hair over one spacing per dab so rounding never skips one, centered on the terrain
+            const float along = (static_cast<float>(dab) - 0.5f * EDIT_DABS) * brush.spacing * brush.radius * 1.001f;
+            const glm::vec2 position{center.x + along, center.y};
+
+            const auto start = std::chrono::steady_clock::now();
+            if (dab == 0)
+                editor.beginStroke(brush, position);
+            else
+                editor.strokeTo(position);
+
+            const auto uploadStart = std::chrono::steady_clock::now();
+            uploadHeightRects(editor.field(), editor.commit());
+            editor.stroke.uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+
+            g_frameGraph.execute();
+            g_stream.endFrame();
+            glFinish();
+            result.latencyMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        const size_t historyBefore = editor.versions().stats().historyBytes;
+        publishHeightField(editor.endStroke());
+        result.stroke = editor.stroke;
+        result.historyBytes = editor.versions().stats().historyBytes - historyBefore;
+
+        // take the stroke back and put it again, the next radius starts from the edited field
+        const auto undoStart = std::chrono::steady_clock::now();
+        if (const std::shared_ptr<const HeightField> undone = editor.undo())
+        {
+            uploadHeightRects(*undone, editor.commit());
+            glFinish();
+        }
+        result.undoMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - undoStart).count();
+        if (const std::shared_ptr<const HeightField> redone = editor.redo())
+        {
+            uploadHeightRects(*redone, editor.commit());
+            publishHeightField(redone);
+        }
+
+        const StrokeStats &stroke = result.stroke;
+        LOG("edit r=%u: %u dabs, %.3f ms apply, %.3f ms bounds, %.3f ms upload per dab, %.1f KB history, %.2f ms undo\n", radius,
+            stroke.dabs, stroke.applyMs / stroke.dabs, stroke.boundsMs / stroke.dabs, stroke.uploadMs / stroke.dabs,
+            result.historyBytes / 1024.0, result.undoMs);
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config = parse_args(argc, argv);
+    const bool replaying = !config.replay.empty();
+    const CameraPath path = replaying ? CameraPath{} : loadCameraPath(config.cameraPath);
+    InputLog log;
+    std::string error;
+    if (replaying && !loadInputLog(config.replay, log, error))
+        EXIT(error);
+
+    if (replaying)
+        config.fps = 1.0f / log.fixedDt;
+
+    const float dt = 1.0f / config.fps;
+    if (config.frames == 0)
+        config.frames = replaying ? std::max(1u, log.frameCount) : std::max(1u, static_cast<uint32_t>(path.duration() / dt) + 1u);
+
+    HeadlessContext ctx = createHeadlessContext("terrain_bench");
+    LOG("terrain_bench on %s\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+    // from before the offscreen target on, so the replay can rebuild everything the frames touch
+    if (!config.glCapture.empty())
+        g_glCapture.start(config.glCapture, config.warmup, std::min(config.glCaptureFrames, config.frames));
+
+    OffscreenTarget target = createOffscreenTarget(g_app.viewerWidth, g_app.viewerHeight);
+
+    g_profiler.init();
+    g_profiler.setThreadName("main");
+    if (!config.trace.empty())
+        g_profiler.start();
+
+    init();
+    setupFrameGraph();
+
+    GLuint timeQueries[QUERY_RING];
+    GLuint primitiveQueries[QUERY_RING];
+    glGenQueries(QUERY_RING, timeQueries);
+    glGenQueries(QUERY_RING, primitiveQueries);
+
+    // g_perf wraps the terrain pass only for the budget controller, its primitives query would clash with ours
+    g_app.perfQueries = false;
+
+    struct Pending
+    {
+        bool measured = false;
+        double cpuMs = 0.0;
+        float detail = 1.0f;
+        uint64_t primitives = 0; // from g_perf when the budget is on, lagging the frame
+    } pending[QUERY_RING];
+
+    std::vector<FrameSample> samples;
+    samples.reserve(config.frames);
+
+    const auto collect = [&](size_t slot) {
+        if (!pending[slot].measured)
+            return;
+
+        GLuint64 gpuNs = 0, primitives = pending[slot].primitives;
+        glGetQueryObjectui64v(timeQueries[slot], GL_QUERY_RESULT, &gpuNs);
+        if (!g_app.lodBudget)
+            glGetQueryObjectui64v(primitiveQueries[slot], GL_QUERY_RESULT, &primitives);
+        samples.push_back({pending[slot].cpuMs, static_cast<double>(gpuNs) * 1e-6, primitives, pending[slot].detail});
+        pending[slot].measured = false;
+    };
+
+    if (!config.captureDir.empty())
+        g_frameCapture.start(FrameCapture::Output::Images, config.captureDir, g_app.viewerWidth, g_app.viewerHeight);
+    else if (!config.captureRaw.empty())
+        g_frameCapture.start(FrameCapture::Output::Raw, config.captureRaw, g_app.viewerWidth, g_app.viewerHeight);
+
+    const uint32_t total = config.warmup + config.frames;
+    for (uint32_t frame = 0; frame < total; ++frame)
+    {
+        const size_t slot = frame % QUERY_RING;
+        collect(slot);
+
+        // warmup frames hold the first key so shader compilation and cache fills do not skew the run
+        const uint32_t measuredFrame = frame < config.warmup ? 0u : frame - config.warmup;
+        if (replaying)
+        {
+            const CameraState state = log.stateAt(measuredFrame);
+            g_camera.pos = state.pos;
+            setCameraOrientation(state.yaw, state.pitch);
+        }
+        else
+        {
+            float yaw, pitch;
+            path.sample(static_cast<float>(measuredFrame) * dt, g_camera.pos, yaw, pitch);
+            setCameraOrientation(yaw, pitch);
+        }
+
+        const auto cpuStart = std::chrono::steady_clock::now();
+
+        {
+            PROFILE_CPU("frame");
+
+            updateHeightFeed();
+
+            glBeginQuery(GL_TIME_ELAPSED, timeQueries[slot]);
+            if (!g_app.lodBudget)
+                glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[slot]);
+
+            g_frameGraph.execute();
+
+            if (!g_app.lodBudget)
+                glEndQuery(GL_PRIMITIVES_GENERATED);
+            glEndQuery(GL_TIME_ELAPSED);
+
+            if (frame >= config.warmup)
+                g_frameCapture.capture(target.fbo);
+
+            g_stream.endFrame();
+            glFlush();
+        }
+        g_profiler.endFrame();
+        g_glCapture.endFrame();
+
+        const double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+        pending[slot].measured = frame >= config.warmup;
+        pending[slot].cpuMs = cpuMs;
+        pending[slot].detail = g_app.lodBudget ? g_budget.detail : 1.0f;
+        pending[slot].primitives = g_perf.terrain.primitives; // latest resolved, a few frames old
+    }
+
+    for (uint32_t frame = total; frame < total + QUERY_RING; ++frame)
+        collect(frame % QUERY_RING);
+
+    g_glCapture.stop();
+    g_frameCapture.stop();
+
+    const std::vector<EditResult> edits = config.editBench ? run_edit_bench() : std::vector<EditResult>{};
+
+    if (!config.trace.empty())
+    {
+        g_profiler.stop();
+        g_profiler.writeTrace(config.trace);
+        LOG("Wrote trace %s (%zu CPU, %zu GPU zones, %zu dropped, ~%.3f ms overhead)\n", config.trace.c_str(),
+            g_profiler.stats.cpuEvents, g_profiler.stats.gpuEvents, g_profiler.stats.dropped, g_profiler.stats.overheadMs);
+    }
+
+    if (config.output.empty())
+        write_json(std::cout, config, samples, edits);
+    else
+    {
+        std::ofstream ofs{config.output};
+        if (!ofs.is_open())
+            EXIT("Failed to open " + config.output);
+        write_json(ofs, config, samples, edits);
+    }
+
+    glDeleteQueries(QUERY_RING, timeQueries);
+    glDeleteQueries(QUERY_RING, primitiveQueries);
+    release();
+    g_profiler.release();
+
+    destroyOffscreenTarget(target);
+    destroyHeadlessContext(ctx);
+    return 0;
+}
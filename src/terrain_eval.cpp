@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CameraPath.hpp"
+#include "Defines.hpp"
+#include "HeadlessContext.hpp"
+#include "InputLog.hpp"
+#include "LodEval.hpp"
+#include "Renderer.hpp"
+
+struct EvalConfig
+{
+    std::string cameraPath = "../assets/paths/flyover.cam";
+    std::string replay; // recorded input log, replaces the camera path when set
+    std::string output; // empty = stdout
+    std::vector<int> maxTess = {8, 16, 32, 64};
+    std::vector<float> rangeScales = {0.25f, 0.5f, 1.0f, 2.0f};
+    uint32_t views = 8;   // camera positions sampled along the path
+    uint32_t repeats = 5; // timed frames per view, the median is kept
+};
+
+static void usage()
+{
+    std::cerr << "usage: terrain_eval [options]\n"
+                 "  --heightmap PATH      heightmap image (default " << g_app.heightmapPath << ")\n"
+                 "                        or procedural:seed=N,size=WxH,x=X,y=Y,... for a generated window\n"
+                 "  --shader-dir PATH     shader directory (default " << g_app.shaderDir << ")\n"
+                 "  --camera-path PATH    keyframed camera path\n"
+                 "  --replay PATH         sample a recorded input log instead\n"
+                 "  --views N             camera positions sampled evenly along the path (default 8)\n"
+                 "  --repeats N           timed frames per view and configuration (default 5)\n"
+                 "  --max-tess LIST       comma separated max tess levels to sweep (default 8,16,32,64)\n"
+                 "  --range-scale LIST    comma separated multipliers of the default LOD bands (default 0.25,0.5,1,2)\n"
+                 "  --width W --height H  offscreen target size\n"
+                 "  --output PATH         write JSON here instead of stdout\n";
+}
+
+template <typename T, typename Parse>
+static std::vector<T> parse_list(const std::string &s, Parse &&parse)
+{
+    std::vector<T> values;
+    std::stringstream ss{s};
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            values.push_back(parse(item));
+    if (values.empty())
+        EXIT("Empty list " + s);
+    return values;
+}
+
+static EvalConfig parse_args(int argc, char **argv)
+{
+    EvalConfig config;
+    g_app.renderType = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                EXIT("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--heightmap")        g_app.heightmapPath = value();
+        else if (arg == "--shader-dir")  g_app.shaderDir = value();
+        else if (arg == "--camera-path") config.cameraPath = value();
+        else if (arg == "--replay")      config.replay = value();
+        else if (arg == "--views")       config.views = std::max(1u, static_cast<uint32_t>(std::stoul(value())));
+        else if (arg == "--repeats")     config.repeats = std::max(1u, static_cast<uint32_t>(std::stoul(value())));
+        else if (arg == "--max-tess")    config.maxTess = parse_list<int>(value(), [](const std::string &s) { return std::stoi(s); });
+        else if (arg == "--range-scale") config.rangeScales = parse_list<float>(value(), [](const std::string &s) { return std::stof(s); });
+        else if (arg == "--width")       g_app.viewerWidth = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--height")      g_app.viewerHeight = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--output")      config.output = value();
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            usage();
+            EXIT("Unknown argument " + arg);
+        }
+    }
+
+    return config;
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string out;
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void write_error(std::ostream &os, const char *name, const LodError &e)
+{
+    os << "\"" << name << "\": {\"mean\": " << e.mean << ", \"p95\": " << e.p95 << ", \"max\": " << e.max << "}";
+}
+
+static void write_json(std::ostream &os, const EvalConfig &config, const std::vector<LodResult> &results)
+{
+    os << "{\n";
+    os << "  \"renderer\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_RENDERER))) << "\",\n";
+    os << "  \"version\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_VERSION))) << "\",\n";
+    os << "  \"config\": {\n";
+    os << "    \"heightmap\": \"" << json_escape(g_app.heightmapPath) << "\",\n";
+    os << "    \"camera_path\": \"" << json_escape(config.cameraPath) << "\",\n";
+    os << "    \"replay\": \"" << json_escape(config.replay) << "\",\n";
+    os << "    \"width\": " << g_app.viewerWidth << ", \"height\": " << g_app.viewerHeight << ",\n";
+    os << "    \"views\": " << config.views << ", \"repeats\": " << config.repeats << ",\n";
+    os << "    \"reference_tess\": " << LodEvaluator::REFERENCE_TESS_LEVEL << ",\n";
+    os << "    \"pareto_error\": \"height.p95\"\n";
+    os << "  },\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const LodResult &r = results[i];
+        os << "    {\"max_tess\": " << r.maxTessLevel << ", \"range_scale\": " << r.rangeScale
+           << ", \"lod_ranges\": [" << r.lodRanges.x << ", " << r.lodRanges.y << ", " << r.lodRanges.z << ", " << r.lodRanges.w << "]"
+           << ", \"gpu_ms\": " << r.gpuMs << ", \"cpu_ms\": " << r.cpuMs
+           << ", \"triangles\": " << r.triangles << ", \"estimated_triangles\": " << r.estTriangles << ", ";
+        write_error(os, "depth", r.depth);
+        os << ", ";
+        write_error(os, "height", r.height);
+        os << ", \"coverage_mismatch\": " << r.coverageMismatch
+           << ", \"pareto_triangles\": " << (r.paretoTriangles ? "true" : "false")
+           << ", \"pareto_gpu\": " << (r.paretoGpu ? "true" : "false") << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char **argv)
+{
+    const EvalConfig config = parse_args(argc, argv);
+    std::vector<LodView> views;
+    if (config.replay.empty())
+        views = sampleLodViews(loadCameraPath(config.cameraPath), config.views);
+    else
+    {
+        InputLog log;
+        std::string error;
+        if (!loadInputLog(config.replay, log, error))
+            EXIT(error);
+        views = sampleLodViews(log, config.views);
+    }
+
+    HeadlessContext ctx = createHeadlessContext("terrain_eval");
+    LOG("terrain_eval on %s\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+    init();
+    setupFrameGraph();
+
+    LodEvaluator evaluator;
+    evaluator.init(g_app.viewerWidth, g_app.viewerHeight);
+    evaluator.captureReference(views);
+
+    std::vector<LodResult> results;
+    for (const int maxTess : config.maxTess)
+    {
+        for (const float scale : config.rangeScales)
+        {
+            const LodResult &result = results.emplace_back(evaluator.measure(views, maxTess, scale, config.repeats));
+            fprintf(stderr, "max_tess %3d  scale %5.2f  gpu %8.3f ms  tris %10.0f  height p95 %7.3f  depth p95 %8.3f  coverage %.4f\n",
+                    maxTess, scale, result.gpuMs, result.triangles, result.height.p95, result.depth.p95, result.coverageMismatch);
+        }
+    }
+
+    LodEvaluator::markPareto(results);
+
+    fprintf(stderr, "pareto front (triangles vs height p95):\n");
+    for (const LodResult &r : results)
+        if (r.paretoTriangles)
+            fprintf(stderr, "  max_tess %3d  scale %5.2f  tris %10.0f  height p95 %7.3f\n", r.maxTessLevel, r.rangeScale, r.triangles, r.height.p95);
+
+    if (config.output.empty())
+        write_json(std::cout, config, results);
+    else
+    {
+        std::ofstream ofs{config.output};
+        if (!ofs.is_open())
+            EXIT("Failed to open " + config.output);
+        write_json(ofs, config, results);
+    }
+
+    evaluator.release();
+    release();
+
+    destroyHeadlessContext(ctx);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Defines.hpp"
+#include "HeightFeed.hpp"
+#include "TerrainGenerator.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * @brief Test producer for a live height feed: a procedural terrain with a
+ * digger that moves around a circle, digging a pit and piling the spoil
+ * around it at every stop, so each frame changes one local region the way
+ * a sensor update would.
+ */
+struct FeedConfig
+{
+    std::string name = "/terrain_feed";
+    uint32_t width = 2048;
+    uint32_t height = 2048;
+    uint32_t slots = 3;
+    float rate = 10.0f;   // frames per second
+    uint32_t frames = 0;  // 0 = until interrupted
+    uint32_t seed = 7;
+    float radius = 48.0f; // digger radius in texels
+};
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void usage()
+{
+    std::cerr << "usage: terrain_feed [options]\n"
+                 "  --name NAME           shared memory object (default /terrain_feed), view it with --heightmap feed:NAME\n"
+                 "  --size WxH            frame size (default 2048x2048)\n"
+                 "  --slots N             ring slots (default 3)\n"
+                 "  --rate F              frames per second (default 10)\n"
+                 "  --frames N            stop after N frames, 0 = until interrupted\n"
+                 "  --seed N              procedural terrain seed (default 7)\n"
+                 "  --radius F            digger radius in texels (default 48)\n";
+}
+
+static FeedConfig parse_args(int argc, char **argv)
+{
+    FeedConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                EXIT("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--name")         config.name = value();
+        else if (arg == "--size")
+        {
+            const std::string size = value();
+            const size_t cross = size.find('x');
+            config.width = static_cast<uint32_t>(std::stoul(size.substr(0, cross)));
+            config.height = cross == std::string::npos ? config.width : static_cast<uint32_t>(std::stoul(size.substr(cross + 1)));
+        }
+        else if (arg == "--slots")   config.slots = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--rate")    config.rate = std::stof(value());
+        else if (arg == "--frames")  config.frames = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--seed")    config.seed = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--radius")  config.radius = std::stof(value());
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            usage();
+            EXIT("Unknown argument " + arg);
+        }
+    }
+    if (config.rate <= 0.0f)
+        EXIT("--rate must be positive");
+    return config;
+}
+
+// pit of depth at center, spoil ring around it, both cumulative on terrain
+static void dig(std::vector<uint8_t> &terrain, uint32_t width, uint32_t height, float cx, float cy, float radius)
+{
+    const int32_t reach = static_cast<int32_t>(std::ceil(radius * 1.5f));
+    const int32_t x0 = std::max(static_cast<int32_t>(cx) - reach, 0), x1 = std::min(static_cast<int32_t>(cx) + reach, static_cast<int32_t>(width) - 1);
+    const int32_t y0 = std::max(static_cast<int32_t>(cy) - reach, 0), y1 = std::min(static_cast<int32_t>(cy) + reach, static_cast<int32_t>(height) - 1);
+    for (int32_t y = y0; y <= y1; ++y)
+        for (int32_t x = x0; x <= x1; ++x)
+        {
+            const float d = std::sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy)) / radius;
+            int32_t delta = 0;
+            if (d < 1.0f)
+                delta = -static_cast<int32_t>(std::lround(3.0f * (1.0f - d * d)));
+            else if (d < 1.5f)
+                delta = static_cast<int32_t>(std::lround(2.0f * std::sin((d - 1.0f) * 6.2831853f)));
+            uint8_t &texel = terrain[static_cast<size_t>(y) * width + x];
+            texel = static_cast<uint8_t>(std::clamp(static_cast<int32_t>(texel) + delta, 0, 255));
+        }
+}
+
+int main(int argc, char **argv)
+{
+    const FeedConfig config = parse_args(argc, argv);
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+    std::signal(SIGTERM, [](int) { g_stop = 1; });
+
+    WorkerPool pool;
+    pool.init();
+    TerrainGenerator generator;
+    NoiseSettings noise;
+    noise.seed = config.seed;
+    generator.init(noise, &pool);
+    Heightmap terrain = generator.heightmap(0, 0, config.width, config.height);
+    generator.release();
+    pool.release();
+
+    HeightFeedWriter writer;
+    writer.create(config.name, config.width, config.height, config.slots);
+    LOG("terrain_feed: %ux%u into %s, %u slots at %.1f Hz\n", config.width, config.height, config.name.c_str(), config.slots, config.rate);
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / config.rate));
+    auto tick = std::chrono::steady_clock::now();
+    double writeMs = 0.0;
+    for (uint32_t frame = 0; !g_stop && (config.frames == 0 || frame < config.frames); ++frame)
+    {
+        // the digger advances a radius per frame along a circle around the middle
+        const float orbit = 0.3f * static_cast<float>(std::min(config.width, config.height));
+        const float angle = static_cast<float>(frame) * config.radius / orbit;
+        if (frame > 0)
+            dig(terrain.texels, config.width, config.height, 0.5f * config.width + orbit * std::cos(angle),
+                0.5f * config.height + orbit * std::sin(angle), config.radius);
+
+        const auto start = std::chrono::steady_clock::now();
+        memcpy(writer.beginFrame(), terrain.texels.data(), terrain.texels.size());
+        writer.publish();
+        writeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if ((frame + 1) % static_cast<uint32_t>(std::max(config.rate, 1.0f)) == 0)
+        {
+            LOG("frame %llu, %.2f ms per write\n", static_cast<unsigned long long>(writer.frame()), writeMs / (frame + 1));
+        }
+
+        tick += period;
+        std::this_thread::sleep_until(tick);
+    }
+
+    writer.release();
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Defines.hpp"
+#include "GlCapture.hpp"
+#include "HeadlessContext.hpp"
+#include "Helpers.hpp"
+
+struct ReplayConfig
+{
+    std::string capture;
+    std::string output; // empty = stdout
+    uint32_t loops = 1;    // times the measured range is replayed
+    bool finish = false;   // glFinish after every measured frame, times include the GPU
+    bool perCall = false;  // CPU time per entry point
+};
+
+struct Summary
+{
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+static void usage()
+{
+    std::cerr << "usage: terrain_glreplay CAPTURE [options]\n"
+                 "  --loops N             replay the measured frames N times (default 1)\n"
+                 "  --finish              glFinish after every frame, times then include GPU execution\n"
+                 "  --per-call            CPU time per GL entry point (adds a clock read around every call)\n"
+                 "  --output PATH         write JSON here instead of stdout\n";
+}
+
+static ReplayConfig parse_args(int argc, char **argv)
+{
+    ReplayConfig config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                EXIT("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--loops")         config.loops = std::max(1u, static_cast<uint32_t>(std::stoul(value())));
+        else if (arg == "--finish")   config.finish = true;
+        else if (arg == "--per-call") config.perCall = true;
+        else if (arg == "--output")   config.output = value();
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            exit(EXIT_SUCCESS);
+        }
+        else if (arg[0] != '-' && config.capture.empty())
+            config.capture = arg;
+        else
+        {
+            usage();
+            EXIT("Unknown argument " + arg);
+        }
+    }
+
+    if (config.capture.empty())
+    {
+        usage();
+        EXIT("No capture given");
+    }
+    return config;
+}
+
+static Summary summarize(std::vector<double> values)
+{
+    Summary summary;
+    if (values.empty())
+        return summary;
+
+    std::sort(values.begin(), values.end());
+    summary.mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    summary.min = values.front();
+    summary.p50 = values[values.size() / 2];
+    summary.p95 = values[static_cast<size_t>(0.95 * static_cast<double>(values.size() - 1))];
+    summary.max = values.back();
+    return summary;
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string out;
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void write_json(std::ostream &os, const ReplayConfig &config, const GlCaptureFile &capture, const GlReplayer &replayer,
+                       const std::vector<double> &frameMs, double setupMs)
+{
+    const Summary s = summarize(frameMs);
+
+    os << "{\n";
+    os << "  \"renderer\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_RENDERER))) << "\",\n";
+    os << "  \"version\": \"" << json_escape(reinterpret_cast<const char *>(glGetString(GL_VERSION))) << "\",\n";
+    os << "  \"capture\": {\"path\": \"" << json_escape(config.capture) << "\", \"renderer\": \"" << json_escape(capture.renderer)
+       << "\", \"version\": \"" << json_escape(capture.version) << "\", \"width\": " << capture.width << ", \"height\": " << capture.height
+       << ", \"setup_frames\": " << capture.firstFrame << ", \"frames\": " << capture.frames - capture.firstFrame << "},\n";
+    os << "  \"config\": {\"loops\": " << config.loops << ", \"finish\": " << (config.finish ? "true" : "false")
+       << ", \"per_call\": " << (config.perCall ? "true" : "false") << "},\n";
+    os << "  \"setup_ms\": " << setupMs << ",\n";
+    os << "  \"frame_ms\": {\"mean\": " << s.mean << ", \"min\": " << s.min << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+       << ", \"max\": " << s.max << "},\n";
+    os << "  \"frames\": [";
+    for (size_t i = 0; i < frameMs.size(); ++i)
+        os << (i ? ", " : "") << frameMs[i];
+    os << "],\n";
+
+    // per entry point over the measured frames, most expensive first when timed
+    std::vector<size_t> order;
+    for (size_t i = 0; i < static_cast<size_t>(GlCall::Count); ++i)
+        if (replayer.calls[i].count > 0)
+            order.push_back(i);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return replayer.calls[a].nanos != replayer.calls[b].nanos ? replayer.calls[a].nanos > replayer.calls[b].nanos
+                                                                  : replayer.calls[a].count > replayer.calls[b].count;
+    });
+
+    os << "  \"calls\": [\n";
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const GlReplayer::CallStats &stats = replayer.calls[order[i]];
+        os << "    {\"name\": \"" << glCallName(static_cast<GlCall>(order[i])) << "\", \"count\": " << stats.count;
+        if (config.perCall)
+            os << ", \"ms\": " << stats.nanos * 1e-6 << ", \"ns_per_call\": " << static_cast<double>(stats.nanos) / stats.count;
+        os << "}" << (i + 1 < order.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char **argv)
+{
+    const ReplayConfig config = parse_args(argc, argv);
+    const GlCaptureFile capture = loadGlCapture(config.capture);
+    if (capture.frames <= capture.firstFrame)
+        EXIT("Capture " + config.capture + " holds no measured frames");
+
+    HeadlessContext ctx = createHeadlessContext("terrain_glreplay");
+    LOG("terrain_glreplay on %s, captured on %s\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)), capture.renderer.c_str());
+
+    // stands in for the default framebuffer of the recording
+    OffscreenTarget target = createOffscreenTarget(std::max(capture.width, 1u), std::max(capture.height, 1u));
+
+    GlReplayer replayer;
+    replayer.begin(capture, target.fbo);
+
+    // setup (init, shader compilation, warmup frames) runs untimed
+    const auto setupStart = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < capture.firstFrame; ++frame)
+        if (!replayer.replayFrame())
+            EXIT("Capture ended during setup");
+    glFinish();
+    const double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+
+    for (GlReplayer::CallStats &stats : replayer.calls)
+        stats = {};
+    replayer.timeCalls = config.perCall;
+
+    const size_t rangeStart = replayer.position();
+    std::vector<double> frameMs;
+    frameMs.reserve(static_cast<size_t>(config.loops) * (capture.frames - capture.firstFrame));
+
+    for (uint32_t loop = 0; loop < config.loops; ++loop)
+    {
+        replayer.seek(rangeStart);
+        for (uint32_t frame = capture.firstFrame; frame < capture.frames; ++frame)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            replayer.replayFrame();
+            if (config.finish)
+                glFinish();
+            frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+    glFinish();
+
+    const Summary s = summarize(frameMs);
+    fprintf(stderr, "%zu frames, %s mean %.3f ms, p50 %.3f ms, p95 %.3f ms (setup %.1f ms)\n", frameMs.size(),
+            config.finish ? "frame" : "issue", s.mean, s.p50, s.p95, setupMs);
+
+    if (config.output.empty())
+        write_json(std::cout, config, capture, replayer, frameMs, setupMs);
+    else
+    {
+        std::ofstream ofs{config.output};
+        if (!ofs.is_open())
+            EXIT("Failed to open " + config.output);
+        write_json(ofs, config, capture, replayer, frameMs, setupMs);
+    }
+
+    destroyOffscreenTarget(target);
+    destroyHeadlessContext(ctx);
+    return 0;
+}
@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CollisionMesh.hpp"
+#include "Defines.hpp"
+#include "HeightField.hpp"
+#include "Heightmap.hpp"
+#include "HorizonMap.hpp"
+#include "PatchGrid.hpp"
+#include "TerrainGenerator.hpp"
+#include "TerrainMaps.hpp"
+#include "TerrainRay.hpp"
+#include "Visibility.hpp"
+#include "WorkerPool.hpp"
+
+// texels covered by one patch edge when the grid scales with the heightmap
+constexpr uint32_t TEXELS_PER_PATCH = 64;
+
+struct MicroConfig
+{
+    std::vector<uint32_t> sizes = {1024, 2048, 4096, 8192, 16384, 32768};
+    std::vector<size_t> threads; // empty = 1 and hardware_concurrency
+    double minSeconds = 0.25;
+    uint32_t minReps = 3;
+    size_t queries = 1u << 20;
+    size_t rays = 1u << 14;
+    std::string tmpDir = "/tmp";
+    std::string image; // optional real image, decoded once at its own size
+    std::string output; // empty = stdout
+    bool csv = false;
+    bool pin = true;
+    uint32_t seed = 1;
+};
+
+struct Result
+{
+    std::string kernel;
+    uint32_t size;
+    size_t threads;
+    uint32_t reps;
+    double minMs;
+    double medianMs;
+    double items; // per rep
+    const char *unit;
+};
+
+static void usage()
+{
+    std::cerr << "usage: terrain_microbench [options]\n"
+                 "  --sizes A,B,...     heightmap edge lengths (default 1024..32768, sizes that do not fit in memory are skipped)\n"
+                 "  --threads A,B,...   thread counts (default 1 and hardware concurrency)\n"
+                 "  --min-time S        minimum seconds per measurement\n"
+                 "  --min-reps N        minimum repetitions per measurement\n"
+                 "  --queries N         height queries per repetition\n"
+                 "  --rays N            ray casts per repetition, the naive march reference runs a 64th of them\n"
+                 "  --tmp DIR           where the synthetic heightmap files go\n"
+                 "  --image PATH        also time stb_image on a real file\n"
+                 "  --no-pin            leave threads unpinned\n"
+                 "  --csv               CSV instead of JSON\n"
+                 "  --output PATH       write results here instead of stdout\n";
+}
+
+template <typename T>
+static std::vector<T> parse_list(const std::string &s)
+{
+    std::vector<T> values;
+    std::stringstream ss{s};
+    std::string item;
+    while (std::getline(ss, item, ','))
+        values.push_back(static_cast<T>(std::stoull(item)));
+    return values;
+}
+
+static MicroConfig parse_args(int argc, char **argv)
+{
+    MicroConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                EXIT("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--sizes")          config.sizes = parse_list<uint32_t>(value());
+        else if (arg == "--threads")   config.threads = parse_list<size_t>(value());
+        else if (arg == "--min-time")  config.minSeconds = std::stod(value());
+        else if (arg == "--min-reps")  config.minReps = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--queries")   config.queries = std::stoull(value());
+        else if (arg == "--rays")      config.rays = std::max<size_t>(std::stoull(value()), 64u);
+        else if (arg == "--tmp")       config.tmpDir = value();
+        else if (arg == "--image")     config.image = value();
+        else if (arg == "--no-pin")    config.pin = false;
+        else if (arg == "--csv")       config.csv = true;
+        else if (arg == "--output")    config.output = value();
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            usage();
+            EXIT("Unknown argument " + arg);
+        }
+    }
+
+    if (config.threads.empty())
+    {
+        config.threads = {1u, std::max<size_t>(std::thread::hardware_concurrency(), 1u)};
+        config.threads.erase(std::unique(config.threads.begin(), config.threads.end()), config.threads.end());
+    }
+    return config;
+}
+
+// keeps results alive so the optimizer cannot drop the work
+static volatile uint64_t g_sink = 0;
+
+template <typename Fn>
+static Result measure(const MicroConfig &config, const char *kernel, uint32_t size, size_t threads, double items, const char *unit, Fn &&fn)
+{
+    std::vector<double> times;
+    double total = 0.0;
+    while (times.size() < config.minReps || total < config.minSeconds)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(ms);
+        total += ms * 1e-3;
+    }
+
+    std::sort(times.begin(), times.end());
+    Result result{kernel, size, threads, static_cast<uint32_t>(times.size()), times.front(), times[times.size() / 2], items, unit};
+    std::cerr << kernel << " " << size << "^2 x" << threads << ": " << result.medianMs << " ms, "
+              << items / (result.medianMs * 1e-3) * 1e-6 << " M" << unit << "/s\n";
+    return result;
+}
+
+static void write_pgm(const std::string &filepath, const Heightmap &heightmap)
+{
+    std::ofstream ofs{filepath, std::ios::out | std::ios::binary};
+    if (!ofs.is_open())
+        EXIT("Failed to open " + filepath);
+
+    // stb_image flips on load, so write top-down to get the same rows back
+    ofs << "P5\n" << heightmap.width << " " << heightmap.height << "\n255\n";
+    for (uint32_t y = heightmap.height; y-- > 0;)
+        ofs.write(reinterpret_cast<const char *>(&heightmap.texels[static_cast<size_t>(y) * heightmap.width]), heightmap.width);
+    if (!ofs)
+        EXIT("Failed to write " + filepath);
+}
+
+static size_t available_memory()
+{
+    return static_cast<size_t>(sysconf(_SC_AVPHYS_PAGES)) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static void run_size(const MicroConfig &config, uint32_t size, std::vector<Result> &results)
+{
+    const double texels = static_cast<double>(size) * size;
+    const size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1u);
+
+    WorkerPool generator;
+    generator.init(hardware - 1);
+    const Heightmap heightmap = makeSyntheticHeightmap(size, size, config.seed, hardware > 1 ? &generator : nullptr);
+    generator.release();
+
+    const std::string base = config.tmpDir + "/terrain_microbench_" + std::to_string(size);
+    write_pgm(base + ".pgm", heightmap);
+    saveRawHeightmap(base + ".thm", heightmap);
+
+    // -- serial kernels --
+    results.push_back(measure(config, "decode_stbi", size, 1, texels, "texels", [&] {
+        const Heightmap decoded = decodeHeightmap(base + ".pgm");
+        g_sink = g_sink + decoded.texels[decoded.texels.size() / 2];
+    }));
+    results.push_back(measure(config, "decode_read", size, 1, texels, "texels", [&] {
+        const Heightmap decoded = readRawHeightmap(base + ".thm");
+        g_sink = g_sink + decoded.texels[decoded.texels.size() / 2];
+    }));
+    results.push_back(measure(config, "decode_mmap", size, 1, texels, "texels", [&] {
+        MappedHeightmap mapped = mapRawHeightmap(base + ".thm");
+        // touch every page so the mapping cost is paid here, as the first upload would
+        uint64_t sum = 0;
+        const size_t bytes = static_cast<size_t>(mapped.width) * mapped.height;
+        for (size_t i = 0; i < bytes; i += 4096)
+            sum += mapped.texels[i];
+        g_sink = g_sink + sum;
+        mapped.release();
+    }));
+
+    const uint32_t resolution = std::max(size / TEXELS_PER_PATCH, 1u);
+    const double patches = static_cast<double>(resolution) * resolution;
+    results.push_back(measure(config, "patch_grid", size, 1, patches, "patches", [&] {
+        const std::vector<float> grid = buildPatchGrid(static_cast<float>(size), static_cast<float>(size), resolution);
+        g_sink = g_sink + grid.size();
+    }));
+
+    const std::vector<float> grid = buildPatchGrid(static_cast<float>(size), static_cast<float>(size), resolution);
+    const std::vector<MinMaxLevel> pyramid = buildMinMaxPyramid(heightmap.data(), size, size);
+    results.push_back(measure(config, "patch_bounds", size, 1, patches, "patches", [&] {
+        const std::vector<PatchBounds> bounds = buildPatchBounds(grid, pyramid, size, size);
+        g_sink = g_sink + bounds.size();
+    }));
+
+    const std::vector<PatchBounds> bounds = buildPatchBounds(grid, pyramid, size, size);
+
+    // camera on the terrain edge looking across it, roughly half the patches in view
+    const float extent = static_cast<float>(size);
+    const glm::mat4 view = glm::lookAt(glm::vec3{-0.5f * extent, 200.0f, 0.0f}, glm::vec3{0.0f, 0.0f, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 900.0f / 700.0f, 0.1f, 2.0f * extent);
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<float> us(config.queries), vs(config.queries);
+    std::mt19937 rng{config.seed};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+    for (size_t i = 0; i < config.queries; ++i)
+    {
+        us[i] = uniform(rng);
+        vs[i] = uniform(rng);
+    }
+
+    // batched queries must agree with the scalar reference bit for bit
+    HeightField field = makeHeightField(Heightmap{heightmap}, glm::vec2{-0.5f * extent}, glm::vec2{extent});
+    std::vector<float> heights(config.queries), reference(config.queries);
+    sampleHeightsScalar(field, us.data(), vs.data(), reference.data(), config.queries);
+    field.sample(us.data(), vs.data(), heights.data(), config.queries);
+    if (heights != reference)
+        EXIT("Batched height queries differ from the scalar reference");
+
+    // grazing rays from above the terrain in every direction, 2 to 30 degrees down, most travel far before they hit
+    std::vector<glm::vec3> rayOrigins(config.rays), rayDirections(config.rays);
+    std::uniform_real_distribution<float> angle{0.0f, 1.0f};
+    for (size_t i = 0; i < config.rays; ++i)
+    {
+        const float yaw = glm::radians(360.0f * angle(rng));
+        const float pitch = glm::radians(2.0f + 28.0f * angle(rng));
+        rayOrigins[i] = glm::vec3{(uniform(rng) - 0.5f) * extent, 60.0f, (uniform(rng) - 0.5f) * extent};
+        rayDirections[i] = glm::vec3{std::cos(yaw) * std::cos(pitch), -std::sin(pitch), std::sin(yaw) * std::cos(pitch)};
+    }
+    std::vector<RayHit> rayHits(config.rays);
+
+    // observer / target pairs up to 512 texels apart, 2 units above the ground
+    std::vector<glm::vec3> losObservers(config.rays), losTargets(config.rays);
+    std::vector<uint8_t> losVisible(config.rays);
+    for (size_t i = 0; i < config.rays; ++i)
+    {
+        const glm::vec2 a{uniform(rng), uniform(rng)};
+        const glm::vec2 b{std::clamp(a.x + (uniform(rng) - 0.5f) * 1024.0f / extent, 0.0f, 1.0f),
+                          std::clamp(a.y + (uniform(rng) - 0.5f) * 1024.0f / extent, 0.0f, 1.0f)};
+        losObservers[i] = glm::vec3{(a.x - 0.5f) * extent, field.sample(a.x, a.y) + 2.0f, (a.y - 0.5f) * extent};
+        losTargets[i] = glm::vec3{(b.x - 0.5f) * extent, field.sample(b.x, b.y) + 2.0f, (b.y - 0.5f) * extent};
+    }
+
+    ViewshedSettings viewshedSettings;
+    viewshedSettings.radius = std::min(0.25f * extent, 2048.0f);
+
+    // collision tiles over up to 1024^2 texels in the middle of the field, at the lod a physics engine near the camera would ask for
+    const CollisionMeshSettings collisionSettings;
+    const glm::uvec2 collisionTiles = collisionTileCount(field, collisionSettings.tileSize);
+    const uint32_t collisionSpan = std::min(std::min(collisionTiles.x, collisionTiles.y), 1024u / collisionSettings.tileSize);
+    const uint32_t collisionFirst = (std::min(collisionTiles.x, collisionTiles.y) - collisionSpan) / 2;
+    const size_t collisionCount = static_cast<size_t>(collisionSpan) * collisionSpan;
+    const uint32_t collisionLod = 3;
+    {
+        size_t triangles = 0;
+        float maxError = 0.0f;
+        for (size_t i = 0; i < collisionCount; ++i)
+        {
+            const CollisionMesh mesh = buildCollisionMesh(
+                field, {collisionFirst + static_cast<uint32_t>(i % collisionSpan), collisionFirst + static_cast<uint32_t>(i / collisionSpan), collisionLod},
+                collisionSettings);
+            triangles += mesh.triangleCount();
+            maxError = std::max(maxError, mesh.maxError);
+        }
+        const double full = 2.0 * collisionCount * collisionSettings.tileSize * collisionSettings.tileSize;
+        std::cerr << "collision_mesh lod " << collisionLod << ": " << triangles << " triangles (" << 100.0 * triangles / full
+                  << "% of full resolution), max error " << maxError << "\n";
+    }
+
+    // -- kernels that scale with threads --
+    for (const size_t threads : config.threads)
+    {
+        WorkerPool pool;
+        WorkerPool *p = nullptr;
+        if (threads > 1)
+        {
+            pool.init(threads - 1, config.pin);
+            p = &pool;
+        }
+        if (config.pin)
+            WorkerPool::pinCurrentThread(0);
+
+        results.push_back(measure(config, "mip_chain", size, threads, texels, "texels", [&] {
+            const std::vector<HeightLevel> mips = buildMipChain(heightmap.data(), size, size, p);
+            g_sink = g_sink + mips.back().texels[0];
+        }));
+
+        results.push_back(measure(config, "minmax_pyramid", size, threads, texels, "texels", [&] {
+            const std::vector<MinMaxLevel> levels = buildMinMaxPyramid(heightmap.data(), size, size, p);
+            g_sink = g_sink + levels.back().max.at(0u, 0u);
+        }));
+
+        std::vector<std::vector<uint32_t>> visible(threads);
+        results.push_back(measure(config, "frustum_cull", size, threads, patches, "patches", [&] {
+            const auto cull = [&](size_t begin, size_t end, size_t worker) {
+                for (size_t i = begin; i < end; ++i)
+                    if (frustum.intersects(bounds[i]))
+                        visible[worker].push_back(static_cast<uint32_t>(i));
+            };
+            for (std::vector<uint32_t> &list : visible)
+                list.clear();
+            if (p)
+                p->parallelFor(bounds.size(), 1024u, cull);
+            else
+                cull(0u, bounds.size(), 0u);
+            g_sink = g_sink + visible[0].size();
+        }));
+
+        results.push_back(measure(config, "height_query", size, threads, static_cast<double>(config.queries), "queries", [&] {
+            std::vector<float> sums(threads, 0.0f);
+            const auto query = [&](size_t begin, size_t end, size_t worker) {
+                float sum = 0.0f;
+                for (size_t i = begin; i < end; ++i)
+                    sum += heightmap.sample(us[i], vs[i]);
+                sums[worker] += sum;
+            };
+            if (p)
+                p->parallelFor(config.queries, 4096u, query);
+            else
+                query(0u, config.queries, 0u);
+            g_sink = g_sink + static_cast<uint64_t>(sums[0]);
+        }));
+
+        using BatchKernel = void (*)(const HeightField &, const float *, const float *, float *, size_t);
+        const auto batch = [&](BatchKernel kernel) {
+            return [&, kernel] {
+                const auto query = [&](size_t begin, size_t end, size_t) {
+                    kernel(field, us.data() + begin, vs.data() + begin, heights.data() + begin, end - begin);
+                };
+                if (p)
+                    p->parallelFor(config.queries, 4096u, query);
+                else
+                    query(0u, config.queries, 0u);
+                g_sink = g_sink + static_cast<uint64_t>(heights[config.queries / 2]);
+            };
+        };
+        results.push_back(measure(config, "height_batch_scalar", size, threads, static_cast<double>(config.queries), "queries",
+                                  batch(sampleHeightsScalar)));
+        if (cpuHasAvx2())
+            results.push_back(measure(config, "height_batch_avx2", size, threads, static_cast<double>(config.queries), "queries",
+                                      batch(sampleHeightsAvx2)));
+
+        results.push_back(measure(config, "ray_cast", size, threads, static_cast<double>(config.rays), "rays", [&] {
+            raycastHeightField(field, rayOrigins.data(), rayDirections.data(), config.rays, FLT_MAX, rayHits.data(), p);
+            g_sink = g_sink + static_cast<uint64_t>(rayHits[config.rays / 2].t);
+        }));
+
+        const size_t marched = config.rays / 64;
+        results.push_back(measure(config, "ray_march", size, threads, static_cast<double>(marched), "rays", [&] {
+            const auto march = [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; ++i)
+                    rayHits[i] = marchHeightField(field, rayOrigins[i], rayDirections[i]);
+            };
+            if (p)
+                p->parallelFor(marched, 1u, march);
+            else
+                march(0u, marched, 0u);
+            g_sink = g_sink + static_cast<uint64_t>(rayHits[marched / 2].t);
+        }));
+
+        results.push_back(measure(config, "line_of_sight", size, threads, static_cast<double>(config.rays), "queries", [&] {
+            lineOfSight(field, losObservers.data(), losTargets.data(), config.rays, losVisible.data(), p);
+            g_sink = g_sink + losVisible[config.rays / 2];
+        }));
+
+        const double viewshedTexels = std::pow(2.0 * std::ceil(viewshedSettings.radius) + 1.0, 2.0);
+        results.push_back(measure(config, "viewshed", size, threads, viewshedTexels, "texels", [&] {
+            const Viewshed viewshed = computeViewshed(field, viewshedSettings, p);
+            g_sink = g_sink + viewshed.visible[viewshed.visible.size() / 2];
+        }));
+
+        const double collisionTexels = static_cast<double>(collisionCount) * collisionSettings.tileSize * collisionSettings.tileSize;
+        results.push_back(measure(config, "collision_mesh", size, threads, collisionTexels, "texels", [&] {
+            std::vector<size_t> triangles(threads, 0u);
+            const auto build = [&](size_t begin, size_t end, size_t worker) {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const CollisionTileKey key{collisionFirst + static_cast<uint32_t>(i % collisionSpan),
+                                               collisionFirst + static_cast<uint32_t>(i / collisionSpan), collisionLod};
+                    triangles[worker] += buildCollisionMesh(field, key, collisionSettings).triangleCount();
+                }
+            };
+            if (p)
+                p->parallelFor(collisionCount, 1u, build);
+            else
+                build(0u, collisionCount, 0u);
+            g_sink = g_sink + triangles[0];
+        }));
+
+        // full pyramid, the scalar rows against the AVX2 ones where the CPU has them
+        for (const bool simd : {false, true})
+        {
+            TerrainMapSettings mapSettings;
+            mapSettings.simd = simd;
+            results.push_back(measure(config, simd ? "terrain_maps_simd" : "terrain_maps_scalar", size, threads, texels, "texels", [&] {
+                const TerrainMaps maps = buildTerrainMaps(field, mapSettings, p);
+                g_sink = g_sink + maps.levels.back().surface[0];
+            }));
+        }
+
+        for (const bool simd : {false, true})
+        {
+            HorizonSettings horizonSettings;
+            horizonSettings.simd = simd;
+            results.push_back(measure(config, simd ? "horizon_map_simd" : "horizon_map_scalar", size, threads, texels, "texels", [&] {
+                const HorizonMap map = buildHorizonMap(field, horizonSettings, p);
+                g_sink = g_sink + map.planes[0][map.planes[0].size() / 2];
+            }));
+        }
+
+        // a cold generator makes every tile of the window, a warm one only copies them out of its cache
+        for (const bool simd : {false, true})
+        {
+            NoiseSettings noise;
+            noise.simd = simd;
+            results.push_back(measure(config, simd ? "procedural_simd" : "procedural_scalar", size, threads, texels, "texels", [&] {
+                TerrainGenerator generator;
+                generator.init(noise, p);
+                const Heightmap generated = generator.heightmap(0, 0, size, size);
+                g_sink = g_sink + generated.texels[generated.texels.size() / 2];
+            }));
+        }
+
+        TerrainGenerator warm;
+        warm.init(NoiseSettings{}, p, static_cast<size_t>(size + GeneratedTile::SIZE) * (size + GeneratedTile::SIZE));
+        warm.heightmap(0, 0, size, size);
+        results.push_back(measure(config, "procedural_cached", size, threads, texels, "texels", [&] {
+            const Heightmap generated = warm.heightmap(0, 0, size, size);
+            g_sink = g_sink + generated.texels[generated.texels.size() / 2];
+        }));
+
+        pool.release();
+    }
+
+    std::remove((base + ".pgm").c_str());
+    std::remove((base + ".thm").c_str());
+}
+
+static void write_json(std::ostream &os, const MicroConfig &config, const std::vector<Result> &results, const std::vector<uint32_t> &skipped)
+{
+    os << "{\n";
+    os << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    os << "  \"pinned\": " << (config.pin ? "true" : "false") << ",\n";
+    os << "  \"skipped_sizes\": [";
+    for (size_t i = 0; i < skipped.size(); ++i)
+        os << (i ? ", " : "") << skipped[i];
+    os << "],\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        os << "    {\"kernel\": \"" << r.kernel << "\", \"size\": " << r.size << ", \"threads\": " << r.threads
+           << ", \"reps\": " << r.reps << ", \"min_ms\": " << r.minMs << ", \"median_ms\": " << r.medianMs
+           << ", \"items\": " << r.items << ", \"unit\": \"" << r.unit << "\", \"throughput_per_s\": " << r.items / (r.medianMs * 1e-3)
+           << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+static void write_csv(std::ostream &os, const std::vector<Result> &results)
+{
+    os << "kernel,size,threads,reps,min_ms,median_ms,items,unit,throughput_per_s\n";
+    for (const Result &r : results)
+        os << r.kernel << "," << r.size << "," << r.threads << "," << r.reps << "," << r.minMs << "," << r.medianMs << ","
+           << r.items << "," << r.unit << "," << r.items / (r.medianMs * 1e-3) << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    const MicroConfig config = parse_args(argc, argv);
+
+    std::vector<Result> results;
+    std::vector<uint32_t> skipped;
+
+    if (!config.image.empty())
+    {
+        const Heightmap probe = decodeHeightmap(config.image);
+        results.push_back(measure(config, "decode_stbi_image", probe.width, 1, static_cast<double>(probe.width) * probe.height, "texels", [&] {
+            const Heightmap decoded = decodeHeightmap(config.image);
+            g_sink = g_sink + decoded.texels[0];
+        }));
+    }
+
+    for (const uint32_t size : config.sizes)
+    {
+        // heightmap, a decoded copy, mips and min/max levels live at the same time
+        const size_t needed = static_cast<size_t>(size) * size * 4u;
+        if (needed > available_memory())
+        {
+            std::cerr << "skipping " << size << "^2, needs ~" << (needed >> 20) << " MB\n";
+            skipped.push_back(size);
+            continue;
+        }
+        run_size(config, size, results);
+    }
+
+    if (config.output.empty())
+    {
+        if (config.csv)
+            write_csv(std::cout, results);
+        else
+            write_json(std::cout, config, results, skipped);
+    }
+    else
+    {
+        std::ofstream ofs{config.output};
+        if (!ofs.is_open())
+            EXIT("Failed to open " + config.output);
+        if (config.csv)
+            write_csv(ofs, results);
+        else
+            write_json(ofs, config, results, skipped);
+    }
+
+    return 0;
+}